@@ -58,7 +58,26 @@ namespace GL
 			: m_Program(program),
 			  m_Name(name)
 		{
-			m_Location = program->getAttribLocation(name);
+			m_Location = program->attribLocation(name);
+		}
+
+		/**
+		 * Constructor.
+		 * Location of the attribute is taken from the reflection table of the program without calling OpenGL.
+		 * @param program Pointer to the program.
+		 * @param hash Hash of the name of the attribute.
+		 * @see GL::Program::findAttribute.
+		 */
+		inline Attrib(const GL::ProgramPtr & program, GL::NameHash hash)
+			: m_Program(program),
+			  m_Location(-1)
+		{
+			const Program::Variable * variable = program->findAttribute(hash);
+			if (LIKELY(variable))
+			{
+				m_Name = variable->name;
+				m_Location = variable->location;
+			}
 		}
 
 		/** Destructor. */
@@ -0,0 +1,486 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "gl_binary_model.h"
+#include "gl_resource_manager.h"
+#include <yip-imports/cxx-util/macros.h>
+#include <sstream>
+#include <vector>
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+
+#if defined(_WIN32)
+ #define WIN32_LEAN_AND_MEAN
+ #include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+ #include <sys/types.h>
+ #include <sys/stat.h>
+ #include <sys/mman.h>
+ #include <fcntl.h>
+ #include <unistd.h>
+ #define USE_MMAP
+#endif
+
+namespace
+{
+	/** Read-only memory mapping of the whole file. */
+	class MappedFile
+	{
+	public:
+		inline MappedFile() : m_Data(nullptr), m_Size(0) {}
+		~MappedFile();
+
+		bool open(const std::string & path);
+
+		inline const char * data() const { return m_Data; }
+		inline size_t size() const { return m_Size; }
+
+	private:
+		const char * m_Data;
+		size_t m_Size;
+
+		MappedFile(const MappedFile &);
+		MappedFile & operator=(const MappedFile &);
+	};
+
+	MappedFile::~MappedFile()
+	{
+		if (!m_Data)
+			return;
+
+	  #if defined(_WIN32)
+		UnmapViewOfFile(m_Data);
+	  #elif defined(USE_MMAP)
+		munmap(const_cast<char *>(m_Data), m_Size);
+	  #endif
+	}
+
+	bool MappedFile::open(const std::string & path)
+	{
+	  #if defined(_WIN32)
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0 || size.QuadPart > LONGLONG(SIZE_MAX))
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		CloseHandle(file);
+		if (!mapping)
+			return false;
+
+		void * data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping);
+		if (!data)
+			return false;
+
+		m_Data = reinterpret_cast<const char *>(data);
+		m_Size = size_t(size.QuadPart);
+		return true;
+	  #elif defined(USE_MMAP)
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		struct stat st;
+		if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0)
+		{
+			::close(fd);
+			return false;
+		}
+
+		void * data = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (data == MAP_FAILED)
+			return false;
+
+		m_Data = reinterpret_cast<const char *>(data);
+		m_Size = size_t(st.st_size);
+		return true;
+	  #else
+		(void)path;
+		return false;
+	  #endif
+	}
+
+	std::string pathInDirectory(const std::string & directory, const std::string & filename)
+	{
+		char last = directory[directory.length() - 1];
+		if (last == '/' || last == '\\')
+			return directory + filename;
+		return directory + '/' + filename;
+	}
+
+	inline bool isValidRange(uint32_t offset, uint64_t size, size_t fileSize)
+	{
+		return uint64_t(offset) + size <= uint64_t(fileSize);
+	}
+
+	inline uint32_t alignTo(uint32_t offset, uint32_t alignment)
+	{
+		return (offset + alignment - 1) & ~(alignment - 1);
+	}
+
+	template <class TYPE> void narrowIndices(const std::vector<GL::UInt> & indices, std::string & out)
+	{
+		out.resize(indices.size() * sizeof(TYPE));
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			TYPE value = static_cast<TYPE>(indices[i]);
+			memcpy(&out[i * sizeof(TYPE)], &value, sizeof(TYPE));
+		}
+	}
+}
+
+GL::BinaryModel::BinaryModel(ResourceManager * resMgr, ::Resource::Loader & loader, const std::string & filename,
+		const std::string & directory)
+	: Model(resMgr, filename),
+	  m_Flags(0),
+	  m_MemoryMapped(false)
+{
+	// Files are mapped only from the explicitly specified directory. Otherwise unrelated files in the current
+	// directory could shadow resources of the loader.
+	MappedFile file;
+	if (!directory.empty() && file.open(pathInDirectory(directory, filename)))
+	{
+		m_MemoryMapped = true;
+		initFromMemory(file.data(), file.size(), filename);
+		return;
+	}
+
+	std::string data = loader.loadResource(filename);
+	initFromMemory(data.data(), data.size(), filename);
+}
+
+void GL::BinaryModel::initFromMemory(const char * data, size_t size, const std::string & filename)
+{
+	FileHeader header;
+	if (UNLIKELY(size < sizeof(header)))
+	{
+		std::stringstream ss;
+		ss << "file \"" << filename << "\" is not a valid binary model.";
+		throw std::runtime_error(ss.str());
+	}
+
+	memcpy(&header, data, sizeof(header));
+	if (UNLIKELY(header.magic != Magic))
+	{
+		std::stringstream ss;
+		ss << "file \"" << filename << "\" is not a valid binary model.";
+		throw std::runtime_error(ss.str());
+	}
+
+	if (UNLIKELY(header.version != Version))
+	{
+		std::stringstream ss;
+		ss << "binary model \"" << filename << "\" has unsupported version " << header.version << '.';
+		throw std::runtime_error(ss.str());
+	}
+
+	size_t vertexSize = (header.vertexFormat == PackedVertexFormat ? sizeof(PackedVertex) : sizeof(Vertex));
+	size_t indexSize = 0;
+	switch (header.indexType)
+	{
+	case GL::UNSIGNED_BYTE: indexSize = sizeof(UByte); break;
+	case GL::UNSIGNED_SHORT: indexSize = sizeof(UShort); break;
+	case GL::UNSIGNED_INT: indexSize = sizeof(UInt); break;
+	}
+
+	if (UNLIKELY(header.vertexFormat > uint32_t(PackedVertexFormat) || indexSize == 0 ||
+		uint64_t(header.numVertices) * vertexSize != header.vertexDataSize ||
+		uint64_t(header.numIndices) * indexSize != header.indexDataSize ||
+		!isValidRange(header.vertexDataOffset, header.vertexDataSize, size) ||
+		!isValidRange(header.indexDataOffset, header.indexDataSize, size) ||
+		!isValidRange(header.materialsOffset, uint64_t(header.numMaterials) * sizeof(FileMaterial), size) ||
+		!isValidRange(header.meshesOffset, uint64_t(header.numMeshes) * (header.numLods + 1) * sizeof(FileMesh),
+			size) ||
+		!isValidRange(header.lodsOffset, uint64_t(header.numLods) * sizeof(FileLod), size) ||
+		!isValidRange(header.stringsOffset, header.stringsSize, size)))
+	{
+		std::stringstream ss;
+		ss << "binary model \"" << filename << "\" is corrupt.";
+		throw std::runtime_error(ss.str());
+	}
+
+	m_Flags = header.flags;
+
+	setCenter(header.center[0], header.center[1], header.center[2]);
+	setSize(header.size[0], header.size[1], header.size[2]);
+	setRadius(header.radius);
+	setNumTriangles(int(header.numIndices / 3));
+
+	uploadVertexData(data + header.vertexDataOffset, header.vertexDataSize, header.numVertices,
+		VertexFormat(header.vertexFormat), header.positionScale, header.positionOffset);
+
+	indexBuffer()->setData(GL::ELEMENT_ARRAY_BUFFER, data + header.indexDataOffset, header.indexDataSize,
+		GL::STATIC_DRAW);
+	setIndexType(header.indexType);
+
+	// Packed vertices are not retained: instance batching needs unpacked positions.
+	if (manager()->retainModelGeometry() && header.vertexFormat == uint32_t(FloatVertexFormat))
+	{
+		retainVertices(reinterpret_cast<const Vertex *>(data + header.vertexDataOffset), header.numVertices);
+
+		std::vector<UInt> indices(header.numIndices);
+		const char * p = data + header.indexDataOffset;
+		for (size_t i = 0; i < header.numIndices; i++)
+		{
+			switch (header.indexType)
+			{
+			case GL::UNSIGNED_BYTE: indices[i] = reinterpret_cast<const UByte *>(p)[i]; break;
+			case GL::UNSIGNED_SHORT: indices[i] = reinterpret_cast<const UShort *>(p)[i]; break;
+			case GL::UNSIGNED_INT: indices[i] = reinterpret_cast<const UInt *>(p)[i]; break;
+			}
+		}
+		retainIndices(indices.data(), indices.size());
+	}
+
+	const char * strings = data + header.stringsOffset;
+	ModelData info;
+
+	info.materials.resize(header.numMaterials);
+	for (size_t i = 0; i < header.numMaterials; i++)
+	{
+		FileMaterial m;
+		memcpy(&m, data + header.materialsOffset + i * sizeof(FileMaterial), sizeof(m));
+
+		if (UNLIKELY(!isValidRange(m.textureOffset, m.textureLength, header.stringsSize) ||
+			!isValidRange(m.normalMapOffset, m.normalMapLength, header.stringsSize)))
+		{
+			std::stringstream ss;
+			ss << "binary model \"" << filename << "\" is corrupt.";
+			throw std::runtime_error(ss.str());
+		}
+
+		ModelData::Material & mat = info.materials[i];
+		memcpy(mat.ambient, m.ambient, sizeof(mat.ambient));
+		memcpy(mat.diffuse, m.diffuse, sizeof(mat.diffuse));
+		memcpy(mat.specular, m.specular, sizeof(mat.specular));
+		mat.shininess = m.shininess;
+		mat.opacity = m.opacity;
+		mat.texture.assign(strings + m.textureOffset, m.textureLength);
+		mat.normalMap.assign(strings + m.normalMapOffset, m.normalMapLength);
+	}
+
+	const char * fileMeshes = data + header.meshesOffset;
+	info.meshes.resize(header.numMeshes);
+	readMeshes(fileMeshes, header, filename, info.meshes);
+
+	info.lods.resize(header.numLods);
+	for (size_t i = 0; i < header.numLods; i++)
+	{
+		FileLod l;
+		memcpy(&l, data + header.lodsOffset + i * sizeof(FileLod), sizeof(l));
+
+		info.lods[i].error = l.error;
+		info.lods[i].meshes.resize(header.numMeshes);
+		const char * lodMeshes = fileMeshes + (i + 1) * header.numMeshes * sizeof(FileMesh);
+		readMeshes(lodMeshes, header, filename, info.lods[i].meshes);
+	}
+
+	initMaterialsAndMeshes(info);
+}
+
+void GL::BinaryModel::readMeshes(const char * data, const FileHeader & header, const std::string & filename,
+	std::vector<ModelData::Mesh> & meshes)
+{
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		FileMesh m;
+		memcpy(&m, data + i * sizeof(FileMesh), sizeof(m));
+
+		if (UNLIKELY(uint64_t(m.firstIndex) + m.numIndices > header.numIndices))
+		{
+			std::stringstream ss;
+			ss << "binary model \"" << filename << "\" is corrupt.";
+			throw std::runtime_error(ss.str());
+		}
+
+		ModelData::Mesh & mesh = meshes[i];
+		mesh.materialIndex = m.materialIndex;
+		mesh.firstIndex = m.firstIndex;
+		mesh.numIndices = m.numIndices;
+		std::copy(m.boundsMin, m.boundsMin + 3, mesh.boundsMin);
+		std::copy(m.boundsMax, m.boundsMax + 3, mesh.boundsMax);
+		std::copy(m.center, m.center + 3, mesh.center);
+		mesh.radius = m.radius;
+	}
+}
+
+void GL::BinaryModel::writeMeshes(const std::vector<ModelData::Mesh> & meshes, std::vector<FileMesh> & out)
+{
+	for (const ModelData::Mesh & mesh : meshes)
+	{
+		FileMesh m;
+		memset(&m, 0, sizeof(m));
+		m.materialIndex = mesh.materialIndex;
+		m.firstIndex = mesh.firstIndex;
+		m.numIndices = mesh.numIndices;
+		std::copy(mesh.boundsMin, mesh.boundsMin + 3, m.boundsMin);
+		std::copy(mesh.boundsMax, mesh.boundsMax + 3, m.boundsMax);
+		std::copy(mesh.center, mesh.center + 3, m.center);
+		m.radius = mesh.radius;
+		out.push_back(m);
+	}
+}
+
+void GL::BinaryModel::write(std::ostream & stream, const ModelData & data, VertexFormat format)
+{
+	FileHeader header;
+	memset(&header, 0, sizeof(header));
+
+	header.magic = Magic;
+	header.version = Version;
+	header.flags = (data.hasPositions ? HasPositions : 0) | (data.hasTexCoords ? HasTexCoords : 0) |
+		(data.hasNormals ? HasNormals : 0) | (data.hasTangents ? HasTangents : 0);
+	header.vertexFormat = format;
+	header.numVertices = uint32_t(data.vertices.size());
+	header.numIndices = uint32_t(data.indices.size());
+	header.numMaterials = uint32_t(data.materials.size());
+	header.numMeshes = uint32_t(data.meshes.size());
+	header.numLods = uint32_t(data.lods.size());
+	header.radius = data.radius;
+	for (int i = 0; i < 3; i++)
+	{
+		header.center[i] = data.center[i];
+		header.size[i] = data.size[i];
+		header.positionScale[i] = 1.0f;
+		header.positionOffset[i] = 0.0f;
+	}
+
+	// Vertices
+
+	std::vector<PackedVertex> packed;
+	const char * vertexData = reinterpret_cast<const char *>(data.vertices.data());
+	header.vertexDataSize = uint32_t(data.vertices.size() * sizeof(Vertex));
+	if (format == PackedVertexFormat)
+	{
+		packed.resize(data.vertices.size());
+		packVertices(data.vertices.data(), data.vertices.size(), packed.data(), header.positionScale,
+			header.positionOffset);
+		vertexData = reinterpret_cast<const char *>(packed.data());
+		header.vertexDataSize = uint32_t(packed.size() * sizeof(PackedVertex));
+	}
+
+	// Indices
+
+	std::string indexData;
+	if (data.vertices.size() < 0xFF)
+	{
+		narrowIndices<UByte>(data.indices, indexData);
+		header.indexType = GL::UNSIGNED_BYTE;
+	}
+	else if (data.vertices.size() < 0xFFFF)
+	{
+		narrowIndices<UShort>(data.indices, indexData);
+		header.indexType = GL::UNSIGNED_SHORT;
+	}
+	else
+	{
+		narrowIndices<UInt>(data.indices, indexData);
+		header.indexType = GL::UNSIGNED_INT;
+	}
+	header.indexDataSize = uint32_t(indexData.size());
+
+	// Materials and string table
+
+	std::string strings;
+	std::vector<FileMaterial> materials(data.materials.size());
+	for (size_t i = 0; i < data.materials.size(); i++)
+	{
+		const ModelData::Material & m = data.materials[i];
+		FileMaterial & mat = materials[i];
+
+		memcpy(mat.ambient, m.ambient, sizeof(mat.ambient));
+		memcpy(mat.diffuse, m.diffuse, sizeof(mat.diffuse));
+		memcpy(mat.specular, m.specular, sizeof(mat.specular));
+		mat.shininess = m.shininess;
+		mat.opacity = m.opacity;
+
+		mat.textureOffset = uint32_t(strings.size());
+		mat.textureLength = uint32_t(m.texture.length());
+		strings += m.texture;
+
+		mat.normalMapOffset = uint32_t(strings.size());
+		mat.normalMapLength = uint32_t(m.normalMap.length());
+		strings += m.normalMap;
+	}
+
+	// Meshes
+
+	std::vector<FileMesh> meshes;
+	meshes.reserve(data.meshes.size() * (data.lods.size() + 1));
+	writeMeshes(data.meshes, meshes);
+
+	std::vector<FileLod> lods(data.lods.size());
+	for (size_t i = 0; i < data.lods.size(); i++)
+	{
+		if (UNLIKELY(data.lods[i].meshes.size() != data.meshes.size()))
+			throw std::runtime_error("level of detail has invalid number of meshes.");
+		lods[i].error = data.lods[i].error;
+		writeMeshes(data.lods[i].meshes, meshes);
+	}
+
+	// Layout: vertex and index data are aligned, so they could be passed to OpenGL directly from the mapping.
+
+	uint32_t offset = uint32_t(sizeof(FileHeader));
+	header.materialsOffset = offset;
+	offset += uint32_t(materials.size() * sizeof(FileMaterial));
+	header.meshesOffset = offset;
+	offset += uint32_t(meshes.size() * sizeof(FileMesh));
+	header.lodsOffset = offset;
+	offset += uint32_t(lods.size() * sizeof(FileLod));
+	header.stringsOffset = offset;
+	header.stringsSize = uint32_t(strings.size());
+	offset += header.stringsSize;
+	header.vertexDataOffset = offset = alignTo(offset, 16);
+	offset += header.vertexDataSize;
+	header.indexDataOffset = offset = alignTo(offset, 16);
+
+	static const char padding[16] = { 0 };
+	size_t position = 0;
+
+	#define WRITE(PTR, SIZE) \
+		(stream.write(reinterpret_cast<const char *>(PTR), std::streamsize(SIZE)), position += (SIZE))
+
+	WRITE(&header, sizeof(header));
+	WRITE(materials.data(), materials.size() * sizeof(FileMaterial));
+	WRITE(meshes.data(), meshes.size() * sizeof(FileMesh));
+	WRITE(lods.data(), lods.size() * sizeof(FileLod));
+	WRITE(strings.data(), strings.size());
+	WRITE(padding, header.vertexDataOffset - position);
+	WRITE(vertexData, header.vertexDataSize);
+	WRITE(padding, header.indexDataOffset - position);
+	WRITE(indexData.data(), indexData.size());
+
+	#undef WRITE
+
+	if (!stream)
+		throw std::runtime_error("unable to write binary model.");
+}
@@ -0,0 +1,199 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __65320b650757793edd96aa63cc10effd__
+#define __65320b650757793edd96aa63cc10effd__
+
+#include "gl_model.h"
+#include "gl_model_data.h"
+#include <yip-imports/resource_loader.h>
+#include <yip-imports/gl.h>
+#include <ostream>
+#include <memory>
+#include <cstdint>
+
+namespace GL
+{
+	/**
+	 * A 3D model loaded from the precompiled binary file.
+	 *
+	 * Binary files contain vertices and indices in the exact layout of the OpenGL buffers, so they are passed
+	 * to *glBufferData* directly without parsing or conversion. When the file is available in the file
+	 * system, it is memory-mapped; otherwise it is read via the resource loader. Binary files are produced
+	 * by GL::BinaryModel::write() (see the *obj2glbm* tool).
+	 *
+	 * All values in the file are stored in the native byte order of the target platform (little-endian).
+	 */
+	class BinaryModel : public Model
+	{
+	public:
+		/** Magic number identifying binary model files ("GLBM"). */
+		static const uint32_t Magic = 0x4D424C47u;
+		/** Version of the file format. */
+		static const uint32_t Version = 3;
+
+		/** Flags in the header of the file. */
+		enum Flags
+		{
+			HasPositions = 0x0001,				/**< Model has positions. */
+			HasTexCoords = 0x0002,				/**< Model has texture coordinates. */
+			HasNormals = 0x0004,				/**< Model has normals. */
+			HasTangents = 0x0008,				/**< Model has tangents. */
+		};
+
+		/** Header of the file. All offsets are relative to the beginning of the file. */
+		struct FileHeader
+		{
+			uint32_t magic;						/**< Magic number (GL::BinaryModel::Magic). */
+			uint32_t version;					/**< Version of the file format (GL::BinaryModel::Version). */
+			uint32_t flags;						/**< Combination of GL::BinaryModel::Flags. */
+			uint32_t vertexFormat;				/**< Layout of vertices (GL::Model::VertexFormat). */
+			uint32_t indexType;					/**< Data type of indices (GL::UNSIGNED_BYTE etc). */
+			uint32_t numVertices;				/**< Number of vertices. */
+			uint32_t numIndices;				/**< Number of indices. */
+			uint32_t numMaterials;				/**< Number of materials. */
+			uint32_t numMeshes;					/**< Number of meshes. */
+			float center[3];					/**< Center of the model. */
+			float size[3];						/**< Size of the model. */
+			float radius;						/**< Radius of the model. */
+			float positionScale[3];				/**< Scale for dequantization of positions. */
+			float positionOffset[3];			/**< Offset for dequantization of positions. */
+			uint32_t vertexDataOffset;			/**< Offset of the vertex data. */
+			uint32_t vertexDataSize;			/**< Size of the vertex data in bytes. */
+			uint32_t indexDataOffset;			/**< Offset of the index data. */
+			uint32_t indexDataSize;				/**< Size of the index data in bytes. */
+			uint32_t materialsOffset;			/**< Offset of the array of GL::BinaryModel::FileMaterial. */
+			uint32_t meshesOffset;				/**< Offset of the array of GL::BinaryModel::FileMesh. */
+			uint32_t stringsOffset;				/**< Offset of the string table. */
+			uint32_t stringsSize;				/**< Size of the string table in bytes. */
+			uint32_t numLods;					/**< Number of simplified levels of detail. */
+			uint32_t lodsOffset;				/**< Offset of the array of GL::BinaryModel::FileLod. */
+		};
+
+		/** Material in the file. Strings are stored in the string table. */
+		struct FileMaterial
+		{
+			float ambient[4];					/**< Ambient reflectivity. */
+			float diffuse[4];					/**< Diffuse reflectivity. */
+			float specular[4];					/**< Specular reflectivity. */
+			float shininess;					/**< Shininess. */
+			float opacity;						/**< Opacity. */
+			uint32_t textureOffset;				/**< Offset of the texture name in the string table. */
+			uint32_t textureLength;				/**< Length of the texture name (0 if there is no texture). */
+			uint32_t normalMapOffset;			/**< Offset of the normal map name in the string table. */
+			uint32_t normalMapLength;			/**< Length of the normal map name (0 if there is no map). */
+		};
+
+		/**
+		 * Simplified level of detail in the file.
+		 * Each level has *numMeshes* meshes. They follow meshes of the previous level in the array of meshes.
+		 */
+		struct FileLod
+		{
+			float error;						/**< Geometric error of the level. */
+		};
+
+		/** Mesh in the file. */
+		struct FileMesh
+		{
+			int32_t materialIndex;				/**< Index of the material. */
+			uint32_t firstIndex;				/**< First index. */
+			uint32_t numIndices;				/**< Number of indices. */
+			float boundsMin[3];					/**< Minimum corner of the bounding box. */
+			float boundsMax[3];					/**< Maximum corner of the bounding box. */
+			float center[3];					/**< Center of the bounding sphere. */
+			float radius;						/**< Radius of the bounding sphere. */
+		};
+
+		/**
+		 * Constructor.
+		 * If *directory* is not empty and contains the file, the file is memory-mapped. Otherwise it is read
+		 * via the resource loader.
+		 * @param resMgr Pointer to the resource manager.
+		 * @param loader Resource loader to use if the file could not be memory-mapped.
+		 * @param filename Name of the binary model file to load.
+		 * @param directory Directory in the file system to memory-map the file from.
+		 */
+		BinaryModel(ResourceManager * resMgr, ::Resource::Loader & loader, const std::string & filename,
+			const std::string & directory = std::string());
+
+		/**
+		 * Checks whether this model has normals.
+		 * @return *true* if model has normals, *false* otherwise.
+		 */
+		inline bool hasNormals() const noexcept { return (m_Flags & HasNormals) != 0; }
+
+		/**
+		 * Checks whether this model has positions.
+		 * @return *true* if model has positions, *false* otherwise.
+		 */
+		inline bool hasPositions() const noexcept { return (m_Flags & HasPositions) != 0; }
+
+		/**
+		 * Checks whether this model has tangents.
+		 * @return *true* if model has tangents, *false* otherwise.
+		 */
+		inline bool hasTangents() const noexcept { return (m_Flags & HasTangents) != 0; }
+
+		/**
+		 * Checks whether this model has texture coordinates.
+		 * @return *true* if model has texture coordinates, *false* otherwise.
+		 */
+		inline bool hasTexCoords() const noexcept { return (m_Flags & HasTexCoords) != 0; }
+
+		/**
+		 * Checks whether the file has been memory-mapped during loading.
+		 * @return *true* if file has been memory-mapped, *false* if it has been read via the resource loader.
+		 */
+		inline bool wasMemoryMapped() const noexcept { return m_MemoryMapped; }
+
+		/**
+		 * Writes model into the binary file.
+		 * Vertices are converted into the specified format and indices are narrowed to the smallest suitable
+		 * data type, so the file could be uploaded without any processing. This method does not use OpenGL.
+		 * @param stream Output stream (should be opened in binary mode).
+		 * @param data Model data.
+		 * @param format Layout of vertices in the file.
+		 * @throws std::runtime_error if write fails.
+		 */
+		static void write(std::ostream & stream, const ModelData & data, VertexFormat format);
+
+	private:
+		uint32_t m_Flags;
+		bool m_MemoryMapped;
+
+		void initFromMemory(const char * data, size_t size, const std::string & filename);
+		static void readMeshes(const char * data, const FileHeader & header, const std::string & filename,
+			std::vector<ModelData::Mesh> & meshes);
+		static void writeMeshes(const std::vector<ModelData::Mesh> & meshes, std::vector<FileMesh> & out);
+
+		BinaryModel(const BinaryModel &);
+		BinaryModel & operator=(const BinaryModel &);
+	};
+
+	/** Strong pointer to the binary model. */
+	typedef std::shared_ptr<BinaryModel> BinaryModelPtr;
+	/** Weak pointer to the binary model. */
+	typedef std::weak_ptr<BinaryModel> BinaryModelWeakPtr;
+}
+
+#endif
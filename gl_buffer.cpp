@@ -24,10 +24,13 @@
 #include "gl_buffer_binder.h"
 #include "gl_resource_manager.h"
 #include <stdexcept>
+#include <vector>
+#include <memory>
 
 GL::Buffer::Buffer(ResourceManager * resMgr, const std::string & resName)
 	: Resource(resMgr, resName),
-	  m_Handle(0)
+	  m_Handle(0),
+	  m_Size(0)
 {
 	GL::genBuffers(1, &m_Handle);
 }
@@ -37,11 +40,47 @@ GL::Buffer::~Buffer()
 	destroy();
 }
 
+void GL::Buffer::setData(Enum target, const void * data, size_t size, Enum usage)
+{
+	if (manager() && manager()->deferredUploads())
+	{
+		const GL::UByte * p = reinterpret_cast<const GL::UByte *>(data);
+		std::shared_ptr<std::vector<GL::UByte>> copy;
+		if (p)
+			copy = std::make_shared<std::vector<GL::UByte>>(p, p + size);
+		if (deferUpload(size, [this, target, copy, size, usage]() {
+				upload(target, copy ? copy->data() : nullptr, size, usage);
+			}))
+			return;
+	}
+
+	upload(target, data, size, usage);
+}
+
+void GL::Buffer::upload(Enum target, const void * data, size_t size, Enum usage)
+{
+	if (m_Handle == 0)
+		return;
+
+	bind(target);
+	GL::bufferData(target, size, data, usage);
+	StateCache::current().unbindBuffer(target);
+
+	m_Size = size;
+}
+
+size_t GL::Buffer::memoryUsage() const
+{
+	return m_Size;
+}
+
 void GL::Buffer::destroy()
 {
 	if (m_Handle != 0)
 	{
 		GL::deleteBuffers(1, &m_Handle);
+		StateCache::current().forgetBuffer(m_Handle);
 		m_Handle = 0;
 	}
+	m_Size = 0;
 }
@@ -25,6 +25,7 @@
 
 #include <yip-imports/gl.h>
 #include "gl_resource.h"
+#include "gl_state_cache.h"
 
 namespace GL
 {
@@ -44,9 +45,46 @@ namespace GL
 		/**
 		 * Binds buffer into the OpenGL context.
 		 * This is equivalent to GL::bindBuffer.
+		 * The call is skipped if buffer is already bound to the target (see GL::StateCache).
 		 * @param target Target to bind buffer to.
 		 */
-		inline void bind(Enum target) { GL::bindBuffer(target, m_Handle); }
+		inline void bind(Enum target) { StateCache::current().bindBuffer(target, m_Handle); }
+
+		/**
+		 * Uploads data into the buffer.
+		 * This is equivalent to GL::bufferData. If resource manager is configured for deferred uploads,
+		 * data is copied and upload is performed later by GL::ResourceManager::pumpUploads.
+		 * @note This method binds buffer to the specified target and then unbinds it.
+		 * @param target Target to bind buffer to.
+		 * @param data Pointer to the data.
+		 * @param size Size of the data in bytes.
+		 * @param usage Expected usage pattern of the data (e.g. GL::STATIC_DRAW).
+		 */
+		void setData(Enum target, const void * data, size_t size, Enum usage);
+
+		/**
+		 * Uploads data into the buffer immediately, even if resource manager is configured for deferred uploads.
+		 * This should be used for data that is regenerated every frame.
+		 * @note This method binds buffer to the specified target and then unbinds it.
+		 * @param target Target to bind buffer to.
+		 * @param data Pointer to the data.
+		 * @param size Size of the data in bytes.
+		 * @param usage Expected usage pattern of the data (e.g. GL::STREAM_DRAW).
+		 */
+		inline void setDataImmediately(Enum target, const void * data, size_t size, Enum usage)
+			{ upload(target, data, size, usage); }
+
+		/**
+		 * Returns size of the data store of the buffer.
+		 * @return Size of the buffer in bytes.
+		 */
+		inline size_t size() const { return m_Size; }
+
+		/**
+		 * Returns amount of video memory used by the buffer.
+		 * @return Size of the buffer in bytes.
+		 */
+		size_t memoryUsage() const override;
 
 	protected:
 		/**
@@ -67,6 +105,9 @@ namespace GL
 
 	private:
 		UInt m_Handle;
+		size_t m_Size;
+
+		void upload(Enum target, const void * data, size_t size, Enum usage);
 
 		Buffer(const Buffer &) = delete;
 		Buffer & operator=(const Buffer &) = delete;
@@ -24,6 +24,7 @@
 #define __7a891cc7f4bf3fed8b291823644da539__
 
 #include "gl_buffer.h"
+#include "gl_state_cache.h"
 #include <yip-imports/gl.h>
 
 namespace GL
@@ -44,6 +45,7 @@ namespace GL
 		/**
 		 * Constructor.
 		 * Calls GL::bindBuffer with the specified target and buffer.
+		 * The call is skipped if buffer is already bound (see GL::StateCache).
 		 * @param buf Buffer to use.
 		 * @param target Buffer binding target.
 		 * @see GL::bindBuffer.
@@ -54,10 +56,13 @@ namespace GL
 			buf->bind(target);
 		}
 
-		/** Destructor. Calls GL::bindBuffer with buffer handle set to zero. */
+		/**
+		 * Destructor. Calls GL::bindBuffer with buffer handle set to zero.
+		 * The call is skipped if lazy unbinding is enabled in the current GL::StateCache.
+		 */
 		inline ~BufferBinder()
 		{
-			GL::bindBuffer(m_Target, 0);
+			StateCache::current().unbindBuffer(m_Target);
 		}
 
 	private:
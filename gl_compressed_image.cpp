@@ -0,0 +1,487 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "gl_compressed_image.h"
+#include <yip-imports/cxx-util/macros.h>
+#include <stdexcept>
+#include <algorithm>
+#include <iterator>
+#include <cstring>
+
+static const unsigned char g_KTXSignature[12] = {
+	0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'
+};
+static const unsigned char g_PKMSignature[6] = { 'P', 'K', 'M', ' ', '1', '0' };
+static const unsigned char g_DDSSignature[4] = { 'D', 'D', 'S', ' ' };
+
+static const size_t g_KTXHeaderSize = 64;
+static const size_t g_PKMHeaderSize = 16;
+static const size_t g_DDSHeaderSize = 128;
+
+static const uint32_t g_KTXEndianness = 0x04030201;
+
+static const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+static const uint32_t DDPF_ALPHAPIXELS = 0x1;
+static const uint32_t DDPF_FOURCC = 0x4;
+static const uint32_t DDSCAPS2_CUBEMAP = 0x200;
+
+static const int g_ETC1Modifiers[8][4] = {
+	{ 2, 8, -2, -8 },
+	{ 5, 17, -5, -17 },
+	{ 9, 29, -9, -29 },
+	{ 13, 42, -13, -42 },
+	{ 18, 60, -18, -60 },
+	{ 24, 80, -24, -80 },
+	{ 33, 106, -33, -106 },
+	{ 47, 183, -47, -183 },
+};
+
+static inline uint32_t readLE32(const unsigned char * p)
+{
+	return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+static inline uint32_t readBE32(const unsigned char * p)
+{
+	return uint32_t(p[3]) | (uint32_t(p[2]) << 8) | (uint32_t(p[1]) << 16) | (uint32_t(p[0]) << 24);
+}
+
+static inline unsigned readBE16(const unsigned char * p)
+{
+	return (unsigned(p[0]) << 8) | unsigned(p[1]);
+}
+
+static inline uint32_t fourCC(char a, char b, char c, char d)
+{
+	return uint32_t(GL::UByte(a)) | (uint32_t(GL::UByte(b)) << 8) | (uint32_t(GL::UByte(c)) << 16)
+		| (uint32_t(GL::UByte(d)) << 24);
+}
+
+static inline GL::UByte clampByte(int value)
+{
+	return GL::UByte(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+// Returns size of the 4x4 block in bytes or 0 if format is unknown.
+static size_t blockSize(GL::Enum format)
+{
+	switch (format)
+	{
+	case GL::CompressedImage::ETC1Format:
+	case GL::CompressedImage::DXT1Format:
+	case GL::CompressedImage::DXT1AlphaFormat:
+		return 8;
+	case GL::CompressedImage::DXT3Format:
+	case GL::CompressedImage::DXT5Format:
+		return 16;
+	}
+	return 0;
+}
+
+static size_t blockDataSize(GL::Enum format, int width, int height)
+{
+	return size_t((width + 3) / 4) * size_t((height + 3) / 4) * blockSize(format);
+}
+
+static void decodeETC1Block(const unsigned char * src, GL::UByte * dst, size_t dstStride, int channels)
+{
+	uint32_t high = readBE32(src);
+	uint32_t low = readBE32(src + 4);
+
+	int base[2][3];
+	if (high & 2)
+	{
+		// Differential mode
+		for (int c = 0; c < 3; c++)
+		{
+			int value = int((high >> (27 - c * 8)) & 0x1F);
+			int delta = int((high >> (24 - c * 8)) & 0x7);
+			if (delta >= 4)
+				delta -= 8;
+			int value2 = value + delta;
+			base[0][c] = (value << 3) | (value >> 2);
+			base[1][c] = ((value2 & 0x1F) << 3) | ((value2 & 0x1F) >> 2);
+		}
+	}
+	else
+	{
+		// Individual mode
+		for (int c = 0; c < 3; c++)
+		{
+			base[0][c] = int((high >> (28 - c * 8)) & 0xF) * 17;
+			base[1][c] = int((high >> (24 - c * 8)) & 0xF) * 17;
+		}
+	}
+
+	const int * table[2] = { g_ETC1Modifiers[(high >> 5) & 7], g_ETC1Modifiers[(high >> 2) & 7] };
+	bool flip = (high & 1) != 0;
+
+	for (int x = 0; x < 4; x++)
+	{
+		for (int y = 0; y < 4; y++)
+		{
+			int bit = x * 4 + y;
+			int index = int(((low >> (bit + 15)) & 2) | ((low >> bit) & 1));
+			int subBlock = (flip ? y >> 1 : x >> 1);
+			int modifier = table[subBlock][index];
+
+			GL::UByte * p = dst + size_t(y) * dstStride + size_t(x * channels);
+			p[0] = clampByte(base[subBlock][0] + modifier);
+			p[1] = clampByte(base[subBlock][1] + modifier);
+			p[2] = clampByte(base[subBlock][2] + modifier);
+			if (channels == 4)
+				p[3] = 0xFF;
+		}
+	}
+}
+
+static void decodeDXTColorBlock(const unsigned char * src, GL::UByte * dst, size_t dstStride, int channels,
+	bool allowTransparency)
+{
+	unsigned c0 = unsigned(src[0]) | (unsigned(src[1]) << 8);
+	unsigned c1 = unsigned(src[2]) | (unsigned(src[3]) << 8);
+	uint32_t indices = readLE32(src + 4);
+
+	int colors[4][4];
+	const unsigned packed[2] = { c0, c1 };
+	for (int i = 0; i < 2; i++)
+	{
+		int r = int((packed[i] >> 11) & 0x1F), g = int((packed[i] >> 5) & 0x3F), b = int(packed[i] & 0x1F);
+		colors[i][0] = (r << 3) | (r >> 2);
+		colors[i][1] = (g << 2) | (g >> 4);
+		colors[i][2] = (b << 3) | (b >> 2);
+		colors[i][3] = 255;
+	}
+
+	if (c0 > c1 || !allowTransparency)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			colors[2][c] = (2 * colors[0][c] + colors[1][c]) / 3;
+			colors[3][c] = (colors[0][c] + 2 * colors[1][c]) / 3;
+		}
+		colors[2][3] = colors[3][3] = 255;
+	}
+	else
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			colors[2][c] = (colors[0][c] + colors[1][c]) / 2;
+			colors[3][c] = 0;
+		}
+		colors[2][3] = 255;
+		colors[3][3] = 0;
+	}
+
+	for (int y = 0; y < 4; y++)
+	{
+		GL::UByte * p = dst + size_t(y) * dstStride;
+		for (int x = 0; x < 4; x++, p += channels)
+		{
+			const int * color = colors[(indices >> (2 * (y * 4 + x))) & 3];
+			for (int c = 0; c < channels; c++)
+				p[c] = GL::UByte(color[c]);
+		}
+	}
+}
+
+static void decodeDXT3AlphaBlock(const unsigned char * src, GL::UByte * dst, size_t dstStride)
+{
+	for (int y = 0; y < 4; y++)
+	{
+		unsigned bits = unsigned(src[y * 2]) | (unsigned(src[y * 2 + 1]) << 8);
+		for (int x = 0; x < 4; x++)
+			dst[size_t(y) * dstStride + size_t(x * 4 + 3)] = GL::UByte(((bits >> (x * 4)) & 0xF) * 17);
+	}
+}
+
+static void decodeDXT5AlphaBlock(const unsigned char * src, GL::UByte * dst, size_t dstStride)
+{
+	int a0 = src[0], a1 = src[1];
+	int alpha[8] = { a0, a1 };
+	if (a0 > a1)
+	{
+		for (int i = 1; i < 7; i++)
+			alpha[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+	}
+	else
+	{
+		for (int i = 1; i < 5; i++)
+			alpha[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+		alpha[6] = 0;
+		alpha[7] = 255;
+	}
+
+	uint64_t bits = 0;
+	for (int i = 0; i < 6; i++)
+		bits |= uint64_t(src[2 + i]) << (8 * i);
+
+	for (int y = 0; y < 4; y++)
+	{
+		for (int x = 0; x < 4; x++)
+			dst[size_t(y) * dstStride + size_t(x * 4 + 3)] = GL::UByte(alpha[(bits >> (3 * (y * 4 + x))) & 7]);
+	}
+}
+
+GL::CompressedImage::CompressedImage()
+	: m_InternalFormat(0)
+{
+}
+
+bool GL::CompressedImage::isCompressedImage(const void * data, size_t size)
+{
+	return (size >= sizeof(g_KTXSignature) && !memcmp(data, g_KTXSignature, sizeof(g_KTXSignature)))
+		|| (size >= sizeof(g_PKMSignature) && !memcmp(data, g_PKMSignature, sizeof(g_PKMSignature)))
+		|| (size >= sizeof(g_DDSSignature) && !memcmp(data, g_DDSSignature, sizeof(g_DDSSignature)));
+}
+
+GL::CompressedImagePtr GL::CompressedImage::loadFromData(std::string && data)
+{
+	CompressedImagePtr image(new CompressedImage);
+	image->m_Data = std::move(data);
+
+	const std::string & d = image->m_Data;
+	if (d.size() >= sizeof(g_KTXSignature) && !memcmp(d.data(), g_KTXSignature, sizeof(g_KTXSignature)))
+		image->parseKTX();
+	else if (d.size() >= sizeof(g_PKMSignature) && !memcmp(d.data(), g_PKMSignature, sizeof(g_PKMSignature)))
+		image->parsePKM();
+	else if (d.size() >= sizeof(g_DDSSignature) && !memcmp(d.data(), g_DDSSignature, sizeof(g_DDSSignature)))
+		image->parseDDS();
+	else
+		throw std::runtime_error("unknown compressed image format.");
+
+	return image;
+}
+
+GL::CompressedImagePtr GL::CompressedImage::loadFromData(const void * data, size_t size)
+{
+	return loadFromData(std::string(reinterpret_cast<const char *>(data), size));
+}
+
+GL::CompressedImagePtr GL::CompressedImage::loadFromStreamIfCompressed(std::istream & stream,
+	std::string & contents)
+{
+	contents.clear();
+
+	std::istream::int_type first = stream.peek();
+	if (first != g_KTXSignature[0] && first != g_PKMSignature[0] && first != g_DDSSignature[0])
+		return CompressedImagePtr();
+
+	contents.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+	if (UNLIKELY(stream.bad()))
+		throw std::runtime_error("unable to read image file.");
+
+	if (!isCompressedImage(contents.data(), contents.size()))
+		return CompressedImagePtr();
+
+	return loadFromData(std::move(contents));
+}
+
+bool GL::CompressedImage::hasAlpha() const noexcept
+{
+	return m_InternalFormat != ETC1Format && m_InternalFormat != DXT1Format;
+}
+
+bool GL::CompressedImage::canDecode() const noexcept
+{
+	return blockSize(m_InternalFormat) != 0;
+}
+
+bool GL::CompressedImage::decode(int level, std::vector<UByte> & pixels) const
+{
+	if (!canDecode())
+		return false;
+
+	const Level & info = m_Levels[size_t(level)];
+	const unsigned char * src = reinterpret_cast<const unsigned char *>(m_Data.data() + info.offset);
+	int channels = (hasAlpha() ? 4 : 3);
+	int blocksX = (info.width + 3) / 4;
+	int blocksY = (info.height + 3) / 4;
+	size_t bytesPerBlock = blockSize(m_InternalFormat);
+
+	// Blocks are decoded into a buffer aligned to the block size and then cropped
+	size_t stride = size_t(blocksX) * 4 * size_t(channels);
+	std::vector<UByte> blocks(stride * size_t(blocksY) * 4);
+
+	for (int by = 0; by < blocksY; by++)
+	{
+		for (int bx = 0; bx < blocksX; bx++, src += bytesPerBlock)
+		{
+			UByte * dst = &blocks[size_t(by) * 4 * stride + size_t(bx) * 4 * size_t(channels)];
+			switch (m_InternalFormat)
+			{
+			case ETC1Format:
+				decodeETC1Block(src, dst, stride, channels);
+				break;
+
+			case DXT1Format:
+			case DXT1AlphaFormat:
+				decodeDXTColorBlock(src, dst, stride, channels, true);
+				break;
+
+			case DXT3Format:
+				decodeDXTColorBlock(src + 8, dst, stride, channels, false);
+				decodeDXT3AlphaBlock(src, dst, stride);
+				break;
+
+			case DXT5Format:
+				decodeDXTColorBlock(src + 8, dst, stride, channels, false);
+				decodeDXT5AlphaBlock(src, dst, stride);
+				break;
+			}
+		}
+	}
+
+	size_t rowSize = size_t(info.width) * size_t(channels);
+	pixels.resize(rowSize * size_t(info.height));
+	for (int y = 0; y < info.height; y++)
+		memcpy(&pixels[size_t(y) * rowSize], &blocks[size_t(y) * stride], rowSize);
+
+	return true;
+}
+
+void GL::CompressedImage::parseKTX()
+{
+	const unsigned char * p = reinterpret_cast<const unsigned char *>(m_Data.data());
+	size_t size = m_Data.size();
+	if (UNLIKELY(size < g_KTXHeaderSize))
+		throw std::runtime_error("KTX file is truncated.");
+
+	bool swap = (readLE32(p + 12) != g_KTXEndianness);
+	if (UNLIKELY(swap && readBE32(p + 12) != g_KTXEndianness))
+		throw std::runtime_error("KTX file has invalid byte order mark.");
+	auto read32 = [swap](const unsigned char * ptr) -> uint32_t { return swap ? readBE32(ptr) : readLE32(ptr); };
+
+	uint32_t glType = read32(p + 16);
+	uint32_t glInternalFormat = read32(p + 28);
+	uint32_t width = read32(p + 36);
+	uint32_t height = read32(p + 40);
+	uint32_t depth = read32(p + 44);
+	uint32_t numArrayElements = read32(p + 48);
+	uint32_t numFaces = read32(p + 52);
+	uint32_t numLevels = std::max(read32(p + 56), uint32_t(1));
+	uint32_t keyValueBytes = read32(p + 60);
+
+	if (UNLIKELY(glType != 0))
+		throw std::runtime_error("KTX file does not contain compressed data.");
+	if (UNLIKELY(depth > 1 || numArrayElements > 0 || numFaces != 1))
+		throw std::runtime_error("KTX file contains unsupported texture type.");
+	if (UNLIKELY(width == 0 || height == 0 || width > 65536 || height > 65536 || numLevels > 32))
+		throw std::runtime_error("KTX file has invalid image size.");
+
+	m_InternalFormat = Enum(glInternalFormat);
+
+	size_t offset = g_KTXHeaderSize + size_t(keyValueBytes);
+	for (uint32_t level = 0; level < numLevels; level++)
+	{
+		if (UNLIKELY(offset + 4 > size || offset < g_KTXHeaderSize))
+			throw std::runtime_error("KTX file is truncated.");
+
+		size_t imageSize = read32(p + offset);
+		offset += 4;
+
+		int w = std::max(int(width >> level), 1);
+		int h = std::max(int(height >> level), 1);
+		if (UNLIKELY(blockSize(m_InternalFormat) != 0 && imageSize < blockDataSize(m_InternalFormat, w, h)))
+			throw std::runtime_error("KTX file has invalid mipmap level size.");
+
+		addLevel(w, h, offset, imageSize);
+		offset += (imageSize + 3) & ~size_t(3);
+	}
+}
+
+void GL::CompressedImage::parsePKM()
+{
+	const unsigned char * p = reinterpret_cast<const unsigned char *>(m_Data.data());
+	if (UNLIKELY(m_Data.size() < g_PKMHeaderSize))
+		throw std::runtime_error("PKM file is truncated.");
+
+	unsigned type = readBE16(p + 6);
+	unsigned extWidth = readBE16(p + 8);
+	unsigned extHeight = readBE16(p + 10);
+	unsigned width = readBE16(p + 12);
+	unsigned height = readBE16(p + 14);
+
+	// Type 0 is ETC1_RGB_NO_MIPMAPS
+	if (UNLIKELY(type != 0))
+		throw std::runtime_error("PKM file contains unsupported data type.");
+	if (UNLIKELY(width == 0 || height == 0 || width > extWidth || height > extHeight))
+		throw std::runtime_error("PKM file has invalid image size.");
+
+	m_InternalFormat = ETC1Format;
+	addLevel(int(width), int(height), g_PKMHeaderSize, blockDataSize(ETC1Format, int(extWidth), int(extHeight)));
+}
+
+void GL::CompressedImage::parseDDS()
+{
+	const unsigned char * p = reinterpret_cast<const unsigned char *>(m_Data.data());
+	if (UNLIKELY(m_Data.size() < g_DDSHeaderSize))
+		throw std::runtime_error("DDS file is truncated.");
+
+	uint32_t headerSize = readLE32(p + 4);
+	uint32_t flags = readLE32(p + 8);
+	uint32_t height = readLE32(p + 12);
+	uint32_t width = readLE32(p + 16);
+	uint32_t numLevels = ((flags & DDSD_MIPMAPCOUNT) ? std::max(readLE32(p + 28), uint32_t(1)) : 1);
+	uint32_t pixelFormatFlags = readLE32(p + 80);
+	uint32_t pixelFormat = readLE32(p + 84);
+	uint32_t caps2 = readLE32(p + 112);
+
+	if (UNLIKELY(headerSize != 124))
+		throw std::runtime_error("DDS file has invalid header.");
+	if (UNLIKELY(!(pixelFormatFlags & DDPF_FOURCC) || (caps2 & DDSCAPS2_CUBEMAP)))
+		throw std::runtime_error("DDS file contains unsupported texture type.");
+	if (UNLIKELY(width == 0 || height == 0 || width > 65536 || height > 65536 || numLevels > 32))
+		throw std::runtime_error("DDS file has invalid image size.");
+
+	if (pixelFormat == fourCC('D', 'X', 'T', '1'))
+		m_InternalFormat = ((pixelFormatFlags & DDPF_ALPHAPIXELS) ? DXT1AlphaFormat : DXT1Format);
+	else if (pixelFormat == fourCC('D', 'X', 'T', '3'))
+		m_InternalFormat = DXT3Format;
+	else if (pixelFormat == fourCC('D', 'X', 'T', '5'))
+		m_InternalFormat = DXT5Format;
+	else
+		throw std::runtime_error("DDS file contains unsupported pixel format.");
+
+	size_t offset = g_DDSHeaderSize;
+	for (uint32_t level = 0; level < numLevels; level++)
+	{
+		int w = std::max(int(width >> level), 1);
+		int h = std::max(int(height >> level), 1);
+		size_t levelSize = blockDataSize(m_InternalFormat, w, h);
+		addLevel(w, h, offset, levelSize);
+		offset += levelSize;
+	}
+}
+
+void GL::CompressedImage::addLevel(int width, int height, size_t offset, size_t size)
+{
+	if (UNLIKELY(offset > m_Data.size() || size > m_Data.size() - offset))
+		throw std::runtime_error("compressed image file is truncated.");
+
+	Level level;
+	level.width = width;
+	level.height = height;
+	level.offset = offset;
+	level.size = size;
+	m_Levels.push_back(level);
+}
@@ -0,0 +1,199 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __3e21085f61d488e7e3dde792c9845f31__
+#define __3e21085f61d488e7e3dde792c9845f31__
+
+#include <yip-imports/gl.h>
+#include <istream>
+#include <string>
+#include <vector>
+#include <memory>
+
+namespace GL
+{
+	class CompressedImage;
+
+	/** Strong pointer to the compressed image. */
+	typedef std::shared_ptr<CompressedImage> CompressedImagePtr;
+
+	/**
+	 * Compressed image loaded from the KTX, PKM or DDS container.
+	 *
+	 * Compressed data of all mipmap levels is kept as is, so it could be uploaded with
+	 * GL::compressedTexImage2D (see GL::Texture::initFromCompressedImage). When the format is not supported by
+	 * the hardware, ETC1, DXT1, DXT3 and DXT5 images could be decoded in software with decode().
+	 *
+	 * This class does not use OpenGL, so images could be loaded in a background thread.
+	 */
+	class CompressedImage
+	{
+	public:
+		/** Known compressed formats. Values match the OpenGL ES enumerants. */
+		enum Format : Enum
+		{
+			ETC1Format = 0x8D64,				/**< ETC1_RGB8_OES. */
+			DXT1Format = 0x83F0,				/**< COMPRESSED_RGB_S3TC_DXT1_EXT. */
+			DXT1AlphaFormat = 0x83F1,			/**< COMPRESSED_RGBA_S3TC_DXT1_EXT. */
+			DXT3Format = 0x83F2,				/**< COMPRESSED_RGBA_S3TC_DXT3_EXT. */
+			DXT5Format = 0x83F3,				/**< COMPRESSED_RGBA_S3TC_DXT5_EXT. */
+		};
+
+		/**
+		 * Checks whether the specified data contains a supported container.
+		 * Only the signature is checked.
+		 * @param data Pointer to the data.
+		 * @param size Size of the data.
+		 * @return *true* if data starts with a KTX, PKM or DDS signature, *false* otherwise.
+		 */
+		static bool isCompressedImage(const void * data, size_t size);
+
+		/**
+		 * Loads compressed image from the specified data.
+		 * @param data Contents of the file.
+		 * @return Pointer to the image.
+		 * @throws std::runtime_error if data is not a valid KTX, PKM or DDS file.
+		 */
+		static CompressedImagePtr loadFromData(std::string && data);
+
+		/**
+		 * Loads compressed image from the specified data.
+		 * @param data Pointer to the data.
+		 * @param size Size of the data.
+		 * @return Pointer to the image.
+		 * @throws std::runtime_error if data is not a valid KTX, PKM or DDS file.
+		 */
+		static CompressedImagePtr loadFromData(const void * data, size_t size);
+
+		/**
+		 * Loads compressed image from the specified stream if it contains a supported container.
+		 * First byte of the stream is examined without consuming it. If it could not start a supported
+		 * container, nothing is read from the stream and *nullptr* is returned. Otherwise the whole stream is
+		 * read; if it does not contain a supported container, its contents are stored into *contents* and
+		 * *nullptr* is returned.
+		 * @param stream Input stream.
+		 * @param contents Receives contents of the stream when they have been read but do not contain a
+		 * compressed image.
+		 * @return Pointer to the image or *nullptr*.
+		 * @throws std::runtime_error if stream contains an invalid KTX, PKM or DDS file.
+		 */
+		static CompressedImagePtr loadFromStreamIfCompressed(std::istream & stream, std::string & contents);
+
+		/**
+		 * Returns width of the image.
+		 * @return Width of the level 0 in pixels.
+		 */
+		inline int width() const noexcept { return m_Levels[0].width; }
+
+		/**
+		 * Returns height of the image.
+		 * @return Height of the level 0 in pixels.
+		 */
+		inline int height() const noexcept { return m_Levels[0].height; }
+
+		/**
+		 * Returns internal format of the image.
+		 * @return OpenGL ES internal format (one of values of GL::CompressedImage::Format for PKM and DDS files).
+		 */
+		inline Enum internalFormat() const noexcept { return m_InternalFormat; }
+
+		/**
+		 * Checks whether image has an alpha channel.
+		 * @return *true* if image has an alpha channel, *false* otherwise.
+		 */
+		bool hasAlpha() const noexcept;
+
+		/**
+		 * Returns number of mipmap levels in the image.
+		 * @return Number of mipmap levels (at least 1).
+		 */
+		inline int numLevels() const noexcept { return int(m_Levels.size()); }
+
+		/**
+		 * Returns width of the specified mipmap level.
+		 * @param level Index of the mipmap level.
+		 * @return Width in pixels.
+		 */
+		inline int levelWidth(int level) const { return m_Levels[size_t(level)].width; }
+
+		/**
+		 * Returns height of the specified mipmap level.
+		 * @param level Index of the mipmap level.
+		 * @return Height in pixels.
+		 */
+		inline int levelHeight(int level) const { return m_Levels[size_t(level)].height; }
+
+		/**
+		 * Returns compressed data of the specified mipmap level.
+		 * @param level Index of the mipmap level.
+		 * @return Pointer to the data.
+		 */
+		inline const void * levelData(int level) const { return m_Data.data() + m_Levels[size_t(level)].offset; }
+
+		/**
+		 * Returns size of compressed data of the specified mipmap level.
+		 * @param level Index of the mipmap level.
+		 * @return Size of the data in bytes.
+		 */
+		inline size_t levelSize(int level) const { return m_Levels[size_t(level)].size; }
+
+		/**
+		 * Checks whether format of the image could be decoded in software.
+		 * @return *true* if decode() is supported, *false* otherwise.
+		 */
+		bool canDecode() const noexcept;
+
+		/**
+		 * Decodes the specified mipmap level in software.
+		 * Pixels are stored as RGBA if the image has an alpha channel (see hasAlpha()) or as RGB otherwise.
+		 * @param level Index of the mipmap level.
+		 * @param pixels Output vector for pixels (rows are tightly packed).
+		 * @return *true* on success, *false* if format of the image could not be decoded.
+		 */
+		bool decode(int level, std::vector<UByte> & pixels) const;
+
+	private:
+		struct Level
+		{
+			int width;
+			int height;
+			size_t offset;
+			size_t size;
+		};
+
+		std::string m_Data;
+		std::vector<Level> m_Levels;
+		Enum m_InternalFormat;
+
+		CompressedImage();
+
+		void parseKTX();
+		void parsePKM();
+		void parseDDS();
+		void addLevel(int width, int height, size_t offset, size_t size);
+
+		CompressedImage(const CompressedImage &) = delete;
+		CompressedImage & operator=(const CompressedImage &) = delete;
+	};
+}
+
+#endif
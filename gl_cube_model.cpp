@@ -21,12 +21,13 @@
 // THE SOFTWARE.
 //
 #include "gl_cube_model.h"
-#include "gl_buffer_binder.h"
+#include "gl_resource_manager.h"
 #include <yip-imports/cxx-util/macros.h>
 #include <sstream>
 #include <vector>
 #include <stdexcept>
 #include <memory>
+#include <cmath>
 
 GL::CubeModel::CubeModel(ResourceManager * resMgr, float size, bool inside, const std::string & resName)
 	: Model(resMgr, resName)
@@ -69,7 +70,7 @@ GL::CubeModel::CubeModel(ResourceManager * resMgr, float size, bool inside, cons
 		{ { -S,  S,  S }, { 1, 0 }, {  0,  0,  N }, { 0, 0, 0, 0 }, { 0, 0, 0 } },		// 23
 	};
 
-	std::vector<GL::UByte> indices;
+	std::vector<GL::UInt> indices;
 	if (inside)
 	{
 		indices = {
@@ -98,22 +99,17 @@ GL::CubeModel::CubeModel(ResourceManager * resMgr, float size, bool inside, cons
 	setRadius(S);
 
 	setNumTriangles(int(indices.size() / 3));
-	setNumVertices(int(sizeof(vertices) / sizeof(vertices[0])));
-
-	{
-		GL::BufferBinder binder(vertexBuffer(), GL::ARRAY_BUFFER);
-		GL::bufferData(GL::ARRAY_BUFFER, sizeof(vertices), vertices, GL::STATIC_DRAW);
-	}
-
-	{
-		GL::BufferBinder binder(indexBuffer(), GL::ELEMENT_ARRAY_BUFFER);
-		GL::bufferData(GL::ELEMENT_ARRAY_BUFFER, Sizei(indices.size()), indices.data(), GL::STATIC_DRAW);
-		setIndexType(GL::UNSIGNED_BYTE);
-	}
+	uploadVertices(vertices, sizeof(vertices) / sizeof(vertices[0]), resMgr->defaultVertexFormat());
+	uploadIndices(indices.data(), indices.size());
 
 	setNumMaterials(1);
 	material(0).initWithDefaults();
 
 	setNumMeshes(1);
 	mesh(0).init(&material(0), 0, Int(indices.size()));
+
+	const float boundsMin[3] = { -S, -S, -S };
+	const float boundsMax[3] = { S, S, S };
+	const float center[3] = { 0.0f, 0.0f, 0.0f };
+	mesh(0).setBounds(boundsMin, boundsMax, center, S * std::sqrt(3.0f));
 }
@@ -25,6 +25,7 @@
 
 #include <yip-imports/gl.h>
 #include "gl_attrib.h"
+#include "gl_state_cache.h"
 
 namespace GL
 {
@@ -52,7 +53,7 @@ namespace GL
 			: m_Index(index)
 		{
 			if (LIKELY(m_Index >= 0))
-				enableVertexAttribArray(m_Index);
+				StateCache::current().enableVertexAttribArray(m_Index);
 		}
 
 		/**
@@ -65,14 +66,14 @@ namespace GL
 			: m_Index(index.location())
 		{
 			if (LIKELY(m_Index >= 0))
-				enableVertexAttribArray(m_Index);
+				StateCache::current().enableVertexAttribArray(m_Index);
 		}
 
 		/** Destructor. Calls GL::disableVertexAttribArray. */
 		inline ~EnableVertexAttrib()
 		{
 			if (LIKELY(m_Index >= 0))
-				disableVertexAttribArray(m_Index);
+				StateCache::current().disableVertexAttribArray(m_Index);
 		}
 
 	private:
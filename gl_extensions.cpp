@@ -0,0 +1,53 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "gl_extensions.h"
+#include <unordered_set>
+#include <sstream>
+
+static std::unordered_set<std::string> g_Extensions;
+static bool g_ExtensionsLoaded;
+
+bool GL::Extensions::isSupported(const std::string & name)
+{
+	if (!g_ExtensionsLoaded)
+	{
+		const char * list = reinterpret_cast<const char *>(GL::getString(GL::EXTENSIONS));
+		if (!list)
+			return false;
+
+		std::istringstream ss(list);
+		std::string extension;
+		while (ss >> extension)
+			g_Extensions.insert(extension);
+
+		g_ExtensionsLoaded = true;
+	}
+
+	return g_Extensions.find(name) != g_Extensions.end();
+}
+
+void GL::Extensions::reset()
+{
+	g_Extensions.clear();
+	g_ExtensionsLoaded = false;
+}
@@ -0,0 +1,54 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __fd1950a47f8cf1f774473bedb4ad891e__
+#define __fd1950a47f8cf1f774473bedb4ad891e__
+
+#include <yip-imports/gl.h>
+#include <string>
+
+namespace GL
+{
+	/** Helper functions for querying OpenGL ES extensions. */
+	class Extensions
+	{
+	public:
+		/**
+		 * Checks whether the specified extension is supported by the current OpenGL context.
+		 * List of extensions is queried once and cached.
+		 * @param name Name of the extension (e.g. "GL_OES_get_program_binary").
+		 * @return *true* if extension is supported, *false* otherwise.
+		 */
+		static bool isSupported(const std::string & name);
+
+		/**
+		 * Discards the cached list of extensions.
+		 * This should be called if application switches to another OpenGL context.
+		 */
+		static void reset();
+
+	private:
+		Extensions() = delete;
+	};
+}
+
+#endif
@@ -42,6 +42,7 @@ void GL::Framebuffer::destroy()
 	if (m_Handle != 0)
 	{
 		GL::deleteFramebuffers(1, &m_Handle);
+		StateCache::current().forgetFramebuffer(m_Handle);
 		m_Handle = 0;
 	}
 }
@@ -25,6 +25,7 @@
 
 #include <yip-imports/gl.h>
 #include "gl_resource.h"
+#include "gl_state_cache.h"
 
 namespace GL
 {
@@ -43,9 +44,10 @@ namespace GL
 		/**
 		 * Binds framebuffer into the OpenGL context.
 		 * This is equivalent to GL::bindFramebuffer.
+		 * The call is skipped if framebuffer is already bound (see GL::StateCache).
 		 * @param target Target to bind framebuffer to (default is GL::FRAMEBUFFER).
 		 */
-		inline void bind(Enum target = GL::FRAMEBUFFER) { GL::bindFramebuffer(target, m_Handle); }
+		inline void bind(Enum target = GL::FRAMEBUFFER) { StateCache::current().bindFramebuffer(target, m_Handle); }
 
 	protected:
 		/**
@@ -24,6 +24,7 @@
 #define __8a35ec321935a1160dc5eddc005d8b9e__
 
 #include "gl_framebuffer.h"
+#include "gl_state_cache.h"
 #include <yip-imports/gl.h>
 
 namespace GL
@@ -37,6 +38,16 @@ namespace GL
 	 * GL::FramebufferBinder framebufferBinder(fb);
 	 * // ...
 	 * @endcode
+	 *
+	 * Previously bound framebuffer is obtained from the current GL::StateCache. If the state cache is
+	 * enabled, this does not require a round-trip to the driver.
+	 *
+	 * Binder could also set the viewport for rendering into the framebuffer. In this case both framebuffer
+	 * and viewport are restored on destruction, allowing nested offscreen passes:
+	 * @code
+	 * GL::FramebufferBinder shadowPass(shadowFramebuffer, 0, 0, 1024, 1024);
+	 * // ...
+	 * @endcode
 	 */
 	class FramebufferBinder
 	{
@@ -50,21 +61,43 @@ namespace GL
 		 */
 		inline FramebufferBinder(const GL::FramebufferPtr & fb, GL::Enum target = GL::FRAMEBUFFER)
 			: m_Target(target),
-			  m_PreviouslyBoundBuffer(0)
+			  m_PreviouslyBoundBuffer(StateCache::current().framebufferBinding()),
+			  m_RenderTarget(false)
 		{
-			GL::getIntegerv(GL::FRAMEBUFFER_BINDING, &m_PreviouslyBoundBuffer);
 			fb->bind(target);
 		}
 
-		/** Destructor. Calls GL::bindFramebuffer with framebuffer handle set to zero. */
+		/**
+		 * Constructor.
+		 * Binds the specified framebuffer and sets the viewport.
+		 * @param fb Framebuffer to use.
+		 * @param x X coordinate of the lower left corner of the viewport.
+		 * @param y Y coordinate of the lower left corner of the viewport.
+		 * @param width Width of the viewport.
+		 * @param height Height of the viewport.
+		 * @see GL::StateCache::pushRenderTarget.
+		 */
+		inline FramebufferBinder(const GL::FramebufferPtr & fb, Int x, Int y, Sizei width, Sizei height)
+			: m_Target(GL::FRAMEBUFFER),
+			  m_PreviouslyBoundBuffer(0),
+			  m_RenderTarget(true)
+		{
+			StateCache::current().pushRenderTarget(fb->handle(), x, y, width, height);
+		}
+
+		/** Destructor. Restores previously bound framebuffer (and viewport, if it has been set). */
 		inline ~FramebufferBinder()
 		{
-			GL::bindFramebuffer(m_Target, m_PreviouslyBoundBuffer);
+			if (m_RenderTarget)
+				StateCache::current().popRenderTarget();
+			else
+				StateCache::current().bindFramebuffer(m_Target, m_PreviouslyBoundBuffer);
 		}
 
 	private:
 		GL::Enum m_Target;
-		GL::Int m_PreviouslyBoundBuffer;
+		GL::UInt m_PreviouslyBoundBuffer;
+		bool m_RenderTarget;
 
 		FramebufferBinder(const FramebufferBinder &) = delete;
 		FramebufferBinder & operator=(const FramebufferBinder &) = delete;
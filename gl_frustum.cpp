@@ -0,0 +1,254 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "gl_frustum.h"
+#include <cmath>
+#include <cstdint>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+ #include <xmmintrin.h>
+ #define GL_FRUSTUM_SSE 1
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+ #include <arm_neon.h>
+ #define GL_FRUSTUM_NEON 1
+#endif
+
+GL::Frustum::BoundsList::BoundsList()
+	: m_Count(0)
+{
+}
+
+void GL::Frustum::BoundsList::clear()
+{
+	for (int i = 0; i < NumArrays; i++)
+		m_Data[i].clear();
+	m_Count = 0;
+}
+
+void GL::Frustum::BoundsList::add(const float * boxMin, const float * boxMax, const float * sphereCenter,
+	float sphereRadius)
+{
+	// Arrays are padded to a multiple of four elements, so SIMD code could always load full vectors.
+	if (m_Count % 4 == 0)
+	{
+		for (int i = 0; i < NumArrays; i++)
+			m_Data[i].resize(m_Count + 4, 0.0f);
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		m_Data[BoxCenterX + i][m_Count] = (boxMin[i] + boxMax[i]) * 0.5f;
+		m_Data[BoxExtentX + i][m_Count] = (boxMax[i] - boxMin[i]) * 0.5f;
+		m_Data[SphereX + i][m_Count] = sphereCenter[i];
+	}
+	m_Data[SphereRadius][m_Count] = sphereRadius;
+
+	++m_Count;
+}
+
+GL::Frustum::Frustum()
+{
+	for (int i = 0; i < NumPlanes; i++)
+	{
+		m_Planes[i][0] = 0.0f;
+		m_Planes[i][1] = 0.0f;
+		m_Planes[i][2] = 0.0f;
+		m_Planes[i][3] = 1.0f;
+	}
+}
+
+GL::Frustum::Frustum(const float * matrix)
+{
+	setMatrix(matrix);
+}
+
+void GL::Frustum::setMatrix(const float * m)
+{
+	// Gribb & Hartmann: planes are sums and differences of the fourth row and other rows of the matrix.
+	for (int i = 0; i < 4; i++)
+	{
+		float row0 = m[i * 4 + 0], row1 = m[i * 4 + 1], row2 = m[i * 4 + 2], row3 = m[i * 4 + 3];
+		m_Planes[Left][i] = row3 + row0;
+		m_Planes[Right][i] = row3 - row0;
+		m_Planes[Bottom][i] = row3 + row1;
+		m_Planes[Top][i] = row3 - row1;
+		m_Planes[Near][i] = row3 + row2;
+		m_Planes[Far][i] = row3 - row2;
+	}
+
+	for (int i = 0; i < NumPlanes; i++)
+	{
+		float * p = m_Planes[i];
+		float length = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+		if (length > 0.0f)
+		{
+			float scale = 1.0f / length;
+			for (int j = 0; j < 4; j++)
+				p[j] *= scale;
+		}
+	}
+}
+
+bool GL::Frustum::isSphereVisible(const float * center, float radius) const
+{
+	for (int i = 0; i < NumPlanes; i++)
+	{
+		const float * p = m_Planes[i];
+		if (p[0] * center[0] + p[1] * center[1] + p[2] * center[2] + p[3] < -radius)
+			return false;
+	}
+	return true;
+}
+
+bool GL::Frustum::isBoxVisible(const float * boxMin, const float * boxMax) const
+{
+	for (int i = 0; i < NumPlanes; i++)
+	{
+		// Test the corner of the box that is farthest along the normal of the plane.
+		const float * p = m_Planes[i];
+		float x = (p[0] >= 0.0f ? boxMax[0] : boxMin[0]);
+		float y = (p[1] >= 0.0f ? boxMax[1] : boxMin[1]);
+		float z = (p[2] >= 0.0f ? boxMax[2] : boxMin[2]);
+		if (p[0] * x + p[1] * y + p[2] * z + p[3] < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+void GL::Frustum::cull(const BoundsList & list, std::vector<int> & visible) const
+{
+	const float * cx = list.m_Data[BoundsList::BoxCenterX].data();
+	const float * cy = list.m_Data[BoundsList::BoxCenterY].data();
+	const float * cz = list.m_Data[BoundsList::BoxCenterZ].data();
+	const float * ex = list.m_Data[BoundsList::BoxExtentX].data();
+	const float * ey = list.m_Data[BoundsList::BoxExtentY].data();
+	const float * ez = list.m_Data[BoundsList::BoxExtentZ].data();
+	const float * sx = list.m_Data[BoundsList::SphereX].data();
+	const float * sy = list.m_Data[BoundsList::SphereY].data();
+	const float * sz = list.m_Data[BoundsList::SphereZ].data();
+	const float * sr = list.m_Data[BoundsList::SphereRadius].data();
+	size_t count = list.size();
+
+	float absPlanes[NumPlanes][3];
+	for (int i = 0; i < NumPlanes; i++)
+	{
+		for (int j = 0; j < 3; j++)
+			absPlanes[i][j] = std::fabs(m_Planes[i][j]);
+	}
+
+  #if defined(GL_FRUSTUM_SSE)
+
+	const __m128 zero = _mm_setzero_ps();
+	for (size_t i = 0; i < count; i += 4)
+	{
+		__m128 boxX = _mm_loadu_ps(cx + i), boxY = _mm_loadu_ps(cy + i), boxZ = _mm_loadu_ps(cz + i);
+		__m128 extX = _mm_loadu_ps(ex + i), extY = _mm_loadu_ps(ey + i), extZ = _mm_loadu_ps(ez + i);
+		__m128 sphX = _mm_loadu_ps(sx + i), sphY = _mm_loadu_ps(sy + i), sphZ = _mm_loadu_ps(sz + i);
+		__m128 sphR = _mm_loadu_ps(sr + i);
+		__m128 outside = zero;
+
+		for (int j = 0; j < NumPlanes; j++)
+		{
+			const float * p = m_Planes[j];
+			__m128 a = _mm_set1_ps(p[0]), b = _mm_set1_ps(p[1]), c = _mm_set1_ps(p[2]), d = _mm_set1_ps(p[3]);
+
+			// Box: distance from the center plus projection of extents onto the normal.
+			__m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, boxX), _mm_mul_ps(b, boxY)),
+				_mm_add_ps(_mm_mul_ps(c, boxZ), d));
+			__m128 proj = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(absPlanes[j][0]), extX),
+				_mm_mul_ps(_mm_set1_ps(absPlanes[j][1]), extY)), _mm_mul_ps(_mm_set1_ps(absPlanes[j][2]), extZ));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(dist, proj), zero));
+
+			// Sphere
+			dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, sphX), _mm_mul_ps(b, sphY)),
+				_mm_add_ps(_mm_mul_ps(c, sphZ), d));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(dist, sphR), zero));
+		}
+
+		int mask = _mm_movemask_ps(outside);
+		for (size_t k = 0; k < 4 && i + k < count; k++)
+		{
+			if (!(mask & (1 << k)))
+				visible.push_back(int(i + k));
+		}
+	}
+
+  #elif defined(GL_FRUSTUM_NEON)
+
+	const float32x4_t zero = vdupq_n_f32(0.0f);
+	for (size_t i = 0; i < count; i += 4)
+	{
+		float32x4_t boxX = vld1q_f32(cx + i), boxY = vld1q_f32(cy + i), boxZ = vld1q_f32(cz + i);
+		float32x4_t extX = vld1q_f32(ex + i), extY = vld1q_f32(ey + i), extZ = vld1q_f32(ez + i);
+		float32x4_t sphX = vld1q_f32(sx + i), sphY = vld1q_f32(sy + i), sphZ = vld1q_f32(sz + i);
+		float32x4_t sphR = vld1q_f32(sr + i);
+		uint32x4_t outside = vdupq_n_u32(0);
+
+		for (int j = 0; j < NumPlanes; j++)
+		{
+			const float * p = m_Planes[j];
+
+			// Box: distance from the center plus projection of extents onto the normal.
+			float32x4_t dist = vdupq_n_f32(p[3]);
+			dist = vmlaq_n_f32(dist, boxX, p[0]);
+			dist = vmlaq_n_f32(dist, boxY, p[1]);
+			dist = vmlaq_n_f32(dist, boxZ, p[2]);
+			dist = vmlaq_n_f32(dist, extX, absPlanes[j][0]);
+			dist = vmlaq_n_f32(dist, extY, absPlanes[j][1]);
+			dist = vmlaq_n_f32(dist, extZ, absPlanes[j][2]);
+			outside = vorrq_u32(outside, vcltq_f32(dist, zero));
+
+			// Sphere
+			dist = vaddq_f32(vdupq_n_f32(p[3]), sphR);
+			dist = vmlaq_n_f32(dist, sphX, p[0]);
+			dist = vmlaq_n_f32(dist, sphY, p[1]);
+			dist = vmlaq_n_f32(dist, sphZ, p[2]);
+			outside = vorrq_u32(outside, vcltq_f32(dist, zero));
+		}
+
+		uint32_t lanes[4];
+		vst1q_u32(lanes, outside);
+		for (size_t k = 0; k < 4 && i + k < count; k++)
+		{
+			if (!lanes[k])
+				visible.push_back(int(i + k));
+		}
+	}
+
+  #else
+
+	for (size_t i = 0; i < count; i++)
+	{
+		bool inside = true;
+		for (int j = 0; j < NumPlanes && inside; j++)
+		{
+			const float * p = m_Planes[j];
+			float dist = p[0] * cx[i] + p[1] * cy[i] + p[2] * cz[i] + p[3];
+			float proj = absPlanes[j][0] * ex[i] + absPlanes[j][1] * ey[i] + absPlanes[j][2] * ez[i];
+			inside = (dist + proj >= 0.0f && p[0] * sx[i] + p[1] * sy[i] + p[2] * sz[i] + p[3] + sr[i] >= 0.0f);
+		}
+		if (inside)
+			visible.push_back(int(i));
+	}
+
+  #endif
+}
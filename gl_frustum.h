@@ -0,0 +1,156 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __0592f2056e204fe51dae0017de4e4bd8__
+#define __0592f2056e204fe51dae0017de4e4bd8__
+
+#include <yip-imports/gl.h>
+#include <vector>
+#include <cstddef>
+
+#ifdef HAVE_GLM
+#include <yip-imports/glm/glm.hpp>
+#endif
+
+namespace GL
+{
+	/**
+	 * View frustum for culling of bounding volumes.
+	 * Planes are extracted from the combined projection and view (and, optionally, model) matrix.
+	 * Matrices are expected in column-major order, as used by OpenGL and GLM.
+	 */
+	class Frustum
+	{
+	public:
+		/** Frustum planes. */
+		enum Plane
+		{
+			Left = 0,							/**< Left plane. */
+			Right,								/**< Right plane. */
+			Bottom,								/**< Bottom plane. */
+			Top,								/**< Top plane. */
+			Near,								/**< Near plane. */
+			Far,								/**< Far plane. */
+			NumPlanes							/**< Number of planes. */
+		};
+
+		/**
+		 * List of bounding volumes (boxes with their bounding spheres).
+		 * Volumes are stored as a structure of arrays, so four of them could be tested at once with SIMD.
+		 */
+		class BoundsList
+		{
+		public:
+			/** Constructor. */
+			BoundsList();
+
+			/**
+			 * Returns number of bounding volumes in the list.
+			 * @return Number of bounding volumes.
+			 */
+			inline size_t size() const noexcept { return m_Count; }
+
+			/** Removes all bounding volumes from the list. */
+			void clear();
+
+			/**
+			 * Appends bounding volume to the list.
+			 * @param boxMin Minimum corner of the axis-aligned bounding box.
+			 * @param boxMax Maximum corner of the axis-aligned bounding box.
+			 * @param sphereCenter Center of the bounding sphere.
+			 * @param sphereRadius Radius of the bounding sphere.
+			 */
+			void add(const float * boxMin, const float * boxMax, const float * sphereCenter, float sphereRadius);
+
+		private:
+			enum { BoxCenterX = 0, BoxCenterY, BoxCenterZ, BoxExtentX, BoxExtentY, BoxExtentZ,
+				SphereX, SphereY, SphereZ, SphereRadius, NumArrays };
+
+			std::vector<float> m_Data[NumArrays];
+			size_t m_Count;
+
+			friend class Frustum;
+		};
+
+		/** Constructor. Creates frustum that contains everything. */
+		Frustum();
+
+		/**
+		 * Constructor.
+		 * @param matrix Projection * view (* model) matrix (16 floats in column-major order).
+		 */
+		explicit Frustum(const float * matrix);
+
+	  #ifdef HAVE_GLM
+		/**
+		 * Constructor.
+		 * @param matrix Projection * view (* model) matrix.
+		 */
+		inline explicit Frustum(const glm::mat4 & matrix) { setMatrix(&matrix[0][0]); }
+	  #endif
+
+		/**
+		 * Extracts planes from the matrix.
+		 * @param matrix Projection * view (* model) matrix (16 floats in column-major order).
+		 */
+		void setMatrix(const float * matrix);
+
+		/**
+		 * Returns the specified plane.
+		 * Normals of the planes point inside of the frustum and are normalized.
+		 * @param plane Index of the plane.
+		 * @return Pointer to four coefficients (*a*, *b*, *c*, *d*) of the plane equation.
+		 */
+		inline const float * plane(Plane plane) const noexcept { return m_Planes[plane]; }
+
+		/**
+		 * Checks whether sphere is at least partially inside of the frustum.
+		 * @param center Center of the sphere.
+		 * @param radius Radius of the sphere.
+		 * @return *true* if sphere is potentially visible, *false* if it is outside of the frustum.
+		 */
+		bool isSphereVisible(const float * center, float radius) const;
+
+		/**
+		 * Checks whether axis-aligned box is at least partially inside of the frustum.
+		 * @param boxMin Minimum corner of the box.
+		 * @param boxMax Maximum corner of the box.
+		 * @return *true* if box is potentially visible, *false* if it is outside of the frustum.
+		 */
+		bool isBoxVisible(const float * boxMin, const float * boxMax) const;
+
+		/**
+		 * Culls the list of bounding volumes.
+		 * Volume is culled if either its box or its sphere is outside of any plane. Uses SSE or NEON when
+		 * available.
+		 * @param list List of bounding volumes.
+		 * @param visible Output vector. Indices of potentially visible volumes in the list are appended to it in
+		 * increasing order.
+		 */
+		void cull(const BoundsList & list, std::vector<int> & visible) const;
+
+	private:
+		float m_Planes[NumPlanes][4];
+	};
+}
+
+#endif
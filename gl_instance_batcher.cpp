@@ -0,0 +1,565 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "gl_instance_batcher.h"
+#include "gl_resource_manager.h"
+#include "gl_buffer_binder.h"
+#include "gl_extensions.h"
+#include "gl_state_cache.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace
+{
+	// Binds textures of materials only when they change (same rules as GL::Model::draw).
+	class MaterialBinder
+	{
+	public:
+		MaterialBinder(int textureUnit, int normalMapUnit, const GL::Model::MaterialCallback & callback)
+			: m_TextureUnit(textureUnit),
+			  m_NormalMapUnit(normalMapUnit),
+			  m_Callback(callback),
+			  m_LastMaterial(nullptr),
+			  m_LastTexture(nullptr),
+			  m_LastNormalMap(nullptr)
+		{
+		}
+
+		void apply(const GL::Model::Material * material)
+		{
+			if (!material || material == m_LastMaterial)
+				return;
+
+			GL::StateCache & stateCache = GL::StateCache::current();
+
+			if (m_TextureUnit >= 0 && material->texture && material->texture.get() != m_LastTexture)
+			{
+				stateCache.activeTexture(GL::Enum(GL::TEXTURE0 + m_TextureUnit));
+				material->texture->bind();
+				m_LastTexture = material->texture.get();
+			}
+
+			if (m_NormalMapUnit >= 0 && material->normalMap && material->normalMap.get() != m_LastNormalMap)
+			{
+				stateCache.activeTexture(GL::Enum(GL::TEXTURE0 + m_NormalMapUnit));
+				material->normalMap->bind();
+				m_LastNormalMap = material->normalMap.get();
+			}
+
+			if (m_Callback)
+				m_Callback(*material);
+
+			m_LastMaterial = material;
+		}
+
+	private:
+		int m_TextureUnit;
+		int m_NormalMapUnit;
+		const GL::Model::MaterialCallback & m_Callback;
+		const GL::Model::Material * m_LastMaterial;
+		const GL::Texture * m_LastTexture;
+		const GL::Texture * m_LastNormalMap;
+	};
+}
+
+static const float g_Identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+
+static void bindVertices(size_t base, int aPos, int aTexCoord, int aNorm, int aTangent)
+{
+	#define OFF(X) ((void *)(base + offsetof(GL::Model::Vertex, X)))
+
+	GL::Sizei stride = GL::Sizei(sizeof(GL::Model::Vertex));
+
+	if (aPos >= 0)
+		GL::vertexAttribPointer(aPos, 3, GL::FLOAT, GL::FALSE, stride, OFF(position));
+	if (aTexCoord >= 0)
+		GL::vertexAttribPointer(aTexCoord, 2, GL::FLOAT, GL::FALSE, stride, OFF(texCoord));
+	if (aNorm >= 0)
+		GL::vertexAttribPointer(aNorm, 3, GL::FLOAT, GL::TRUE, stride, OFF(normal));
+	if (aTangent >= 0)
+		GL::vertexAttribPointer(aTangent, 4, GL::FLOAT, GL::FALSE, stride, OFF(tangent));
+
+	#undef OFF
+}
+
+template <class V> static void transformDirection(const float * m, V & v)
+{
+	float x = m[0] * v[0] + m[4] * v[1] + m[8] * v[2];
+	float y = m[1] * v[0] + m[5] * v[1] + m[9] * v[2];
+	float z = m[2] * v[0] + m[6] * v[1] + m[10] * v[2];
+
+	float length = std::sqrt(x * x + y * y + z * z);
+	if (length > 0.0f)
+	{
+		float scale = 1.0f / length;
+		x *= scale;
+		y *= scale;
+		z *= scale;
+	}
+
+	v[0] = x;
+	v[1] = y;
+	v[2] = z;
+}
+
+// Computes inverse transpose of the upper 3x3 part of the matrix, stored in the same layout as the matrix.
+// Scale is irrelevant because transformed directions are renormalized, so only the sign of the determinant
+// is applied to the cofactor matrix.
+static void normalMatrix(const float * m, float * n)
+{
+	n[0] = m[5] * m[10] - m[6] * m[9];
+	n[1] = m[6] * m[8] - m[4] * m[10];
+	n[2] = m[4] * m[9] - m[5] * m[8];
+	n[4] = m[9] * m[2] - m[10] * m[1];
+	n[5] = m[10] * m[0] - m[8] * m[2];
+	n[6] = m[8] * m[1] - m[9] * m[0];
+	n[8] = m[1] * m[6] - m[2] * m[5];
+	n[9] = m[2] * m[4] - m[0] * m[6];
+	n[10] = m[0] * m[5] - m[1] * m[4];
+
+	float det = m[0] * n[0] + m[1] * n[1] + m[2] * n[2];
+	if (det < 0.0f)
+	{
+		for (int i : { 0, 1, 2, 4, 5, 6, 8, 9, 10 })
+			n[i] = -n[i];
+	}
+}
+
+GL::InstanceBatcher::InstanceBatcher(const ModelPtr & model, Mode mode)
+	: m_Model(model),
+	  m_RequestedMode(mode),
+	  m_Api(UnknownApi),
+	  m_GeometryMode(AutomaticMode),
+	  m_GeometryCopies(0),
+	  m_UniformArraySize(0),
+	  m_DrawCalls(0),
+	  m_MatrixAttrib(-1),
+	  m_IndexAttrib(-1),
+	  m_MatricesUniform(-1),
+	  m_ModelMatrixUniform(-1),
+	  m_InstancesChanged(true)
+{
+}
+
+GL::InstanceBatcher::~InstanceBatcher()
+{
+}
+
+GL::InstanceBatcher::Api GL::InstanceBatcher::api() const
+{
+	if (m_Api == UnknownApi)
+	{
+		m_Api = NoInstancing;
+	  #ifdef GL_EXT_instanced_arrays
+		if (Extensions::isSupported("GL_EXT_instanced_arrays"))
+			m_Api = InstancingEXT;
+	  #endif
+	  #ifdef GL_ANGLE_instanced_arrays
+		if (m_Api == NoInstancing && Extensions::isSupported("GL_ANGLE_instanced_arrays"))
+			m_Api = InstancingANGLE;
+	  #endif
+	}
+	return m_Api;
+}
+
+void GL::InstanceBatcher::vertexAttribDivisor(UInt index, UInt divisor) const
+{
+  #ifdef GL_EXT_instanced_arrays
+	if (m_Api == InstancingEXT)
+		GL::vertexAttribDivisorEXT(index, divisor);
+  #endif
+  #ifdef GL_ANGLE_instanced_arrays
+	if (m_Api == InstancingANGLE)
+		GL::vertexAttribDivisorANGLE(index, divisor);
+  #endif
+}
+
+void GL::InstanceBatcher::drawElementsInstanced(Sizei count, Enum type, const void * indices,
+	Sizei primcount) const
+{
+  #ifdef GL_EXT_instanced_arrays
+	if (m_Api == InstancingEXT)
+		GL::drawElementsInstancedEXT(GL::TRIANGLES, count, type, indices, primcount);
+  #endif
+  #ifdef GL_ANGLE_instanced_arrays
+	if (m_Api == InstancingANGLE)
+		GL::drawElementsInstancedANGLE(GL::TRIANGLES, count, type, indices, primcount);
+  #endif
+}
+
+size_t GL::InstanceBatcher::copiesPerBatch(Mode mode) const
+{
+	size_t numVertices = m_Model->retainedVertices().size();
+	if (numVertices == 0)
+		return 0;
+
+	// Replicated geometry uses 16-bit indices.
+	size_t copies = 0xFFFF / numVertices;
+	if (mode == UniformArrayMode)
+		copies = std::min(copies, m_UniformArraySize);
+
+	return copies;
+}
+
+bool GL::InstanceBatcher::isModeSupported(Mode mode) const
+{
+	switch (mode)
+	{
+	case AutomaticMode:
+	case SeparateDrawsMode:
+		return true;
+
+	case InstancedArraysMode:
+		return m_MatrixAttrib >= 0 && api() != NoInstancing;
+
+	case UniformArrayMode:
+		return m_IndexAttrib >= 0 && m_MatricesUniform >= 0 && m_Model->hasRetainedGeometry()
+			&& copiesPerBatch(mode) > 0;
+
+	case PretransformMode:
+		return m_Model->hasRetainedGeometry() && copiesPerBatch(mode) > 0;
+	}
+
+	return false;
+}
+
+GL::InstanceBatcher::Mode GL::InstanceBatcher::mode() const
+{
+	if (m_RequestedMode != AutomaticMode && isModeSupported(m_RequestedMode))
+		return m_RequestedMode;
+
+	if (isModeSupported(InstancedArraysMode))
+		return InstancedArraysMode;
+	if (isModeSupported(UniformArrayMode))
+		return UniformArrayMode;
+	if (isModeSupported(PretransformMode))
+		return PretransformMode;
+
+	return SeparateDrawsMode;
+}
+
+void GL::InstanceBatcher::clear()
+{
+	m_Matrices.clear();
+	m_InstancesChanged = true;
+}
+
+void GL::InstanceBatcher::addInstance(const float * matrix)
+{
+	m_Matrices.insert(m_Matrices.end(), matrix, matrix + 16);
+	m_InstancesChanged = true;
+}
+
+void GL::InstanceBatcher::setInstanceMatricesUniform(int location, size_t arraySize)
+{
+	m_MatricesUniform = location;
+	m_UniformArraySize = arraySize;
+}
+
+size_t GL::InstanceBatcher::maxUniformArraySize(size_t reservedVectors)
+{
+	GL::Int maxVectors = 0;
+	GL::getIntegerv(GL::MAX_VERTEX_UNIFORM_VECTORS, &maxVectors);
+	return (size_t(maxVectors) > reservedVectors ? (size_t(maxVectors) - reservedVectors) / 4 : 0);
+}
+
+void GL::InstanceBatcher::prepareGeometry(Mode mode)
+{
+	const std::vector<Model::DrawCommand> & commands = m_Model->drawList();
+	size_t copies = copiesPerBatch(mode);
+
+	bool commandsChanged = (commands.size() != m_Commands.size());
+	for (size_t i = 0; !commandsChanged && i < commands.size(); i++)
+	{
+		commandsChanged = (commands[i].material != m_Commands[i].material ||
+			commands[i].firstIndex != m_Commands[i].firstIndex ||
+			commands[i].numIndices != m_Commands[i].numIndices);
+	}
+
+	if (!commandsChanged && mode == m_GeometryMode && copies == m_GeometryCopies)
+		return;
+
+	m_Commands = commands;
+	m_GeometryMode = mode;
+	m_GeometryCopies = copies;
+	m_InstancesChanged = true;
+
+	if (mode != UniformArrayMode && mode != PretransformMode)
+		return;
+
+	ResourceManager * resMgr = m_Model->manager();
+	const std::vector<Model::Vertex> & vertices = m_Model->retainedVertices();
+	const std::vector<UInt> & srcIndices = m_Model->retainedIndices();
+	size_t numVertices = vertices.size();
+
+	// Indices are grouped by draw command, so a batch of N copies is drawn with a single call per command.
+	std::vector<UShort> indices;
+	m_CommandOffsets.clear();
+	m_CommandOffsets.reserve(m_Commands.size());
+	for (const Model::DrawCommand & command : m_Commands)
+	{
+		m_CommandOffsets.push_back(indices.size());
+		for (size_t copy = 0; copy < copies; copy++)
+		{
+			size_t base = copy * numVertices;
+			for (Int i = 0; i < command.numIndices; i++)
+				indices.push_back(UShort(base + srcIndices[size_t(command.firstIndex + i)]));
+		}
+	}
+
+	if (!m_IndexBuffer)
+		m_IndexBuffer = resMgr->createBuffer(m_Model->name());
+	m_IndexBuffer->setDataImmediately(GL::ELEMENT_ARRAY_BUFFER, indices.data(), indices.size() * sizeof(UShort),
+		GL::STATIC_DRAW);
+
+	if (mode != UniformArrayMode)
+		return;
+
+	std::vector<Model::Vertex> replicated;
+	std::vector<Float> instanceIndices;
+	replicated.reserve(copies * numVertices);
+	instanceIndices.reserve(copies * numVertices);
+	for (size_t copy = 0; copy < copies; copy++)
+	{
+		replicated.insert(replicated.end(), vertices.begin(), vertices.end());
+		instanceIndices.insert(instanceIndices.end(), numVertices, Float(copy));
+	}
+
+	if (!m_VertexBuffer)
+		m_VertexBuffer = resMgr->createBuffer(m_Model->name());
+	m_VertexBuffer->setDataImmediately(GL::ARRAY_BUFFER, replicated.data(),
+		replicated.size() * sizeof(Model::Vertex), GL::STATIC_DRAW);
+
+	if (!m_InstanceIndexBuffer)
+		m_InstanceIndexBuffer = resMgr->createBuffer(m_Model->name());
+	m_InstanceIndexBuffer->setDataImmediately(GL::ARRAY_BUFFER, instanceIndices.data(),
+		instanceIndices.size() * sizeof(Float), GL::STATIC_DRAW);
+}
+
+void GL::InstanceBatcher::updateInstanceData(Mode mode)
+{
+	if (!m_InstancesChanged)
+		return;
+	m_InstancesChanged = false;
+
+	ResourceManager * resMgr = m_Model->manager();
+
+	if (mode == InstancedArraysMode)
+	{
+		if (!m_InstanceBuffer)
+			m_InstanceBuffer = resMgr->createBuffer(m_Model->name());
+		m_InstanceBuffer->setDataImmediately(GL::ARRAY_BUFFER, m_Matrices.data(),
+			m_Matrices.size() * sizeof(Float), GL::STREAM_DRAW);
+		return;
+	}
+
+	if (mode != PretransformMode)
+		return;
+
+	const std::vector<Model::Vertex> & vertices = m_Model->retainedVertices();
+	size_t count = numInstances();
+
+	std::vector<Model::Vertex> transformed(count * vertices.size());
+	Model::Vertex * dst = transformed.data();
+	for (size_t i = 0; i < count; i++)
+	{
+		const float * m = instanceMatrix(i);
+		float n[16];
+		normalMatrix(m, n);
+
+		for (const Model::Vertex & src : vertices)
+		{
+			*dst = src;
+
+			float x = src.position[0], y = src.position[1], z = src.position[2];
+			dst->position[0] = m[0] * x + m[4] * y + m[8] * z + m[12];
+			dst->position[1] = m[1] * x + m[5] * y + m[9] * z + m[13];
+			dst->position[2] = m[2] * x + m[6] * y + m[10] * z + m[14];
+
+			// Normals are transformed with the inverse transpose to stay perpendicular to the surface under
+			// non-uniform scaling; tangents and binormals lie in the surface and are transformed as positions
+			transformDirection(n, dst->normal);
+			transformDirection(m, dst->tangent);
+			transformDirection(m, dst->binormal);
+
+			++dst;
+		}
+	}
+
+	if (!m_VertexBuffer)
+		m_VertexBuffer = resMgr->createBuffer(m_Model->name());
+	m_VertexBuffer->setDataImmediately(GL::ARRAY_BUFFER, transformed.data(),
+		transformed.size() * sizeof(Model::Vertex), GL::STREAM_DRAW);
+}
+
+void GL::InstanceBatcher::setConstantMatrix(const float * matrix)
+{
+	if (m_MatrixAttrib >= 0)
+	{
+		for (int i = 0; i < 4; i++)
+			GL::vertexAttrib4fv(UInt(m_MatrixAttrib + i), matrix + i * 4);
+	}
+
+	if (m_ModelMatrixUniform >= 0)
+		GL::uniformMatrix4fv(m_ModelMatrixUniform, 1, GL::FALSE, matrix);
+}
+
+void GL::InstanceBatcher::draw(int aPos, int aTexCoord, int aNorm, int aTangent, int textureUnit,
+	int normalMapUnit, const Model::MaterialCallback & onMaterialChange)
+{
+	m_DrawCalls = 0;
+	if (m_Matrices.empty())
+		return;
+
+	Mode currentMode = mode();
+	prepareGeometry(currentMode);
+	updateInstanceData(currentMode);
+
+	switch (currentMode)
+	{
+	case InstancedArraysMode:
+		drawInstanced(aPos, aTexCoord, aNorm, aTangent, textureUnit, normalMapUnit, onMaterialChange);
+		break;
+
+	case UniformArrayMode:
+	case PretransformMode:
+		drawBatches(currentMode, aPos, aTexCoord, aNorm, aTangent, textureUnit, normalMapUnit, onMaterialChange);
+		break;
+
+	case AutomaticMode:
+	case SeparateDrawsMode:
+		drawSeparately(aPos, aTexCoord, aNorm, aTangent, textureUnit, normalMapUnit, onMaterialChange);
+		break;
+	}
+}
+
+void GL::InstanceBatcher::drawInstanced(int aPos, int aTexCoord, int aNorm, int aTangent, int textureUnit,
+	int normalMapUnit, const Model::MaterialCallback & onMaterialChange)
+{
+	StateCache & stateCache = StateCache::current();
+
+	m_Model->bindVertexBuffer(aPos, aTexCoord, aNorm, aTangent);
+
+	{
+		GL::BufferBinder binder(m_InstanceBuffer, GL::ARRAY_BUFFER);
+		for (int i = 0; i < 4; i++)
+		{
+			UInt index = UInt(m_MatrixAttrib + i);
+			stateCache.enableVertexAttribArray(index);
+			GL::vertexAttribPointer(index, 4, GL::FLOAT, GL::FALSE, Sizei(16 * sizeof(Float)),
+				(void *)(i * 4 * sizeof(Float)));
+			vertexAttribDivisor(index, 1);
+		}
+	}
+
+	GL::BufferBinder indexBinder(m_Model->indexBuffer(), GL::ELEMENT_ARRAY_BUFFER);
+	MaterialBinder materials(textureUnit, normalMapUnit, onMaterialChange);
+	size_t step = m_Model->indexSize();
+
+	for (const Model::DrawCommand & command : m_Commands)
+	{
+		materials.apply(command.material);
+		drawElementsInstanced(command.numIndices, m_Model->indexType(),
+			(void *)(command.firstIndex * step), Sizei(numInstances()));
+		++m_DrawCalls;
+	}
+
+	for (int i = 0; i < 4; i++)
+	{
+		UInt index = UInt(m_MatrixAttrib + i);
+		vertexAttribDivisor(index, 0);
+		stateCache.disableVertexAttribArray(index);
+	}
+}
+
+void GL::InstanceBatcher::drawBatches(Mode mode, int aPos, int aTexCoord, int aNorm, int aTangent,
+	int textureUnit, int normalMapUnit, const Model::MaterialCallback & onMaterialChange)
+{
+	StateCache & stateCache = StateCache::current();
+	size_t numVertices = m_Model->retainedVertices().size();
+	size_t copies = m_GeometryCopies;
+	size_t count = numInstances();
+
+	if (mode == PretransformMode)
+		setConstantMatrix(g_Identity);
+	else
+	{
+		GL::BufferBinder binder(m_InstanceIndexBuffer, GL::ARRAY_BUFFER);
+		stateCache.enableVertexAttribArray(UInt(m_IndexAttrib));
+		GL::vertexAttribPointer(UInt(m_IndexAttrib), 1, GL::FLOAT, GL::FALSE, Sizei(sizeof(Float)), nullptr);
+
+		GL::BufferBinder vertexBinder(m_VertexBuffer, GL::ARRAY_BUFFER);
+		bindVertices(0, aPos, aTexCoord, aNorm, aTangent);
+	}
+
+	GL::BufferBinder indexBinder(m_IndexBuffer, GL::ELEMENT_ARRAY_BUFFER);
+	MaterialBinder materials(textureUnit, normalMapUnit, onMaterialChange);
+
+	for (size_t first = 0; first < count; first += copies)
+	{
+		size_t n = std::min(copies, count - first);
+
+		if (mode == PretransformMode)
+		{
+			// Each batch starts at its own vertex, so 16-bit indices are enough.
+			GL::BufferBinder binder(m_VertexBuffer, GL::ARRAY_BUFFER);
+			bindVertices(first * numVertices * sizeof(Model::Vertex), aPos, aTexCoord, aNorm, aTangent);
+		}
+		else
+			GL::uniformMatrix4fv(m_MatricesUniform, Sizei(n), GL::FALSE, instanceMatrix(first));
+
+		for (size_t i = 0; i < m_Commands.size(); i++)
+		{
+			materials.apply(m_Commands[i].material);
+			GL::drawElements(GL::TRIANGLES, Sizei(m_Commands[i].numIndices * n), GL::UNSIGNED_SHORT,
+				(void *)(m_CommandOffsets[i] * sizeof(UShort)));
+			++m_DrawCalls;
+		}
+	}
+
+	if (mode == UniformArrayMode)
+		stateCache.disableVertexAttribArray(UInt(m_IndexAttrib));
+}
+
+void GL::InstanceBatcher::drawSeparately(int aPos, int aTexCoord, int aNorm, int aTangent, int textureUnit,
+	int normalMapUnit, const Model::MaterialCallback & onMaterialChange)
+{
+	m_Model->bindVertexBuffer(aPos, aTexCoord, aNorm, aTangent);
+
+	GL::BufferBinder indexBinder(m_Model->indexBuffer(), GL::ELEMENT_ARRAY_BUFFER);
+	MaterialBinder materials(textureUnit, normalMapUnit, onMaterialChange);
+	size_t step = m_Model->indexSize();
+	size_t count = numInstances();
+
+	for (size_t i = 0; i < count; i++)
+	{
+		setConstantMatrix(instanceMatrix(i));
+		for (const Model::DrawCommand & command : m_Commands)
+		{
+			materials.apply(command.material);
+			GL::drawElements(GL::TRIANGLES, command.numIndices, m_Model->indexType(),
+				(void *)(command.firstIndex * step));
+			++m_DrawCalls;
+		}
+	}
+}
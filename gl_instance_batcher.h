@@ -0,0 +1,283 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __29e28c8aea7c37e6a9ce47c92c355ca6__
+#define __29e28c8aea7c37e6a9ce47c92c355ca6__
+
+#include "gl_model.h"
+#include "gl_buffer.h"
+#include "gl_attrib.h"
+#include "gl_uniform.h"
+#include <yip-imports/gl.h>
+#include <vector>
+
+#ifdef HAVE_GLM
+#include <yip-imports/glm/glm.hpp>
+#endif
+
+namespace GL
+{
+	/**
+	 * Draws many copies of a single model with different transformations.
+	 *
+	 * OpenGL ES 2.0 has no core instancing, so drawing each copy separately costs a draw call and a uniform
+	 * upload per instance. This class reduces number of draw calls to the number of batches using one of the
+	 * following techniques:
+	 *
+	 * - *InstancedArraysMode* uses *GL_EXT_instanced_arrays* or *GL_ANGLE_instanced_arrays*. Instance matrices
+	 *   are stored in a vertex buffer and fed to the *mat4* attribute with divisor 1. One draw call per entry of
+	 *   the draw list of the model.
+	 * - *UniformArrayMode* replicates geometry of the model in a static buffer. Each copy has an additional
+	 *   attribute with the index of the copy, which the vertex shader uses to fetch its matrix from the uniform
+	 *   array. One draw call per entry of the draw list per batch of instances that fit into the uniform array.
+	 * - *PretransformMode* transforms vertices on the CPU into a dynamic buffer. One draw call per entry of the
+	 *   draw list per batch of 65535 vertices. Normals are transformed with the inverse transpose of the upper
+	 *   3x3 part of the matrix, tangents and binormals with the upper 3x3 part itself; all of them are
+	 *   renormalized, so non-uniform scaling is handled correctly.
+	 * - *SeparateDrawsMode* draws each instance separately. Instance matrix is passed as a constant value of
+	 *   the matrix attribute (and/or via the model matrix uniform).
+	 *
+	 * Uniform array and pretransform modes require CPU-side copy of the geometry of the model (see
+	 * GL::ResourceManager::setRetainModelGeometry). In all modes except *UniformArrayMode* the same vertex
+	 * shader could be used: in pretransform mode the matrix attribute is set to the identity matrix.
+	 *
+	 * Matrices are stored in column-major order (as expected by OpenGL and GLM).
+	 */
+	class InstanceBatcher
+	{
+	public:
+		/** Drawing technique. */
+		enum Mode
+		{
+			AutomaticMode = 0,					/**< Select the best supported technique. */
+			InstancedArraysMode,				/**< Use instanced arrays extension. */
+			UniformArrayMode,					/**< Fetch matrices from the uniform array. */
+			PretransformMode,					/**< Transform vertices on the CPU. */
+			SeparateDrawsMode,					/**< Issue draw calls for each instance. */
+		};
+
+		/**
+		 * Constructor.
+		 * @param model Model to draw.
+		 * @param mode Preferred drawing technique. If the technique is not supported, the best supported
+		 * technique is used instead.
+		 */
+		explicit InstanceBatcher(const ModelPtr & model, Mode mode = AutomaticMode);
+
+		/** Destructor. */
+		~InstanceBatcher();
+
+		/**
+		 * Returns the model.
+		 * @return Pointer to the model.
+		 */
+		inline const ModelPtr & model() const noexcept { return m_Model; }
+
+		/**
+		 * Returns the preferred drawing technique.
+		 * @return Preferred drawing technique.
+		 */
+		inline Mode requestedMode() const noexcept { return m_RequestedMode; }
+
+		/**
+		 * Returns drawing technique that will be used by draw().
+		 * Depends on supported extensions, availability of the geometry of the model and configured attributes
+		 * and uniforms.
+		 * @return Drawing technique.
+		 */
+		Mode mode() const;
+
+		/**
+		 * Checks whether the specified drawing technique could be used.
+		 * @param mode Drawing technique.
+		 * @return *true* if technique is supported, *false* otherwise.
+		 */
+		bool isModeSupported(Mode mode) const;
+
+		/** Removes all instances. */
+		void clear();
+
+		/**
+		 * Adds an instance.
+		 * @param matrix Transformation matrix of the instance (16 floats in column-major order).
+		 */
+		void addInstance(const float * matrix);
+
+	  #ifdef HAVE_GLM
+		/**
+		 * Adds an instance.
+		 * @param matrix Transformation matrix of the instance.
+		 */
+		inline void addInstance(const glm::mat4 & matrix) { addInstance(&matrix[0][0]); }
+	  #endif
+
+		/**
+		 * Returns number of instances.
+		 * @return Number of instances.
+		 */
+		inline size_t numInstances() const noexcept { return m_Matrices.size() / 16; }
+
+		/**
+		 * Returns matrix of the specified instance.
+		 * @param index Index of the instance.
+		 * @return Pointer to 16 floats in column-major order.
+		 */
+		inline const float * instanceMatrix(size_t index) const noexcept { return &m_Matrices[index * 16]; }
+
+		/**
+		 * Sets vertex attribute for instance matrices (*attribute mat4* in the vertex shader).
+		 * Matrix attribute occupies four consecutive locations starting with the specified one.
+		 * @param location Location of the attribute (use -1 to disable).
+		 */
+		inline void setInstanceMatrixAttrib(int location) noexcept { m_MatrixAttrib = location; }
+
+		/**
+		 * Sets vertex attribute for instance matrices (*attribute mat4* in the vertex shader).
+		 * @param attrib Attribute (use default-constructed value to disable).
+		 */
+		inline void setInstanceMatrixAttrib(const GL::Attrib & attrib) { m_MatrixAttrib = attrib.location(); }
+
+		/**
+		 * Sets vertex attribute for index of the instance in the uniform array (*attribute float*).
+		 * Used only in *UniformArrayMode*.
+		 * @param location Location of the attribute (use -1 to disable).
+		 */
+		inline void setInstanceIndexAttrib(int location) noexcept { m_IndexAttrib = location; }
+
+		/**
+		 * Sets vertex attribute for index of the instance in the uniform array (*attribute float*).
+		 * @param attrib Attribute (use default-constructed value to disable).
+		 */
+		inline void setInstanceIndexAttrib(const GL::Attrib & attrib) { m_IndexAttrib = attrib.location(); }
+
+		/**
+		 * Sets uniform array of instance matrices (*uniform mat4 u_matrices[N]*).
+		 * Used only in *UniformArrayMode*. Program containing the uniform should be current during draw().
+		 * @param location Location of the uniform (use -1 to disable).
+		 * @param arraySize Number of elements in the array.
+		 * @see maxUniformArraySize().
+		 */
+		void setInstanceMatricesUniform(int location, size_t arraySize);
+
+		/**
+		 * Sets uniform array of instance matrices (*uniform mat4 u_matrices[N]*).
+		 * @param uniform Uniform (use default-constructed value to disable).
+		 * @param arraySize Number of elements in the array.
+		 */
+		inline void setInstanceMatricesUniform(const GL::Uniform & uniform, size_t arraySize)
+			{ setInstanceMatricesUniform(uniform.location(), arraySize); }
+
+		/**
+		 * Sets uniform for the model matrix (*uniform mat4*).
+		 * If set, *SeparateDrawsMode* uploads matrix of each instance into this uniform and *PretransformMode*
+		 * sets it to the identity matrix. Program containing the uniform should be current during draw().
+		 * @param location Location of the uniform (use -1 to disable).
+		 */
+		inline void setModelMatrixUniform(int location) noexcept { m_ModelMatrixUniform = location; }
+
+		/**
+		 * Sets uniform for the model matrix (*uniform mat4*).
+		 * @param uniform Uniform (use default-constructed value to disable).
+		 */
+		inline void setModelMatrixUniform(const GL::Uniform & uniform)
+			{ m_ModelMatrixUniform = uniform.location(); }
+
+		/**
+		 * Draws all instances.
+		 * Vertex attribute arrays for the model attributes should be enabled by the caller. Arrays for the
+		 * instance attributes are enabled and disabled by this method.
+		 * @note For packed vertices binormals are not available (see GL::Model::bindVertexBuffer).
+		 * @param aPos Index of the attribute for vertex positions (use -1 to skip).
+		 * @param aTexCoord Index of the attribute for texture coordinates (use -1 to skip).
+		 * @param aNorm Index of the attribute for normals (use -1 to skip).
+		 * @param aTangent Index of the attribute for tangents (use -1 to skip).
+		 * @param textureUnit Index of the texture unit for material textures (use -1 to skip).
+		 * @param normalMapUnit Index of the texture unit for normal maps (use -1 to skip).
+		 * @param onMaterialChange Optional callback invoked before the first draw call with each material.
+		 * @see GL::Model::draw.
+		 */
+		void draw(int aPos, int aTexCoord = -1, int aNorm = -1, int aTangent = -1, int textureUnit = 0,
+			int normalMapUnit = -1, const Model::MaterialCallback & onMaterialChange = Model::MaterialCallback());
+
+		/**
+		 * Returns number of draw calls issued by the last call to draw().
+		 * @return Number of draw calls.
+		 */
+		inline size_t drawCalls() const noexcept { return m_DrawCalls; }
+
+		/**
+		 * Returns maximum number of *mat4* elements in the uniform array of the vertex shader.
+		 * This is derived from GL::MAX_VERTEX_UNIFORM_VECTORS.
+		 * @param reservedVectors Number of uniform vectors used by other uniforms of the shader.
+		 * @return Maximum size of the array.
+		 */
+		static size_t maxUniformArraySize(size_t reservedVectors = 16);
+
+	private:
+		enum Api
+		{
+			UnknownApi = 0,
+			NoInstancing,
+			InstancingEXT,
+			InstancingANGLE,
+		};
+
+		ModelPtr m_Model;
+		Mode m_RequestedMode;
+		mutable Api m_Api;
+		std::vector<float> m_Matrices;
+		std::vector<Model::DrawCommand> m_Commands;
+		std::vector<size_t> m_CommandOffsets;
+		BufferPtr m_InstanceBuffer;
+		BufferPtr m_VertexBuffer;
+		BufferPtr m_IndexBuffer;
+		BufferPtr m_InstanceIndexBuffer;
+		Mode m_GeometryMode;
+		size_t m_GeometryCopies;
+		size_t m_UniformArraySize;
+		size_t m_DrawCalls;
+		int m_MatrixAttrib;
+		int m_IndexAttrib;
+		int m_MatricesUniform;
+		int m_ModelMatrixUniform;
+		bool m_InstancesChanged;
+
+		Api api() const;
+		void vertexAttribDivisor(UInt index, UInt divisor) const;
+		void drawElementsInstanced(Sizei count, Enum type, const void * indices, Sizei primcount) const;
+		size_t copiesPerBatch(Mode mode) const;
+		void prepareGeometry(Mode mode);
+		void updateInstanceData(Mode mode);
+		void setConstantMatrix(const float * matrix);
+		void drawInstanced(int aPos, int aTexCoord, int aNorm, int aTangent, int textureUnit, int normalMapUnit,
+			const Model::MaterialCallback & onMaterialChange);
+		void drawBatches(Mode mode, int aPos, int aTexCoord, int aNorm, int aTangent, int textureUnit,
+			int normalMapUnit, const Model::MaterialCallback & onMaterialChange);
+		void drawSeparately(int aPos, int aTexCoord, int aNorm, int aTangent, int textureUnit, int normalMapUnit,
+			const Model::MaterialCallback & onMaterialChange);
+
+		InstanceBatcher(const InstanceBatcher &) = delete;
+		InstanceBatcher & operator=(const InstanceBatcher &) = delete;
+	};
+}
+
+#endif
@@ -0,0 +1,332 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "gl_mesh_optimizer.h"
+#include <yip-imports/cxx-util/macros.h>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// Parameters of the vertex scoring function, as suggested by Tom Forsyth.
+	const size_t ScoreCacheSize = 32;
+	const float CacheDecayPower = 1.5f;
+	const float LastTriangleScore = 0.75f;
+	const float ValenceBoostScale = 2.0f;
+	const float ValenceBoostPower = 0.5f;
+	const GL::UInt InvalidIndex = 0xFFFFFFFFu;
+
+	struct VertexInfo
+	{
+		size_t firstTriangle;		// Offset of the adjacent triangles in the adjacency list.
+		size_t numTriangles;		// Number of adjacent triangles not yet added to the output.
+		int cachePosition;			// Position in the simulated LRU cache or -1.
+		float score;
+	};
+
+	inline float vertexScore(const VertexInfo & vertex)
+	{
+		if (vertex.numTriangles == 0)
+			return -1.0f;
+
+		float score = 0.0f;
+		if (vertex.cachePosition >= 0)
+		{
+			if (vertex.cachePosition < 3)
+				score = LastTriangleScore;
+			else
+			{
+				const float scaler = 1.0f / float(ScoreCacheSize - 3);
+				score = 1.0f - float(vertex.cachePosition - 3) * scaler;
+				score = powf(score, CacheDecayPower);
+			}
+		}
+
+		score += ValenceBoostScale * powf(float(vertex.numTriangles), -ValenceBoostPower);
+
+		return score;
+	}
+}
+
+GL::MeshOptimizer::Statistics GL::MeshOptimizer::analyze(const UInt * indices, size_t numIndices,
+	size_t numVertices, size_t cacheSize)
+{
+	Statistics stats;
+	stats.numTriangles = numIndices / 3;
+	stats.numVertices = 0;
+	stats.cacheMisses = 0;
+
+	// Timestamp of the vertex insertion into the FIFO cache. Vertex is in cache when it was inserted less than
+	// cacheSize misses ago.
+	std::vector<size_t> timestamps(numVertices, 0);
+	std::vector<bool> referenced(numVertices, false);
+
+	for (size_t i = 0; i < stats.numTriangles * 3; i++)
+	{
+		UInt index = indices[i];
+		if (UNLIKELY(index >= numVertices))
+			continue;
+
+		if (!referenced[index])
+		{
+			referenced[index] = true;
+			++stats.numVertices;
+		}
+
+		if (timestamps[index] == 0 || stats.cacheMisses - timestamps[index] >= cacheSize)
+		{
+			++stats.cacheMisses;
+			timestamps[index] = stats.cacheMisses;
+		}
+	}
+
+	stats.acmr = (stats.numTriangles > 0 ? float(stats.cacheMisses) / float(stats.numTriangles) : 0.0f);
+	stats.atvr = (stats.numVertices > 0 ? float(stats.cacheMisses) / float(stats.numVertices) : 0.0f);
+
+	return stats;
+}
+
+void GL::MeshOptimizer::optimizeVertexCache(UInt * indices, size_t numIndices, size_t numVertices)
+{
+	const size_t numTriangles = numIndices / 3;
+	if (numTriangles == 0)
+		return;
+
+	for (size_t i = 0; i < numTriangles * 3; i++)
+	{
+		if (UNLIKELY(indices[i] >= numVertices))
+			return;
+	}
+
+	// Build triangle adjacency for each vertex
+
+	std::vector<VertexInfo> vertices(numVertices);
+	for (size_t i = 0; i < numVertices; i++)
+	{
+		vertices[i].numTriangles = 0;
+		vertices[i].cachePosition = -1;
+	}
+
+	for (size_t i = 0; i < numTriangles * 3; i++)
+		++vertices[indices[i]].numTriangles;
+
+	size_t offset = 0;
+	for (size_t i = 0; i < numVertices; i++)
+	{
+		vertices[i].firstTriangle = offset;
+		offset += vertices[i].numTriangles;
+		vertices[i].numTriangles = 0;
+	}
+
+	std::vector<UInt> adjacency(offset);
+	for (size_t i = 0; i < numTriangles * 3; i++)
+	{
+		VertexInfo & vertex = vertices[indices[i]];
+		adjacency[vertex.firstTriangle + vertex.numTriangles++] = UInt(i / 3);
+	}
+
+	// Calculate initial scores
+
+	for (size_t i = 0; i < numVertices; i++)
+		vertices[i].score = vertexScore(vertices[i]);
+
+	std::vector<float> triangleScores(numTriangles);
+	std::vector<bool> triangleAdded(numTriangles, false);
+	for (size_t i = 0; i < numTriangles; i++)
+	{
+		const UInt * tri = indices + i * 3;
+		triangleScores[i] = vertices[tri[0]].score + vertices[tri[1]].score + vertices[tri[2]].score;
+	}
+
+	// Add triangles to the output in order of their score
+
+	std::vector<UInt> output;
+	output.reserve(numTriangles * 3);
+
+	UInt cache[ScoreCacheSize + 3];
+	size_t cacheSize = 0;
+
+	size_t bestTriangle = 0;
+	for (size_t i = 1; i < numTriangles; i++)
+	{
+		if (triangleScores[i] > triangleScores[bestTriangle])
+			bestTriangle = i;
+	}
+
+	size_t nextUnadded = 0;
+	for (size_t n = 0; n < numTriangles; n++)
+	{
+		if (bestTriangle == InvalidIndex)
+		{
+			// Dead end: no triangles adjacent to the cached vertices. Restart from the next triangle in the
+			// original order. This keeps the algorithm linear.
+			while (triangleAdded[nextUnadded])
+				++nextUnadded;
+			bestTriangle = nextUnadded;
+		}
+
+		const UInt * tri = indices + bestTriangle * 3;
+		output.push_back(tri[0]);
+		output.push_back(tri[1]);
+		output.push_back(tri[2]);
+		triangleAdded[bestTriangle] = true;
+
+		// Remove the triangle from the adjacency lists of its vertices
+
+		for (int k = 0; k < 3; k++)
+		{
+			VertexInfo & vertex = vertices[tri[k]];
+			UInt * list = &adjacency[vertex.firstTriangle];
+			for (size_t j = 0; j < vertex.numTriangles; j++)
+			{
+				if (list[j] == bestTriangle)
+				{
+					list[j] = list[vertex.numTriangles - 1];
+					--vertex.numTriangles;
+					break;
+				}
+			}
+		}
+
+		// Move vertices of the triangle to the front of the cache
+
+		UInt newCache[ScoreCacheSize + 3];
+		size_t newCacheSize = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			if (k > 0 && (tri[k] == tri[0] || (k > 1 && tri[k] == tri[1])))
+				continue;
+			newCache[newCacheSize++] = tri[k];
+		}
+		for (size_t j = 0; j < cacheSize; j++)
+		{
+			UInt index = cache[j];
+			if (index != tri[0] && index != tri[1] && index != tri[2])
+				newCache[newCacheSize++] = index;
+		}
+
+		// Update scores of the vertices in cache and of their triangles.
+		// Vertices pushed out of the cache are updated too, as they have lost their cache bonus.
+
+		for (size_t j = 0; j < newCacheSize; j++)
+		{
+			VertexInfo & vertex = vertices[newCache[j]];
+			vertex.cachePosition = (j < ScoreCacheSize ? int(j) : -1);
+
+			float newScore = vertexScore(vertex);
+			float delta = newScore - vertex.score;
+			vertex.score = newScore;
+
+			const UInt * list = &adjacency[vertex.firstTriangle];
+			for (size_t t = 0; t < vertex.numTriangles; t++)
+				triangleScores[list[t]] += delta;
+		}
+
+		cacheSize = std::min(newCacheSize, ScoreCacheSize);
+		std::copy(newCache, newCache + cacheSize, cache);
+
+		// Find the best triangle among the triangles adjacent to the cached vertices
+
+		bestTriangle = InvalidIndex;
+		float bestScore = -1.0f;
+		for (size_t j = 0; j < cacheSize; j++)
+		{
+			const VertexInfo & vertex = vertices[cache[j]];
+			const UInt * list = &adjacency[vertex.firstTriangle];
+			for (size_t t = 0; t < vertex.numTriangles; t++)
+			{
+				if (triangleScores[list[t]] > bestScore)
+				{
+					bestScore = triangleScores[list[t]];
+					bestTriangle = list[t];
+				}
+			}
+		}
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+std::vector<GL::UInt> GL::MeshOptimizer::optimizeVertexFetch(UInt * indices, size_t numIndices,
+	size_t numVertices)
+{
+	std::vector<UInt> remap(numVertices, InvalidIndex);
+
+	UInt next = 0;
+	for (size_t i = 0; i < numIndices; i++)
+	{
+		UInt index = indices[i];
+		if (UNLIKELY(index >= numVertices))
+			continue;
+
+		if (remap[index] == InvalidIndex)
+			remap[index] = next++;
+		indices[i] = remap[index];
+	}
+
+	for (size_t i = 0; i < numVertices; i++)
+	{
+		if (remap[i] == InvalidIndex)
+			remap[i] = next++;
+	}
+
+	return remap;
+}
+
+GL::MeshOptimizer::Report GL::MeshOptimizer::optimize(ModelData & data, size_t cacheSize)
+{
+	Report report;
+
+	const size_t numVertices = data.vertices.size();
+	UInt * indices = data.indices.data();
+	const size_t numIndices = data.indices.size();
+
+	report.before = analyze(indices, numIndices, numVertices, cacheSize);
+
+	for (const ModelData::Mesh & mesh : data.meshes)
+	{
+		if (UNLIKELY(size_t(mesh.firstIndex) + mesh.numIndices > numIndices))
+			continue;
+		optimizeVertexCache(indices + mesh.firstIndex, mesh.numIndices, numVertices);
+	}
+
+	for (const ModelData::Lod & lod : data.lods)
+	{
+		for (const ModelData::Mesh & mesh : lod.meshes)
+		{
+			if (UNLIKELY(size_t(mesh.firstIndex) + mesh.numIndices > numIndices))
+				continue;
+			optimizeVertexCache(indices + mesh.firstIndex, mesh.numIndices, numVertices);
+		}
+	}
+
+	std::vector<UInt> remap = optimizeVertexFetch(indices, numIndices, numVertices);
+
+	std::vector<Model::Vertex> vertices(numVertices);
+	for (size_t i = 0; i < numVertices; i++)
+		vertices[remap[i]] = data.vertices[i];
+	data.vertices.swap(vertices);
+
+	report.after = analyze(indices, numIndices, numVertices, cacheSize);
+
+	return report;
+}
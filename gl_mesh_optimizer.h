@@ -0,0 +1,107 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __33678f5841e92a923dec53b23cc1d300__
+#define __33678f5841e92a923dec53b23cc1d300__
+
+#include "gl_model_data.h"
+#include <yip-imports/gl.h>
+#include <vector>
+
+namespace GL
+{
+	/**
+	 * Optimizer of triangle meshes for the post-transform vertex cache and the vertex fetch.
+	 *
+	 * Triangles are reordered using the algorithm by Tom Forsyth ("Linear-Speed Vertex Cache Optimisation"),
+	 * then vertices are reordered in order of their first use. This class does not use OpenGL and could be
+	 * used in offline tools.
+	 */
+	class MeshOptimizer
+	{
+	public:
+		/** Default size of the simulated FIFO vertex cache used for statistics. */
+		static const size_t DefaultCacheSize = 16;
+
+		/** Statistics of the vertex cache efficiency. */
+		struct Statistics
+		{
+			size_t numTriangles;				/**< Number of triangles. */
+			size_t numVertices;					/**< Number of distinct vertices referenced by triangles. */
+			size_t cacheMisses;					/**< Number of vertex cache misses. */
+			float acmr;							/**< Average cache miss ratio (misses per triangle). */
+			float atvr;							/**< Average transformed vertex ratio (misses per vertex). */
+		};
+
+		/** Statistics before and after optimization. */
+		struct Report
+		{
+			Statistics before;					/**< Statistics of the original index buffer. */
+			Statistics after;					/**< Statistics of the optimized index buffer. */
+		};
+
+		/**
+		 * Calculates vertex cache efficiency of the index buffer by simulating a FIFO cache.
+		 * @param indices Pointer to the indices.
+		 * @param numIndices Number of indices (should be a multiple of 3).
+		 * @param numVertices Number of vertices.
+		 * @param cacheSize Size of the simulated vertex cache.
+		 * @return Statistics.
+		 */
+		static Statistics analyze(const UInt * indices, size_t numIndices, size_t numVertices,
+			size_t cacheSize = DefaultCacheSize);
+
+		/**
+		 * Reorders triangles for better locality in the post-transform vertex cache.
+		 * @param indices Pointer to the indices. Indices are reordered in place.
+		 * @param numIndices Number of indices (should be a multiple of 3).
+		 * @param numVertices Number of vertices.
+		 */
+		static void optimizeVertexCache(UInt * indices, size_t numIndices, size_t numVertices);
+
+		/**
+		 * Calculates order of vertices for sequential vertex fetch.
+		 * Vertices are numbered in order of their first use; unused vertices are moved to the end.
+		 * @param indices Pointer to the indices. Indices are remapped in place.
+		 * @param numIndices Number of indices.
+		 * @param numVertices Number of vertices.
+		 * @return Remap table: new index for each of the original vertices.
+		 */
+		static std::vector<UInt> optimizeVertexFetch(UInt * indices, size_t numIndices, size_t numVertices);
+
+		/**
+		 * Optimizes the model.
+		 * Triangles of each mesh (including meshes of levels of detail) are reordered independently, so meshes
+		 * keep their index ranges. Then vertices
+		 * of the whole model are reordered for sequential vertex fetch.
+		 * @param data Model to optimize.
+		 * @param cacheSize Size of the simulated vertex cache used for statistics.
+		 * @return Statistics before and after optimization.
+		 */
+		static Report optimize(ModelData & data, size_t cacheSize = DefaultCacheSize);
+
+	private:
+		MeshOptimizer() = delete;
+	};
+}
+
+#endif
@@ -0,0 +1,377 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "gl_mesh_simplifier.h"
+#include <yip-imports/cxx-util/macros.h>
+#include <unordered_map>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cstdint>
+
+namespace
+{
+	// Sum of squared distances to planes of the adjacent triangles, weighted by area of the triangles.
+	struct Quadric
+	{
+		double a00, a01, a02, a11, a12, a22;
+		double b0, b1, b2;
+		double c;
+		double weight;
+
+		inline Quadric() : a00(0), a01(0), a02(0), a11(0), a12(0), a22(0), b0(0), b1(0), b2(0), c(0), weight(0) {}
+
+		inline void addPlane(double nx, double ny, double nz, double d, double w)
+		{
+			a00 += w * nx * nx; a01 += w * nx * ny; a02 += w * nx * nz;
+			a11 += w * ny * ny; a12 += w * ny * nz; a22 += w * nz * nz;
+			b0 += w * nx * d; b1 += w * ny * d; b2 += w * nz * d;
+			c += w * d * d;
+			weight += w;
+		}
+
+		inline void add(const Quadric & q)
+		{
+			a00 += q.a00; a01 += q.a01; a02 += q.a02;
+			a11 += q.a11; a12 += q.a12; a22 += q.a22;
+			b0 += q.b0; b1 += q.b1; b2 += q.b2;
+			c += q.c;
+			weight += q.weight;
+		}
+
+		inline double error(const double * p) const
+		{
+			double x = p[0], y = p[1], z = p[2];
+			double e = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+				+ 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+			return std::max(e, 0.0);
+		}
+	};
+
+	struct Collapse
+	{
+		GL::UInt from;
+		GL::UInt to;
+		double cost;
+	};
+}
+
+static void cross(const double * a, const double * b, const double * c, double * n)
+{
+	double u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+	double v[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+	n[0] = u[1] * v[2] - u[2] * v[1];
+	n[1] = u[2] * v[0] - u[0] * v[2];
+	n[2] = u[0] * v[1] - u[1] * v[0];
+}
+
+float GL::MeshSimplifier::simplify(const std::vector<Model::Vertex> & vertices, const UInt * indices,
+	size_t numIndices, size_t targetIndices, std::vector<UInt> & result)
+{
+	const size_t numVertices = vertices.size();
+
+	result.clear();
+	result.reserve(numIndices);
+	for (size_t i = 0; i + 2 < numIndices; i += 3)
+	{
+		if (UNLIKELY(indices[i] >= numVertices || indices[i + 1] >= numVertices || indices[i + 2] >= numVertices))
+			continue;
+		result.insert(result.end(), indices + i, indices + i + 3);
+	}
+
+	size_t targetTriangles = targetIndices / 3;
+	if (result.size() / 3 <= targetTriangles)
+		return 0.0f;
+
+	// Vertices of the mesh
+
+	std::vector<UInt> used(result);
+	std::sort(used.begin(), used.end());
+	used.erase(std::unique(used.begin(), used.end()), used.end());
+
+	std::vector<double> positions(numVertices * 3);
+	for (UInt v : used)
+	{
+		for (int j = 0; j < 3; j++)
+			positions[v * 3 + j] = vertices[v].position[j];
+	}
+
+	// Vertices on attribute seams and on borders of the mesh are locked
+
+	std::vector<char> locked(numVertices, 0);
+
+	std::vector<UInt> byPosition(used);
+	std::sort(byPosition.begin(), byPosition.end(), [&positions](UInt a, UInt b) {
+		return std::lexicographical_compare(&positions[a * 3], &positions[a * 3 + 3],
+			&positions[b * 3], &positions[b * 3 + 3]);
+	});
+	for (size_t i = 1; i < byPosition.size(); i++)
+	{
+		UInt a = byPosition[i - 1], b = byPosition[i];
+		if (std::equal(&positions[a * 3], &positions[a * 3 + 3], &positions[b * 3]))
+			locked[a] = locked[b] = 1;
+	}
+
+	std::unordered_map<uint64_t, int> edges;
+	for (size_t i = 0; i < result.size(); i += 3)
+	{
+		for (int e = 0; e < 3; e++)
+		{
+			uint64_t a = result[i + e], b = result[i + (e + 1) % 3];
+			++edges[(std::min(a, b) << 32) | std::max(a, b)];
+		}
+	}
+	for (const auto & it : edges)
+	{
+		if (it.second != 2)
+		{
+			locked[size_t(it.first >> 32)] = 1;
+			locked[size_t(it.first & 0xFFFFFFFFu)] = 1;
+		}
+	}
+
+	// Quadrics
+
+	std::vector<Quadric> quadrics(numVertices);
+	for (size_t i = 0; i < result.size(); i += 3)
+	{
+		const double * p0 = &positions[result[i] * 3];
+		const double * p1 = &positions[result[i + 1] * 3];
+		const double * p2 = &positions[result[i + 2] * 3];
+
+		double n[3];
+		cross(p0, p1, p2, n);
+		double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		if (length <= 0.0)
+			continue;
+
+		n[0] /= length;
+		n[1] /= length;
+		n[2] /= length;
+		double d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+		double area = length * 0.5;
+
+		for (int j = 0; j < 3; j++)
+			quadrics[result[i + j]].addPlane(n[0], n[1], n[2], d, area);
+	}
+
+	// Collapse edges in passes. In each pass every vertex gets its cheapest collapse, collapses are applied in
+	// order of their cost and vertices around a collapsed vertex are not touched again until the next pass.
+
+	std::vector<UInt> adjacencyOffsets(numVertices + 1);
+	std::vector<UInt> adjacency;
+	std::vector<double> bestCost(numVertices);
+	std::vector<UInt> bestTarget(numVertices);
+	std::vector<UInt> remap(numVertices);
+	std::vector<char> touched(numVertices);
+	std::vector<Collapse> collapses;
+	double maxError = 0.0;
+
+	for (;;)
+	{
+		size_t numTriangles = result.size() / 3;
+		if (numTriangles <= targetTriangles)
+			break;
+
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (UInt v : result)
+			++adjacencyOffsets[v + 1];
+		for (size_t i = 0; i < numVertices; i++)
+			adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+		adjacency.resize(result.size());
+		std::vector<UInt> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < result.size(); i++)
+			adjacency[fill[result[i]]++] = UInt(i / 3);
+
+		for (UInt v : used)
+		{
+			bestCost[v] = std::numeric_limits<double>::max();
+			remap[v] = v;
+			touched[v] = 0;
+		}
+
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			for (int e = 0; e < 3; e++)
+			{
+				UInt a = result[i + e], b = result[i + (e + 1) % 3];
+				for (int k = 0; k < 2; k++, std::swap(a, b))
+				{
+					if (locked[a])
+						continue;
+
+					Quadric q = quadrics[a];
+					q.add(quadrics[b]);
+					double cost = q.error(&positions[b * 3]);
+					if (cost < bestCost[a])
+					{
+						bestCost[a] = cost;
+						bestTarget[a] = b;
+					}
+				}
+			}
+		}
+
+		collapses.clear();
+		for (UInt v : used)
+		{
+			if (bestCost[v] != std::numeric_limits<double>::max())
+				collapses.push_back(Collapse{ v, bestTarget[v], bestCost[v] });
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse & a, const Collapse & b) {
+			return a.cost < b.cost;
+		});
+
+		size_t numCollapsed = 0;
+		for (const Collapse & collapse : collapses)
+		{
+			if (numTriangles <= targetTriangles)
+				break;
+			if (touched[collapse.from] || touched[collapse.to])
+				continue;
+
+			const UInt * first = &adjacency[adjacencyOffsets[collapse.from]];
+			const UInt * last = &adjacency[0] + adjacencyOffsets[collapse.from + 1];
+
+			// Reject collapses that flip triangles
+			size_t removed = 0;
+			bool flips = false;
+			for (const UInt * t = first; t != last && !flips; ++t)
+			{
+				const UInt * tri = &result[*t * 3];
+				if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to)
+				{
+					++removed;
+					continue;
+				}
+
+				const double * p[3];
+				const double * q[3];
+				for (int j = 0; j < 3; j++)
+				{
+					p[j] = &positions[tri[j] * 3];
+					q[j] = (tri[j] == collapse.from ? &positions[collapse.to * 3] : p[j]);
+				}
+
+				double before[3], after[3];
+				cross(p[0], p[1], p[2], before);
+				cross(q[0], q[1], q[2], after);
+				flips = (before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0);
+			}
+			if (flips)
+				continue;
+
+			for (const UInt * t = first; t != last; ++t)
+			{
+				const UInt * tri = &result[*t * 3];
+				touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = 1;
+			}
+
+			Quadric & q = quadrics[collapse.to];
+			q.add(quadrics[collapse.from]);
+			if (q.weight > 0.0)
+				maxError = std::max(maxError, std::sqrt(q.error(&positions[collapse.to * 3]) / q.weight));
+
+			remap[collapse.from] = collapse.to;
+			numTriangles -= removed;
+			++numCollapsed;
+		}
+
+		if (numCollapsed == 0)
+			break;
+
+		size_t count = 0;
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			UInt a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+			if (a == b || b == c || a == c)
+				continue;
+			result[count++] = a;
+			result[count++] = b;
+			result[count++] = c;
+		}
+		result.resize(count);
+	}
+
+	return float(maxError);
+}
+
+void GL::MeshSimplifier::generateLods(ModelData & data, size_t maxLevels, float ratio)
+{
+	// Drop indices of the previously generated levels
+	if (!data.lods.empty())
+	{
+		size_t end = 0;
+		for (const ModelData::Mesh & mesh : data.meshes)
+			end = std::max(end, size_t(mesh.firstIndex) + mesh.numIndices);
+		data.indices.resize(std::min(end, data.indices.size()));
+		data.lods.clear();
+	}
+
+	size_t previousCount = 0;
+	for (const ModelData::Mesh & mesh : data.meshes)
+		previousCount += mesh.numIndices;
+
+	std::vector<UInt> simplified;
+	float scale = 1.0f;
+	for (size_t level = 1; level <= maxLevels; level++)
+	{
+		size_t levelStart = data.indices.size();
+		size_t levelCount = 0;
+		scale *= ratio;
+
+		ModelData::Lod lod;
+		lod.error = 0.0f;
+		lod.meshes.reserve(data.meshes.size());
+
+		for (size_t i = 0; i < data.meshes.size(); i++)
+		{
+			ModelData::Mesh mesh = data.meshes[i];
+			if (UNLIKELY(size_t(mesh.firstIndex) + mesh.numIndices > levelStart))
+				mesh.numIndices = 0;
+
+			size_t target = size_t(float(mesh.numIndices) * scale) / 3 * 3;
+			float error = simplify(data.vertices, data.indices.data() + mesh.firstIndex, mesh.numIndices, target,
+				simplified);
+
+			levelCount += simplified.size();
+
+			mesh.firstIndex = UInt(data.indices.size());
+			mesh.numIndices = UInt(simplified.size());
+			data.indices.insert(data.indices.end(), simplified.begin(), simplified.end());
+
+			lod.meshes.push_back(mesh);
+			lod.error = std::max(lod.error, error);
+		}
+
+		// Level that removes less than half of the requested triangles is not worth its indices: simplification
+		// is blocked by locked vertices and the error grows quickly.
+		if (levelCount == 0 || float(levelCount) > float(previousCount) * (1.0f + ratio) * 0.5f)
+		{
+			data.indices.resize(levelStart);
+			break;
+		}
+
+		data.lods.push_back(std::move(lod));
+		previousCount = levelCount;
+	}
+}
@@ -0,0 +1,79 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __85c3b5590d011d05c9bc628abf102a70__
+#define __85c3b5590d011d05c9bc628abf102a70__
+
+#include "gl_model_data.h"
+#include <yip-imports/gl.h>
+#include <vector>
+
+namespace GL
+{
+	/**
+	 * Simplifier of triangle meshes for generation of levels of detail.
+	 *
+	 * Meshes are simplified by quadric error edge collapse (Garland & Heckbert, "Surface Simplification Using
+	 * Quadric Error Metrics"). Vertices are collapsed into their existing neighbours, so simplified meshes
+	 * reference the original vertices and share the vertex buffer with the full-detail model. Vertices on
+	 * borders of meshes and on attribute seams (vertices with the same position but different texture
+	 * coordinates or normals) are never moved, so meshes do not crack apart. This class does not use OpenGL
+	 * and could be used in offline tools.
+	 */
+	class MeshSimplifier
+	{
+	public:
+		/** Default ratio of number of triangles between adjacent levels of detail. */
+		static constexpr float DefaultRatio = 0.5f;
+
+		/**
+		 * Simplifies the mesh.
+		 * @param vertices Vertices of the model.
+		 * @param indices Pointer to the indices of the mesh.
+		 * @param numIndices Number of indices (should be a multiple of 3).
+		 * @param targetIndices Desired number of indices. Result may contain more indices if the mesh could
+		 * not be simplified further without moving border or seam vertices or flipping triangles.
+		 * @param result Output vector for the indices of the simplified mesh.
+		 * @return Geometric error of the simplified mesh (estimated distance to the original surface, in the
+		 * units of the model).
+		 */
+		static float simplify(const std::vector<Model::Vertex> & vertices, const UInt * indices,
+			size_t numIndices, size_t targetIndices, std::vector<UInt> & result);
+
+		/**
+		 * Generates levels of detail for the model.
+		 * Each level contains one mesh for each mesh of the full-detail model, with *ratio* times less
+		 * triangles than the previous level. Indices of the levels are appended to *data.indices*. Generation
+		 * stops early when a level removes less than half of the requested triangles. Existing levels of detail
+		 * are replaced.
+		 * @param data Model data.
+		 * @param maxLevels Maximum number of levels to generate (not counting the full-detail level).
+		 * @param ratio Ratio of number of triangles between adjacent levels.
+		 */
+		static void generateLods(ModelData & data, size_t maxLevels, float ratio = DefaultRatio);
+
+	private:
+		MeshSimplifier() = delete;
+	};
+}
+
+#endif
@@ -0,0 +1,394 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "gl_mip_builder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <emmintrin.h>
+ #define GL_MIP_BUILDER_SSE2 1
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+ #include <arm_neon.h>
+ #define GL_MIP_BUILDER_NEON 1
+#endif
+
+namespace
+{
+	const int KaiserWidth = 3;
+	const float KaiserAlpha = 4.0f;
+	const int LinearToSrgbTableSize = 16384;
+
+	// Lookup tables for conversion between sRGB and linear space.
+	class GammaTables
+	{
+	public:
+		float toLinear[256];
+		GL::UByte toSrgb[LinearToSrgbTableSize];
+
+		GammaTables()
+		{
+			for (int i = 0; i < 256; i++)
+			{
+				float c = float(i) / 255.0f;
+				toLinear[i] = (c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f));
+			}
+
+			for (int i = 0; i < LinearToSrgbTableSize; i++)
+			{
+				float l = float(i) / float(LinearToSrgbTableSize - 1);
+				float c = (l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f);
+				toSrgb[i] = GL::UByte(std::min(std::max(c * 255.0f + 0.5f, 0.0f), 255.0f));
+			}
+		}
+
+		static const GammaTables & instance()
+		{
+			static const GammaTables tables;
+			return tables;
+		}
+	};
+
+	// Zeroth order modified Bessel function of the first kind.
+	double bessel0(double x)
+	{
+		double sum = 1.0, term = 1.0;
+		for (int k = 1; k < 32; k++)
+		{
+			double t = x / (2.0 * k);
+			term *= t * t;
+			sum += term;
+			if (term < sum * 1e-12)
+				break;
+		}
+		return sum;
+	}
+
+	float kaiser(float x)
+	{
+		if (std::fabs(x) >= float(KaiserWidth))
+			return 0.0f;
+
+		double sinc = 1.0;
+		if (x != 0.0f)
+		{
+			double px = 3.14159265358979323846 * x;
+			sinc = std::sin(px) / px;
+		}
+
+		double t = x / double(KaiserWidth);
+		double window = bessel0(KaiserAlpha * std::sqrt(1.0 - t * t)) / bessel0(KaiserAlpha);
+		return float(sinc * window);
+	}
+
+	// Weights of the filter for each destination pixel along one axis.
+	struct FilterTaps
+	{
+		std::vector<int> first;
+		std::vector<int> count;
+		std::vector<int> indices;
+		std::vector<float> weights;
+	};
+
+	void computeKaiserTaps(int srcSize, int dstSize, FilterTaps & taps)
+	{
+		float scale = float(srcSize) / float(dstSize);
+		float support = float(KaiserWidth) * scale;
+
+		taps.first.resize(size_t(dstSize));
+		taps.count.resize(size_t(dstSize));
+		taps.indices.clear();
+		taps.weights.clear();
+
+		for (int i = 0; i < dstSize; i++)
+		{
+			float center = (float(i) + 0.5f) * scale;
+			int left = int(std::floor(center - support));
+			int right = int(std::ceil(center + support));
+
+			size_t first = taps.weights.size();
+			float total = 0.0f;
+			for (int j = left; j <= right; j++)
+			{
+				float w = kaiser((float(j) + 0.5f - center) / scale);
+				if (w == 0.0f)
+					continue;
+				taps.indices.push_back(std::min(std::max(j, 0), srcSize - 1));
+				taps.weights.push_back(w);
+				total += w;
+			}
+
+			for (size_t k = first; k < taps.weights.size(); k++)
+				taps.weights[k] /= total;
+
+			taps.first[size_t(i)] = int(first);
+			taps.count[size_t(i)] = int(taps.weights.size() - first);
+		}
+	}
+
+	int alphaChannel(int channels)
+	{
+		switch (channels)
+		{
+		case 1: return 0;
+		case 2: return 1;
+		case 4: return 3;
+		default: return -1;
+		}
+	}
+
+	void downsampleBox(const GL::UByte * src, int sw, int sh, int channels, GL::UByte * dst, int dw, int dh)
+	{
+		size_t srcStride = size_t(sw) * size_t(channels);
+
+		for (int y = 0; y < dh; y++)
+		{
+			const GL::UByte * row0 = src + size_t(std::min(y * 2, sh - 1)) * srcStride;
+			const GL::UByte * row1 = src + size_t(std::min(y * 2 + 1, sh - 1)) * srcStride;
+			GL::UByte * out = dst + size_t(y) * size_t(dw) * size_t(channels);
+			int x = 0;
+
+		  #if defined(GL_MIP_BUILDER_SSE2)
+			if (channels == 4 && sw >= 2)
+			{
+				// Two destination pixels (four source pixels of each row) per iteration.
+				const __m128i zero = _mm_setzero_si128();
+				const __m128i two = _mm_set1_epi16(2);
+				for (; x + 2 <= dw && x * 2 + 4 <= sw; x += 2)
+				{
+					__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + x * 8));
+					__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + x * 8));
+					__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+					__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+					lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+					hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+					__m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo, hi), two), 2);
+					_mm_storel_epi64(reinterpret_cast<__m128i *>(out + x * 4), _mm_packus_epi16(sum, sum));
+				}
+			}
+		  #elif defined(GL_MIP_BUILDER_NEON)
+			if (channels == 4 && sw >= 2)
+			{
+				// Two destination pixels (four source pixels of each row) per iteration.
+				for (; x + 2 <= dw && x * 2 + 4 <= sw; x += 2)
+				{
+					uint8x16_t a = vld1q_u8(row0 + x * 8);
+					uint8x16_t b = vld1q_u8(row1 + x * 8);
+					uint16x8_t lo = vaddl_u8(vget_low_u8(a), vget_low_u8(b));
+					uint16x8_t hi = vaddl_u8(vget_high_u8(a), vget_high_u8(b));
+					uint16x4_t sum01 = vadd_u16(vget_low_u16(lo), vget_high_u16(lo));
+					uint16x4_t sum23 = vadd_u16(vget_low_u16(hi), vget_high_u16(hi));
+					vst1_u8(out + x * 4, vrshrn_n_u16(vcombine_u16(sum01, sum23), 2));
+				}
+			}
+		  #endif
+
+			for (; x < dw; x++)
+			{
+				size_t x0 = size_t(std::min(x * 2, sw - 1)) * size_t(channels);
+				size_t x1 = size_t(std::min(x * 2 + 1, sw - 1)) * size_t(channels);
+				for (int c = 0; c < channels; c++)
+				{
+					unsigned sum = unsigned(row0[x0 + c]) + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+					out[size_t(x) * size_t(channels) + size_t(c)] = GL::UByte((sum + 2) >> 2);
+				}
+			}
+		}
+	}
+
+	void downsampleBox(const float * src, int sw, int sh, int channels, float * dst, int dw, int dh)
+	{
+		size_t srcStride = size_t(sw) * size_t(channels);
+
+		for (int y = 0; y < dh; y++)
+		{
+			const float * row0 = src + size_t(std::min(y * 2, sh - 1)) * srcStride;
+			const float * row1 = src + size_t(std::min(y * 2 + 1, sh - 1)) * srcStride;
+			float * out = dst + size_t(y) * size_t(dw) * size_t(channels);
+
+			for (int x = 0; x < dw; x++)
+			{
+				size_t x0 = size_t(std::min(x * 2, sw - 1)) * size_t(channels);
+				size_t x1 = size_t(std::min(x * 2 + 1, sw - 1)) * size_t(channels);
+				for (int c = 0; c < channels; c++)
+					*out++ = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c]) * 0.25f;
+			}
+		}
+	}
+
+	void downsampleKaiser(const float * src, int sw, int sh, int channels, float * dst, int dw, int dh,
+		std::vector<float> & temp)
+	{
+		FilterTaps horizontal, vertical;
+		computeKaiserTaps(sw, dw, horizontal);
+		computeKaiserTaps(sh, dh, vertical);
+
+		// Horizontal pass: sw x sh -> dw x sh
+		temp.resize(size_t(dw) * size_t(sh) * size_t(channels));
+		for (int y = 0; y < sh; y++)
+		{
+			const float * row = src + size_t(y) * size_t(sw) * size_t(channels);
+			float * out = &temp[size_t(y) * size_t(dw) * size_t(channels)];
+			for (int x = 0; x < dw; x++, out += channels)
+			{
+				for (int c = 0; c < channels; c++)
+					out[c] = 0.0f;
+
+				const int * index = &horizontal.indices[size_t(horizontal.first[size_t(x)])];
+				const float * weight = &horizontal.weights[size_t(horizontal.first[size_t(x)])];
+				for (int k = 0; k < horizontal.count[size_t(x)]; k++)
+				{
+					const float * p = row + size_t(index[k]) * size_t(channels);
+					for (int c = 0; c < channels; c++)
+						out[c] += p[c] * weight[k];
+				}
+			}
+		}
+
+		// Vertical pass: dw x sh -> dw x dh
+		size_t rowSize = size_t(dw) * size_t(channels);
+		for (int y = 0; y < dh; y++)
+		{
+			float * out = dst + size_t(y) * rowSize;
+			std::fill(out, out + rowSize, 0.0f);
+
+			const int * index = &vertical.indices[size_t(vertical.first[size_t(y)])];
+			const float * weight = &vertical.weights[size_t(vertical.first[size_t(y)])];
+			for (int k = 0; k < vertical.count[size_t(y)]; k++)
+			{
+				const float * row = &temp[size_t(index[k]) * rowSize];
+				for (size_t i = 0; i < rowSize; i++)
+					out[i] += row[i] * weight[k];
+			}
+		}
+	}
+}
+
+GL::MipBuilder::MipBuilder(Filter filter, bool gammaCorrect)
+	: m_Filter(filter),
+	  m_GammaCorrect(gammaCorrect)
+{
+}
+
+void GL::MipBuilder::build(const void * pixels, int width, int height, int channels,
+	std::vector<Level> & levels) const
+{
+	levels.clear();
+	if (width <= 0 || height <= 0 || channels <= 0 || (width == 1 && height == 1))
+		return;
+
+	levels.reserve(size_t(numLevels(width, height) - 1));
+
+	// Fast path: 8-bit box filter
+	if (m_Filter == BoxFilter && !m_GammaCorrect)
+	{
+		const UByte * src = reinterpret_cast<const UByte *>(pixels);
+		int w = width, h = height;
+		while (w > 1 || h > 1)
+		{
+			Level level;
+			level.width = std::max(w / 2, 1);
+			level.height = std::max(h / 2, 1);
+			level.pixels.resize(size_t(level.width) * size_t(level.height) * size_t(channels));
+			downsampleBox(src, w, h, channels, level.pixels.data(), level.width, level.height);
+
+			levels.push_back(std::move(level));
+			src = levels.back().pixels.data();
+			w = levels.back().width;
+			h = levels.back().height;
+		}
+		return;
+	}
+
+	// Floating point path
+	const GammaTables & tables = GammaTables::instance();
+	int alpha = alphaChannel(channels);
+	bool gamma = m_GammaCorrect;
+
+	size_t numValues = size_t(width) * size_t(height) * size_t(channels);
+	std::vector<float> current(numValues), next, temp;
+	const UByte * p = reinterpret_cast<const UByte *>(pixels);
+	for (size_t i = 0; i < numValues; i++)
+	{
+		int c = int(i % size_t(channels));
+		current[i] = (gamma && c != alpha ? tables.toLinear[p[i]] : float(p[i]) * (1.0f / 255.0f));
+	}
+
+	int w = width, h = height;
+	while (w > 1 || h > 1)
+	{
+		Level level;
+		level.width = std::max(w / 2, 1);
+		level.height = std::max(h / 2, 1);
+
+		size_t count = size_t(level.width) * size_t(level.height) * size_t(channels);
+		next.resize(count);
+		if (m_Filter == KaiserFilter)
+			downsampleKaiser(current.data(), w, h, channels, next.data(), level.width, level.height, temp);
+		else
+			downsampleBox(current.data(), w, h, channels, next.data(), level.width, level.height);
+
+		level.pixels.resize(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			float v = std::min(std::max(next[i], 0.0f), 1.0f);
+			int c = int(i % size_t(channels));
+			if (gamma && c != alpha)
+				level.pixels[i] = tables.toSrgb[int(v * float(LinearToSrgbTableSize - 1) + 0.5f)];
+			else
+				level.pixels[i] = UByte(v * 255.0f + 0.5f);
+		}
+
+		levels.push_back(std::move(level));
+		current.swap(next);
+		w = levels.back().width;
+		h = levels.back().height;
+	}
+}
+
+void GL::MipBuilder::build(const Stb::Image & image, std::vector<Level> & levels) const
+{
+	int channels = 0;
+	switch (image.format())
+	{
+	case Stb::Image::UNKNOWN: break;
+	case Stb::Image::ALPHA: channels = 1; break;
+	case Stb::Image::LUMINANCE_ALPHA: channels = 2; break;
+	case Stb::Image::RGB: channels = 3; break;
+	case Stb::Image::RGBA: channels = 4; break;
+	}
+
+	build(image.data(), image.width(), image.height(), channels, levels);
+}
+
+int GL::MipBuilder::numLevels(int width, int height)
+{
+	int levels = 1;
+	while (width > 1 || height > 1)
+	{
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+		++levels;
+	}
+	return levels;
+}
@@ -0,0 +1,116 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __a055b94aaf3738ecbe939a226dbe336e__
+#define __a055b94aaf3738ecbe939a226dbe336e__
+
+#include <yip-imports/gl.h>
+#include <yip-imports/stb_image.hpp>
+#include <vector>
+#include <memory>
+
+namespace GL
+{
+	/**
+	 * Builder of mipmap chains on the CPU.
+	 *
+	 * Each level is downsampled from the previous one. The box filter averages 2x2 blocks of pixels and, when
+	 * gamma correction is disabled, uses SSE2 or NEON for RGBA images. The Kaiser filter is a separable
+	 * windowed sinc filter that keeps more detail in the smaller levels at a higher cost. In gamma-correct mode
+	 * color channels are converted from sRGB into linear space before filtering and back after filtering;
+	 * alpha is always filtered as is. Filtering in gamma-correct mode or with the Kaiser filter is performed in
+	 * floating point without quantization of intermediate levels.
+	 *
+	 * This class does not use OpenGL, so mipmaps could be built in a background thread.
+	 */
+	class MipBuilder
+	{
+	public:
+		/** Downsampling filter. */
+		enum Filter
+		{
+			BoxFilter = 0,						/**< Average of 2x2 pixels. */
+			KaiserFilter,						/**< Kaiser-windowed sinc filter. */
+		};
+
+		/** Mipmap level. */
+		struct Level
+		{
+			int width;							/**< Width of the level in pixels. */
+			int height;							/**< Height of the level in pixels. */
+			std::vector<UByte> pixels;			/**< Pixels (rows are tightly packed). */
+		};
+
+		/**
+		 * Constructor.
+		 * @param filter Downsampling filter.
+		 * @param gammaCorrect Set to *true* to filter color channels in linear space.
+		 */
+		explicit MipBuilder(Filter filter = BoxFilter, bool gammaCorrect = false);
+
+		/**
+		 * Returns downsampling filter.
+		 * @return Filter.
+		 */
+		inline Filter filter() const noexcept { return m_Filter; }
+
+		/**
+		 * Checks whether color channels are filtered in linear space.
+		 * @return *true* if filtering is gamma-correct, *false* otherwise.
+		 */
+		inline bool gammaCorrect() const noexcept { return m_GammaCorrect; }
+
+		/**
+		 * Builds mipmap levels for the image.
+		 * @param pixels Pointer to the pixels of the image (rows are tightly packed).
+		 * @param width Width of the image in pixels.
+		 * @param height Height of the image in pixels.
+		 * @param channels Number of channels (1 for alpha, 2 for luminance and alpha, 3 for RGB or 4 for RGBA).
+		 * @param levels Output vector. Receives levels starting with level 1 and ending with the 1x1 level.
+		 */
+		void build(const void * pixels, int width, int height, int channels, std::vector<Level> & levels) const;
+
+		/**
+		 * Builds mipmap levels for the image.
+		 * @param image Image.
+		 * @param levels Output vector. Receives levels starting with level 1 and ending with the 1x1 level.
+		 */
+		void build(const Stb::Image & image, std::vector<Level> & levels) const;
+
+		/**
+		 * Returns number of mipmap levels for an image of the specified size.
+		 * @param width Width of the image.
+		 * @param height Height of the image.
+		 * @return Number of levels, including level 0.
+		 */
+		static int numLevels(int width, int height);
+
+	private:
+		Filter m_Filter;
+		bool m_GammaCorrect;
+	};
+
+	/** Shared list of mipmap levels built by GL::MipBuilder. */
+	typedef std::shared_ptr<const std::vector<MipBuilder::Level>> MipLevelsPtr;
+}
+
+#endif
@@ -21,6 +21,7 @@
 // THE SOFTWARE.
 //
 #include "gl_model.h"
+#include "gl_model_data.h"
 #include "gl_resource_manager.h"
 #include "gl_buffer_binder.h"
 #include <yip-imports/cxx-util/macros.h>
@@ -28,6 +29,24 @@
 #include <vector>
 #include <stdexcept>
 #include <memory>
+#include <cmath>
+#include <algorithm>
+#include <tuple>
+#include <limits>
+
+// OpenGL ES 2.0 converts normalized signed integers using f = (2c + 1) / (2^b - 1)
+
+static GL::Short packSnorm16(float value)
+{
+	float c = std::floor((value * 65535.0f - 1.0f) * 0.5f + 0.5f);
+	return static_cast<GL::Short>(std::max(-32768.0f, std::min(32767.0f, c)));
+}
+
+static GL::Byte packSnorm8(float value)
+{
+	float c = std::floor((value * 255.0f - 1.0f) * 0.5f + 0.5f);
+	return static_cast<GL::Byte>(std::max(-128.0f, std::min(127.0f, c)));
+}
 
 void GL::Model::Material::initWithDefaults()
 {
@@ -56,21 +75,49 @@ void GL::Model::Material::initWithDefaults()
 GL::Model::Model(ResourceManager * resMgr, const std::string & resName)
 	: Resource(resMgr, resName),
 	  m_IndexType(GL::UNSIGNED_SHORT),
+	  m_VertexFormat(FloatVertexFormat),
 	  m_Radius(0.0f),
 	  m_NumTriangles(0),
-	  m_NumVertices(0)
+	  m_NumVertices(0),
+	  m_DrawListValid(false),
+	  m_MeshBoundsValid(false)
 {
 	setCenter(0.0f, 0.0f, 0.0f);
 	setSize(0.0f, 0.0f, 0.0f);
+	for (int i = 0; i < 3; i++)
+	{
+		m_PositionScale[i] = 1.0f;
+		m_PositionOffset[i] = 0.0f;
+	}
 	m_Vertices = resMgr->createBuffer(resName);
 	m_Indices = resMgr->createBuffer(resName);
 }
 
 void GL::Model::bindVertexBuffer(int aPos, int aTexCoord, int aNorm, int aTangent, int aBinorm) const
 {
+	GL::BufferBinder binder(m_Vertices, GL::ARRAY_BUFFER);
+
+	if (m_VertexFormat == PackedVertexFormat)
+	{
+		#define OFF(X) ((void *)offsetof(PackedVertex, X))
+
+		Sizei stride = Sizei(sizeof(PackedVertex));
+
+		if (aPos >= 0)
+			GL::vertexAttribPointer(aPos, 3, GL::SHORT, GL::TRUE, stride, OFF(position));
+		if (aTexCoord >= 0)
+			GL::vertexAttribPointer(aTexCoord, 2, GL::FLOAT, GL::FALSE, stride, OFF(texCoord));
+		if (aNorm >= 0)
+			GL::vertexAttribPointer(aNorm, 3, GL::BYTE, GL::TRUE, stride, OFF(normal));
+		if (aTangent >= 0)
+			GL::vertexAttribPointer(aTangent, 4, GL::BYTE, GL::TRUE, stride, OFF(tangent));
+
+		#undef OFF
+		return;
+	}
+
 	#define OFF(X) ((void *)offsetof(Vertex, X))
 
-	GL::BufferBinder binder(m_Vertices, GL::ARRAY_BUFFER);
 	Sizei stride = Sizei(sizeof(Vertex));
 
 	if (aPos >= 0)
@@ -87,28 +134,433 @@ void GL::Model::bindVertexBuffer(int aPos, int aTexCoord, int aNorm, int aTangen
 	#undef OFF
 }
 
-void GL::Model::drawMesh(int index) const
+void GL::Model::packVertices(const Vertex * vertices, size_t count, PackedVertex * packed, float scale[3],
+	float offset[3])
 {
-	const Mesh & mesh = m_Meshes[index];
+	float minPos[3] = { 0.0f, 0.0f, 0.0f };
+	float maxPos[3] = { 0.0f, 0.0f, 0.0f };
+	for (size_t i = 0; i < count; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			float value = vertices[i].position[j];
+			if (i == 0 || value < minPos[j])
+				minPos[j] = value;
+			if (i == 0 || value > maxPos[j])
+				maxPos[j] = value;
+		}
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		offset[i] = (minPos[i] + maxPos[i]) * 0.5f;
+		scale[i] = (maxPos[i] - minPos[i]) * 0.5f;
+		if (scale[i] <= 0.0f)
+			scale[i] = 1.0f;
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const Vertex & src = vertices[i];
+		PackedVertex & dst = packed[i];
+
+		for (int j = 0; j < 3; j++)
+		{
+			dst.position[j] = packSnorm16((src.position[j] - offset[j]) / scale[j]);
+			dst.normal[j] = packSnorm8(src.normal[j]);
+			dst.tangent[j] = packSnorm8(src.tangent[j]);
+		}
+
+		dst.position[3] = 0;
+		dst.normal[3] = 0;
+		dst.tangent[3] = packSnorm8(src.tangent[3] < 0.0f ? -1.0f : 1.0f);
+		dst.texCoord[0] = src.texCoord[0];
+		dst.texCoord[1] = src.texCoord[1];
+	}
+}
+
+void GL::Model::uploadVertices(const Vertex * vertices, size_t count, VertexFormat format)
+{
+	retainVertices(vertices, count);
+
+	if (format != PackedVertexFormat)
+	{
+		static const float scale[3] = { 1.0f, 1.0f, 1.0f };
+		static const float offset[3] = { 0.0f, 0.0f, 0.0f };
+		uploadVertexData(vertices, count * sizeof(Vertex), count, format, scale, offset);
+		return;
+	}
+
+	float scale[3], offset[3];
+	std::vector<PackedVertex> packed(count);
+	packVertices(vertices, count, packed.data(), scale, offset);
+	uploadVertexData(packed.data(), packed.size() * sizeof(PackedVertex), count, format, scale, offset);
+}
+
+void GL::Model::uploadVertexData(const void * data, size_t size, size_t count, VertexFormat format,
+	const float * scale, const float * offset)
+{
+	m_VertexFormat = format;
+	setNumVertices(int(count));
+
+	for (int i = 0; i < 3; i++)
+	{
+		m_PositionScale[i] = scale[i];
+		m_PositionOffset[i] = offset[i];
+	}
+
+	m_Vertices->setData(GL::ARRAY_BUFFER, data, size, GL::STATIC_DRAW);
+}
+
+void GL::Model::uploadIndices(const UInt * indices, size_t count)
+{
+	retainIndices(indices, count);
+
+	if (m_NumVertices < 0xFF)
+	{
+		std::vector<GL::UByte> narrow(count);
+		for (size_t i = 0; i < count; i++)
+			narrow[i] = static_cast<GL::UByte>(indices[i]);
+		m_Indices->setData(GL::ELEMENT_ARRAY_BUFFER, narrow.data(), narrow.size(), GL::STATIC_DRAW);
+		setIndexType(GL::UNSIGNED_BYTE);
+	}
+	else if (m_NumVertices < 0xFFFF)
+	{
+		std::vector<GL::UShort> narrow(count);
+		for (size_t i = 0; i < count; i++)
+			narrow[i] = static_cast<GL::UShort>(indices[i]);
+		m_Indices->setData(GL::ELEMENT_ARRAY_BUFFER, narrow.data(), narrow.size() * sizeof(GL::UShort),
+			GL::STATIC_DRAW);
+		setIndexType(GL::UNSIGNED_SHORT);
+	}
+	else
+	{
+		m_Indices->setData(GL::ELEMENT_ARRAY_BUFFER, indices, count * sizeof(GL::UInt), GL::STATIC_DRAW);
+		setIndexType(GL::UNSIGNED_INT);
+	}
+}
+
+void GL::Model::retainVertices(const Vertex * vertices, size_t count)
+{
+	if (manager() && manager()->retainModelGeometry())
+		m_RetainedVertices.assign(vertices, vertices + count);
+}
+
+void GL::Model::retainIndices(const UInt * indices, size_t count)
+{
+	if (manager() && manager()->retainModelGeometry())
+		m_RetainedIndices.assign(indices, indices + count);
+}
+
+void GL::Model::initFromData(const ModelData & data)
+{
+	setCenter(data.center[0], data.center[1], data.center[2]);
+	setSize(data.size[0], data.size[1], data.size[2]);
+	setRadius(data.radius);
+	setNumTriangles(int(data.indices.size() / 3));
+
+	uploadVertices(data.vertices.data(), data.vertices.size(), manager()->defaultVertexFormat());
+	uploadIndices(data.indices.data(), data.indices.size());
+
+	initMaterialsAndMeshes(data);
+}
+
+void GL::Model::initMaterialsAndMeshes(const ModelData & data)
+{
+	setNumMaterials(data.materials.size());
+	for (size_t i = 0; i < data.materials.size(); i++)
+	{
+		const ModelData::Material & m = data.materials[i];
+		Material & mat = material(i);
+
+	  #ifdef HAVE_GLM
+		mat.ambient = glm::vec4(m.ambient[0], m.ambient[1], m.ambient[2], m.ambient[3]);
+		mat.diffuse = glm::vec4(m.diffuse[0], m.diffuse[1], m.diffuse[2], m.diffuse[3]);
+		mat.specular = glm::vec4(m.specular[0], m.specular[1], m.specular[2], m.specular[3]);
+	  #else
+		std::copy(&m.ambient[0], m.ambient + sizeof(m.ambient) / sizeof(m.ambient[0]), &mat.ambient[0]);
+		std::copy(&m.diffuse[0], m.diffuse + sizeof(m.diffuse) / sizeof(m.diffuse[0]), &mat.diffuse[0]);
+		std::copy(&m.specular[0], m.specular + sizeof(m.specular) / sizeof(m.specular[0]), &mat.specular[0]);
+	  #endif
+		mat.shininess = m.shininess;
+		mat.opacity = m.opacity;
+
+		if (m.texture.length() > 0)
+			mat.texture = manager()->getTexture(m.texture);
+		if (m.normalMap.length() > 0)
+			mat.normalMap = manager()->getTexture(m.normalMap);
+	}
+
+	if (data.materials.empty())
+	{
+		setNumMaterials(1);
+		material(0).initWithDefaults();
+	}
+
+	setNumMeshes(data.meshes.size());
+	for (size_t i = 0; i < data.meshes.size(); i++)
+	{
+		const ModelData::Mesh & m = data.meshes[i];
+		Mesh & mm = mesh(i);
+
+		mm.firstIndex = Int(m.firstIndex);
+		mm.numIndices = Int(m.numIndices);
+		mm.material = &material(size_t(std::min(std::max(m.materialIndex, 0), int(numMaterials()) - 1)));
+		mm.setBounds(m.boundsMin, m.boundsMax, m.center, m.radius);
+	}
+
+	m_Lods.resize(data.lods.size());
+	for (size_t i = 0; i < data.lods.size(); i++)
+	{
+		const ModelData::Lod & src = data.lods[i];
+		Lod & lod = m_Lods[i];
 
-	size_t step = 0;
+		lod.error = src.error;
+		lod.meshes.resize(src.meshes.size());
+		for (size_t j = 0; j < src.meshes.size(); j++)
+		{
+			const ModelData::Mesh & m = src.meshes[j];
+			Mesh & mm = lod.meshes[j];
+
+			mm.init(&material(size_t(std::min(std::max(m.materialIndex, 0), int(numMaterials()) - 1))),
+				Int(m.firstIndex), Int(m.numIndices));
+			mm.setBounds(m.boundsMin, m.boundsMax, m.center, m.radius);
+		}
+	}
+	m_DrawListValid = false;
+}
+
+size_t GL::Model::indexSize() const
+{
 	switch (m_IndexType)
 	{
-	case GL::UNSIGNED_BYTE: step = sizeof(UByte); break;
-	case GL::UNSIGNED_SHORT: step = sizeof(UShort); break;
-	case GL::UNSIGNED_INT: step = sizeof(UInt); break;
+	case GL::UNSIGNED_BYTE: return sizeof(UByte);
+	case GL::UNSIGNED_SHORT: return sizeof(UShort);
+	case GL::UNSIGNED_INT: return sizeof(UInt);
 	default: throw std::runtime_error("indices have invalid type.");
 	}
+}
+
+void GL::Model::drawMesh(int index) const
+{
+	const Mesh & mesh = m_Meshes[index];
+	size_t step = indexSize();
+	GL::drawElements(GL::TRIANGLES, mesh.numIndices, m_IndexType, (void *)(mesh.firstIndex * step));
+}
 
+void GL::Model::drawLodMesh(size_t level, int index) const
+{
+	const Mesh & mesh = lodMeshes(level)[index];
+	size_t step = indexSize();
 	GL::drawElements(GL::TRIANGLES, mesh.numIndices, m_IndexType, (void *)(mesh.firstIndex * step));
 }
 
+float GL::Model::projectedRadius(float distance, float projectionScale) const
+{
+	// Camera inside of the bounding sphere sees the model at full size
+	if (distance <= m_Radius)
+		return std::numeric_limits<float>::max();
+	return m_Radius * projectionScale / distance;
+}
+
+size_t GL::Model::selectLod(float projectedRadius, float maxPixelError) const
+{
+	if (m_Radius <= 0.0f)
+		return 0;
+
+	float pixelsPerUnit = projectedRadius / m_Radius;
+	for (size_t level = m_Lods.size(); level > 0; level--)
+	{
+		if (m_Lods[level - 1].error * pixelsPerUnit <= maxPixelError)
+			return level;
+	}
+
+	return 0;
+}
+
+void GL::Model::visibleMeshes(const Frustum & frustum, std::vector<int> & visible) const
+{
+	if (!m_MeshBoundsValid)
+	{
+		m_MeshBounds.clear();
+		for (const Mesh & mesh : m_Meshes)
+			m_MeshBounds.add(&mesh.boundsMin[0], &mesh.boundsMax[0], &mesh.center[0], mesh.radius);
+		m_MeshBoundsValid = true;
+	}
+
+	visible.clear();
+	frustum.cull(m_MeshBounds, visible);
+}
+
+const std::vector<GL::Model::DrawCommand> & GL::Model::lodDrawList(size_t level) const
+{
+	if (!m_DrawListValid)
+	{
+		m_DrawLists.resize(numLods());
+		for (size_t i = 0; i < m_DrawLists.size(); i++)
+			buildDrawList(lodMeshes(i), m_DrawLists[i]);
+		m_DrawListValid = true;
+	}
+	return m_DrawLists[level];
+}
+
+void GL::Model::buildDrawList(const std::vector<Mesh> & meshes, std::vector<DrawCommand> & list)
+{
+	list.clear();
+	list.reserve(meshes.size());
+
+	for (const Mesh & mesh : meshes)
+	{
+		if (mesh.numIndices <= 0)
+			continue;
+
+		DrawCommand command;
+		command.material = mesh.material;
+		command.firstIndex = mesh.firstIndex;
+		command.numIndices = mesh.numIndices;
+		list.push_back(command);
+	}
+
+	// Transparent meshes are drawn after opaque ones; within each group meshes are sorted by textures.
+	// Meshes with the same material keep order of their indices, so contiguous ranges end up adjacent.
+	auto key = [](const DrawCommand & command) {
+		const Material * m = command.material;
+		return std::make_tuple(m && m->opacity < 1.0f, m ? m->texture.get() : nullptr,
+			m ? m->normalMap.get() : nullptr, m ? -m->opacity : -1.0f, m, command.firstIndex);
+	};
+	std::sort(list.begin(), list.end(), [&key](const DrawCommand & a, const DrawCommand & b) {
+		return key(a) < key(b);
+	});
+
+	size_t count = 0;
+	for (size_t i = 0; i < list.size(); i++)
+	{
+		if (count > 0)
+		{
+			DrawCommand & last = list[count - 1];
+			const DrawCommand & cur = list[i];
+			if (last.material == cur.material && last.firstIndex + last.numIndices == cur.firstIndex)
+			{
+				last.numIndices += cur.numIndices;
+				continue;
+			}
+		}
+		list[count++] = list[i];
+	}
+	list.resize(count);
+}
+
+void GL::Model::drawLod(size_t level, int textureUnit, int normalMapUnit,
+	const MaterialCallback & onMaterialChange) const
+{
+	const std::vector<DrawCommand> & commands = lodDrawList(level);
+	size_t step = indexSize();
+
+	StateCache & stateCache = StateCache::current();
+	const Material * lastMaterial = nullptr;
+	const Texture * lastTexture = nullptr;
+	const Texture * lastNormalMap = nullptr;
+
+	for (const DrawCommand & command : commands)
+	{
+		const Material * material = command.material;
+		if (material && material != lastMaterial)
+		{
+			if (textureUnit >= 0 && material->texture && material->texture.get() != lastTexture)
+			{
+				stateCache.activeTexture(GL::Enum(GL::TEXTURE0 + textureUnit));
+				material->texture->bind();
+				lastTexture = material->texture.get();
+			}
+
+			if (normalMapUnit >= 0 && material->normalMap && material->normalMap.get() != lastNormalMap)
+			{
+				stateCache.activeTexture(GL::Enum(GL::TEXTURE0 + normalMapUnit));
+				material->normalMap->bind();
+				lastNormalMap = material->normalMap.get();
+			}
+
+			if (onMaterialChange)
+				onMaterialChange(*material);
+
+			lastMaterial = material;
+		}
+
+		GL::drawElements(GL::TRIANGLES, command.numIndices, m_IndexType, (void *)(command.firstIndex * step));
+	}
+}
+
+static size_t countTextureBinds(const GL::Model::Material * material, const GL::Texture *& lastTexture,
+	const GL::Texture *& lastNormalMap)
+{
+	size_t binds = 0;
+	if (material && material->texture && material->texture.get() != lastTexture)
+	{
+		lastTexture = material->texture.get();
+		++binds;
+	}
+	if (material && material->normalMap && material->normalMap.get() != lastNormalMap)
+	{
+		lastNormalMap = material->normalMap.get();
+		++binds;
+	}
+	return binds;
+}
+
+GL::Model::DrawStatistics GL::Model::meshDrawStatistics() const
+{
+	DrawStatistics stats;
+	stats.drawCalls = 0;
+	stats.textureBinds = 0;
+
+	const Texture * lastTexture = nullptr;
+	const Texture * lastNormalMap = nullptr;
+	for (const Mesh & mesh : m_Meshes)
+	{
+		if (mesh.numIndices <= 0)
+			continue;
+		stats.textureBinds += countTextureBinds(mesh.material, lastTexture, lastNormalMap);
+		++stats.drawCalls;
+	}
+
+	return stats;
+}
+
+GL::Model::DrawStatistics GL::Model::drawListStatistics() const
+{
+	DrawStatistics stats;
+	stats.drawCalls = 0;
+	stats.textureBinds = 0;
+
+	const Texture * lastTexture = nullptr;
+	const Texture * lastNormalMap = nullptr;
+	for (const DrawCommand & command : drawList())
+	{
+		stats.textureBinds += countTextureBinds(command.material, lastTexture, lastNormalMap);
+		++stats.drawCalls;
+	}
+
+	return stats;
+}
+
+size_t GL::Model::memoryUsage() const
+{
+	return m_Vertices->memoryUsage() + m_Indices->memoryUsage();
+}
+
 void GL::Model::destroy()
 {
 	m_Indices->destroy();
 	m_Vertices->destroy();
 	m_Meshes.clear();
 	m_Materials.clear();
+	m_RetainedVertices.clear();
+	m_RetainedIndices.clear();
+	m_Lods.clear();
+	m_DrawLists.clear();
+	m_DrawListValid = false;
+	m_MeshBounds.clear();
+	m_MeshBoundsValid = false;
 	setCenter(0.0f, 0.0f, 0.0f);
 	setSize(0.0f, 0.0f, 0.0f);
 	m_Radius = 0.0f;
@@ -27,8 +27,11 @@
 #include "gl_buffer.h"
 #include "gl_texture.h"
 #include "gl_attrib.h"
+#include "gl_frustum.h"
 #include <yip-imports/gl.h>
 #include <memory>
+#include <vector>
+#include <functional>
 
 #ifdef HAVE_GLM
 #include <yip-imports/glm/glm.hpp>
@@ -36,6 +39,8 @@
 
 namespace GL
 {
+	struct ModelData;
+
 	/** Base class for 3D models. */
 	class Model : public Resource
 	{
@@ -58,6 +63,32 @@ namespace GL
 		  #endif
 		};
 
+		/**
+		 * Packed vertex.
+		 * Position is stored as normalized signed shorts relative to the bounding box of the model and should
+		 * be dequantized in the vertex shader using positionScale() and positionOffset(). Normal and tangent are
+		 * stored as normalized signed bytes, *w* component of the tangent contains handedness of the tangent
+		 * space. Binormal is not stored and should be derived in the shader:
+		 * @code
+		 * vec3 position = a_position * u_positionScale + u_positionOffset;
+		 * vec3 binormal = cross(a_normal, a_tangent.xyz) * a_tangent.w;
+		 * @endcode
+		 */
+		struct PackedVertex
+		{
+			Short position[4];					/**< Quantized position (*w* is unused). */
+			Float texCoord[2];					/**< Texture coordinates of the vertex. */
+			Byte normal[4];						/**< Normal (*w* is unused). */
+			Byte tangent[4];					/**< Tangent, *w* contains handedness. */
+		};
+
+		/** Layout of vertices in the vertex buffer. */
+		enum VertexFormat
+		{
+			FloatVertexFormat = 0,				/**< Vertices are stored as GL::Model::Vertex. */
+			PackedVertexFormat,					/**< Vertices are stored as GL::Model::PackedVertex. */
+		};
+
 		/** Material. */
 		struct Material
 		{
@@ -85,6 +116,16 @@ namespace GL
 			const Material * material;			/**< Pointer to the material. */
 			Int firstIndex;						/**< First index. */
 			Int numIndices;						/**< Number of indices. */
+		  #ifdef HAVE_GLM
+			glm::vec3 boundsMin;				/**< Minimum corner of the bounding box. */
+			glm::vec3 boundsMax;				/**< Maximum corner of the bounding box. */
+			glm::vec3 center;					/**< Center of the bounding sphere. */
+		  #else
+			Float boundsMin[3];					/**< Minimum corner of the bounding box. */
+			Float boundsMax[3];					/**< Maximum corner of the bounding box. */
+			Float center[3];					/**< Center of the bounding sphere. */
+		  #endif
+			Float radius;						/**< Radius of the bounding sphere. */
 
 			/**
 			 * Initializes mesh data.
@@ -98,8 +139,52 @@ namespace GL
 				firstIndex = first;
 				numIndices = num;
 			}
+
+			/**
+			 * Sets bounding volumes of the mesh.
+			 * @param min Minimum corner of the bounding box.
+			 * @param max Maximum corner of the bounding box.
+			 * @param sphereCenter Center of the bounding sphere.
+			 * @param sphereRadius Radius of the bounding sphere.
+			 */
+			inline void setBounds(const float * min, const float * max, const float * sphereCenter,
+				float sphereRadius) noexcept
+			{
+				for (int i = 0; i < 3; i++)
+				{
+					boundsMin[i] = min[i];
+					boundsMax[i] = max[i];
+					center[i] = sphereCenter[i];
+				}
+				radius = sphereRadius;
+			}
+		};
+
+		/** Simplified level of detail. */
+		struct Lod
+		{
+			Float error;						/**< Geometric error of the level (in units of the model). */
+			std::vector<Mesh> meshes;			/**< Meshes (one for each mesh of the full-detail model). */
+		};
+
+		/** Draw call in the draw list. */
+		struct DrawCommand
+		{
+			const Material * material;			/**< Pointer to the material. */
+			Int firstIndex;						/**< First index. */
+			Int numIndices;						/**< Number of indices. */
+		};
+
+		/** Statistics of draw submission. */
+		struct DrawStatistics
+		{
+			size_t drawCalls;					/**< Number of calls to GL::drawElements. */
+			size_t textureBinds;				/**< Number of texture binds. */
 		};
 
+		/** Callback invoked by draw() when material changes (e.g. to set material uniforms). */
+		typedef std::function<void(const Material &)> MaterialCallback;
+
 		/**
 		 * Constructor.
 		 * @param resMgr Pointer to the resource manager.
@@ -118,7 +203,7 @@ namespace GL
 		 * @param index Index of the material.
 		 * @return Reference to the specified material.
 		 */
-		inline Material & material(size_t index) { return m_Materials[index]; }
+		inline Material & material(size_t index) { m_DrawListValid = false; return m_Materials[index]; }
 
 		/**
 		 * Returns reference to the specified material.
@@ -138,7 +223,8 @@ namespace GL
 		 * @param index Index of the mesh.
 		 * @return Reference to the specified mesh.
 		 */
-		inline Mesh & mesh(size_t index) { return m_Meshes[index]; }
+		inline Mesh & mesh(size_t index)
+			{ m_DrawListValid = false; m_MeshBoundsValid = false; return m_Meshes[index]; }
 
 		/**
 		 * Returns reference to the specified mesh.
@@ -159,6 +245,68 @@ namespace GL
 		 */
 		inline const GL::BufferPtr & vertexBuffer() const noexcept { return m_Vertices; }
 
+		/**
+		 * Returns layout of vertices in the vertex buffer.
+		 * @return Vertex format.
+		 */
+		inline VertexFormat vertexFormat() const noexcept { return m_VertexFormat; }
+
+		/**
+		 * Returns size of a single vertex in the vertex buffer.
+		 * @return Size of a vertex in bytes.
+		 */
+		inline size_t vertexStride() const noexcept
+			{ return (m_VertexFormat == PackedVertexFormat ? sizeof(PackedVertex) : sizeof(Vertex)); }
+
+		/**
+		 * Returns data type of indices in the index buffer.
+		 * @return Data type of indices (GL::UNSIGNED_BYTE, GL::UNSIGNED_SHORT or GL::UNSIGNED_INT).
+		 */
+		inline GL::Enum indexType() const noexcept { return m_IndexType; }
+
+		/**
+		 * Returns size of a single index in the index buffer.
+		 * @return Size of an index in bytes.
+		 */
+		size_t indexSize() const;
+
+		/**
+		 * Checks whether CPU-side copy of vertices and indices is available.
+		 * Geometry is retained only when GL::ResourceManager::setRetainModelGeometry is enabled.
+		 * @return *true* if geometry is available, *false* otherwise.
+		 */
+		inline bool hasRetainedGeometry() const noexcept
+			{ return !m_RetainedVertices.empty() && !m_RetainedIndices.empty(); }
+
+		/**
+		 * Returns CPU-side copy of vertices of the model.
+		 * Vertices are always unpacked, regardless of the vertex format of the vertex buffer.
+		 * @return Vertices (empty if geometry has not been retained).
+		 */
+		inline const std::vector<Vertex> & retainedVertices() const noexcept { return m_RetainedVertices; }
+
+		/**
+		 * Returns CPU-side copy of indices of the model.
+		 * @return Indices (empty if geometry has not been retained).
+		 */
+		inline const std::vector<UInt> & retainedIndices() const noexcept { return m_RetainedIndices; }
+
+		/**
+		 * Returns scale for dequantization of vertex positions.
+		 * For packed vertices actual position is `position * positionScale() + positionOffset()`.
+		 * For unpacked vertices scale is always (1, 1, 1).
+		 * @return Pointer to the array of three floats.
+		 */
+		inline const float * positionScale() const noexcept { return m_PositionScale; }
+
+		/**
+		 * Returns offset for dequantization of vertex positions.
+		 * For unpacked vertices offset is always (0, 0, 0).
+		 * @return Pointer to the array of three floats.
+		 * @see positionScale().
+		 */
+		inline const float * positionOffset() const noexcept { return m_PositionOffset; }
+
 		/**
 		 * Retrieves X coordinate of a center of the model.
 		 * @return X coordinate of a center of the model.
@@ -231,6 +379,7 @@ namespace GL
 
 		/**
 		 * Configures vertex attribute for positions.
+		 * @note For packed vertices binormals are not available and *aBinorm* is ignored.
 		 * @param aPos Index of the attribute for vertex positions (use -1 to skip).
 		 * @param aTexCoord Index of the attribute for texture coordinates (use -1 to skip).
 		 * @param aNorm Index of the attribute for normals (use -1 to skip).
@@ -261,6 +410,144 @@ namespace GL
 		 */
 		void drawMesh(int index) const;
 
+		/**
+		 * Returns number of levels of detail, including the full-detail level 0.
+		 * Simplified levels are generated by GL::MeshSimplifier (see GL::ResourceManager::setNumLods).
+		 * @return Number of levels of detail.
+		 */
+		inline size_t numLods() const noexcept { return m_Lods.size() + 1; }
+
+		/**
+		 * Returns meshes of the specified level of detail.
+		 * Meshes of all levels correspond to each other, so indices returned by visibleMeshes() could be used
+		 * for any level.
+		 * @param level Level of detail (0 is the full-detail level).
+		 * @return Meshes of the level.
+		 */
+		inline const std::vector<Mesh> & lodMeshes(size_t level) const
+			{ return (level == 0 ? m_Meshes : m_Lods[level - 1].meshes); }
+
+		/**
+		 * Returns geometric error of the specified level of detail.
+		 * @param level Level of detail (0 is the full-detail level).
+		 * @return Estimated distance between the simplified and the original surface, in units of the model.
+		 */
+		inline Float lodError(size_t level) const { return (level == 0 ? 0.0f : m_Lods[level - 1].error); }
+
+		/**
+		 * Calculates radius of the model on the screen.
+		 * @param distance Distance from the camera to the center of the model.
+		 * @param projectionScale Number of pixels per unit at the distance of one unit from the camera. For the
+		 * perspective projection this is `viewportHeight / (2 * tan(fovY / 2))`.
+		 * @return Projected radius of the model in pixels.
+		 */
+		float projectedRadius(float distance, float projectionScale) const;
+
+		/**
+		 * Selects the coarsest level of detail with geometric error not exceeding the specified number of pixels.
+		 * Error of each level is scaled by the ratio of the projected radius to radius().
+		 * @param projectedRadius Radius of the model on the screen in pixels (see projectedRadius()).
+		 * @param maxPixelError Maximum acceptable error in pixels.
+		 * @return Level of detail.
+		 */
+		size_t selectLod(float projectedRadius, float maxPixelError = 1.0f) const;
+
+		/**
+		 * Calls GL::drawElements for vertices of the specified mesh of the specified level of detail.
+		 * @param level Level of detail.
+		 * @param index Index of the mesh.
+		 */
+		void drawLodMesh(size_t level, int index) const;
+
+		/**
+		 * Determines which meshes are potentially visible.
+		 * Bounding boxes and spheres of meshes are tested against the frustum (using SSE or NEON when available).
+		 * @param frustum View frustum in the coordinate space of the model.
+		 * @param visible Output vector. It is cleared and then filled with indices of potentially visible
+		 * meshes in increasing order, suitable for calling drawMesh().
+		 */
+		void visibleMeshes(const Frustum & frustum, std::vector<int> & visible) const;
+
+		/**
+		 * Determines which meshes are potentially visible.
+		 * @param matrix Projection * view * model matrix (16 floats in column-major order).
+		 * @param visible Output vector for indices of potentially visible meshes.
+		 * @see visibleMeshes(const Frustum &, std::vector<int> &).
+		 */
+		inline void visibleMeshes(const float * matrix, std::vector<int> & visible) const
+			{ visibleMeshes(Frustum(matrix), visible); }
+
+		/**
+		 * Returns list of draw calls required to draw the whole model.
+		 * Meshes are sorted by material: opaque meshes first, then by texture, normal map and opacity. Adjacent
+		 * meshes that share a material and are contiguous in the index buffer are merged into a single draw call.
+		 * The list is rebuilt lazily after meshes or materials are modified.
+		 * @return Draw list.
+		 */
+		inline const std::vector<DrawCommand> & drawList() const { return lodDrawList(0); }
+
+		/**
+		 * Returns draw list for the specified level of detail.
+		 * @param level Level of detail.
+		 * @return Draw list.
+		 * @see drawList().
+		 */
+		const std::vector<DrawCommand> & lodDrawList(size_t level) const;
+
+		/**
+		 * Draws the whole model using the draw list.
+		 * Textures of materials are bound only when they change. Materials without a texture (or a normal map)
+		 * leave the previous binding intact.
+		 * @param textureUnit Index of the texture unit for material textures (use -1 to skip).
+		 * @param normalMapUnit Index of the texture unit for normal maps (use -1 to skip).
+		 * @param onMaterialChange Optional callback invoked before the first draw call with each material.
+		 */
+		inline void draw(int textureUnit = 0, int normalMapUnit = -1,
+				const MaterialCallback & onMaterialChange = MaterialCallback()) const
+			{ drawLod(0, textureUnit, normalMapUnit, onMaterialChange); }
+
+		/**
+		 * Draws the specified level of detail using its draw list.
+		 * @param level Level of detail.
+		 * @param textureUnit Index of the texture unit for material textures (use -1 to skip).
+		 * @param normalMapUnit Index of the texture unit for normal maps (use -1 to skip).
+		 * @param onMaterialChange Optional callback invoked before the first draw call with each material.
+		 * @see draw().
+		 */
+		void drawLod(size_t level, int textureUnit = 0, int normalMapUnit = -1,
+			const MaterialCallback & onMaterialChange = MaterialCallback()) const;
+
+		/**
+		 * Calculates statistics of drawing the model mesh by mesh in the original order of meshes.
+		 * @return Draw statistics.
+		 */
+		DrawStatistics meshDrawStatistics() const;
+
+		/**
+		 * Calculates statistics of drawing the model with draw().
+		 * @return Draw statistics.
+		 */
+		DrawStatistics drawListStatistics() const;
+
+		/**
+		 * Returns estimated amount of memory used by the vertex and index buffers of the model.
+		 * @return Estimated memory usage in bytes.
+		 */
+		size_t memoryUsage() const override;
+
+		/**
+		 * Converts vertices into the packed format.
+		 * Positions are quantized relative to the bounding box of the vertices.
+		 * @param vertices Pointer to the array of vertices.
+		 * @param count Number of vertices.
+		 * @param packed Pointer to the output array of *count* packed vertices.
+		 * @param scale Output scale for dequantization of positions.
+		 * @param offset Output offset for dequantization of positions.
+		 * @see GL::Model::PackedVertex.
+		 */
+		static void packVertices(const Vertex * vertices, size_t count, PackedVertex * packed, float scale[3],
+			float offset[3]);
+
 	protected:
 		/** Releases associated OpenGL resources. */
 		void destroy() override;
@@ -269,13 +556,14 @@ namespace GL
 		 * Sets number of materials.
 		 * @param n Number of materials.
 		 */
-		inline void setNumMaterials(size_t n) { m_Materials.resize(n); }
+		inline void setNumMaterials(size_t n) { m_Materials.resize(n); m_DrawListValid = false; }
 
 		/**
 		 * Sets number of meshes.
 		 * @param n Number of meshes.
 		 */
-		inline void setNumMeshes(size_t n) { m_Meshes.resize(n); }
+		inline void setNumMeshes(size_t n)
+			{ m_Meshes.resize(n); m_DrawListValid = false; m_MeshBoundsValid = false; }
 
 		/**
 		 * Sets center of the model.
@@ -321,6 +609,68 @@ namespace GL
 		 */
 		inline void setNumVertices(int n) noexcept { m_NumVertices = n; }
 
+		/**
+		 * Uploads vertices into the vertex buffer.
+		 * Also sets number of vertices in the model.
+		 * @param vertices Pointer to the array of vertices.
+		 * @param count Number of vertices.
+		 * @param format Layout of vertices in the vertex buffer. If GL::Model::PackedVertexFormat is specified,
+		 * vertices are converted into GL::Model::PackedVertex.
+		 */
+		void uploadVertices(const Vertex * vertices, size_t count, VertexFormat format);
+
+		/**
+		 * Uploads vertices that are already in the specified format into the vertex buffer.
+		 * Also sets number of vertices in the model.
+		 * @param data Pointer to the vertex data.
+		 * @param size Size of the vertex data in bytes.
+		 * @param count Number of vertices.
+		 * @param format Layout of vertices.
+		 * @param scale Scale for dequantization of positions (see positionScale()).
+		 * @param offset Offset for dequantization of positions (see positionOffset()).
+		 */
+		void uploadVertexData(const void * data, size_t size, size_t count, VertexFormat format,
+			const float * scale, const float * offset);
+
+		/**
+		 * Uploads indices into the index buffer using the smallest suitable index type.
+		 * Number of vertices should be set before calling this method.
+		 * @param indices Pointer to the array of indices.
+		 * @param count Number of indices.
+		 */
+		void uploadIndices(const UInt * indices, size_t count);
+
+		/**
+		 * Stores CPU-side copy of vertices if the resource manager is configured to retain model geometry.
+		 * This is done automatically by uploadVertices().
+		 * @param vertices Pointer to the array of vertices.
+		 * @param count Number of vertices.
+		 */
+		void retainVertices(const Vertex * vertices, size_t count);
+
+		/**
+		 * Stores CPU-side copy of indices if the resource manager is configured to retain model geometry.
+		 * This is done automatically by uploadIndices().
+		 * @param indices Pointer to the array of indices.
+		 * @param count Number of indices.
+		 */
+		void retainIndices(const UInt * indices, size_t count);
+
+		/**
+		 * Initializes the model from the CPU-side representation.
+		 * Uploads vertices (in the default vertex format of the resource manager) and indices (using the smallest
+		 * suitable index type), copies materials and meshes and loads textures.
+		 * @param data Model data.
+		 */
+		void initFromData(const ModelData & data);
+
+		/**
+		 * Copies materials, meshes and levels of detail from the CPU-side representation and loads textures.
+		 * Vertex and index data of *data* are ignored.
+		 * @param data Model data.
+		 */
+		void initMaterialsAndMeshes(const ModelData & data);
+
 		/**
 		 * Sets data type of indices.
 		 * @param type Data type of indices.
@@ -333,6 +683,9 @@ namespace GL
 		GL::BufferPtr m_Indices;
 		GL::BufferPtr m_Vertices;
 		GL::Enum m_IndexType;
+		VertexFormat m_VertexFormat;
+		float m_PositionScale[3];
+		float m_PositionOffset[3];
 	  #ifdef HAVE_GLM
 		glm::vec3 m_Center;
 		glm::vec3 m_Size;
@@ -343,6 +696,15 @@ namespace GL
 		float m_Radius;
 		int m_NumTriangles;
 		int m_NumVertices;
+		std::vector<Vertex> m_RetainedVertices;
+		std::vector<UInt> m_RetainedIndices;
+		std::vector<Lod> m_Lods;
+		mutable std::vector<std::vector<DrawCommand>> m_DrawLists;
+		mutable Frustum::BoundsList m_MeshBounds;
+		mutable bool m_DrawListValid;
+		mutable bool m_MeshBoundsValid;
+
+		static void buildDrawList(const std::vector<Mesh> & meshes, std::vector<DrawCommand> & list);
 
 		Model(const Model &);
 		Model & operator=(const Model &);
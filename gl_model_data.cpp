@@ -0,0 +1,126 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "gl_model_data.h"
+#include <algorithm>
+#include <cmath>
+
+void GL::ModelData::Material::initWithDefaults()
+{
+	ambient[0] = 0.0f;
+	ambient[1] = 0.0f;
+	ambient[2] = 0.0f;
+	ambient[3] = 1.0f;
+
+	diffuse[0] = 1.0f;
+	diffuse[1] = 1.0f;
+	diffuse[2] = 1.0f;
+	diffuse[3] = 1.0f;
+
+	specular[0] = 0.0f;
+	specular[1] = 0.0f;
+	specular[2] = 0.0f;
+	specular[3] = 1.0f;
+
+	shininess = 0.0f;
+	opacity = 1.0f;
+
+	texture.clear();
+	normalMap.clear();
+}
+
+GL::ModelData::ModelData()
+{
+	clear();
+}
+
+void GL::ModelData::clear()
+{
+	vertices.clear();
+	indices.clear();
+	materials.clear();
+	meshes.clear();
+	lods.clear();
+
+	for (int i = 0; i < 3; i++)
+	{
+		center[i] = 0.0f;
+		size[i] = 0.0f;
+	}
+
+	radius = 0.0f;
+	hasPositions = false;
+	hasTexCoords = false;
+	hasNormals = false;
+	hasTangents = false;
+}
+
+void GL::ModelData::computeMeshBounds()
+{
+	for (Mesh & mesh : meshes)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			mesh.boundsMin[i] = 0.0f;
+			mesh.boundsMax[i] = 0.0f;
+			mesh.center[i] = 0.0f;
+		}
+		mesh.radius = 0.0f;
+
+		size_t first = std::min(size_t(mesh.firstIndex), indices.size());
+		size_t last = std::min(first + mesh.numIndices, indices.size());
+		bool empty = true;
+
+		for (size_t i = first; i < last; i++)
+		{
+			if (indices[i] >= vertices.size())
+				continue;
+
+			const Model::Vertex & v = vertices[indices[i]];
+			for (int j = 0; j < 3; j++)
+			{
+				if (empty || v.position[j] < mesh.boundsMin[j])
+					mesh.boundsMin[j] = v.position[j];
+				if (empty || v.position[j] > mesh.boundsMax[j])
+					mesh.boundsMax[j] = v.position[j];
+			}
+			empty = false;
+		}
+
+		for (int j = 0; j < 3; j++)
+			mesh.center[j] = (mesh.boundsMin[j] + mesh.boundsMax[j]) * 0.5f;
+
+		float radiusSquared = 0.0f;
+		for (size_t i = first; i < last; i++)
+		{
+			if (indices[i] >= vertices.size())
+				continue;
+
+			const Model::Vertex & v = vertices[indices[i]];
+			float dx = v.position[0] - mesh.center[0];
+			float dy = v.position[1] - mesh.center[1];
+			float dz = v.position[2] - mesh.center[2];
+			radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+		}
+		mesh.radius = std::sqrt(radiusSquared);
+	}
+}
@@ -0,0 +1,101 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __9b6e01fc7b5a2a18b96463cf92f4e617__
+#define __9b6e01fc7b5a2a18b96463cf92f4e617__
+
+#include "gl_model.h"
+#include <yip-imports/gl.h>
+#include <vector>
+#include <string>
+
+namespace GL
+{
+	/**
+	 * CPU-side representation of a 3D model.
+	 * Model loaders produce this structure, which could be processed (e.g. by GL::MeshOptimizer) before it is
+	 * uploaded into OpenGL buffers by GL::Model. This structure does not depend on the OpenGL context.
+	 */
+	struct ModelData
+	{
+		/** Material. */
+		struct Material
+		{
+			Float ambient[4];					/**< Ambient reflectivity. */
+			Float diffuse[4];					/**< Diffuse reflectivity. */
+			Float specular[4];					/**< Specular reflectivity. */
+			Float shininess;					/**< Shininess. */
+			Float opacity;						/**< Opacity. */
+			std::string texture;				/**< Name of the texture (empty if there is no texture). */
+			std::string normalMap;				/**< Name of the normal map (empty if there is no normal map). */
+
+			/** Loads default values into material variables. */
+			void initWithDefaults();
+		};
+
+		/** Mesh. */
+		struct Mesh
+		{
+			int materialIndex;					/**< Index of the material. */
+			UInt firstIndex;					/**< First index. */
+			UInt numIndices;					/**< Number of indices. */
+			Float boundsMin[3];					/**< Minimum corner of the bounding box. */
+			Float boundsMax[3];					/**< Maximum corner of the bounding box. */
+			Float center[3];					/**< Center of the bounding sphere. */
+			Float radius;						/**< Radius of the bounding sphere. */
+		};
+
+		/** Level of detail. */
+		struct Lod
+		{
+			Float error;						/**< Geometric error of the level. */
+			std::vector<Mesh> meshes;			/**< Meshes (one for each mesh of the full-detail model). */
+		};
+
+		std::vector<Model::Vertex> vertices;	/**< Vertices. */
+		std::vector<UInt> indices;				/**< Indices of triangles. */
+		std::vector<Material> materials;		/**< Materials. */
+		std::vector<Mesh> meshes;				/**< Meshes. */
+		std::vector<Lod> lods;					/**< Simplified levels of detail (see GL::MeshSimplifier). */
+		Float center[3];						/**< Center of the model. */
+		Float size[3];							/**< Size of the model. */
+		Float radius;							/**< Radius of the model. */
+		bool hasPositions;						/**< Set to *true* if model has positions. */
+		bool hasTexCoords;						/**< Set to *true* if model has texture coordinates. */
+		bool hasNormals;						/**< Set to *true* if model has normals. */
+		bool hasTangents;						/**< Set to *true* if model has tangents. */
+
+		/** Constructor. */
+		ModelData();
+
+		/** Resets the structure into the empty state. */
+		void clear();
+
+		/**
+		 * Calculates bounding boxes and bounding spheres of meshes from their vertices.
+		 * Sphere is centered in the bounding box and encloses all vertices of the mesh.
+		 */
+		void computeMeshBounds();
+	};
+}
+
+#endif
@@ -0,0 +1,109 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __1b220bb76163587b2b445e802273c8db__
+#define __1b220bb76163587b2b445e802273c8db__
+
+#include <string>
+#include <cstdint>
+
+namespace GL
+{
+	/**
+	 * Precomputed hash of the name of a shader variable.
+	 *
+	 * This is a 32-bit FNV-1a hash. When constructed from a string literal, hash is calculated at compile time:
+	 * @code
+	 * static const GL::NameHash u_color("u_color");
+	 * GL::Uniform uniform(program, u_color);
+	 * @endcode
+	 */
+	class NameHash
+	{
+	public:
+		/**
+		 * Constructor.
+		 * @param name Name of the variable.
+		 */
+		constexpr explicit NameHash(const char * name)
+			: m_Value(hashString(name, 2166136261u))
+		{
+		}
+
+		/**
+		 * Constructor.
+		 * @param name Name of the variable.
+		 */
+		inline explicit NameHash(const std::string & name)
+			: m_Value(hashBuffer(name.c_str(), name.length()))
+		{
+		}
+
+		/**
+		 * Constructor.
+		 * @param name Pointer to the name of the variable.
+		 * @param length Length of the name.
+		 */
+		inline NameHash(const char * name, size_t length)
+			: m_Value(hashBuffer(name, length))
+		{
+		}
+
+		/**
+		 * Returns value of the hash.
+		 * @return Value of the hash.
+		 */
+		constexpr uint32_t value() const { return m_Value; }
+
+		/**
+		 * Compares two hashes.
+		 * @param other Hash to compare with.
+		 * @return *true* if hashes are equal, *false* otherwise.
+		 */
+		constexpr bool operator==(const NameHash & other) const { return m_Value == other.m_Value; }
+
+		/**
+		 * Compares two hashes.
+		 * @param other Hash to compare with.
+		 * @return *true* if hashes are not equal, *false* otherwise.
+		 */
+		constexpr bool operator!=(const NameHash & other) const { return m_Value != other.m_Value; }
+
+	private:
+		uint32_t m_Value;
+
+		static constexpr uint32_t hashString(const char * p, uint32_t hash)
+		{
+			return (*p ? hashString(p + 1, (hash ^ static_cast<unsigned char>(*p)) * 16777619u) : hash);
+		}
+
+		static inline uint32_t hashBuffer(const char * p, size_t length)
+		{
+			uint32_t hash = 2166136261u;
+			for (size_t i = 0; i < length; i++)
+				hash = (hash ^ static_cast<unsigned char>(p[i])) * 16777619u;
+			return hash;
+		}
+	};
+}
+
+#endif
@@ -22,7 +22,9 @@
 //
 #include "gl_obj_model.h"
 #include "gl_resource_manager.h"
-#include "gl_buffer_binder.h"
+#include "gl_model_data.h"
+#include "gl_obj_parser.h"
+#include "gl_mesh_simplifier.h"
 #include <yip-imports/cxx-util/macros.h>
 #include <yip-imports/model_obj.h>
 #include <sstream>
@@ -34,98 +36,86 @@
 GL::ObjModel::ObjModel(ResourceManager * resMgr, ::Resource::Loader & loader, const std::string & filename)
 	: Model(resMgr, filename)
 {
-	ModelOBJ model;
-	model.import(loader, filename);
+	ModelData data;
+	loadData(loader, filename, data, resMgr->useObjParser());
+
+	m_HasNormals = data.hasNormals ? 1 : 0;
+	m_HasPositions = data.hasPositions ? 1 : 0;
+	m_HasTangents = data.hasTangents ? 1 : 0;
+	m_HasTexCoords = data.hasTexCoords ? 1 : 0;
+	m_Optimized = 0;
 
-	float x = 0.0f, y = 0.0f, z = 0.0f;
-	model.getCenter(x, y, z);
-	setCenter(x, y, z);
+	if (resMgr->numLods() > 1)
+		MeshSimplifier::generateLods(data, resMgr->numLods() - 1);
+
+	if (resMgr->optimizeMeshes())
+	{
+		m_OptimizationReport = MeshOptimizer::optimize(data);
+		m_Optimized = 1;
+	}
 
-	setSize(model.getWidth(), model.getHeight(), model.getLength());
-	setRadius(model.getRadius());
-	setNumTriangles(model.getNumberOfTriangles());
-	setNumVertices(model.getNumberOfVertices());
+	initFromData(data);
+}
 
-	m_HasNormals = model.hasNormals() ? 1 : 0;
-	m_HasPositions = model.hasPositions() ? 1 : 0;
-	m_HasTangents = model.hasTangents() ? 1 : 0;
-	m_HasTexCoords = model.hasTextureCoords() ? 1 : 0;
+void GL::ObjModel::loadData(::Resource::Loader & loader, const std::string & filename, ModelData & data,
+	bool useObjParser)
+{
+	if (useObjParser)
+	{
+		ObjParser parser;
+		parser.parse(loader, filename, data);
+		return;
+	}
+
+	ModelOBJ model;
+	model.import(loader, filename);
+
+	data.clear();
+	model.getCenter(data.center[0], data.center[1], data.center[2]);
+	data.size[0] = model.getWidth();
+	data.size[1] = model.getHeight();
+	data.size[2] = model.getLength();
+	data.radius = model.getRadius();
+	data.hasNormals = model.hasNormals();
+	data.hasPositions = model.hasPositions();
+	data.hasTangents = model.hasTangents();
+	data.hasTexCoords = model.hasTextureCoords();
 
 	STATIC_ASSERT(sizeof(Vertex) == sizeof(ModelOBJ::Vertex));
 	STATIC_ASSERT(sizeof(int) == sizeof(Int));
 	STATIC_ASSERT(sizeof(float) == sizeof(Float));
 
-	{
-		GL::BufferBinder binder(vertexBuffer(), GL::ARRAY_BUFFER);
-		GL::bufferData(GL::ARRAY_BUFFER, model.getNumberOfVertices() * model.getVertexSize(),
-			model.getVertexBuffer(), GL::STATIC_DRAW);
-	}
+	const Vertex * vertices = reinterpret_cast<const Vertex *>(model.getVertexBuffer());
+	data.vertices.assign(vertices, vertices + model.getNumberOfVertices());
 
-	{
-		GL::BufferBinder binder(indexBuffer(), GL::ELEMENT_ARRAY_BUFFER);
-		if (model.getNumberOfVertices() < 0xFF)
-		{
-			std::vector<GL::UByte> data(model.getNumberOfIndices());
-			for (int i = 0; i < model.getNumberOfIndices(); i++)
-				data[i] = static_cast<GL::UByte>(model.getIndexBuffer()[i]);
-			GL::bufferData(GL::ELEMENT_ARRAY_BUFFER, Sizei(data.size()), data.data(), GL::STATIC_DRAW);
-			setIndexType(GL::UNSIGNED_BYTE);
-		}
-		else if (model.getNumberOfVertices() < 0xFFFF)
-		{
-			std::vector<GL::UShort> data(model.getNumberOfIndices());
-			for (int i = 0; i < model.getNumberOfIndices(); i++)
-				data[i] = static_cast<GL::UShort>(model.getIndexBuffer()[i]);
-			GL::bufferData(GL::ELEMENT_ARRAY_BUFFER, Sizei(data.size() * sizeof(GL::UShort)),
-				data.data(), GL::STATIC_DRAW);
-			setIndexType(GL::UNSIGNED_SHORT);
-		}
-		else
-		{
-			GL::bufferData(GL::ELEMENT_ARRAY_BUFFER, model.getNumberOfIndices() * model.getIndexSize(),
-				model.getIndexBuffer(), GL::STATIC_DRAW);
-			setIndexType(GL::UNSIGNED_INT);
-		}
-	}
+	const int * indices = model.getIndexBuffer();
+	data.indices.assign(indices, indices + model.getNumberOfIndices());
 
-	setNumMaterials(model.getNumberOfMaterials());
+	data.materials.resize(size_t(model.getNumberOfMaterials()));
 	for (int i = 0; i < model.getNumberOfMaterials(); i++)
 	{
 		const ModelOBJ::Material & m = model.getMaterial(i);
-		Material & mat = material(i);
+		ModelData::Material & mat = data.materials[size_t(i)];
 
-	  #ifdef HAVE_GLM
-		mat.ambient = glm::vec4(m.ambient[0], m.ambient[1], m.ambient[2], m.ambient[3]);
-		mat.diffuse = glm::vec4(m.diffuse[0], m.diffuse[1], m.diffuse[2], m.diffuse[3]);
-		mat.specular = glm::vec4(m.specular[0], m.specular[1], m.specular[2], m.specular[3]);
-	  #else
 		std::copy(&m.ambient[0], m.ambient + sizeof(m.ambient) / sizeof(m.ambient[0]), &mat.ambient[0]);
 		std::copy(&m.diffuse[0], m.diffuse + sizeof(m.diffuse) / sizeof(m.diffuse[0]), &mat.diffuse[0]);
 		std::copy(&m.specular[0], m.specular + sizeof(m.specular) / sizeof(m.specular[0]), &mat.specular[0]);
-	  #endif
 		mat.shininess = m.shininess;
 		mat.opacity = m.alpha;
-
-		if (m.colorMapFilename.length() > 0)
-			mat.texture = manager()->getTexture(m.colorMapFilename);
-		if (m.bumpMapFilename.length() > 0)
-			mat.normalMap = manager()->getTexture(m.bumpMapFilename);
+		mat.texture = m.colorMapFilename;
+		mat.normalMap = m.bumpMapFilename;
 	}
 
-	if (model.getNumberOfMaterials() == 0)
-	{
-		setNumMaterials(1);
-		material(0).initWithDefaults();
-	}
-
-	setNumMeshes(model.getNumberOfMeshes());
+	data.meshes.resize(size_t(model.getNumberOfMeshes()));
 	for (int i = 0; i < model.getNumberOfMeshes(); i++)
 	{
 		const ModelOBJ::Mesh & m = model.getMesh(i);
-		Mesh & mm = mesh(i);
+		ModelData::Mesh & mm = data.meshes[size_t(i)];
 
-		mm.firstIndex = m.startIndex;
-		mm.numIndices = m.triangleCount * 3;
-		mm.material = &material(std::min(std::max(m.materialIndex, 0), int(numMaterials())));
+		mm.firstIndex = UInt(m.startIndex);
+		mm.numIndices = UInt(m.triangleCount * 3);
+		mm.materialIndex = m.materialIndex;
 	}
+
+	data.computeMeshBounds();
 }
@@ -27,6 +27,7 @@
 #include "gl_buffer.h"
 #include "gl_texture.h"
 #include "gl_attrib.h"
+#include "gl_mesh_optimizer.h"
 #include <yip-imports/resource_loader.h>
 #include <yip-imports/gl.h>
 #include <memory>
@@ -49,6 +50,19 @@ namespace GL
 		 */
 		ObjModel(ResourceManager * resMgr, ::Resource::Loader & loader, const std::string & filename);
 
+		/**
+		 * Parses the OBJ file into the CPU-side representation without creating any OpenGL resources.
+		 * This method could be used in offline tools. By default the file is imported with ModelOBJ from the
+		 * dhpoware-modelobj package.
+		 * @param loader Resource loader to use.
+		 * @param filename Name of the OBJ file to load.
+		 * @param data Output model data.
+		 * @param useObjParser *true* to parse the file with GL::ObjParser instead of ModelOBJ.
+		 * @see GL::ResourceManager::setUseObjParser().
+		 */
+		static void loadData(::Resource::Loader & loader, const std::string & filename, ModelData & data,
+			bool useObjParser = false);
+
 		/**
 		 * Checks whether this model has normals.
 		 * @return *true* if model has normals, *false* otherwise.
@@ -73,11 +87,27 @@ namespace GL
 		 */
 		inline bool hasTexCoords() const noexcept { return m_HasTexCoords != 0; }
 
+		/**
+		 * Checks whether index and vertex buffers of this model have been optimized by GL::MeshOptimizer.
+		 * @return *true* if model has been optimized, *false* otherwise.
+		 * @see GL::ResourceManager::setOptimizeMeshes().
+		 */
+		inline bool isOptimized() const noexcept { return m_Optimized != 0; }
+
+		/**
+		 * Returns vertex cache statistics of the model before and after optimization.
+		 * Only valid if GL::ObjModel::isOptimized() returns *true*.
+		 * @return Optimization report.
+		 */
+		inline const MeshOptimizer::Report & optimizationReport() const noexcept { return m_OptimizationReport; }
+
 	private:
+		MeshOptimizer::Report m_OptimizationReport;
 		unsigned m_HasNormals : 1;
 		unsigned m_HasPositions : 1;
 		unsigned m_HasTangents : 1;
 		unsigned m_HasTexCoords : 1;
+		unsigned m_Optimized : 1;
 
 		ObjModel(const ObjModel &);
 		ObjModel & operator=(const ObjModel &);
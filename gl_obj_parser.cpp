@@ -0,0 +1,1046 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "gl_obj_parser.h"
+#include <yip-imports/cxx-util/macros.h>
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <unordered_map>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <cmath>
+#include <cfloat>
+
+namespace
+{
+	// Files smaller than this are parsed in a single thread.
+	const size_t MinChunkSize = 1024 * 1024;
+
+	const int32_t NoIndex = INT32_MIN;
+
+	enum
+	{
+		RelativePosition = 0x01,
+		RelativeTexCoord = 0x02,
+		RelativeNormal = 0x04,
+	};
+
+	struct Corner
+	{
+		int32_t position;
+		int32_t texCoord;
+		int32_t normal;
+		uint32_t relative;
+	};
+
+	struct MaterialSwitch
+	{
+		size_t triangle;
+		std::string name;
+	};
+
+	struct Chunk
+	{
+		const char * text;
+		const char * begin;
+		const char * end;
+		std::vector<float> positions;
+		std::vector<float> texCoords;
+		std::vector<float> normals;
+		std::vector<Corner> corners;
+		std::vector<uint32_t> hashes;
+		std::vector<MaterialSwitch> materials;
+		std::vector<std::string> materialLibraries;
+		size_t positionBase;
+		size_t texCoordBase;
+		size_t normalBase;
+		size_t triangleBase;
+	};
+
+	struct Material
+	{
+		GL::ModelData::Material data;
+		std::string name;
+	};
+
+	// Runs fn(0) ... fn(count - 1) in parallel and rethrows the first exception.
+	void parallelFor(size_t count, const std::function<void(size_t)> & fn)
+	{
+		if (count == 1)
+		{
+			fn(0);
+			return;
+		}
+
+		std::vector<std::exception_ptr> errors(count);
+		std::vector<std::thread> threads;
+		threads.reserve(count - 1);
+
+		auto run = [&fn, &errors](size_t index) {
+			try {
+				fn(index);
+			} catch (...) {
+				errors[index] = std::current_exception();
+			}
+		};
+
+		for (size_t i = 1; i < count; i++)
+			threads.push_back(std::thread(run, i));
+		run(0);
+
+		for (std::thread & thread : threads)
+			thread.join();
+
+		for (const std::exception_ptr & error : errors)
+		{
+			if (error)
+				std::rethrow_exception(error);
+		}
+	}
+
+	inline bool isSpace(char ch)
+	{
+		return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\f' || ch == '\v';
+	}
+
+	inline void skipSpaces(const char *& p, const char * end)
+	{
+		while (p < end && isSpace(*p))
+			++p;
+	}
+
+	inline void skipLine(const char *& p, const char * end)
+	{
+		const char * eol = static_cast<const char *>(memchr(p, '\n', size_t(end - p)));
+		p = (eol ? eol + 1 : end);
+	}
+
+	inline bool matchKeyword(const char * p, const char * end, const char * keyword, size_t length)
+	{
+		return size_t(end - p) > length && !memcmp(p, keyword, length) && isSpace(p[length]);
+	}
+
+	std::string restOfLine(const char *& p, const char * end)
+	{
+		skipSpaces(p, end);
+		const char * start = p;
+		const char * eol = static_cast<const char *>(memchr(p, '\n', size_t(end - p)));
+		p = (eol ? eol : end);
+
+		const char * last = p;
+		while (last > start && isSpace(last[-1]))
+			--last;
+
+		return std::string(start, last);
+	}
+
+	// Parses floating-point number. Numbers with at most 7 significant digits and a small exponent are converted
+	// with a single correctly rounded float operation (exact powers of ten up to 1e10 are representable in a
+	// float), so the result matches strtof(). Other numbers are passed to strtof().
+	bool parseFloat(const char *& p, const char * end, float & out)
+	{
+		static const float powersOfTen[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+
+		skipSpaces(p, end);
+		const char * start = p;
+
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+			negative = (*p++ == '-');
+
+		uint32_t mantissa = 0;
+		int digits = 0, exponent = 0;
+		bool anyDigits = false;
+
+		for (; p < end && *p >= '0' && *p <= '9'; ++p)
+		{
+			anyDigits = true;
+			if (mantissa == 0 && *p == '0')
+				continue;
+			if (digits < 9)
+				mantissa = mantissa * 10 + uint32_t(*p - '0');
+			else
+				++exponent;
+			++digits;
+		}
+
+		if (p < end && *p == '.')
+		{
+			for (++p; p < end && *p >= '0' && *p <= '9'; ++p)
+			{
+				anyDigits = true;
+				if (mantissa == 0 && *p == '0')
+				{
+					--exponent;
+					continue;
+				}
+				if (digits < 9)
+				{
+					mantissa = mantissa * 10 + uint32_t(*p - '0');
+					--exponent;
+				}
+				++digits;
+			}
+		}
+
+		bool fastPath = anyDigits && digits <= 7;
+		if (fastPath && p < end && (*p == 'e' || *p == 'E'))
+		{
+			const char * q = p + 1;
+			bool negativeExp = false;
+			if (q < end && (*q == '-' || *q == '+'))
+				negativeExp = (*q++ == '-');
+
+			int value = 0;
+			bool expDigits = false;
+			for (; q < end && *q >= '0' && *q <= '9'; ++q)
+			{
+				expDigits = true;
+				if (value < 1000)
+					value = value * 10 + (*q - '0');
+			}
+
+			if (!expDigits)
+				fastPath = false;
+			else
+			{
+				exponent += (negativeExp ? -value : value);
+				p = q;
+			}
+		}
+
+		if (fastPath && p < end && !isSpace(*p) && *p != '\n')
+			fastPath = false;
+
+		if (fastPath && mantissa == 0)
+		{
+			out = (negative ? -0.0f : 0.0f);
+			return true;
+		}
+
+		if (fastPath && exponent >= -10 && exponent <= 10)
+		{
+			float value = float(mantissa);
+			value = (exponent < 0 ? value / powersOfTen[-exponent] : value * powersOfTen[exponent]);
+			out = (negative ? -value : value);
+			return true;
+		}
+
+		// Slow path
+
+		p = start;
+		const char * tokenEnd = p;
+		while (tokenEnd < end && !isSpace(*tokenEnd) && *tokenEnd != '\n')
+			++tokenEnd;
+
+		char buffer[64];
+		size_t length = size_t(tokenEnd - p);
+		if (length == 0 || length >= sizeof(buffer))
+			return false;
+
+		memcpy(buffer, p, length);
+		buffer[length] = 0;
+
+		char * parsedEnd = nullptr;
+		out = strtof(buffer, &parsedEnd);
+		p = tokenEnd;
+
+		return parsedEnd != buffer;
+	}
+
+	inline bool parseInt(const char *& p, const char * end, int32_t & out)
+	{
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+			negative = (*p++ == '-');
+
+		if (p >= end || *p < '0' || *p > '9')
+			return false;
+
+		int64_t value = 0;
+		for (; p < end && *p >= '0' && *p <= '9'; ++p)
+		{
+			if (value < INT32_MAX)
+				value = value * 10 + (*p - '0');
+		}
+
+		out = int32_t(negative ? -std::min<int64_t>(value, INT32_MAX) : std::min<int64_t>(value, INT32_MAX));
+		return true;
+	}
+
+	// Converts OBJ index into zero-based index. Negative indices are relative to the end of the array parsed
+	// so far; they are converted into indices relative to the beginning of the chunk and marked as relative.
+	inline bool convertIndex(int32_t index, size_t localCount, int32_t & out, uint32_t & relative, uint32_t flag)
+	{
+		if (index > 0)
+		{
+			out = index - 1;
+			return true;
+		}
+		else if (index < 0)
+		{
+			out = int32_t(localCount) + index;
+			relative |= flag;
+			return true;
+		}
+		return false;
+	}
+
+	void throwParseError(const Chunk & chunk, const char * p, const char * message)
+	{
+		size_t line = 1 + size_t(std::count(chunk.text, p, '\n'));
+
+		std::stringstream ss;
+		ss << message << " at line " << line << '.';
+		throw std::runtime_error(ss.str());
+	}
+
+	void parseChunk(Chunk & chunk)
+	{
+		const char * p = chunk.begin;
+		const char * end = chunk.end;
+
+		size_t numTriangles = 0;
+		Corner polygon[3];
+
+		while (p < end)
+		{
+			skipSpaces(p, end);
+			if (p >= end)
+				break;
+
+			switch (*p)
+			{
+			case 'v':
+				if (p + 1 < end && isSpace(p[1]))
+				{
+					float x = 0.0f, y = 0.0f, z = 0.0f;
+					++p;
+					if (!parseFloat(p, end, x) || !parseFloat(p, end, y) || !parseFloat(p, end, z))
+						throwParseError(chunk, p, "invalid vertex position");
+					chunk.positions.push_back(x);
+					chunk.positions.push_back(y);
+					chunk.positions.push_back(z);
+				}
+				else if (p + 2 < end && p[1] == 't' && isSpace(p[2]))
+				{
+					float u = 0.0f, v = 0.0f;
+					p += 2;
+					if (!parseFloat(p, end, u) || !parseFloat(p, end, v))
+						throwParseError(chunk, p, "invalid texture coordinates");
+					chunk.texCoords.push_back(u);
+					chunk.texCoords.push_back(v);
+				}
+				else if (p + 2 < end && p[1] == 'n' && isSpace(p[2]))
+				{
+					float x = 0.0f, y = 0.0f, z = 0.0f;
+					p += 2;
+					if (!parseFloat(p, end, x) || !parseFloat(p, end, y) || !parseFloat(p, end, z))
+						throwParseError(chunk, p, "invalid vertex normal");
+					chunk.normals.push_back(x);
+					chunk.normals.push_back(y);
+					chunk.normals.push_back(z);
+				}
+				break;
+
+			case 'f':
+				if (p + 1 < end && isSpace(p[1]))
+				{
+					size_t numCorners = 0;
+					++p;
+
+					for (;;)
+					{
+						skipSpaces(p, end);
+						if (p >= end || *p == '\n' || *p == '#')
+							break;
+
+						Corner corner;
+						corner.position = NoIndex;
+						corner.texCoord = NoIndex;
+						corner.normal = NoIndex;
+						corner.relative = 0;
+
+						int32_t index = 0;
+						if (!parseInt(p, end, index) ||
+								!convertIndex(index, chunk.positions.size() / 3, corner.position, corner.relative,
+									RelativePosition))
+							throwParseError(chunk, p, "invalid face");
+
+						if (p < end && *p == '/')
+						{
+							++p;
+							if (p < end && *p != '/')
+							{
+								if (!parseInt(p, end, index) ||
+										!convertIndex(index, chunk.texCoords.size() / 2, corner.texCoord,
+											corner.relative, RelativeTexCoord))
+									throwParseError(chunk, p, "invalid face");
+							}
+
+							if (p < end && *p == '/')
+							{
+								++p;
+								if (!parseInt(p, end, index) ||
+										!convertIndex(index, chunk.normals.size() / 3, corner.normal,
+											corner.relative, RelativeNormal))
+									throwParseError(chunk, p, "invalid face");
+							}
+						}
+
+						// Triangulate polygon as a fan
+						if (numCorners < 3)
+							polygon[numCorners] = corner;
+						else
+						{
+							polygon[1] = polygon[2];
+							polygon[2] = corner;
+						}
+
+						if (++numCorners >= 3)
+						{
+							chunk.corners.push_back(polygon[0]);
+							chunk.corners.push_back(polygon[1]);
+							chunk.corners.push_back(polygon[2]);
+							++numTriangles;
+						}
+					}
+				}
+				break;
+
+			case 'u':
+				if (matchKeyword(p, end, "usemtl", 6))
+				{
+					p += 6;
+					MaterialSwitch material;
+					material.triangle = numTriangles;
+					material.name = restOfLine(p, end);
+					chunk.materials.push_back(std::move(material));
+				}
+				break;
+
+			case 'm':
+				if (matchKeyword(p, end, "mtllib", 6))
+				{
+					p += 6;
+					chunk.materialLibraries.push_back(restOfLine(p, end));
+				}
+				break;
+			}
+
+			skipLine(p, end);
+		}
+	}
+
+	void makeVertex(GL::Model::Vertex & vertex, const Corner & corner, const std::vector<float> & positions,
+		const std::vector<float> & texCoords, const std::vector<float> & normals)
+	{
+		memset(&vertex, 0, sizeof(vertex));
+
+		const float * pos = &positions[size_t(corner.position) * 3];
+		vertex.position[0] = pos[0];
+		vertex.position[1] = pos[1];
+		vertex.position[2] = pos[2];
+
+		if (corner.texCoord != NoIndex)
+		{
+			const float * tex = &texCoords[size_t(corner.texCoord) * 2];
+			vertex.texCoord[0] = tex[0];
+			vertex.texCoord[1] = tex[1];
+		}
+
+		if (corner.normal != NoIndex)
+		{
+			const float * norm = &normals[size_t(corner.normal) * 3];
+			vertex.normal[0] = norm[0];
+			vertex.normal[1] = norm[1];
+			vertex.normal[2] = norm[2];
+		}
+	}
+
+	// Vertex is defined by values of its attributes, but vertices with different position indices are never
+	// merged (this matches ModelOBJ).
+	inline uint32_t hashVertex(int32_t position, const GL::Model::Vertex & vertex)
+	{
+		uint32_t words[sizeof(vertex) / sizeof(uint32_t)];
+		memcpy(words, &vertex, sizeof(words));
+
+		uint32_t hash = uint32_t(position) * 0x9E3779B1u;
+		for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); i++)
+			hash = (hash ^ words[i]) * 0x01000193u;
+
+		return hash ^ (hash >> 16);
+	}
+
+	// Resolves indices into absolute zero-based indices and calculates hashes of vertices.
+	void resolveChunk(Chunk & chunk, const std::vector<float> & positions, const std::vector<float> & texCoords,
+		const std::vector<float> & normals)
+	{
+		const int64_t numPositions = int64_t(positions.size() / 3);
+		const int64_t numTexCoords = int64_t(texCoords.size() / 2);
+		const int64_t numNormals = int64_t(normals.size() / 3);
+
+		GL::Model::Vertex vertex;
+		chunk.hashes.resize(chunk.corners.size());
+		for (size_t i = 0; i < chunk.corners.size(); i++)
+		{
+			Corner & corner = chunk.corners[i];
+
+			int64_t position = corner.position;
+			if (corner.relative & RelativePosition)
+				position += int64_t(chunk.positionBase);
+			if (UNLIKELY(position < 0 || position >= numPositions))
+				throw std::runtime_error("vertex index in face is out of range.");
+			corner.position = int32_t(position);
+
+			if (corner.texCoord != NoIndex)
+			{
+				int64_t texCoord = corner.texCoord;
+				if (corner.relative & RelativeTexCoord)
+					texCoord += int64_t(chunk.texCoordBase);
+				if (UNLIKELY(texCoord < 0 || texCoord >= numTexCoords))
+					throw std::runtime_error("texture coordinate index in face is out of range.");
+				corner.texCoord = int32_t(texCoord);
+			}
+
+			if (corner.normal != NoIndex)
+			{
+				int64_t normal = corner.normal;
+				if (corner.relative & RelativeNormal)
+					normal += int64_t(chunk.normalBase);
+				if (UNLIKELY(normal < 0 || normal >= numNormals))
+					throw std::runtime_error("normal index in face is out of range.");
+				corner.normal = int32_t(normal);
+			}
+
+			makeVertex(vertex, corner, positions, texCoords, normals);
+			chunk.hashes[i] = hashVertex(corner.position, vertex);
+		}
+	}
+
+	std::string resolvePath(const std::string & directory, const std::string & name)
+	{
+		if (name.empty() || name[0] == '/' || name[0] == '\\' || (name.length() > 1 && name[1] == ':'))
+			return name;
+		return directory + name;
+	}
+
+	void parseMaterialLibrary(const std::string & text, const std::string & directory,
+		std::vector<Material> & materials)
+	{
+		const char * p = text.data();
+		const char * end = p + text.length();
+		Material * material = nullptr;
+
+		while (p < end)
+		{
+			skipSpaces(p, end);
+			if (p >= end)
+				break;
+
+			if (matchKeyword(p, end, "newmtl", 6))
+			{
+				p += 6;
+				materials.push_back(Material());
+				material = &materials.back();
+				material->name = restOfLine(p, end);
+
+				GL::ModelData::Material & m = material->data;
+				m.initWithDefaults();
+				m.ambient[0] = m.ambient[1] = m.ambient[2] = 0.2f;
+				m.diffuse[0] = m.diffuse[1] = m.diffuse[2] = 0.8f;
+			}
+			else if (material && (matchKeyword(p, end, "Ka", 2) || matchKeyword(p, end, "Kd", 2) ||
+				matchKeyword(p, end, "Ks", 2)))
+			{
+				float * color = (p[1] == 'a' ? material->data.ambient :
+					(p[1] == 'd' ? material->data.diffuse : material->data.specular));
+				p += 2;
+				for (int i = 0; i < 3; i++)
+					parseFloat(p, end, color[i]);
+			}
+			else if (material && matchKeyword(p, end, "Ns", 2))
+			{
+				// Shininess in MTL files is in range [0, 1000]
+				p += 2;
+				if (parseFloat(p, end, material->data.shininess))
+					material->data.shininess /= 1000.0f;
+			}
+			else if (material && matchKeyword(p, end, "d", 1))
+			{
+				p += 1;
+				parseFloat(p, end, material->data.opacity);
+			}
+			else if (material && matchKeyword(p, end, "Tr", 2))
+			{
+				float transparency = 0.0f;
+				p += 2;
+				if (parseFloat(p, end, transparency))
+					material->data.opacity = 1.0f - transparency;
+			}
+			else if (material && matchKeyword(p, end, "map_Kd", 6))
+			{
+				p += 6;
+				material->data.texture = resolvePath(directory, restOfLine(p, end));
+			}
+			else if (material && (matchKeyword(p, end, "map_Bump", 8) || matchKeyword(p, end, "map_bump", 8)))
+			{
+				p += 8;
+				material->data.normalMap = resolvePath(directory, restOfLine(p, end));
+			}
+			else if (material && matchKeyword(p, end, "bump", 4))
+			{
+				p += 4;
+				material->data.normalMap = resolvePath(directory, restOfLine(p, end));
+			}
+
+			skipLine(p, end);
+		}
+	}
+
+	void generateNormals(GL::ModelData & data)
+	{
+		for (GL::Model::Vertex & vertex : data.vertices)
+		{
+			vertex.normal[0] = 0.0f;
+			vertex.normal[1] = 0.0f;
+			vertex.normal[2] = 0.0f;
+		}
+
+		// Face normals are not normalized, so they are weighted by the area of the triangle
+		for (size_t i = 0; i + 2 < data.indices.size(); i += 3)
+		{
+			GL::Model::Vertex & v0 = data.vertices[data.indices[i + 0]];
+			GL::Model::Vertex & v1 = data.vertices[data.indices[i + 1]];
+			GL::Model::Vertex & v2 = data.vertices[data.indices[i + 2]];
+
+			float edge1[3], edge2[3], normal[3];
+			for (int j = 0; j < 3; j++)
+			{
+				edge1[j] = v1.position[j] - v0.position[j];
+				edge2[j] = v2.position[j] - v0.position[j];
+			}
+
+			normal[0] = (edge1[1] * edge2[2]) - (edge1[2] * edge2[1]);
+			normal[1] = (edge1[2] * edge2[0]) - (edge1[0] * edge2[2]);
+			normal[2] = (edge1[0] * edge2[1]) - (edge1[1] * edge2[0]);
+
+			for (int j = 0; j < 3; j++)
+			{
+				v0.normal[j] += normal[j];
+				v1.normal[j] += normal[j];
+				v2.normal[j] += normal[j];
+			}
+		}
+
+		for (GL::Model::Vertex & vertex : data.vertices)
+		{
+			float length = 1.0f / sqrtf(vertex.normal[0] * vertex.normal[0] +
+				vertex.normal[1] * vertex.normal[1] + vertex.normal[2] * vertex.normal[2]);
+			vertex.normal[0] *= length;
+			vertex.normal[1] *= length;
+			vertex.normal[2] *= length;
+		}
+
+		data.hasNormals = true;
+	}
+
+	void generateTangents(GL::ModelData & data)
+	{
+		for (GL::Model::Vertex & vertex : data.vertices)
+		{
+			for (int j = 0; j < 4; j++)
+				vertex.tangent[j] = 0.0f;
+			for (int j = 0; j < 3; j++)
+				vertex.binormal[j] = 0.0f;
+		}
+
+		for (size_t i = 0; i + 2 < data.indices.size(); i += 3)
+		{
+			GL::Model::Vertex & v0 = data.vertices[data.indices[i + 0]];
+			GL::Model::Vertex & v1 = data.vertices[data.indices[i + 1]];
+			GL::Model::Vertex & v2 = data.vertices[data.indices[i + 2]];
+
+			float edge1[3], edge2[3], texEdge1[2], texEdge2[2], tangent[3], bitangent[3];
+			for (int j = 0; j < 3; j++)
+			{
+				edge1[j] = v1.position[j] - v0.position[j];
+				edge2[j] = v2.position[j] - v0.position[j];
+			}
+			for (int j = 0; j < 2; j++)
+			{
+				texEdge1[j] = v1.texCoord[j] - v0.texCoord[j];
+				texEdge2[j] = v2.texCoord[j] - v0.texCoord[j];
+			}
+
+			float det = texEdge1[0] * texEdge2[1] - texEdge2[0] * texEdge1[1];
+			if (fabsf(det) < 1e-6f)
+			{
+				tangent[0] = 1.0f;
+				tangent[1] = 0.0f;
+				tangent[2] = 0.0f;
+				bitangent[0] = 0.0f;
+				bitangent[1] = 1.0f;
+				bitangent[2] = 0.0f;
+			}
+			else
+			{
+				det = 1.0f / det;
+				for (int j = 0; j < 3; j++)
+				{
+					tangent[j] = (texEdge2[1] * edge1[j] - texEdge1[1] * edge2[j]) * det;
+					bitangent[j] = (-texEdge2[0] * edge1[j] + texEdge1[0] * edge2[j]) * det;
+				}
+			}
+
+			for (int j = 0; j < 3; j++)
+			{
+				v0.tangent[j] += tangent[j];
+				v1.tangent[j] += tangent[j];
+				v2.tangent[j] += tangent[j];
+				v0.binormal[j] += bitangent[j];
+				v1.binormal[j] += bitangent[j];
+				v2.binormal[j] += bitangent[j];
+			}
+		}
+
+		for (GL::Model::Vertex & vertex : data.vertices)
+		{
+			// Gram-Schmidt orthogonalization of the tangent with the normal
+			float nDotT = vertex.normal[0] * vertex.tangent[0] + vertex.normal[1] * vertex.tangent[1] +
+				vertex.normal[2] * vertex.tangent[2];
+			for (int j = 0; j < 3; j++)
+				vertex.tangent[j] -= vertex.normal[j] * nDotT;
+
+			float length = 1.0f / sqrtf(vertex.tangent[0] * vertex.tangent[0] +
+				vertex.tangent[1] * vertex.tangent[1] + vertex.tangent[2] * vertex.tangent[2]);
+			for (int j = 0; j < 3; j++)
+				vertex.tangent[j] *= length;
+
+			// Handedness of the tangent space. Normal maps have a left-handed coordinate system.
+			float bitangent[3];
+			bitangent[0] = (vertex.normal[1] * vertex.tangent[2]) - (vertex.normal[2] * vertex.tangent[1]);
+			bitangent[1] = (vertex.normal[2] * vertex.tangent[0]) - (vertex.normal[0] * vertex.tangent[2]);
+			bitangent[2] = (vertex.normal[0] * vertex.tangent[1]) - (vertex.normal[1] * vertex.tangent[0]);
+
+			float bDotB = bitangent[0] * vertex.binormal[0] + bitangent[1] * vertex.binormal[1] +
+				bitangent[2] * vertex.binormal[2];
+			vertex.tangent[3] = (bDotB < 0.0f ? 1.0f : -1.0f);
+
+			for (int j = 0; j < 3; j++)
+				vertex.binormal[j] = bitangent[j];
+		}
+
+		data.hasTangents = true;
+	}
+}
+
+GL::ObjParser::ObjParser(size_t numThreads)
+	: m_NumThreads(numThreads)
+{
+	if (m_NumThreads == 0)
+	{
+		unsigned cores = std::thread::hardware_concurrency();
+		m_NumThreads = (cores > 0 ? cores : 1);
+	}
+}
+
+void GL::ObjParser::parse(::Resource::Loader & loader, const std::string & filename, ModelData & data)
+{
+	size_t pos = filename.find_last_of("/\\");
+	std::string directory = (pos != std::string::npos ? filename.substr(0, pos + 1) : std::string());
+
+	std::string text = loader.loadResource(filename);
+	parse(text.data(), text.length(), loader, directory, data);
+}
+
+void GL::ObjParser::parse(const char * text, size_t length, ::Resource::Loader & loader,
+	const std::string & directory, ModelData & data)
+{
+	data.clear();
+
+	// Split file into chunks at line boundaries
+
+	size_t numChunks = std::max<size_t>(1, std::min(m_NumThreads, length / MinChunkSize));
+	std::vector<Chunk> chunks(numChunks);
+
+	const char * textEnd = text + length;
+	const char * p = text;
+	for (size_t i = 0; i < numChunks; i++)
+	{
+		chunks[i].text = text;
+		chunks[i].begin = p;
+		if (i == numChunks - 1)
+			p = textEnd;
+		else
+		{
+			p = std::max(p, text + length * (i + 1) / numChunks);
+			const char * eol = static_cast<const char *>(memchr(p, '\n', size_t(textEnd - p)));
+			p = (eol ? eol + 1 : textEnd);
+		}
+		chunks[i].end = p;
+	}
+
+	// Parse chunks in parallel
+
+	parallelFor(numChunks, [&chunks](size_t index) {
+		parseChunk(chunks[index]);
+	});
+
+	// Merge attributes
+
+	size_t numPositions = 0, numTexCoords = 0, numNormals = 0, numTriangles = 0;
+	for (Chunk & chunk : chunks)
+	{
+		chunk.positionBase = numPositions;
+		chunk.texCoordBase = numTexCoords;
+		chunk.normalBase = numNormals;
+		chunk.triangleBase = numTriangles;
+		numPositions += chunk.positions.size() / 3;
+		numTexCoords += chunk.texCoords.size() / 2;
+		numNormals += chunk.normals.size() / 3;
+		numTriangles += chunk.corners.size() / 3;
+	}
+
+	std::vector<float> positions, texCoords, normals;
+	if (numChunks == 1)
+	{
+		positions.swap(chunks[0].positions);
+		texCoords.swap(chunks[0].texCoords);
+		normals.swap(chunks[0].normals);
+	}
+	else
+	{
+		positions.reserve(numPositions * 3);
+		texCoords.reserve(numTexCoords * 2);
+		normals.reserve(numNormals * 3);
+		for (Chunk & chunk : chunks)
+		{
+			positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+			texCoords.insert(texCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+			normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+			std::vector<float>().swap(chunk.positions);
+			std::vector<float>().swap(chunk.texCoords);
+			std::vector<float>().swap(chunk.normals);
+		}
+	}
+
+	data.hasPositions = numPositions > 0;
+	data.hasTexCoords = numTexCoords > 0;
+	data.hasNormals = numNormals > 0;
+
+	parallelFor(numChunks, [&chunks, &positions, &texCoords, &normals](size_t index) {
+		resolveChunk(chunks[index], positions, texCoords, normals);
+	});
+
+	// Deduplicate vertices in order of their first use
+
+	data.indices.resize(numTriangles * 3);
+	data.vertices.reserve(numTriangles / 2 + 16);
+
+	std::vector<int32_t> vertexPositions;
+	vertexPositions.reserve(numTriangles / 2 + 16);
+
+	std::vector<UInt> table(1024, UInt(-1));
+	size_t tableMask = table.size() - 1;
+
+	size_t outIndex = 0;
+	Model::Vertex vertex;
+	for (const Chunk & chunk : chunks)
+	{
+		for (size_t i = 0; i < chunk.corners.size(); i++)
+		{
+			const Corner & corner = chunk.corners[i];
+			makeVertex(vertex, corner, positions, texCoords, normals);
+
+			size_t slot = chunk.hashes[i] & tableMask;
+			for (;;)
+			{
+				UInt index = table[slot];
+				if (index == UInt(-1))
+				{
+					index = UInt(data.vertices.size());
+					table[slot] = index;
+					data.vertices.push_back(vertex);
+					vertexPositions.push_back(corner.position);
+					data.indices[outIndex++] = index;
+					break;
+				}
+
+				if (vertexPositions[index] == corner.position &&
+					!memcmp(&data.vertices[index], &vertex, sizeof(vertex)))
+				{
+					data.indices[outIndex++] = index;
+					break;
+				}
+
+				slot = (slot + 1) & tableMask;
+			}
+
+			// Grow the table when it is half full
+			if (data.vertices.size() * 2 > table.size())
+			{
+				std::vector<UInt> newTable(table.size() * 2, UInt(-1));
+				size_t newMask = newTable.size() - 1;
+				for (UInt index : table)
+				{
+					if (index == UInt(-1))
+						continue;
+
+					size_t newSlot = hashVertex(vertexPositions[index], data.vertices[index]) & newMask;
+					while (newTable[newSlot] != UInt(-1))
+						newSlot = (newSlot + 1) & newMask;
+					newTable[newSlot] = index;
+				}
+				table.swap(newTable);
+				tableMask = newMask;
+			}
+		}
+	}
+
+	std::vector<UInt>().swap(table);
+	std::vector<int32_t>().swap(vertexPositions);
+
+	// Load materials
+
+	std::vector<Material> materials;
+	std::unordered_map<std::string, int> materialIndices;
+	for (const Chunk & chunk : chunks)
+	{
+		for (const std::string & library : chunk.materialLibraries)
+		{
+			std::string path = resolvePath(directory, library);
+			size_t pos = path.find_last_of("/\\");
+			std::string libraryDirectory = (pos != std::string::npos ? path.substr(0, pos + 1) : std::string());
+
+			size_t first = materials.size();
+			parseMaterialLibrary(loader.loadResource(path), libraryDirectory, materials);
+			for (size_t i = first; i < materials.size(); i++)
+				materialIndices[materials[i].name] = int(i);
+		}
+	}
+
+	data.materials.reserve(materials.size());
+	for (const Material & material : materials)
+		data.materials.push_back(material.data);
+
+	// Build meshes from runs of triangles with the same material
+
+	std::vector<std::pair<size_t, int>> switches;
+	for (const Chunk & chunk : chunks)
+	{
+		for (const MaterialSwitch & material : chunk.materials)
+		{
+			auto it = materialIndices.find(material.name);
+			int materialIndex = (it != materialIndices.end() ? it->second : 0);
+
+			size_t triangle = chunk.triangleBase + material.triangle;
+			if (!switches.empty() && switches.back().first == triangle)
+				switches.back().second = materialIndex;
+			else
+				switches.push_back(std::make_pair(triangle, materialIndex));
+		}
+	}
+
+	int runMaterial = 0;
+	size_t runStart = 0;
+	for (const auto & it : switches)
+	{
+		if (it.second == runMaterial)
+			continue;
+
+		if (it.first > runStart)
+		{
+			ModelData::Mesh mesh;
+			mesh.materialIndex = runMaterial;
+			mesh.firstIndex = UInt(runStart * 3);
+			mesh.numIndices = UInt((it.first - runStart) * 3);
+			data.meshes.push_back(mesh);
+			runStart = it.first;
+		}
+
+		runMaterial = it.second;
+	}
+
+	if (numTriangles > runStart)
+	{
+		ModelData::Mesh mesh;
+		mesh.materialIndex = runMaterial;
+		mesh.firstIndex = UInt(runStart * 3);
+		mesh.numIndices = UInt((numTriangles - runStart) * 3);
+		data.meshes.push_back(mesh);
+	}
+
+	// Opaque meshes first
+	const std::vector<ModelData::Material> & mats = data.materials;
+	std::sort(data.meshes.begin(), data.meshes.end(), [&mats](const ModelData::Mesh & a,
+		const ModelData::Mesh & b) {
+		float alphaA = (size_t(a.materialIndex) < mats.size() ? mats[a.materialIndex].opacity : 1.0f);
+		float alphaB = (size_t(b.materialIndex) < mats.size() ? mats[b.materialIndex].opacity : 1.0f);
+		return alphaA > alphaB;
+	});
+
+	// Bounds. As in ModelOBJ, radius is the largest dimension of the bounding box.
+
+	if (!data.vertices.empty())
+	{
+		float minPos[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float maxPos[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (const Model::Vertex & v : data.vertices)
+		{
+			for (int j = 0; j < 3; j++)
+			{
+				minPos[j] = std::min(minPos[j], float(v.position[j]));
+				maxPos[j] = std::max(maxPos[j], float(v.position[j]));
+			}
+		}
+
+		for (int j = 0; j < 3; j++)
+		{
+			data.size[j] = maxPos[j] - minPos[j];
+			data.center[j] = (maxPos[j] + minPos[j]) / 2.0f;
+		}
+		data.radius = std::max(std::max(data.size[0], data.size[1]), data.size[2]);
+	}
+
+	data.computeMeshBounds();
+
+	// Generate normals and tangents
+
+	if (!data.hasNormals)
+		generateNormals(data);
+
+	for (const ModelData::Material & material : data.materials)
+	{
+		if (!material.normalMap.empty())
+		{
+			generateTangents(data);
+			break;
+		}
+	}
+}
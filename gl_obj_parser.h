@@ -0,0 +1,86 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __28aa9fae2a84e8511f0115222e2f38f7__
+#define __28aa9fae2a84e8511f0115222e2f38f7__
+
+#include "gl_model_data.h"
+#include <yip-imports/resource_loader.h>
+#include <string>
+
+namespace GL
+{
+	/**
+	 * Parser of Alias|Wavefront OBJ and MTL files.
+	 *
+	 * The file is split into chunks at line boundaries and the chunks are parsed in parallel. Vertices are then
+	 * deduplicated with a hash table. The result matches the one produced by *ModelOBJ::import*: polygons are
+	 * triangulated as fans, meshes are built from runs of triangles with the same material and sorted by
+	 * opacity, missing normals are generated and tangents are generated when any material has a bump map.
+	 *
+	 * Names of material libraries and textures are resolved relative to the directory of the OBJ file.
+	 */
+	class ObjParser
+	{
+	public:
+		/**
+		 * Constructor.
+		 * @param numThreads Maximum number of threads to use. If zero, number of CPU cores is used.
+		 */
+		explicit ObjParser(size_t numThreads = 0);
+
+		/**
+		 * Returns maximum number of threads used by the parser.
+		 * @return Maximum number of threads.
+		 */
+		inline size_t numThreads() const { return m_NumThreads; }
+
+		/**
+		 * Parses the OBJ file and material libraries referenced by it.
+		 * @param loader Resource loader to use.
+		 * @param filename Name of the OBJ file.
+		 * @param data Output model data.
+		 * @throws std::runtime_error if file is malformed.
+		 */
+		void parse(::Resource::Loader & loader, const std::string & filename, ModelData & data);
+
+		/**
+		 * Parses the OBJ file contents.
+		 * @param text Pointer to the contents of the file.
+		 * @param length Length of the contents.
+		 * @param loader Resource loader to use for material libraries.
+		 * @param directory Directory of the OBJ file (empty or ending with a slash).
+		 * @param data Output model data.
+		 * @throws std::runtime_error if file is malformed.
+		 */
+		void parse(const char * text, size_t length, ::Resource::Loader & loader, const std::string & directory,
+			ModelData & data);
+
+	private:
+		size_t m_NumThreads;
+
+		ObjParser(const ObjParser &) = delete;
+		ObjParser & operator=(const ObjParser &) = delete;
+	};
+}
+
+#endif
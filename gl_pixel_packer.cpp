@@ -0,0 +1,333 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "gl_pixel_packer.h"
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <emmintrin.h>
+ #define GL_PIXEL_PACKER_SSE2 1
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+ #include <arm_neon.h>
+ #define GL_PIXEL_PACKER_NEON 1
+#endif
+
+namespace
+{
+	// 4x4 Bayer threshold matrix
+	const int BayerMatrix[4][4] = {
+		{ 0, 8, 2, 10 },
+		{ 12, 4, 14, 6 },
+		{ 3, 11, 1, 9 },
+		{ 15, 7, 13, 5 },
+	};
+
+	// Moves bits of an RGBA pixel (R in the lowest byte) into the packed pixel:
+	// packed |= (shift > 0 ? pixel >> shift : pixel << -shift) & mask
+	struct Term
+	{
+		int shift;
+		uint32_t mask;
+	};
+
+	struct Layout
+	{
+		int bits[4];							// Number of bits for each channel
+		Term terms[4];
+	};
+
+	const Layout RGB565Layout = {
+		{ 5, 6, 5, 0 },
+		{ { -8, 0xF800 }, { 5, 0x07E0 }, { 19, 0x001F }, { 0, 0 } },
+	};
+
+	const Layout RGBA4444Layout = {
+		{ 4, 4, 4, 4 },
+		{ { -8, 0xF000 }, { 4, 0x0F00 }, { 16, 0x00F0 }, { 28, 0x000F } },
+	};
+
+	const Layout RGBA5551Layout = {
+		{ 5, 5, 5, 1 },
+		{ { -8, 0xF800 }, { 5, 0x07C0 }, { 18, 0x003E }, { 31, 0x0001 } },
+	};
+
+	const Layout & layoutForFormat(GL::PixelPacker::Format format)
+	{
+		switch (format)
+		{
+		case GL::PixelPacker::UnpackedFormat: break;
+		case GL::PixelPacker::RGB565Format: return RGB565Layout;
+		case GL::PixelPacker::RGBA4444Format: return RGBA4444Layout;
+		case GL::PixelPacker::RGBA5551Format: return RGBA5551Layout;
+		}
+		assert(false);
+		return RGB565Layout;
+	}
+
+	// Calculates rounding (or dithering) bias added to each byte of four consecutive RGBA pixels
+	void computeBias(const Layout & layout, bool dither, int x, int y, GL::UByte bias[16])
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			int threshold = BayerMatrix[y & 3][(x + i) & 3];
+			for (int c = 0; c < 4; c++)
+			{
+				int bits = layout.bits[c];
+				int shift = 8 - bits;
+				if (bits <= 1)
+					bias[i * 4 + c] = 0;
+				else if (!dither)
+					bias[i * 4 + c] = GL::UByte((1 << shift) >> 1);
+				else
+					bias[i * 4 + c] = GL::UByte(((2 * threshold + 1) << shift) >> 5);
+			}
+		}
+	}
+
+	inline GL::UShort packPixel(const Layout & layout, const GL::UByte * pixel, const GL::UByte * bias)
+	{
+		uint32_t p = 0;
+		for (int c = 0; c < 4; c++)
+		{
+			unsigned value = unsigned(pixel[c]) + bias[c];
+			p |= uint32_t(value > 255 ? 255 : value) << (c * 8);
+		}
+
+		uint32_t result = 0;
+		for (const Term & term : layout.terms)
+			result |= (term.shift >= 0 ? p >> term.shift : p << -term.shift) & term.mask;
+		return GL::UShort(result);
+	}
+
+	void packRow(const Layout & layout, const GL::UByte * src, int width, const GL::UByte bias[16],
+		GL::UShort * dst)
+	{
+		int x = 0;
+
+	  #if defined(GL_PIXEL_PACKER_SSE2)
+		const __m128i vbias = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bias));
+		__m128i shifts[4], masks[4];
+		bool left[4];
+		for (int i = 0; i < 4; i++)
+		{
+			left[i] = layout.terms[i].shift < 0;
+			shifts[i] = _mm_cvtsi32_si128(left[i] ? -layout.terms[i].shift : layout.terms[i].shift);
+			masks[i] = _mm_set1_epi32(int(layout.terms[i].mask));
+		}
+
+		for (; x + 8 <= width; x += 8)
+		{
+			__m128i result[2];
+			for (int half = 0; half < 2; half++)
+			{
+				__m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + (x + half * 4) * 4));
+				p = _mm_adds_epu8(p, vbias);
+
+				__m128i packed = _mm_setzero_si128();
+				for (int i = 0; i < 4; i++)
+				{
+					__m128i t = (left[i] ? _mm_sll_epi32(p, shifts[i]) : _mm_srl_epi32(p, shifts[i]));
+					packed = _mm_or_si128(packed, _mm_and_si128(t, masks[i]));
+				}
+
+				// Sign-extend so that signed saturation in _mm_packs_epi32 keeps all 16 bits
+				result[half] = _mm_srai_epi32(_mm_slli_epi32(packed, 16), 16);
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_packs_epi32(result[0], result[1]));
+		}
+	  #elif defined(GL_PIXEL_PACKER_NEON)
+		const uint8x16_t vbias = vld1q_u8(bias);
+		int32x4_t shifts[4];
+		uint32x4_t masks[4];
+		for (int i = 0; i < 4; i++)
+		{
+			shifts[i] = vdupq_n_s32(-layout.terms[i].shift);
+			masks[i] = vdupq_n_u32(layout.terms[i].mask);
+		}
+
+		for (; x + 4 <= width; x += 4)
+		{
+			uint32x4_t p = vreinterpretq_u32_u8(vqaddq_u8(vld1q_u8(src + x * 4), vbias));
+			uint32x4_t packed = vdupq_n_u32(0);
+			for (int i = 0; i < 4; i++)
+				packed = vorrq_u32(packed, vandq_u32(vshlq_u32(p, shifts[i]), masks[i]));
+			vst1_u16(dst + x, vmovn_u32(packed));
+		}
+	  #endif
+
+		// Bias pattern repeats every four pixels
+		for (; x < width; x++)
+			dst[x] = packPixel(layout, src + x * 4, bias + (x & 3) * 4);
+	}
+
+	inline GL::UByte expand(unsigned value, int bits)
+	{
+		// Replicate bits to fill all 8 bits
+		unsigned result = value << (8 - bits);
+		for (int filled = bits; filled < 8; filled += bits)
+			result |= result >> bits;
+		return GL::UByte(result);
+	}
+}
+
+GL::PixelPacker::PixelPacker(Format format, bool dither)
+	: m_Format(format),
+	  m_Dither(dither)
+{
+}
+
+GL::Enum GL::PixelPacker::glFormat() const noexcept
+{
+	switch (m_Format)
+	{
+	case UnpackedFormat: break;
+	case RGB565Format: return GL::RGB;
+	case RGBA4444Format: return GL::RGBA;
+	case RGBA5551Format: return GL::RGBA;
+	}
+	return GL::NONE;
+}
+
+GL::Enum GL::PixelPacker::glType() const noexcept
+{
+	switch (m_Format)
+	{
+	case UnpackedFormat: break;
+	case RGB565Format: return GL::UNSIGNED_SHORT_5_6_5;
+	case RGBA4444Format: return GL::UNSIGNED_SHORT_4_4_4_4;
+	case RGBA5551Format: return GL::UNSIGNED_SHORT_5_5_5_1;
+	}
+	return GL::UNSIGNED_BYTE;
+}
+
+void GL::PixelPacker::pack(const void * pixels, int width, int height, int channels, std::vector<UShort> & output,
+	int originX, int originY) const
+{
+	assert(m_Format != UnpackedFormat);
+	assert(channels == 3 || channels == 4);
+
+	const Layout & layout = layoutForFormat(m_Format);
+	const UByte * src = reinterpret_cast<const UByte *>(pixels);
+
+	output.resize(size_t(width) * size_t(height));
+
+	std::vector<UByte> row;
+	if (channels != 4)
+		row.resize(size_t(width) * 4);
+
+	for (int y = 0; y < height; y++)
+	{
+		const UByte * srcRow = src + size_t(y) * size_t(width) * size_t(channels);
+		if (channels != 4)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				memcpy(&row[size_t(x) * 4], srcRow + size_t(x) * 3, 3);
+				row[size_t(x) * 4 + 3] = 0xFF;
+			}
+			srcRow = row.data();
+		}
+
+		UByte bias[16];
+		computeBias(layout, m_Dither, originX, originY + y, bias);
+		packRow(layout, srcRow, width, bias, &output[size_t(y) * size_t(width)]);
+	}
+}
+
+void GL::PixelPacker::unpack(const UShort * packed, size_t count, std::vector<UByte> & output) const
+{
+	assert(m_Format != UnpackedFormat);
+
+	const Layout & layout = layoutForFormat(m_Format);
+	output.resize(count * 4);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			if (layout.bits[c] == 0)
+			{
+				output[i * 4 + size_t(c)] = 0xFF;
+				continue;
+			}
+
+			const Term & term = layout.terms[c];
+			uint32_t bits = uint32_t(packed[i]) & term.mask;
+			// Invert the term: move bits back to the top of the channel byte and then to its lowest bit
+			uint32_t p = (term.shift >= 0 ? bits << term.shift : bits >> -term.shift);
+			unsigned value = (p >> (c * 8 + 8 - layout.bits[c])) & ((1u << layout.bits[c]) - 1);
+			output[i * 4 + size_t(c)] = expand(value, layout.bits[c]);
+		}
+	}
+}
+
+double GL::PixelPacker::psnr(const void * pixels, int width, int height, int channels) const
+{
+	size_t numPixels = size_t(width) * size_t(height);
+	if (m_Format == UnpackedFormat || numPixels == 0)
+		return std::numeric_limits<double>::infinity();
+
+	std::vector<UShort> packed;
+	std::vector<UByte> unpacked;
+	pack(pixels, width, height, channels, packed);
+	unpack(packed.data(), numPixels, unpacked);
+
+	// Alpha is compared only if both the image and the packed format have it
+	const Layout & layout = layoutForFormat(m_Format);
+	int numCompared = (channels == 4 && layout.bits[3] > 0 ? 4 : 3);
+
+	const UByte * src = reinterpret_cast<const UByte *>(pixels);
+	double sum = 0.0;
+	for (size_t i = 0; i < numPixels; i++)
+	{
+		for (int c = 0; c < numCompared; c++)
+		{
+			double diff = double(src[i * size_t(channels) + size_t(c)]) - double(unpacked[i * 4 + size_t(c)]);
+			sum += diff * diff;
+		}
+	}
+
+	if (sum == 0.0)
+		return std::numeric_limits<double>::infinity();
+
+	double mse = sum / (double(numPixels) * double(numCompared));
+	return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+double GL::PixelPacker::psnr(const Stb::Image & image) const
+{
+	int channels = 0;
+	switch (image.format())
+	{
+	case Stb::Image::RGB: channels = 3; break;
+	case Stb::Image::RGBA: channels = 4; break;
+	case Stb::Image::UNKNOWN:
+	case Stb::Image::ALPHA:
+	case Stb::Image::LUMINANCE_ALPHA:
+		return std::numeric_limits<double>::infinity();
+	}
+
+	return psnr(image.data(), image.width(), image.height(), channels);
+}
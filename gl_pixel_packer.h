@@ -0,0 +1,130 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __0e9d31fd8ac417adb8cb210430366ac7__
+#define __0e9d31fd8ac417adb8cb210430366ac7__
+
+#include <yip-imports/gl.h>
+#include <yip-imports/stb_image.hpp>
+#include <vector>
+
+namespace GL
+{
+	/**
+	 * Converter of 8-bit RGB and RGBA pixels into 16-bit packed formats.
+	 *
+	 * Packed formats use half the memory and bandwidth of RGBA images. To hide banding, 4x4 ordered (Bayer)
+	 * dithering is applied to all channels except the 1-bit alpha of RGBA5551Format. Conversion uses SSE2 or
+	 * NEON when available.
+	 *
+	 * Use psnr() to estimate quality loss of the conversion and choose format for each asset.
+	 */
+	class PixelPacker
+	{
+	public:
+		/** Packed pixel format. */
+		enum Format
+		{
+			UnpackedFormat = 0,					/**< No conversion (8 bits per channel). */
+			RGB565Format,						/**< GL::RGB with GL::UNSIGNED_SHORT_5_6_5. */
+			RGBA4444Format,						/**< GL::RGBA with GL::UNSIGNED_SHORT_4_4_4_4. */
+			RGBA5551Format,						/**< GL::RGBA with GL::UNSIGNED_SHORT_5_5_5_1. */
+		};
+
+		/**
+		 * Constructor.
+		 * @param format Packed pixel format.
+		 * @param dither Set to *true* to apply ordered dithering.
+		 */
+		explicit PixelPacker(Format format = UnpackedFormat, bool dither = true);
+
+		/**
+		 * Returns packed pixel format.
+		 * @return Packed pixel format.
+		 */
+		inline Format format() const noexcept { return m_Format; }
+
+		/**
+		 * Checks whether ordered dithering is applied.
+		 * @return *true* if dithering is enabled, *false* otherwise.
+		 */
+		inline bool dither() const noexcept { return m_Dither; }
+
+		/**
+		 * Returns OpenGL pixel format for the packed pixels.
+		 * @return GL::RGB, GL::RGBA or GL::NONE for UnpackedFormat.
+		 */
+		Enum glFormat() const noexcept;
+
+		/**
+		 * Returns OpenGL pixel type for the packed pixels.
+		 * @return One of GL::UNSIGNED_SHORT_5_6_5, GL::UNSIGNED_SHORT_4_4_4_4, GL::UNSIGNED_SHORT_5_5_5_1 or
+		 * GL::UNSIGNED_BYTE for UnpackedFormat.
+		 */
+		Enum glType() const noexcept;
+
+		/**
+		 * Converts pixels into the packed format.
+		 * @param pixels Pointer to the pixels (rows are tightly packed).
+		 * @param width Width of the image in pixels.
+		 * @param height Height of the image in pixels.
+		 * @param channels Number of channels (3 for RGB or 4 for RGBA). RGB pixels are treated as opaque.
+		 * @param output Output vector for packed pixels.
+		 * @param originX X coordinate of the image in the texture (aligns the dithering pattern).
+		 * @param originY Y coordinate of the image in the texture (aligns the dithering pattern).
+		 */
+		void pack(const void * pixels, int width, int height, int channels, std::vector<UShort> & output,
+			int originX = 0, int originY = 0) const;
+
+		/**
+		 * Converts packed pixels into RGBA pixels with 8 bits per channel.
+		 * @param packed Pointer to the packed pixels.
+		 * @param count Number of pixels.
+		 * @param output Output vector for RGBA pixels.
+		 */
+		void unpack(const UShort * packed, size_t count, std::vector<UByte> & output) const;
+
+		/**
+		 * Calculates peak signal-to-noise ratio of the conversion of the specified image.
+		 * Only channels that exist in both the image and the packed format are compared.
+		 * @param pixels Pointer to the pixels (rows are tightly packed).
+		 * @param width Width of the image in pixels.
+		 * @param height Height of the image in pixels.
+		 * @param channels Number of channels (3 for RGB or 4 for RGBA).
+		 * @return PSNR in decibels (higher is better; infinity if conversion is lossless).
+		 */
+		double psnr(const void * pixels, int width, int height, int channels) const;
+
+		/**
+		 * Calculates peak signal-to-noise ratio of the conversion of the specified image.
+		 * @param image Image (should be in the RGB or RGBA format).
+		 * @return PSNR in decibels (higher is better; infinity if conversion is lossless).
+		 */
+		double psnr(const Stb::Image & image) const;
+
+	private:
+		Format m_Format;
+		bool m_Dither;
+	};
+}
+
+#endif
@@ -25,20 +25,37 @@
 #include "gl_attrib.h"
 #include "gl_resource_manager.h"
 #include "gl_program_binder.h"
+#include "gl_program_binary_cache.h"
 #include "gl_vertex_attrib_pointer.h"
 #include "gl_enable_vertex_attrib.h"
 #include <yip-imports/cxx-util/macros.h>
 #include <sstream>
 #include <stdexcept>
 #include <iostream>
+#include <algorithm>
+#include <cstring>
 
 static bool iswhite(char ch)
 {
 	return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
 }
 
+static size_t arrayBaseNameLength(const std::string & name)
+{
+	// Active uniform arrays are reported with the "[0]" suffix
+	size_t length = name.length();
+	if (length > 3 && !memcmp(name.c_str() + length - 3, "[0]", 3))
+		return length - 3;
+	return length;
+}
+
 GL::Program::Program(ResourceManager * resMgr, const std::string & resName)
-	: Resource(resMgr, resName)
+	: Resource(resMgr, resName),
+	  m_UniformUploadsIssued(0),
+	  m_UniformUploadsSkipped(0),
+	  m_Reflected(false),
+	  m_LinkFailed(false),
+	  m_UniformShadowEnabled(false)
 {
 	m_Handle = GL::createProgram();
 }
@@ -82,6 +99,7 @@ void GL::Program::initFromSource(const char * data)
 	vertex.reserve(lines.size());
 	fragment.reserve(lines.size());
 
+	std::vector<std::pair<Enum, std::string>> files;
 	bool hasVertex = false, hasFragment = 0;
 	Enum type = GL::NONE;
 	for (std::vector<std::string>::const_iterator it = lines.begin(); it != lines.end(); ++it)
@@ -136,11 +154,48 @@ void GL::Program::initFromSource(const char * data)
 				std::string filename(file);
 				if (filename.length() > 0 && filename[filename.length() - 1] == '\n')
 					filename.resize(filename.length() - 1);
-				attachShader(manager()->getShader(type, filename));
+				files.push_back(std::make_pair(type, filename));
 			}
 		}
 	}
 
+	// Sources of included files are loaded only if they are needed for the binary cache key
+	ProgramBinaryCache * binaryCache = manager()->m_ProgramBinaryCache.get();
+	std::vector<std::string> fileSources;
+	std::string binaryKey;
+	if (binaryCache && binaryCache->isSupported())
+	{
+		std::string vertexSource, fragmentSource;
+		fileSources.reserve(files.size());
+		for (const auto & it : files)
+		{
+			fileSources.push_back(manager()->m_ResourceLoader->loadResource(it.second));
+			std::string & source = (it.first == GL::VERTEX_SHADER ? vertexSource : fragmentSource);
+			source += fileSources.back();
+			source += '\0';
+		}
+		if (hasVertex)
+		{
+			for (const char * line : vertex)
+				vertexSource += line;
+		}
+		if (hasFragment)
+		{
+			for (const char * line : fragment)
+				fragmentSource += line;
+		}
+
+		binaryKey = binaryCache->makeKey(vertexSource, fragmentSource);
+		if (binaryCache->load(binaryKey, *this))
+			return;
+	}
+
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		const std::string * source = (i < fileSources.size() ? &fileSources[i] : nullptr);
+		attachShader(manager()->getShader(files[i].first, files[i].second, source));
+	}
+
 	if (hasVertex)
 	{
 		ShaderPtr shader = manager()->createShader(GL::VERTEX_SHADER);
@@ -156,12 +211,31 @@ void GL::Program::initFromSource(const char * data)
 	}
 
 	link();
+
+	if (binaryCache && !binaryKey.empty())
+	{
+		// Retrieving the program binary waits for the link to complete, so postpone it in batch mode
+		if (manager()->isBatching())
+			manager()->m_PendingProgramBinaries.push_back(std::make_pair(
+				std::static_pointer_cast<Program>(shared_from_this()), binaryKey));
+		else
+			binaryCache->store(binaryKey, *this);
+	}
 }
 
 void GL::Program::link()
 {
 	linkProgram(m_Handle);
+	invalidateReflection();
 
+	if (manager() && manager()->isBatching())
+		manager()->m_PendingPrograms.push_back(std::static_pointer_cast<Program>(shared_from_this()));
+	else
+		reportLinkLog();
+}
+
+void GL::Program::reportLinkLog()
+{
 	GL::Int logLength = 0;
 	GL::getProgramiv(m_Handle, GL::INFO_LOG_LENGTH, &logLength);
 	if (logLength > 0)
@@ -172,6 +246,13 @@ void GL::Program::link()
 	}
 }
 
+bool GL::Program::linkStatus() const
+{
+	GL::Int status = GL::FALSE;
+	GL::getProgramiv(m_Handle, GL::LINK_STATUS, &status);
+	return status != GL::FALSE;
+}
+
 void GL::Program::validate()
 {
 	validateProgram(m_Handle);
@@ -186,11 +267,285 @@ void GL::Program::validate()
 	}
 }
 
+const std::vector<GL::Program::Variable> & GL::Program::activeUniforms() const
+{
+	reflect();
+	return m_Uniforms.variables;
+}
+
+const std::vector<GL::Program::Variable> & GL::Program::activeAttributes() const
+{
+	reflect();
+	return m_Attributes.variables;
+}
+
+const GL::Program::Variable * GL::Program::findUniform(NameHash hash) const
+{
+	return (reflect() ? m_Uniforms.find(hash) : nullptr);
+}
+
+const GL::Program::Variable * GL::Program::findUniform(const std::string & name) const
+{
+	if (UNLIKELY(!reflect()))
+		return nullptr;
+	size_t length = arrayBaseNameLength(name);
+	return m_Uniforms.find(NameHash(name.c_str(), length), name.c_str(), length);
+}
+
+const GL::Program::Variable * GL::Program::findAttribute(NameHash hash) const
+{
+	return (reflect() ? m_Attributes.find(hash) : nullptr);
+}
+
+const GL::Program::Variable * GL::Program::findAttribute(const std::string & name) const
+{
+	if (UNLIKELY(!reflect()))
+		return nullptr;
+	size_t length = arrayBaseNameLength(name);
+	return m_Attributes.find(NameHash(name.c_str(), length), name.c_str(), length);
+}
+
+int GL::Program::uniformLocation(const std::string & name) const
+{
+	if (UNLIKELY(!reflect()))
+		return getUniformLocation(name);
+
+	const Variable * variable = findUniform(name);
+	if (LIKELY(variable))
+		return variable->location;
+
+	// Locations of array elements are not guaranteed to be consecutive, ask the driver
+	if (name.length() > 0 && name[name.length() - 1] == ']')
+		return getUniformLocation(name);
+
+	return -1;
+}
+
+int GL::Program::attribLocation(const std::string & name) const
+{
+	if (UNLIKELY(!reflect()))
+		return getAttribLocation(name);
+
+	const Variable * variable = findAttribute(name);
+	return (variable ? variable->location : -1);
+}
+
+void GL::Program::setUniformShadowEnabled(bool flag)
+{
+	m_UniformShadowEnabled = flag;
+	if (!flag)
+		m_UniformShadow.clear();
+}
+
+void GL::Program::resetUniformStatistics()
+{
+	m_UniformUploadsIssued = 0;
+	m_UniformUploadsSkipped = 0;
+}
+
+bool GL::Program::updateUniformShadow(int location, const void * data, size_t size, bool transposed)
+{
+	if (UNLIKELY(m_UniformShadow.empty()))
+		initUniformShadow();
+
+	// Elements of uniform arrays are not shadowed: they could be written both through the base location and
+	// through locations of individual elements, which are not guaranteed to be consecutive.
+	if (UNLIKELY(location < 0 || static_cast<size_t>(location) >= m_UniformShadow.size() ||
+		!m_UniformShadow[static_cast<size_t>(location)].shadowed))
+	{
+		++m_UniformUploadsIssued;
+		return true;
+	}
+
+	UniformShadow & shadow = m_UniformShadow[static_cast<size_t>(location)];
+	if (shadow.valid && shadow.transposed == transposed && shadow.value.size() == size &&
+		!memcmp(shadow.value.data(), data, size))
+	{
+		++m_UniformUploadsSkipped;
+		return false;
+	}
+
+	const char * bytes = reinterpret_cast<const char *>(data);
+	shadow.value.assign(bytes, bytes + size);
+	shadow.transposed = transposed;
+	shadow.valid = true;
+	++m_UniformUploadsIssued;
+
+	return true;
+}
+
+void GL::Program::initUniformShadow()
+{
+	// Locations are small integers on all known implementations, so the shadow is indexed by location.
+	// Unusually large locations are not shadowed.
+	static const int MaxShadowedLocation = 4096;
+
+	// Table always has at least one entry, so it is built only once after linking
+	m_UniformShadow.resize(1, UniformShadow{ std::vector<char>(), false, false, false });
+	for (const Variable & uniform : activeUniforms())
+	{
+		if (uniform.size != 1 || uniform.location < 0 || uniform.location >= MaxShadowedLocation)
+			continue;
+
+		size_t location = static_cast<size_t>(uniform.location);
+		if (location >= m_UniformShadow.size())
+			m_UniformShadow.resize(location + 1, UniformShadow{ std::vector<char>(), false, false, false });
+		m_UniformShadow[location].shadowed = true;
+	}
+}
+
+void GL::Program::invalidateReflection()
+{
+	// Relinking resets values of all uniforms and may change their locations
+	m_Reflected = false;
+	m_LinkFailed = false;
+	m_UniformShadow.clear();
+}
+
+bool GL::Program::reflect() const
+{
+	if (LIKELY(m_Reflected))
+		return true;
+
+	// Failed link is remembered until the program is linked again, so lookups do not query the driver
+	if (m_LinkFailed)
+		return false;
+
+	m_Uniforms.clear();
+	m_Attributes.clear();
+
+	if (m_Handle == 0 || !linkStatus())
+	{
+		m_LinkFailed = true;
+		return false;
+	}
+
+	GL::Int count = 0, maxLength = 0;
+	std::vector<char> buffer;
+
+	GL::getProgramiv(m_Handle, GL::ACTIVE_UNIFORMS, &count);
+	GL::getProgramiv(m_Handle, GL::ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+	buffer.resize(static_cast<size_t>(std::max(maxLength, 1) + 1));
+	m_Uniforms.variables.reserve(static_cast<size_t>(count));
+	for (GL::Int i = 0; i < count; i++)
+	{
+		GL::Sizei length = 0;
+		GL::Int size = 0;
+		GL::Enum type = GL::NONE;
+		buffer[0] = 0;
+		GL::getActiveUniform(m_Handle, static_cast<GL::UInt>(i), static_cast<GL::Sizei>(buffer.size()),
+			&length, &size, &type, buffer.data());
+		if (length <= 0)
+			continue;
+
+		std::string name(buffer.data(), static_cast<size_t>(length));
+		int location = GL::getUniformLocation(m_Handle, name.c_str());
+		name.resize(arrayBaseNameLength(name));
+		m_Uniforms.variables.push_back(Variable{ name, NameHash(name), location, type, size });
+	}
+
+	GL::getProgramiv(m_Handle, GL::ACTIVE_ATTRIBUTES, &count);
+	GL::getProgramiv(m_Handle, GL::ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength);
+	buffer.resize(static_cast<size_t>(std::max(maxLength, 1) + 1));
+	m_Attributes.variables.reserve(static_cast<size_t>(count));
+	for (GL::Int i = 0; i < count; i++)
+	{
+		GL::Sizei length = 0;
+		GL::Int size = 0;
+		GL::Enum type = GL::NONE;
+		buffer[0] = 0;
+		GL::getActiveAttrib(m_Handle, static_cast<GL::UInt>(i), static_cast<GL::Sizei>(buffer.size()),
+			&length, &size, &type, buffer.data());
+		if (length <= 0)
+			continue;
+
+		std::string name(buffer.data(), static_cast<size_t>(length));
+		int location = GL::getAttribLocation(m_Handle, name.c_str());
+		name.resize(arrayBaseNameLength(name));
+		m_Attributes.variables.push_back(Variable{ name, NameHash(name), location, type, size });
+	}
+
+	m_Uniforms.build();
+	m_Attributes.build();
+	m_Reflected = true;
+
+	return true;
+}
+
+void GL::Program::VariableTable::build()
+{
+	std::sort(variables.begin(), variables.end(),
+		[](const Variable & a, const Variable & b) { return a.name < b.name; });
+
+	// Open-addressing hash index with load factor of at most 0.5; zero denotes an empty slot
+	size_t size = 4;
+	while (size < variables.size() * 2)
+		size <<= 1;
+
+	index.assign(size, 0);
+	for (size_t i = 0; i < variables.size(); i++)
+	{
+		size_t slot = variables[i].hash.value() & (size - 1);
+		while (index[slot] != 0)
+		{
+			if (UNLIKELY(variables[index[slot] - 1].hash == variables[i].hash))
+			{
+				std::clog << "Hash collision between shader variables \"" << variables[index[slot] - 1].name
+					<< "\" and \"" << variables[i].name << "\"." << std::endl;
+			}
+			slot = (slot + 1) & (size - 1);
+		}
+		index[slot] = static_cast<uint16_t>(i + 1);
+	}
+}
+
+void GL::Program::VariableTable::clear()
+{
+	variables.clear();
+	index.clear();
+}
+
+const GL::Program::Variable * GL::Program::VariableTable::find(NameHash hash) const
+{
+	if (UNLIKELY(index.empty()))
+		return nullptr;
+
+	size_t mask = index.size() - 1;
+	for (size_t slot = hash.value() & mask; index[slot] != 0; slot = (slot + 1) & mask)
+	{
+		const Variable & variable = variables[index[slot] - 1];
+		if (variable.hash == hash)
+			return &variable;
+	}
+
+	return nullptr;
+}
+
+const GL::Program::Variable * GL::Program::VariableTable::find(NameHash hash, const char * name,
+	size_t length) const
+{
+	if (UNLIKELY(index.empty()))
+		return nullptr;
+
+	// Probe past variables with the same hash but different name, so collisions do not hide variables
+	size_t mask = index.size() - 1;
+	for (size_t slot = hash.value() & mask; index[slot] != 0; slot = (slot + 1) & mask)
+	{
+		const Variable & variable = variables[index[slot] - 1];
+		if (variable.hash == hash && variable.name.length() == length &&
+			!memcmp(variable.name.c_str(), name, length))
+			return &variable;
+	}
+
+	return nullptr;
+}
+
 void GL::Program::destroy()
 {
 	if (m_Handle != 0)
 	{
 		GL::deleteProgram(m_Handle);
+		StateCache::current().forgetProgram(m_Handle);
 		m_Handle = 0;
 	}
 }
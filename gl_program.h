@@ -26,15 +26,31 @@
 #include <yip-imports/gl.h>
 #include "gl_shader.h"
 #include "gl_resource.h"
+#include "gl_state_cache.h"
+#include "gl_name_hash.h"
+#include <vector>
+#include <string>
+#include <cstdint>
 
 namespace GL
 {
 	class ResourceManager;
+	class ProgramBinaryCache;
 
 	/** OpenGL ES program. */
 	class Program : public Resource
 	{
 	public:
+		/** Information about an active uniform or attribute of the program. */
+		struct Variable
+		{
+			std::string name;		/**< Name of the variable (without the "[0]" suffix for arrays). */
+			NameHash hash;			/**< Hash of the name. */
+			int location;			/**< Location of the variable. */
+			Enum type;				/**< Type of the variable (e.g. GL::FLOAT_VEC4). */
+			Int size;				/**< Number of array elements (1 for non-array variables). */
+		};
+
 		/**
 		 * Returns raw OpenGL ES handle of the program.
 		 * @return Raw handle of the program.
@@ -57,7 +73,10 @@ namespace GL
 
 		/**
 		 * Initializes program from source code.
+		 * If program binary cache is set in the resource manager, the program is loaded from the cache
+		 * when possible. Otherwise it is compiled and linked, and the resulting binary is stored into the cache.
 		 * @param data Source code.
+		 * @see GL::ResourceManager::setProgramBinaryCache.
 		 */
 		void initFromSource(const char * data);
 
@@ -70,9 +89,24 @@ namespace GL
 		/**
 		 * Links the program.
 		 * This is equivalent to GL::linkProgram but also reports any warnings and errors to *std::clog*.
+		 * If resource manager is in the batch mode (see GL::ResourceManager::beginBatch), warnings and
+		 * errors are reported by GL::ResourceManager::endBatch.
 		 */
 		void link();
 
+		/**
+		 * Reports link warnings and errors to *std::clog*.
+		 * @note This call blocks until the driver finishes linking of the program.
+		 */
+		void reportLinkLog();
+
+		/**
+		 * Checks whether the last link operation was successful.
+		 * This is equivalent to querying GL::LINK_STATUS with GL::getProgramiv.
+		 * @return *true* if program has been successfully linked, *false* otherwise.
+		 */
+		bool linkStatus() const;
+
 		/**
 		 * Checks whether this program may be run with the current OpenGL state.
 		 * This is equivalent to GL::validateProgram but also reports any warnings and errors to *std::clog*.
@@ -82,8 +116,9 @@ namespace GL
 		/**
 		 * Binds program into the OpenGL context.
 		 * This is equivalent to GL::useProgram.
+		 * The call is skipped if program is already current (see GL::StateCache).
 		 */
-		inline void use() { GL::useProgram(m_Handle); }
+		inline void use() { StateCache::current().useProgram(m_Handle); }
 
 		/**
 		 * Retrieves location of the specified attribute.
@@ -115,6 +150,118 @@ namespace GL
 		inline int getUniformLocation(const std::string & name) const
 			{ return GL::getUniformLocation(m_Handle, name.c_str()); }
 
+		/**
+		 * Returns table of active uniforms of the program.
+		 * Table is built once after the program is linked, using GL::getActiveUniform. Table is sorted by name.
+		 * @return Table of active uniforms (empty if program has not been successfully linked).
+		 */
+		const std::vector<Variable> & activeUniforms() const;
+
+		/**
+		 * Returns table of active attributes of the program.
+		 * Table is built once after the program is linked, using GL::getActiveAttrib. Table is sorted by name.
+		 * @return Table of active attributes (empty if program has not been successfully linked).
+		 */
+		const std::vector<Variable> & activeAttributes() const;
+
+		/**
+		 * Looks up active uniform in the reflection table.
+		 * If names of several variables have the same hash (this is reported when the table is built), the
+		 * first one is returned; lookup by name resolves such collisions.
+		 * @param hash Hash of the name of the uniform.
+		 * @return Pointer to the uniform or *nullptr* if uniform was not found.
+		 */
+		const Variable * findUniform(NameHash hash) const;
+
+		/**
+		 * Looks up active uniform in the reflection table.
+		 * @param name Name of the uniform.
+		 * @return Pointer to the uniform or *nullptr* if uniform was not found.
+		 */
+		const Variable * findUniform(const std::string & name) const;
+
+		/**
+		 * Looks up active attribute in the reflection table.
+		 * If names of several variables have the same hash (this is reported when the table is built), the
+		 * first one is returned; lookup by name resolves such collisions.
+		 * @param hash Hash of the name of the attribute.
+		 * @return Pointer to the attribute or *nullptr* if attribute was not found.
+		 */
+		const Variable * findAttribute(NameHash hash) const;
+
+		/**
+		 * Looks up active attribute in the reflection table.
+		 * @param name Name of the attribute.
+		 * @return Pointer to the attribute or *nullptr* if attribute was not found.
+		 */
+		const Variable * findAttribute(const std::string & name) const;
+
+		/**
+		 * Retrieves location of the specified uniform using the reflection table.
+		 * Unlike getUniformLocation(), this method does not call OpenGL unless *name* refers to an element
+		 * of the uniform array other than the first one, or the program has not been successfully linked.
+		 * @param name Name of the uniform.
+		 * @return Location of the uniform or -1 if uniform was not found in the program.
+		 */
+		int uniformLocation(const std::string & name) const;
+
+		/**
+		 * Enables or disables shadowing of uniform values.
+		 * When enabled, the program keeps copy of the last value uploaded into each uniform through GL::Uniform,
+		 * and setters of GL::Uniform skip OpenGL calls if value has not changed. Shadow is discarded when the
+		 * program is relinked. Uniform arrays are not shadowed and are always uploaded.
+		 * @note Uniforms should not be modified by calling OpenGL directly while shadowing is enabled.
+		 * @param flag *true* to enable shadowing, *false* to disable it.
+		 */
+		void setUniformShadowEnabled(bool flag);
+
+		/**
+		 * Checks whether shadowing of uniform values is enabled.
+		 * @return *true* if shadowing is enabled, *false* otherwise.
+		 */
+		inline bool isUniformShadowEnabled() const { return m_UniformShadowEnabled; }
+
+		/**
+		 * Compares value of the uniform with the shadow copy and updates the shadow copy.
+		 * This method is used by GL::Uniform.
+		 * @param location Location of the uniform.
+		 * @param data Pointer to the new value.
+		 * @param size Size of the new value in bytes.
+		 * @param transposed *true* if value is a transposed matrix.
+		 * @return *true* if value has changed (or shadowing is disabled) and should be uploaded,
+		 * *false* if upload could be skipped.
+		 */
+		inline bool uniformValueChanged(int location, const void * data, size_t size, bool transposed)
+		{
+			if (!m_UniformShadowEnabled)
+				return true;
+			return updateUniformShadow(location, data, size, transposed);
+		}
+
+		/**
+		 * Returns number of uniform uploads issued while shadowing was enabled.
+		 * @return Number of issued uploads.
+		 */
+		inline size_t uniformUploadsIssued() const { return m_UniformUploadsIssued; }
+
+		/**
+		 * Returns number of uniform uploads skipped because value has not changed.
+		 * @return Number of skipped uploads.
+		 */
+		inline size_t uniformUploadsSkipped() const { return m_UniformUploadsSkipped; }
+
+		/** Resets counters of issued and skipped uniform uploads. */
+		void resetUniformStatistics();
+
+		/**
+		 * Retrieves location of the specified attribute using the reflection table.
+		 * Unlike getAttribLocation(), this method does not call OpenGL unless the program has not been
+		 * successfully linked.
+		 * @param name Name of the attribute.
+		 * @return Location of the attribute or -1 if attribute was not found in the program.
+		 */
+		int attribLocation(const std::string & name) const;
+
 	protected:
 		/**
 		 * Constructor.
@@ -133,12 +280,45 @@ namespace GL
 		void destroy() override;
 
 	private:
+		struct VariableTable
+		{
+			std::vector<Variable> variables;
+			std::vector<uint16_t> index;
+
+			void build();
+			void clear();
+			const Variable * find(NameHash hash) const;
+			const Variable * find(NameHash hash, const char * name, size_t length) const;
+		};
+
 		UInt m_Handle;
+		mutable VariableTable m_Uniforms;
+		mutable VariableTable m_Attributes;
+		struct UniformShadow
+		{
+			std::vector<char> value;
+			bool transposed;
+			bool valid;
+			bool shadowed;
+		};
+
+		std::vector<UniformShadow> m_UniformShadow;
+		size_t m_UniformUploadsIssued;
+		size_t m_UniformUploadsSkipped;
+		mutable bool m_Reflected;
+		mutable bool m_LinkFailed;
+		bool m_UniformShadowEnabled;
+
+		bool reflect() const;
+		void invalidateReflection();
+		bool updateUniformShadow(int location, const void * data, size_t size, bool transposed);
+		void initUniformShadow();
 
 		Program(const Program &) = delete;
 		Program & operator=(const Program &) = delete;
 
 		friend class ResourceManager;
+		friend class ProgramBinaryCache;
 	};
 
 	/** Strong pointer to the OpenGL ES program. */
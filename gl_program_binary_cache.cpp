@@ -0,0 +1,257 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "gl_program_binary_cache.h"
+#include "gl_program.h"
+#include "gl_extensions.h"
+#include <yip-imports/cxx-util/macros.h>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <cstdio>
+#include <cstdint>
+
+static const uint32_t g_FileMagic = 0x42505247;	// "GRPB"
+static const uint32_t g_FileVersion = 1;
+
+namespace
+{
+	struct FileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t format;
+		uint32_t length;
+	};
+}
+
+static uint64_t fnv1a(uint64_t hash, const char * data, size_t length)
+{
+	for (size_t i = 0; i < length; i++)
+	{
+		hash ^= static_cast<unsigned char>(data[i]);
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+static uint64_t fnv1a(uint64_t hash, const std::string & str)
+{
+	// Include terminating zero to separate consecutive strings
+	return fnv1a(hash, str.c_str(), str.length() + 1);
+}
+
+static std::string glString(GL::Enum name)
+{
+	const char * str = reinterpret_cast<const char *>(GL::getString(name));
+	return (str ? std::string(str) : std::string());
+}
+
+GL::ProgramBinaryCache::ProgramBinaryCache(const std::string & directory)
+	: m_Directory(directory),
+	  m_Hits(0),
+	  m_Misses(0),
+	  m_Rejections(0),
+	  m_SupportChecked(false),
+	  m_Supported(false)
+{
+}
+
+GL::ProgramBinaryCache::~ProgramBinaryCache()
+{
+}
+
+bool GL::ProgramBinaryCache::isSupported() const
+{
+	if (!m_SupportChecked)
+	{
+	  #ifdef GL_OES_get_program_binary
+		if (Extensions::isSupported("GL_OES_get_program_binary"))
+		{
+			GL::Int numFormats = 0;
+			GL::getIntegerv(GL::NUM_PROGRAM_BINARY_FORMATS_OES, &numFormats);
+			m_Supported = (numFormats > 0);
+		}
+	  #endif
+		m_SupportChecked = true;
+	}
+
+	return m_Supported;
+}
+
+std::string GL::ProgramBinaryCache::makeKey(const std::string & vertexSource,
+	const std::string & fragmentSource) const
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	hash = fnv1a(hash, vertexSource);
+	hash = fnv1a(hash, fragmentSource);
+	hash = fnv1a(hash, glString(GL::VENDOR));
+	hash = fnv1a(hash, glString(GL::RENDERER));
+	hash = fnv1a(hash, glString(GL::VERSION));
+
+	std::stringstream ss;
+	ss << std::hex << std::setw(16) << std::setfill('0') << hash;
+	return ss.str();
+}
+
+bool GL::ProgramBinaryCache::load(const std::string & key, Program & program)
+{
+	if (!isSupported())
+		return false;
+
+	Enum format = GL::NONE;
+	std::vector<char> data;
+	if (!readBinary(key, &format, data) || data.empty())
+	{
+		++m_Misses;
+		return false;
+	}
+
+	if (UNLIKELY(!programBinary(program, format, data)))
+	{
+		++m_Rejections;
+		return false;
+	}
+
+	++m_Hits;
+	return true;
+}
+
+void GL::ProgramBinaryCache::store(const std::string & key, const Program & program)
+{
+	if (!isSupported())
+		return;
+
+	Enum format = GL::NONE;
+	std::vector<char> data;
+	if (getProgramBinary(program, &format, data) && !data.empty())
+		writeBinary(key, format, data);
+}
+
+bool GL::ProgramBinaryCache::readBinary(const std::string & key, Enum * format, std::vector<char> & data)
+{
+	std::ifstream file(pathForKey(key), std::ios::in | std::ios::binary);
+	if (!file)
+		return false;
+
+	FileHeader header;
+	if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)))
+		return false;
+	if (header.magic != g_FileMagic || header.version != g_FileVersion)
+		return false;
+
+	data.resize(header.length);
+	if (!file.read(data.data(), header.length))
+	{
+		data.clear();
+		return false;
+	}
+
+	*format = static_cast<Enum>(header.format);
+	return true;
+}
+
+void GL::ProgramBinaryCache::writeBinary(const std::string & key, Enum format, const std::vector<char> & data)
+{
+	std::string path = pathForKey(key);
+	std::string tempPath = path + ".tmp";
+
+	FileHeader header;
+	header.magic = g_FileMagic;
+	header.version = g_FileVersion;
+	header.format = static_cast<uint32_t>(format);
+	header.length = static_cast<uint32_t>(data.size());
+
+	{
+		std::ofstream file(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		file.write(data.data(), static_cast<std::streamsize>(data.size()));
+		if (!file)
+		{
+			std::clog << "Unable to write program binary \"" << tempPath << "\"." << std::endl;
+			file.close();
+			remove(tempPath.c_str());
+			return;
+		}
+	}
+
+	// Rename is atomic on POSIX, so partially written files are never picked up by readBinary().
+	// Some platforms do not allow renaming over an existing file, so retry after removing it.
+	if (rename(tempPath.c_str(), path.c_str()) != 0 &&
+		(remove(path.c_str()), rename(tempPath.c_str(), path.c_str()) != 0))
+	{
+		std::clog << "Unable to rename \"" << tempPath << "\" to \"" << path << "\"." << std::endl;
+		remove(tempPath.c_str());
+	}
+}
+
+bool GL::ProgramBinaryCache::programBinary(Program & program, Enum format, const std::vector<char> & data)
+{
+  #ifdef GL_OES_get_program_binary
+	GL::programBinaryOES(program.handle(), format, data.data(), static_cast<GL::Int>(data.size()));
+	program.invalidateReflection();
+	return program.linkStatus();
+  #else
+	(void)program;
+	(void)format;
+	(void)data;
+	return false;
+  #endif
+}
+
+bool GL::ProgramBinaryCache::getProgramBinary(const Program & program, Enum * format, std::vector<char> & data)
+{
+  #ifdef GL_OES_get_program_binary
+	if (!program.linkStatus())
+		return false;
+
+	GL::Int length = 0;
+	GL::getProgramiv(program.handle(), GL::PROGRAM_BINARY_LENGTH_OES, &length);
+	if (length <= 0)
+		return false;
+
+	data.resize(static_cast<size_t>(length));
+	GL::Sizei written = 0;
+	GL::getProgramBinaryOES(program.handle(), length, &written, format, data.data());
+	if (written <= 0)
+		return false;
+
+	data.resize(static_cast<size_t>(written));
+	return true;
+  #else
+	(void)program;
+	(void)format;
+	(void)data;
+	return false;
+  #endif
+}
+
+std::string GL::ProgramBinaryCache::pathForKey(const std::string & key) const
+{
+	if (m_Directory.empty())
+		return key + ".glbin";
+	char last = m_Directory[m_Directory.length() - 1];
+	if (last == '/' || last == '\\')
+		return m_Directory + key + ".glbin";
+	return m_Directory + '/' + key + ".glbin";
+}
@@ -0,0 +1,166 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __1f7ecd8ee15806bf8b41809362455830__
+#define __1f7ecd8ee15806bf8b41809362455830__
+
+#include <yip-imports/gl.h>
+#include <string>
+#include <vector>
+#include <memory>
+
+namespace GL
+{
+	class Program;
+
+	/**
+	 * Persistent cache of linked program binaries.
+	 *
+	 * This cache uses the GL_OES_get_program_binary extension to store linked programs and to load them
+	 * on subsequent launches of the application, avoiding expensive compilation and linking of shaders.
+	 * Binaries are keyed by the hash of the expanded source code of shaders and of the GL::RENDERER and
+	 * GL::VERSION strings, so driver updates automatically invalidate the cache.
+	 *
+	 * Default implementation stores binaries as files in the specified directory. Storage could be
+	 * customized by overriding the readBinary() and writeBinary() methods. All calls to the extension go
+	 * through the isSupported(), programBinary() and getProgramBinary() methods, so the cache could be
+	 * tested against a mock that accepts or rejects binaries.
+	 *
+	 * @see GL::ResourceManager::setProgramBinaryCache.
+	 */
+	class ProgramBinaryCache
+	{
+	public:
+		/**
+		 * Constructor.
+		 * @param directory Directory where binaries should be stored. Directory should exist.
+		 */
+		explicit ProgramBinaryCache(const std::string & directory = std::string());
+
+		/** Destructor. */
+		virtual ~ProgramBinaryCache();
+
+		/**
+		 * Checks whether program binaries are supported by the current OpenGL context.
+		 * Default implementation queries OpenGL only on the first call and returns the stored result afterwards.
+		 * @return *true* if program binaries are supported, *false* otherwise.
+		 */
+		virtual bool isSupported() const;
+
+		/**
+		 * Calculates cache key for the specified shader sources.
+		 * @param vertexSource Expanded source code of the vertex shader.
+		 * @param fragmentSource Expanded source code of the fragment shader.
+		 * @return Cache key.
+		 */
+		std::string makeKey(const std::string & vertexSource, const std::string & fragmentSource) const;
+
+		/**
+		 * Attempts to initialize program from the cached binary.
+		 * @param key Cache key (see makeKey()).
+		 * @param program Program to initialize.
+		 * @return *true* if binary has been found and accepted by the driver, *false* otherwise.
+		 */
+		bool load(const std::string & key, Program & program);
+
+		/**
+		 * Stores binary of the successfully linked program into the cache.
+		 * @param key Cache key (see makeKey()).
+		 * @param program Linked program.
+		 */
+		void store(const std::string & key, const Program & program);
+
+		/**
+		 * Returns number of programs loaded from the cache.
+		 * @return Number of cache hits.
+		 */
+		inline size_t hits() const { return m_Hits; }
+
+		/**
+		 * Returns number of programs that were not found in the cache.
+		 * @return Number of cache misses.
+		 */
+		inline size_t misses() const { return m_Misses; }
+
+		/**
+		 * Returns number of cached binaries rejected by the driver.
+		 * @return Number of rejected binaries.
+		 */
+		inline size_t rejections() const { return m_Rejections; }
+
+	protected:
+		/**
+		 * Reads cached binary.
+		 * @param key Cache key.
+		 * @param format Output: binary format of the program.
+		 * @param data Output: program binary.
+		 * @return *true* if binary has been found, *false* otherwise.
+		 */
+		virtual bool readBinary(const std::string & key, Enum * format, std::vector<char> & data);
+
+		/**
+		 * Writes binary into the cache.
+		 * @param key Cache key.
+		 * @param format Binary format of the program.
+		 * @param data Program binary.
+		 */
+		virtual void writeBinary(const std::string & key, Enum format, const std::vector<char> & data);
+
+		/**
+		 * Loads binary into the program.
+		 * Default implementation calls GL::programBinaryOES and checks link status of the program.
+		 * @param program Program.
+		 * @param format Binary format of the program.
+		 * @param data Program binary.
+		 * @return *true* if binary has been accepted by the driver, *false* otherwise.
+		 */
+		virtual bool programBinary(Program & program, Enum format, const std::vector<char> & data);
+
+		/**
+		 * Retrieves binary of the linked program.
+		 * Default implementation calls GL::getProgramBinaryOES.
+		 * @param program Program.
+		 * @param format Output: binary format of the program.
+		 * @param data Output: program binary.
+		 * @return *true* on success, *false* if program is not linked or binary is not available.
+		 */
+		virtual bool getProgramBinary(const Program & program, Enum * format, std::vector<char> & data);
+
+	private:
+		std::string m_Directory;
+		size_t m_Hits;
+		size_t m_Misses;
+		size_t m_Rejections;
+		mutable bool m_SupportChecked;
+		mutable bool m_Supported;
+
+		std::string pathForKey(const std::string & key) const;
+
+		ProgramBinaryCache(const ProgramBinaryCache &) = delete;
+		ProgramBinaryCache & operator=(const ProgramBinaryCache &) = delete;
+	};
+
+	/** Strong pointer to the program binary cache. */
+	typedef std::shared_ptr<ProgramBinaryCache> ProgramBinaryCachePtr;
+}
+
+#endif
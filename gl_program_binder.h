@@ -24,6 +24,7 @@
 #define __b38e3901acc6d421bef185cb94551820__
 
 #include "gl_program.h"
+#include "gl_state_cache.h"
 #include <yip-imports/gl.h>
 
 namespace GL
@@ -45,6 +46,7 @@ namespace GL
 		/**
 		 * Constructor.
 		 * Calls GL::useProgram with the specified shader program.
+		 * The call is skipped if program is already current (see GL::StateCache).
 		 * @param program Shader program to use.
 		 * @see GL::useProgram.
 		 */
@@ -53,10 +55,13 @@ namespace GL
 			program->use();
 		}
 
-		/** Destructor. Calls GL::useProgram with program handle set to zero. */
+		/**
+		 * Destructor. Calls GL::useProgram with program handle set to zero.
+		 * The call is skipped if lazy unbinding is enabled in the current GL::StateCache.
+		 */
 		inline ~ProgramBinder()
 		{
-			GL::useProgram(0);
+			StateCache::current().unuseProgram();
 		}
 
 	private:
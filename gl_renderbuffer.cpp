@@ -27,7 +27,10 @@
 
 GL::Renderbuffer::Renderbuffer(ResourceManager * resMgr, const std::string & resName)
 	: Resource(resMgr, resName),
-	  m_Handle(0)
+	  m_Handle(0),
+	  m_InternalFormat(GL::NONE),
+	  m_Width(0),
+	  m_Height(0)
 {
 	GL::genRenderbuffers(1, &m_Handle);
 }
@@ -37,6 +40,33 @@ GL::Renderbuffer::~Renderbuffer()
 	destroy();
 }
 
+void GL::Renderbuffer::setStorage(Enum internalFormat, Sizei w, Sizei h)
+{
+	bind(GL::RENDERBUFFER);
+	GL::renderbufferStorage(GL::RENDERBUFFER, internalFormat, w, h);
+	GL::bindRenderbuffer(GL::RENDERBUFFER, 0);
+
+	m_InternalFormat = internalFormat;
+	m_Width = w;
+	m_Height = h;
+}
+
+size_t GL::Renderbuffer::memoryUsage() const
+{
+	size_t bytesPerPixel;
+	switch (m_InternalFormat)
+	{
+	case GL::NONE: bytesPerPixel = 0; break;
+	case GL::STENCIL_INDEX8: bytesPerPixel = 1; break;
+	case GL::RGBA4: bytesPerPixel = 2; break;
+	case GL::RGB5_A1: bytesPerPixel = 2; break;
+	case GL::RGB565: bytesPerPixel = 2; break;
+	case GL::DEPTH_COMPONENT16: bytesPerPixel = 2; break;
+	default: bytesPerPixel = 4; break;
+	}
+	return size_t(m_Width) * size_t(m_Height) * bytesPerPixel;
+}
+
 void GL::Renderbuffer::destroy()
 {
 	if (m_Handle != 0)
@@ -44,4 +74,7 @@ void GL::Renderbuffer::destroy()
 		GL::deleteRenderbuffers(1, &m_Handle);
 		m_Handle = 0;
 	}
+	m_InternalFormat = GL::NONE;
+	m_Width = 0;
+	m_Height = 0;
 }
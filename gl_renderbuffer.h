@@ -47,6 +47,40 @@ namespace GL
 		 */
 		inline void bind(Enum target = GL::RENDERBUFFER) { GL::bindRenderbuffer(target, m_Handle); }
 
+		/**
+		 * Allocates storage for the renderbuffer.
+		 * This is equivalent to GL::renderbufferStorage but also records size of the storage.
+		 * @note This method binds renderbuffer to the GL::RENDERBUFFER target and then unbinds it.
+		 * @param internalFormat Internal format of the renderbuffer (e.g. GL::DEPTH_COMPONENT16).
+		 * @param w Width of the renderbuffer in pixels.
+		 * @param h Height of the renderbuffer in pixels.
+		 */
+		void setStorage(Enum internalFormat, Sizei w, Sizei h);
+
+		/**
+		 * Returns internal format of the renderbuffer storage.
+		 * @return Internal format or GL::NONE if storage has not been allocated.
+		 */
+		inline Enum internalFormat() const { return m_InternalFormat; }
+
+		/**
+		 * Returns width of the renderbuffer in pixels.
+		 * @return Width of the renderbuffer in pixels.
+		 */
+		inline int width() const { return m_Width; }
+
+		/**
+		 * Returns height of the renderbuffer in pixels.
+		 * @return Height of the renderbuffer in pixels.
+		 */
+		inline int height() const { return m_Height; }
+
+		/**
+		 * Returns estimated amount of video memory used by the renderbuffer.
+		 * @return Estimated memory usage in bytes.
+		 */
+		size_t memoryUsage() const override;
+
 	protected:
 		/**
 		 * Constructor.
@@ -66,6 +100,9 @@ namespace GL
 
 	private:
 		UInt m_Handle;
+		Enum m_InternalFormat;
+		int m_Width;
+		int m_Height;
 
 		Renderbuffer(const Renderbuffer &) = delete;
 		Renderbuffer & operator=(const Renderbuffer &) = delete;
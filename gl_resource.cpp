@@ -21,6 +21,7 @@
 // THE SOFTWARE.
 //
 #include "gl_resource.h"
+#include "gl_resource_manager.h"
 
 GL::Resource::Resource(ResourceManager * resMgr, const std::string & resName)
 	: m_Manager(resMgr),
@@ -31,3 +32,29 @@ GL::Resource::Resource(ResourceManager * resMgr, const std::string & resName)
 GL::Resource::~Resource()
 {
 }
+
+size_t GL::Resource::memoryUsage() const
+{
+	return 0;
+}
+
+bool GL::Resource::deferUpload(size_t bytes, std::function<void()> task)
+{
+	if (!m_Manager || !m_Manager->deferredUploads())
+		return false;
+
+	ResourceWeakPtr self;
+	try {
+		self = shared_from_this();
+	} catch (const std::bad_weak_ptr &) {
+		return false;
+	}
+
+	m_Manager->uploadScheduler().enqueue(bytes, [self, task]() {
+		ResourcePtr resource = self.lock();
+		if (resource)
+			task();
+	});
+
+	return true;
+}
@@ -26,13 +26,14 @@
 #include <string>
 #include <cassert>
 #include <memory>
+#include <functional>
 
 namespace GL
 {
 	class ResourceManager;
 
 	/** Base class for resources managed by GL::ResourceManager. */
-	class Resource
+	class Resource : public std::enable_shared_from_this<Resource>
 	{
 	public:
 		/**
@@ -47,6 +48,12 @@ namespace GL
 		 */
 		inline ResourceManager * manager() const noexcept { return m_Manager; }
 
+		/**
+		 * Returns estimated amount of memory used by the resource.
+		 * @return Estimated memory usage in bytes.
+		 */
+		virtual size_t memoryUsage() const;
+
 	protected:
 		/**
 		 * Constructor.
@@ -65,6 +72,16 @@ namespace GL
 		 */
 		virtual void destroy() = 0;
 
+		/**
+		 * Queues the specified upload task if resource manager is configured for deferred uploads.
+		 * Task is not executed if resource gets destroyed before the upload.
+		 * @param bytes Number of bytes uploaded by the task.
+		 * @param task Upload task.
+		 * @return *true* if task has been queued or *false* if caller should perform upload immediately.
+		 * @see GL::ResourceManager::setDeferredUploads.
+		 */
+		bool deferUpload(size_t bytes, std::function<void()> task);
+
 	private:
 		ResourceManager * m_Manager;
 		std::string m_Name;
@@ -0,0 +1,130 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "gl_resource_cache.h"
+
+GL::ResourceCache::ResourceCache()
+	: m_Budget(0),
+	  m_MaxEntries(0),
+	  m_RetainedBytes(0),
+	  m_Hits(0),
+	  m_Misses(0),
+	  m_Evictions(0)
+{
+}
+
+GL::ResourceCache::~ResourceCache()
+{
+}
+
+void GL::ResourceCache::setBudget(size_t bytes, size_t maxEntries)
+{
+	m_Budget = bytes;
+	m_MaxEntries = maxEntries;
+
+	if (!isEnabled())
+		clear();
+}
+
+void GL::ResourceCache::touchEntry(const ResourcePtr & resource, bool isNew, bool retainedOnly)
+{
+	if (!isEnabled() || !resource)
+		return;
+
+	auto it = m_Index.find(resource.get());
+	if (it == m_Index.end())
+	{
+		m_Entries.push_front(resource);
+		m_Index.insert(std::make_pair(resource.get(), m_Entries.begin()));
+	}
+	else
+	{
+		if (retainedOnly)
+			++m_Hits;
+		m_Entries.splice(m_Entries.begin(), m_Entries, it->second);
+	}
+
+	if (isNew)
+		++m_Misses;
+}
+
+size_t GL::ResourceCache::trim()
+{
+	size_t numEvicted = 0;
+
+	// Evicting a resource may release other resources (e.g. textures of a model), so repeat until stable
+	for (bool evicted = true; evicted; )
+	{
+		evicted = false;
+
+		size_t totalBytes = 0;
+		size_t totalCount = 0;
+		for (const ResourcePtr & resource : m_Entries)
+		{
+			if (resource.use_count() == 1)
+			{
+				totalBytes += resource->memoryUsage();
+				++totalCount;
+			}
+		}
+
+		for (List::iterator it = m_Entries.end(); it != m_Entries.begin(); )
+		{
+			bool overBudget = (m_Budget != 0 && totalBytes > m_Budget);
+			bool overLimit = (m_MaxEntries != 0 && totalCount > m_MaxEntries);
+			if (!overBudget && !overLimit)
+				break;
+
+			--it;
+			if (it->use_count() != 1)
+				continue;
+
+			totalBytes -= (*it)->memoryUsage();
+			--totalCount;
+
+			m_Index.erase(it->get());
+			it = m_Entries.erase(it);
+
+			++m_Evictions;
+			++numEvicted;
+			evicted = true;
+		}
+
+		m_RetainedBytes = totalBytes;
+	}
+
+	return numEvicted;
+}
+
+void GL::ResourceCache::clear()
+{
+	m_Index.clear();
+	m_Entries.clear();
+	m_RetainedBytes = 0;
+}
+
+void GL::ResourceCache::resetStatistics()
+{
+	m_Hits = 0;
+	m_Misses = 0;
+	m_Evictions = 0;
+}
@@ -0,0 +1,152 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __3afb1753b0ffb6781f35047a2f44dd6b__
+#define __3afb1753b0ffb6781f35047a2f44dd6b__
+
+#include "gl_resource.h"
+#include <list>
+#include <unordered_map>
+
+namespace GL
+{
+	/**
+	 * Least-recently-used retention cache for resources.
+	 *
+	 * The cache keeps strong references to resources requested from the GL::ResourceManager, so that
+	 * resources stay in memory for some time after application releases its last reference to them.
+	 * Resources that are not referenced by anything except the cache are evicted in the least-recently-used
+	 * order when their total memory usage exceeds the budget or their number exceeds the limit.
+	 *
+	 * Instance of this class is owned by the GL::ResourceManager.
+	 * @see GL::ResourceManager::setCacheBudget.
+	 */
+	class ResourceCache
+	{
+	public:
+		/** Constructor. */
+		ResourceCache();
+
+		/** Destructor. */
+		~ResourceCache();
+
+		/**
+		 * Sets limits for the released resources retained by the cache.
+		 * Setting both limits to zero disables the cache.
+		 * @param bytes Maximum memory usage of released resources, in bytes (zero means no limit).
+		 * @param maxEntries Maximum number of released resources (zero means no limit).
+		 */
+		void setBudget(size_t bytes, size_t maxEntries = 0);
+
+		/**
+		 * Returns the memory budget.
+		 * @return Maximum memory usage of released resources, in bytes.
+		 */
+		inline size_t budget() const { return m_Budget; }
+
+		/**
+		 * Returns the limit on the number of released resources.
+		 * @return Maximum number of released resources.
+		 */
+		inline size_t maxEntries() const { return m_MaxEntries; }
+
+		/**
+		 * Checks whether cache is enabled.
+		 * @return *true* if cache is enabled, *false* otherwise.
+		 */
+		inline bool isEnabled() const { return m_Budget != 0 || m_MaxEntries != 0; }
+
+		/**
+		 * Marks resource as recently used.
+		 * @param resource Pointer to the resource that has been requested from the resource manager.
+		 * @param isNew Set to *true* if resource has just been loaded (this counts as a cache miss).
+		 */
+		template <class T> inline void touch(const std::shared_ptr<T> & resource, bool isNew)
+		{
+			// Resource is referenced only by the cache and by the caller
+			bool retainedOnly = !isNew && resource.use_count() <= 2;
+			touchEntry(resource, isNew, retainedOnly);
+		}
+
+		/**
+		 * Evicts least recently used released resources until the cache fits into the budget.
+		 * @return Number of evicted resources.
+		 */
+		size_t trim();
+
+		/** Releases all resources retained by the cache. */
+		void clear();
+
+		/**
+		 * Returns number of resources tracked by the cache (both used and released).
+		 * @return Number of resources in the cache.
+		 */
+		inline size_t size() const { return m_Entries.size(); }
+
+		/**
+		 * Returns memory usage of released resources retained by the cache.
+		 * This value is updated by the trim() method.
+		 * @return Memory usage of released resources, in bytes.
+		 */
+		inline size_t retainedBytes() const { return m_RetainedBytes; }
+
+		/**
+		 * Returns number of requests satisfied by resources that were retained only by the cache.
+		 * @return Number of cache hits.
+		 */
+		inline size_t hits() const { return m_Hits; }
+
+		/**
+		 * Returns number of requests that required loading of the resource.
+		 * @return Number of cache misses.
+		 */
+		inline size_t misses() const { return m_Misses; }
+
+		/**
+		 * Returns number of resources evicted from the cache.
+		 * @return Number of evictions.
+		 */
+		inline size_t evictions() const { return m_Evictions; }
+
+		/** Resets hit, miss and eviction counters. */
+		void resetStatistics();
+
+	private:
+		typedef std::list<ResourcePtr> List;
+
+		List m_Entries;
+		std::unordered_map<const Resource *, List::iterator> m_Index;
+		size_t m_Budget;
+		size_t m_MaxEntries;
+		size_t m_RetainedBytes;
+		size_t m_Hits;
+		size_t m_Misses;
+		size_t m_Evictions;
+
+		void touchEntry(const ResourcePtr & resource, bool isNew, bool retainedOnly);
+
+		ResourceCache(const ResourceCache &) = delete;
+		ResourceCache & operator=(const ResourceCache &) = delete;
+	};
+}
+
+#endif
@@ -21,8 +21,11 @@
 // THE SOFTWARE.
 //
 #include "gl_resource_manager.h"
-#include "gl_buffer_binder.h"
 #include <yip-imports/cxx-util/make_ptr.h>
+#include <yip-imports/cxx-util/macros.h>
+#include <iostream>
+#include <exception>
+#include <chrono>
 
 const std::string GL::ResourceManager::m_DefaultTextureName = "<texture>";
 const std::string GL::ResourceManager::m_DefaultShaderName = "<shader>";
@@ -33,18 +36,36 @@ const std::string GL::ResourceManager::m_DefaultFramebufferName = "<framebuffer>
 const std::string GL::ResourceManager::m_DefaultCubeModelName = "<cube>";
 
 GL::ResourceManager::ResourceManager(::Resource::Loader & loader)
-	: m_ResourceLoader(&loader)
+	: m_ResourceLoader(&loader),
+	  m_NumLoaderThreads(0),
+	  m_DefaultVertexFormat(Model::FloatVertexFormat),
+	  m_NumLods(1),
+	  m_TextureMipmaps(false),
+	  m_DeferredUploads(false),
+	  m_OptimizeMeshes(false),
+	  m_UseObjParser(false),
+	  m_RetainModelGeometry(false),
+	  m_BatchDepth(0)
 {
 	GL::init();
+	m_StateCache.makeCurrent();
 }
 
 GL::ResourceManager::~ResourceManager()
 {
+	m_LoaderThreads.reset();
+	m_PendingTextures.clear();
+	m_UploadScheduler.clear();
 	destroyAllResources();
 }
 
 void GL::ResourceManager::destroyAllResources()
 {
+	m_Cache.clear();
+	m_PendingShaders.clear();
+	m_PendingPrograms.clear();
+	m_PendingProgramBinaries.clear();
+
 	for (const ResourceWeakPtr & resourceWeakPtr : m_AllResources)
 	{
 		std::shared_ptr<Resource> resource = resourceWeakPtr.lock();
@@ -55,13 +76,88 @@ void GL::ResourceManager::destroyAllResources()
 
 void GL::ResourceManager::collectGarbage()
 {
+	m_Cache.trim();
+
 	collectGarbageIn(m_Textures);
 	collectGarbageIn(m_Shaders);
 	collectGarbageIn(m_Programs);
 	collectGarbageIn(m_ObjModels);
+	collectGarbageIn(m_BinaryModels);
 	collectGarbageIn(m_AllResources);
 }
 
+GL::ResourceManager::MemoryUsage GL::ResourceManager::memoryUsage() const
+{
+	MemoryUsage usage;
+	usage.textures = 0;
+	usage.buffers = 0;
+	usage.renderbuffers = 0;
+
+	for (const ResourceWeakPtr & resourceWeakPtr : m_AllResources)
+	{
+		ResourcePtr resource = resourceWeakPtr.lock();
+		if (!resource)
+			continue;
+
+		size_t bytes;
+		if (dynamic_cast<Texture *>(resource.get()))
+			usage.textures += (bytes = resource->memoryUsage());
+		else if (dynamic_cast<Buffer *>(resource.get()))
+			usage.buffers += (bytes = resource->memoryUsage());
+		else if (dynamic_cast<Renderbuffer *>(resource.get()))
+			usage.renderbuffers += (bytes = resource->memoryUsage());
+		else
+			continue;
+
+		if (bytes > 0)
+			usage.byName[resource->name()] += bytes;
+	}
+
+	return usage;
+}
+
+void GL::ResourceManager::endBatch()
+{
+	if (UNLIKELY(m_BatchDepth <= 0))
+	{
+		std::clog << "GL::ResourceManager::endBatch() called without matching beginBatch()." << std::endl;
+		return;
+	}
+
+	if (--m_BatchDepth > 0)
+		return;
+
+	std::vector<ShaderPtr> shaders;
+	std::vector<ProgramPtr> programs;
+	std::vector<std::pair<ProgramPtr, std::string>> binaries;
+	shaders.swap(m_PendingShaders);
+	programs.swap(m_PendingPrograms);
+	binaries.swap(m_PendingProgramBinaries);
+
+	for (const ShaderPtr & shader : shaders)
+		shader->reportCompileLog();
+	for (const ProgramPtr & program : programs)
+		program->reportLinkLog();
+
+	if (m_ProgramBinaryCache)
+	{
+		for (const auto & it : binaries)
+			m_ProgramBinaryCache->store(it.second, *it.first);
+	}
+}
+
+size_t GL::ResourceManager::pumpUploads(std::chrono::microseconds timeBudget, size_t byteBudget)
+{
+	processAsyncLoads();
+	return m_UploadScheduler.pump(timeBudget, byteBudget);
+}
+
+size_t GL::ResourceManager::flushUploads()
+{
+	processAsyncLoads();
+	return m_UploadScheduler.flush();
+}
+
 GL::BufferPtr GL::ResourceManager::createBuffer(const std::string & name)
 {
 	BufferPtr buf = make_ptr<GL::Buffer>(this, name);
@@ -69,13 +165,19 @@ GL::BufferPtr GL::ResourceManager::createBuffer(const std::string & name)
 	return buf;
 }
 
+GL::StreamBufferPtr GL::ResourceManager::createStreamBuffer(Enum target, size_t capacity, const std::string & name)
+{
+	StreamBufferPtr buf = make_ptr<GL::StreamBuffer>(this, target, capacity, name);
+	m_AllResources.push_back(buf);
+	return buf;
+}
+
 GL::BufferPtr GL::ResourceManager::createVertexBufferForQuad(float x1, float y1, float x2, float y2,
 	const std::string & name)
 {
 	const GL::Float vertices[] = { x1, y1, x2, y1, x1, y2, x2, y2 };
 	GL::BufferPtr buffer = createBuffer(name);
-	GL::BufferBinder binder(buffer, GL::ARRAY_BUFFER);
-	GL::bufferData(GL::ARRAY_BUFFER, sizeof(vertices), vertices, GL::STATIC_DRAW);
+	buffer->setData(GL::ARRAY_BUFFER, vertices, sizeof(vertices), GL::STATIC_DRAW);
 	return buffer;
 }
 
@@ -84,8 +186,7 @@ GL::BufferPtr GL::ResourceManager::createVertexBufferForTexturedQuad(float x1, f
 {
 	const GL::Float vertices[] = { x1, y1, s1, t1, x2, y1, s2, t1, x1, y2, s1, t2, x2, y2, s2, t2 };
 	GL::BufferPtr buffer = createBuffer(name);
-	GL::BufferBinder binder(buffer, GL::ARRAY_BUFFER);
-	GL::bufferData(GL::ARRAY_BUFFER, sizeof(vertices), vertices, GL::STATIC_DRAW);
+	buffer->setData(GL::ARRAY_BUFFER, vertices, sizeof(vertices), GL::STATIC_DRAW);
 	return buffer;
 }
 
@@ -122,10 +223,162 @@ GL::TexturePtr GL::ResourceManager::getTexture(const std::string & name)
 	bool isNew = false;
 	TexturePtr texture = getResource<Texture, GL::Texture>(m_Textures, name, &isNew);
 	if (isNew)
-		texture->initFromStream(*m_ResourceLoader->openResource(name));
+	{
+		texture->setPackedFormat(m_PixelPacker.format(), m_PixelPacker.dither());
+
+		::Resource::StreamPtr stream = m_ResourceLoader->openResource(name);
+		if (!m_TextureMipmaps)
+			texture->initFromStream(*stream);
+		else
+		{
+			Internal::DecodedImage decoded = decodeImage(*stream, &m_MipBuilder);
+			if (decoded.compressed)
+				texture->initFromCompressedImage(decoded.compressed);
+			else
+				texture->initFromImage(decoded.image, decoded.mipmaps);
+		}
+	}
+	else
+	{
+		auto it = m_PendingTextures.find(name);
+		if (it != m_PendingTextures.end())
+		{
+			Internal::PendingTexture pending = std::move(it->second);
+			m_PendingTextures.erase(it);
+			finishAsyncLoad(pending);
+		}
+	}
+	return texture;
+}
+
+GL::TexturePtr GL::ResourceManager::getTextureAsync(const std::string & name, const TextureCallback & callback)
+{
+	bool isNew = false;
+	TexturePtr texture = getResource<Texture, GL::Texture>(m_Textures, name, &isNew);
+
+	if (!isNew)
+	{
+		auto it = m_PendingTextures.find(name);
+		if (it != m_PendingTextures.end())
+		{
+			if (callback)
+				it->second.callbacks.push_back(callback);
+		}
+		else if (callback)
+			callback(texture, true);
+		return texture;
+	}
+
+	texture->setPackedFormat(m_PixelPacker.format(), m_PixelPacker.dither());
+	texture->initWithPlaceholder();
+
+	if (!m_LoaderThreads)
+		m_LoaderThreads.reset(new ThreadPool(m_NumLoaderThreads));
+
+	auto promise = std::make_shared<std::promise<Internal::DecodedImage>>();
+	::Resource::Loader * loader = m_ResourceLoader;
+	std::shared_ptr<MipBuilder> builder;
+	if (m_TextureMipmaps)
+		builder = std::make_shared<MipBuilder>(m_MipBuilder);
+
+	Internal::PendingTexture & pending = m_PendingTextures[name];
+	pending.texture = texture;
+	pending.image = promise->get_future().share();
+	if (callback)
+		pending.callbacks.push_back(callback);
+
+	m_LoaderThreads->enqueue([promise, loader, name, builder]() {
+		try {
+			::Resource::StreamPtr stream = loader->openResource(name);
+			promise->set_value(decodeImage(*stream, builder.get()));
+		} catch (...) {
+			promise->set_exception(std::current_exception());
+		}
+	});
+
 	return texture;
 }
 
+void GL::ResourceManager::processAsyncLoads()
+{
+	// Callbacks may request more textures, so completed loads are removed from the map before processing
+	std::vector<Internal::PendingTexture> completed;
+	for (auto it = m_PendingTextures.begin(); it != m_PendingTextures.end(); )
+	{
+		if (it->second.image.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			++it;
+		else
+		{
+			completed.push_back(std::move(it->second));
+			it = m_PendingTextures.erase(it);
+		}
+	}
+
+	for (Internal::PendingTexture & pending : completed)
+		finishAsyncLoad(pending);
+}
+
+GL::Internal::DecodedImage GL::ResourceManager::decodeImage(std::istream & stream, const MipBuilder * builder)
+{
+	Internal::DecodedImage decoded;
+
+	std::string contents;
+	decoded.compressed = CompressedImage::loadFromStreamIfCompressed(stream, contents);
+	if (decoded.compressed)
+		return decoded;
+
+	if (contents.empty())
+		decoded.image = Stb::Image::loadFromStream(stream, Stb::Image::UNKNOWN);
+	else
+	{
+		std::istrstream buffered(contents.data(), static_cast<std::streamsize>(contents.size()));
+		decoded.image = Stb::Image::loadFromStream(buffered, Stb::Image::UNKNOWN);
+	}
+
+	if (builder)
+	{
+		auto levels = std::make_shared<std::vector<MipBuilder::Level>>();
+		builder->build(*decoded.image, *levels);
+		decoded.mipmaps = levels;
+	}
+
+	return decoded;
+}
+
+void GL::ResourceManager::finishAsyncLoad(Internal::PendingTexture & pending)
+{
+	bool success = false;
+
+	try {
+		const Internal::DecodedImage & decoded = pending.image.get();
+		if (decoded.compressed)
+			pending.texture->initFromCompressedImage(decoded.compressed);
+		else if (!decoded.mipmaps)
+			pending.texture->initFromImage(decoded.image);
+		else
+			pending.texture->initFromImage(decoded.image, decoded.mipmaps);
+		success = true;
+	} catch (const std::exception & e) {
+		std::clog << "Unable to load texture \"" << pending.texture->name() << "\": " << e.what() << std::endl;
+	}
+
+	if (pending.callbacks.empty())
+		return;
+
+	// When uploads are deferred, callbacks are queued after the upload itself
+	TexturePtr texture = pending.texture;
+	std::vector<TextureCallback> callbacks = std::move(pending.callbacks);
+	auto invokeCallbacks = [texture, callbacks, success]() {
+		for (const TextureCallback & callback : callbacks)
+			callback(texture, success);
+	};
+
+	if (m_DeferredUploads)
+		m_UploadScheduler.enqueue(0, invokeCallbacks);
+	else
+		invokeCallbacks();
+}
+
 GL::ShaderPtr GL::ResourceManager::createShader(Enum type, const std::string & name)
 {
 	ShaderPtr shader = make_ptr<GL::Shader>(this, name, type);
@@ -134,11 +387,21 @@ GL::ShaderPtr GL::ResourceManager::createShader(Enum type, const std::string & n
 }
 
 GL::ShaderPtr GL::ResourceManager::getShader(Enum type, const std::string & name)
+{
+	return getShader(type, name, nullptr);
+}
+
+GL::ShaderPtr GL::ResourceManager::getShader(Enum type, const std::string & name, const std::string * source)
 {
 	bool isNew = false;
 	ShaderPtr shader = getResource<Shader, GL::Shader>(m_Shaders, std::make_pair(type, name), &isNew);
 	if (isNew)
-		shader->initFromSource(m_ResourceLoader->loadResource(name));
+	{
+		if (source)
+			shader->initFromSource(*source);
+		else
+			shader->initFromSource(m_ResourceLoader->loadResource(name));
+	}
 	return shader;
 }
 
@@ -180,7 +443,10 @@ GL::ObjModelPtr GL::ResourceManager::getObjModel(const std::string & name)
 	ObjModelPtr result;
 	auto it = m_ObjModels.find(name);
 	if (it != m_ObjModels.end() && (result = it->second.lock()))
+	{
+		m_Cache.touch(result, false);
 		return result;
+	}
 	else
 	{
 		result = make_ptr<ObjModel>(this, *m_ResourceLoader, name);
@@ -188,6 +454,37 @@ GL::ObjModelPtr GL::ResourceManager::getObjModel(const std::string & name)
 			it->second = result;
 		else
 			m_ObjModels.insert(std::make_pair(name, result));
+		m_AllResources.push_back(result);
+		m_Cache.touch(result, true);
+		return result;
+	}
+}
+
+GL::BinaryModelPtr GL::ResourceManager::createBinaryModel(::Resource::Loader & loader, const std::string & name)
+{
+	BinaryModelPtr model = make_ptr<BinaryModel>(this, loader, name, m_BinaryModelDirectory);
+	m_AllResources.push_back(model);
+	return model;
+}
+
+GL::BinaryModelPtr GL::ResourceManager::getBinaryModel(const std::string & name)
+{
+	BinaryModelPtr result;
+	auto it = m_BinaryModels.find(name);
+	if (it != m_BinaryModels.end() && (result = it->second.lock()))
+	{
+		m_Cache.touch(result, false);
+		return result;
+	}
+	else
+	{
+		result = make_ptr<BinaryModel>(this, *m_ResourceLoader, name, m_BinaryModelDirectory);
+		if (it != m_BinaryModels.end())
+			it->second = result;
+		else
+			m_BinaryModels.insert(std::make_pair(name, result));
+		m_AllResources.push_back(result);
+		m_Cache.touch(result, true);
 		return result;
 	}
 }
@@ -222,6 +519,7 @@ std::shared_ptr<T> GL::ResourceManager::getResource(M & map, const K & key, bool
 	{
 		if (isNew)
 			*isNew = false;
+		m_Cache.touch(result, false);
 		return result;
 	}
 	else
@@ -234,6 +532,8 @@ std::shared_ptr<T> GL::ResourceManager::getResource(M & map, const K & key, bool
 			it->second = resource;
 		else
 			map.insert(std::make_pair(key, resource));
+		m_AllResources.push_back(resource);
+		m_Cache.touch(resource, true);
 
 		return resource;
 	}
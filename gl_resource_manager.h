@@ -27,15 +27,28 @@
 #include "gl_shader.h"
 #include "gl_program.h"
 #include "gl_buffer.h"
+#include "gl_stream_buffer.h"
 #include "gl_renderbuffer.h"
 #include "gl_framebuffer.h"
 #include "gl_obj_model.h"
+#include "gl_binary_model.h"
 #include "gl_cube_model.h"
+#include "gl_thread_pool.h"
+#include "gl_upload_scheduler.h"
+#include "gl_resource_cache.h"
+#include "gl_program_binary_cache.h"
+#include "gl_state_cache.h"
 #include <yip-imports/resource_loader.h>
+#include <yip-imports/stb_image.hpp>
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <map>
 #include <memory>
+#include <algorithm>
+#include <future>
+#include <functional>
+#include <chrono>
 
 namespace GL
 {
@@ -48,6 +61,22 @@ namespace GL
 			inline size_t operator()(const ShaderMapKey & value) const
 				{ return std::hash<std::string>()(value.second); }
 		};
+
+		// Image decoded in background
+		struct DecodedImage
+		{
+			Stb::ImagePtr image;
+			MipLevelsPtr mipmaps;
+			CompressedImagePtr compressed;
+		};
+
+		// Texture that is being loaded in background
+		struct PendingTexture
+		{
+			TexturePtr texture;
+			std::shared_future<DecodedImage> image;
+			std::vector<std::function<void(const TexturePtr &, bool)>> callbacks;
+		};
 	}
 	/** @endcond */
 
@@ -58,14 +87,38 @@ namespace GL
 	 * so that resource manager could cleanup internal structures. Not calling this method will
 	 * result in negligible memory leaks.
 	 *
-	 * In this implementation resource manager does not cache resources in any way. Resources are
-	 * kept "alive" only while there is at least one ResourcePtr pointing to it.
+	 * By default resource manager does not cache resources in any way. Resources are kept "alive" only
+	 * while there is at least one ResourcePtr pointing to it. Optional retention cache could be enabled
+	 * using the setCacheBudget() method.
 	 *
 	 * Custom caching could be implemented on top of this class by subclassing it.
 	 */
 	class ResourceManager
 	{
 	public:
+		/**
+		 * Callback for asynchronously loaded textures.
+		 * First argument is a pointer to the texture, second argument is *true* if texture has been
+		 * successfully loaded or *false* if it has failed to load (in this case texture contains a placeholder
+		 * image).
+		 */
+		typedef std::function<void(const TexturePtr &, bool)> TextureCallback;
+
+		/** Estimated video memory usage of resources. */
+		struct MemoryUsage
+		{
+			size_t textures;						/**< Memory used by textures, in bytes. */
+			size_t buffers;							/**< Memory used by vertex and index buffers, in bytes. */
+			size_t renderbuffers;					/**< Memory used by renderbuffers, in bytes. */
+			std::map<std::string, size_t> byName;	/**< Memory usage of resources grouped by name, in bytes. */
+
+			/**
+			 * Returns total memory usage.
+			 * @return Total memory usage in bytes.
+			 */
+			inline size_t total() const { return textures + buffers + renderbuffers; }
+		};
+
 		/**
 		 * Constructor.
 		 * @param loader Custom loader for resources (optional).
@@ -80,11 +133,286 @@ namespace GL
 
 		/**
 		 * Cleans up internal storage.
-		 * In default implementation this method cleans up internal tables from expired weak pointers.
+		 * In default implementation this method evicts resources from the retention cache (if it is enabled)
+		 * and cleans up internal tables from expired weak pointers.
 		 * This method could be overriden in child classes that implement caching of resources.
 		 */
 		virtual void collectGarbage();
 
+		/**
+		 * Calculates estimated video memory usage of all resources alive in this resource manager.
+		 * Buffers of models are reported under the name of the model.
+		 * @return Memory usage statistics.
+		 */
+		MemoryUsage memoryUsage() const;
+
+		/**
+		 * Enables retention cache for textures, shaders, programs and OBJ models.
+		 * When enabled, resources returned by getTexture(), getShader(), getProgram() and getObjModel() are
+		 * kept in memory after application releases the last reference to them. Released resources are
+		 * evicted in least-recently-used order by the collectGarbage() method when their total memory usage
+		 * exceeds *bytes* or their number exceeds *maxEntries*.
+		 * @note Shaders and programs report zero memory usage, use *maxEntries* to limit their number.
+		 * @param bytes Memory budget for released resources, in bytes (zero means no limit).
+		 * @param maxEntries Maximum number of released resources (zero means no limit).
+		 * Setting both parameters to zero disables the cache.
+		 */
+		inline void setCacheBudget(size_t bytes, size_t maxEntries = 0) { m_Cache.setBudget(bytes, maxEntries); }
+
+		/**
+		 * Returns the retention cache.
+		 * This could be used to query hit, miss and eviction counters.
+		 * @return Reference to the retention cache.
+		 */
+		inline const ResourceCache & cache() const { return m_Cache; }
+
+		/**
+		 * Returns the retention cache.
+		 * @return Reference to the retention cache.
+		 */
+		inline ResourceCache & cache() { return m_Cache; }
+
+		/**
+		 * Sets layout of vertices for models created by this resource manager.
+		 * Default is GL::Model::FloatVertexFormat.
+		 * @param format Vertex format.
+		 * @see GL::Model::PackedVertex.
+		 */
+		inline void setDefaultVertexFormat(Model::VertexFormat format) { m_DefaultVertexFormat = format; }
+
+		/**
+		 * Returns layout of vertices for models created by this resource manager.
+		 * @return Vertex format.
+		 */
+		inline Model::VertexFormat defaultVertexFormat() const { return m_DefaultVertexFormat; }
+
+		/**
+		 * Enables or disables optimization of models for the vertex cache and the vertex fetch on load.
+		 * Disabled by default. Models loaded while this option is enabled are processed by GL::MeshOptimizer.
+		 * @param flag *true* to enable optimization, *false* to disable.
+		 */
+		inline void setOptimizeMeshes(bool flag) { m_OptimizeMeshes = flag; }
+
+		/**
+		 * Checks whether models are optimized on load.
+		 * @return *true* if models are optimized on load, *false* otherwise.
+		 */
+		inline bool optimizeMeshes() const { return m_OptimizeMeshes; }
+
+		/**
+		 * Selects parser of OBJ models.
+		 * By default OBJ models are imported with ModelOBJ from the dhpoware-modelobj package. When this option
+		 * is enabled, they are parsed by the multithreaded GL::ObjParser instead.
+		 * @param flag *true* to use GL::ObjParser, *false* to use ModelOBJ.
+		 * @see GL::ObjModel::loadData().
+		 */
+		inline void setUseObjParser(bool flag) { m_UseObjParser = flag; }
+
+		/**
+		 * Checks whether OBJ models are parsed by GL::ObjParser.
+		 * @return *true* if GL::ObjParser is used, *false* if models are imported with ModelOBJ.
+		 */
+		inline bool useObjParser() const { return m_UseObjParser; }
+
+		/**
+		 * Enables memory mapping of binary models.
+		 * By default binary models are read via the resource loader. If directory is set, files found in it are
+		 * memory-mapped instead, and other files are still read via the resource loader.
+		 * @param directory Directory in the file system containing binary models (empty string disables mapping).
+		 * @see GL::BinaryModel.
+		 */
+		inline void setBinaryModelDirectory(const std::string & directory) { m_BinaryModelDirectory = directory; }
+
+		/**
+		 * Returns directory binary models are memory-mapped from.
+		 * @return Directory in the file system or empty string if memory mapping is disabled.
+		 */
+		inline const std::string & binaryModelDirectory() const { return m_BinaryModelDirectory; }
+
+		/**
+		 * Sets number of levels of detail generated for models loaded from OBJ files.
+		 * Default is 1 (no simplified levels). Each level has half the triangles of the previous one; generation
+		 * stops early when meshes could not be simplified substantially further.
+		 * @param levels Number of levels of detail, including the full-detail level.
+		 * @see GL::MeshSimplifier, GL::Model::selectLod.
+		 */
+		inline void setNumLods(size_t levels) { m_NumLods = std::max(levels, size_t(1)); }
+
+		/**
+		 * Returns number of levels of detail generated for models loaded from OBJ files.
+		 * @return Number of levels of detail, including the full-detail level.
+		 */
+		inline size_t numLods() const { return m_NumLods; }
+
+		/**
+		 * Enables or disables building of mipmaps for textures returned by getTexture() and getTextureAsync().
+		 * Disabled by default. When enabled, mipmaps are built on the CPU with GL::MipBuilder (on a worker
+		 * thread for getTextureAsync()), all levels are uploaded and trilinear filtering is used.
+		 * @param flag *true* to build mipmaps, *false* to upload only the level 0.
+		 * @param filter Downsampling filter.
+		 * @param gammaCorrect Set to *true* to filter color channels in linear space.
+		 */
+		inline void setTextureMipmaps(bool flag, MipBuilder::Filter filter = MipBuilder::BoxFilter,
+			bool gammaCorrect = false)
+		{
+			m_TextureMipmaps = flag;
+			m_MipBuilder = MipBuilder(filter, gammaCorrect);
+		}
+
+		/**
+		 * Checks whether mipmaps are built for loaded textures.
+		 * @return *true* if mipmaps are built, *false* otherwise.
+		 */
+		inline bool textureMipmaps() const { return m_TextureMipmaps; }
+
+		/**
+		 * Returns mipmap builder used for loaded textures.
+		 * @return Mipmap builder.
+		 */
+		inline const MipBuilder & mipBuilder() const { return m_MipBuilder; }
+
+		/**
+		 * Sets 16-bit packed format for textures returned by getTexture() and getTextureAsync().
+		 * Default is GL::PixelPacker::UnpackedFormat (8 bits per channel).
+		 * @param format Packed pixel format.
+		 * @param dither Set to *true* to apply ordered dithering.
+		 * @see GL::Texture::setPackedFormat, GL::PixelPacker::psnr.
+		 */
+		inline void setTexturePackedFormat(PixelPacker::Format format, bool dither = true)
+			{ m_PixelPacker = PixelPacker(format, dither); }
+
+		/**
+		 * Returns converter used for textures returned by getTexture() and getTextureAsync().
+		 * @return Pixel packer.
+		 */
+		inline const PixelPacker & texturePixelPacker() const { return m_PixelPacker; }
+
+		/**
+		 * Enables or disables retention of CPU-side copies of model geometry.
+		 * Disabled by default. Models loaded while this option is enabled keep their vertices and indices in
+		 * memory (see GL::Model::retainedVertices), which is required by some modes of GL::InstanceBatcher.
+		 * @param flag *true* to retain geometry, *false* to release it after upload.
+		 */
+		inline void setRetainModelGeometry(bool flag) { m_RetainModelGeometry = flag; }
+
+		/**
+		 * Checks whether CPU-side copies of model geometry are retained.
+		 * @return *true* if model geometry is retained, *false* otherwise.
+		 */
+		inline bool retainModelGeometry() const { return m_RetainModelGeometry; }
+
+		/**
+		 * Returns cache of the OpenGL binding state.
+		 * State cache is made current when resource manager is constructed. It is disabled by default.
+		 * @return Reference to the state cache.
+		 * @see GL::StateCache.
+		 */
+		inline StateCache & stateCache() { return m_StateCache; }
+
+		/**
+		 * Returns cache of the OpenGL binding state.
+		 * @return Reference to the state cache.
+		 */
+		inline const StateCache & stateCache() const { return m_StateCache; }
+
+		/**
+		 * Enters the batch compilation mode.
+		 * Querying status or info log of a shader or a program right after compilation or linking forces
+		 * the driver to finish the operation synchronously. In the batch mode such queries are postponed
+		 * until endBatch() is called, so drivers that compile shaders in parallel are able to overlap
+		 * the work. Calls to beginBatch() could be nested.
+		 */
+		inline void beginBatch() { ++m_BatchDepth; }
+
+		/**
+		 * Leaves the batch compilation mode.
+		 * When the outermost batch is finished, this method reports compilation and link logs of all
+		 * shaders and programs created within the batch and stores newly linked programs into the
+		 * program binary cache (if it is set).
+		 */
+		void endBatch();
+
+		/**
+		 * Checks whether resource manager is in the batch compilation mode.
+		 * @return *true* if batch compilation mode is active, *false* otherwise.
+		 */
+		inline bool isBatching() const { return m_BatchDepth > 0; }
+
+		/**
+		 * Sets persistent cache of program binaries.
+		 * When set, getProgram() (and GL::Program::initFromSource in general) first tries to load the program
+		 * from the cache and falls back to compiling shaders if program is not in the cache or cached binary
+		 * has been rejected by the driver. Newly linked programs are stored into the cache.
+		 * @param cache Pointer to the cache (could be *nullptr* to disable caching).
+		 */
+		inline void setProgramBinaryCache(const ProgramBinaryCachePtr & cache) { m_ProgramBinaryCache = cache; }
+
+		/**
+		 * Returns persistent cache of program binaries.
+		 * @return Pointer to the cache or *nullptr* if caching of program binaries is disabled.
+		 */
+		inline const ProgramBinaryCachePtr & programBinaryCache() const { return m_ProgramBinaryCache; }
+
+		/**
+		 * Enables or disables deferred uploads.
+		 * When deferred uploads are enabled, GL::Texture::uploadImage, GL::Buffer::setData and all methods
+		 * using them (including loading of models and creation of quad buffers) do not upload data into
+		 * OpenGL immediately. Instead, uploads are queued and performed by the pumpUploads() method.
+		 * Resources should not be used for rendering until their uploads are complete.
+		 * @param flag *true* to enable deferred uploads, *false* to disable them.
+		 */
+		inline void setDeferredUploads(bool flag) { m_DeferredUploads = flag; }
+
+		/**
+		 * Checks whether deferred uploads are enabled.
+		 * @return *true* if deferred uploads are enabled, *false* otherwise.
+		 */
+		inline bool deferredUploads() const { return m_DeferredUploads; }
+
+		/**
+		 * Performs pending uploads within the specified budget.
+		 * This method should be called periodically (e.g. once per frame) on the thread owning the OpenGL
+		 * context. It also processes textures loaded in background (see processAsyncLoads()).
+		 * @code
+		 * manager.pumpUploads(std::chrono::milliseconds(2));
+		 * @endcode
+		 * @param timeBudget Maximum time to spend on uploads.
+		 * @param byteBudget Maximum number of bytes to upload (zero means no limit).
+		 * @return Number of performed uploads.
+		 */
+		size_t pumpUploads(std::chrono::microseconds timeBudget, size_t byteBudget = 0);
+
+		/**
+		 * Performs all pending uploads.
+		 * @return Number of performed uploads.
+		 */
+		size_t flushUploads();
+
+		/**
+		 * Returns number of pending uploads.
+		 * @return Number of pending uploads.
+		 */
+		inline size_t numPendingUploads() const { return m_UploadScheduler.pendingUploads(); }
+
+		/**
+		 * Returns number of bytes in pending uploads.
+		 * This value could be used to display progress of loading.
+		 * @return Number of bytes still queued for upload.
+		 */
+		inline size_t pendingUploadBytes() const { return m_UploadScheduler.pendingBytes(); }
+
+		/**
+		 * Returns the resource loader.
+		 * @return Reference to the resource loader.
+		 */
+		inline ::Resource::Loader & resourceLoader() const { return *m_ResourceLoader; }
+
+		/**
+		 * Returns the upload scheduler.
+		 * @return Reference to the upload scheduler.
+		 */
+		inline UploadScheduler & uploadScheduler() { return m_UploadScheduler; }
+
 		/**
 		 * Creates new vertex or index buffer.
 		 * @param name Name of the buffer (optional). This is the name that will be returned by
@@ -93,6 +421,18 @@ namespace GL
 		 */
 		BufferPtr createBuffer(const std::string & name = m_DefaultBufferName);
 
+		/**
+		 * Creates new stream buffer for data that is regenerated every frame.
+		 * @param target Target of the buffer (GL::ARRAY_BUFFER or GL::ELEMENT_ARRAY_BUFFER).
+		 * @param capacity Size of the data store in bytes. Buffer grows if a larger range is requested.
+		 * @param name Name of the buffer (optional). This is the name that will be returned by
+		 * GL::Resource::name().
+		 * @return Pointer to the buffer.
+		 * @see GL::StreamBuffer.
+		 */
+		StreamBufferPtr createStreamBuffer(Enum target, size_t capacity,
+			const std::string & name = m_DefaultBufferName);
+
 		/**
 		 * Creates new vertex buffer for a 2D quad.
 		 * The created buffer contains 4 vertices (two `GL::FLOAT`s per vertex) and should be rendered using
@@ -177,6 +517,46 @@ namespace GL
 		 */
 		TexturePtr getTexture(const std::string & name);
 
+		/**
+		 * Loads texture with the specified name in background.
+		 * File I/O and image decoding are performed on a worker thread. Upload of the decoded image into
+		 * the OpenGL texture is performed by the processAsyncLoads() method, which should be called
+		 * periodically (e.g. once per frame) on the thread owning the OpenGL context.
+		 *
+		 * Returned texture is immediately usable: until the image is uploaded it contains a 1x1 white
+		 * placeholder image. If texture with the same name is already loaded or is being loaded, this method
+		 * returns the same texture and no additional decoding is performed.
+		 *
+		 * @note Resource loader passed to the constructor should be thread-safe to use this method.
+		 * @param name Name of the texture.
+		 * @param callback Callback to invoke when texture has been uploaded (optional). The callback is
+		 * invoked from the processAsyncLoads() method. If the texture has already been loaded, callback is
+		 * invoked immediately.
+		 * @return Pointer to the texture.
+		 */
+		TexturePtr getTextureAsync(const std::string & name, const TextureCallback & callback = TextureCallback());
+
+		/**
+		 * Uploads textures that have been decoded in background into OpenGL.
+		 * This method should be called periodically on the thread owning the OpenGL context.
+		 * If deferred uploads are enabled, decoded textures are queued for upload by pumpUploads() instead.
+		 * @see getTextureAsync.
+		 */
+		void processAsyncLoads();
+
+		/**
+		 * Returns number of textures that are being loaded in background.
+		 * @return Number of textures that have not been uploaded yet.
+		 */
+		inline size_t numPendingAsyncLoads() const { return m_PendingTextures.size(); }
+
+		/**
+		 * Sets number of worker threads used for background loading.
+		 * This method has effect only if called before the first call to getTextureAsync().
+		 * @param n Number of threads. Zero means that the number of threads is selected automatically.
+		 */
+		inline void setNumLoaderThreads(size_t n) { m_NumLoaderThreads = n; }
+
 		/**
 		 * Creates new shader.
 		 * This method always creates a new shader, even if there is one with the same name in the resource
@@ -245,6 +625,26 @@ namespace GL
 		 */
 		ObjModelPtr getObjModel(const std::string & name);
 
+		/**
+		 * Loads the precompiled binary model.
+		 * The file is memory-mapped if it exists in the directory set by setBinaryModelDirectory().
+		 * @param loader Resource loader to use if the file could not be memory-mapped.
+		 * @param name Name of the file.
+		 * @return Pointer to the model.
+		 * @see GL::BinaryModel.
+		 */
+		BinaryModelPtr createBinaryModel(::Resource::Loader & loader, const std::string & name);
+
+		/**
+		 * Loads the specified precompiled binary model from resource.
+		 * This method does not load a model if it has already been loaded; in this case it returns
+		 * the cached model.
+		 * @param name Name of the file.
+		 * @return Pointer to the model.
+		 * @see GL::BinaryModel.
+		 */
+		BinaryModelPtr getBinaryModel(const std::string & name);
+
 	private:
 		static const std::string m_DefaultTextureName;
 		static const std::string m_DefaultShaderName;
@@ -260,10 +660,35 @@ namespace GL
 		std::unordered_map<Internal::ShaderMapKey, ShaderWeakPtr, Internal::ShaderMapKeyHash> m_Shaders;
 		std::unordered_map<std::string, ProgramWeakPtr> m_Programs;
 		std::unordered_map<std::string, ObjModelWeakPtr> m_ObjModels;
+		std::unordered_map<std::string, BinaryModelWeakPtr> m_BinaryModels;
+		std::unordered_map<std::string, Internal::PendingTexture> m_PendingTextures;
+		std::unique_ptr<ThreadPool> m_LoaderThreads;
+		size_t m_NumLoaderThreads;
+		UploadScheduler m_UploadScheduler;
+		ResourceCache m_Cache;
+		ProgramBinaryCachePtr m_ProgramBinaryCache;
+		std::string m_BinaryModelDirectory;
+		StateCache m_StateCache;
+		std::vector<ShaderPtr> m_PendingShaders;
+		std::vector<ProgramPtr> m_PendingPrograms;
+		std::vector<std::pair<ProgramPtr, std::string>> m_PendingProgramBinaries;
+		Model::VertexFormat m_DefaultVertexFormat;
+		size_t m_NumLods;
+		MipBuilder m_MipBuilder;
+		PixelPacker m_PixelPacker;
+		bool m_TextureMipmaps;
+		bool m_DeferredUploads;
+		bool m_OptimizeMeshes;
+		bool m_UseObjParser;
+		bool m_RetainModelGeometry;
+		int m_BatchDepth;
 
 		template <class T> void collectGarbageIn(T & collection);
+		void finishAsyncLoad(Internal::PendingTexture & pending);
+		static Internal::DecodedImage decodeImage(std::istream & stream, const MipBuilder * builder);
 		template <class T, class P, class M, class K>
 			std::shared_ptr<T> getResource(M & map, const K & key, bool * isNew);
+		ShaderPtr getShader(Enum type, const std::string & name, const std::string * source);
 
 		ResourceManager(const ResourceManager &) = delete;
 		ResourceManager & operator=(const ResourceManager &) = delete;
@@ -271,6 +696,7 @@ namespace GL
 		friend class Shader;
 		friend class Program;
 		friend class GLTexture;
+		friend class TextureStreamer;
 	};
 
 	/** Strong pointer to the resource manager. */
@@ -52,23 +52,24 @@ void GL::Shader::initFromSource(const char * data)
 {
 	const GL::Char * source[1] = { data };
 	GL::shaderSource(m_Handle, 1, source, nullptr);
-	GL::compileShader(m_Handle);
-
-	GL::Int logLength = 0;
-	GL::getShaderiv(m_Handle, GL::INFO_LOG_LENGTH, &logLength);
-	if (logLength > 0)
-	{
-		std::vector<char> log(static_cast<size_t>(logLength + 1), 0);
-		GL::getShaderInfoLog(m_Handle, logLength, nullptr, log.data());
-		std::clog << log.data() << std::endl;
-	}
+	compile();
 }
 
 void GL::Shader::initFromSource(const std::vector<const char *> & data)
 {
 	GL::shaderSource(m_Handle, static_cast<GL::Sizei>(data.size()), (const Char **)data.data(), nullptr);
-	GL::compileShader(m_Handle);
+	compile();
+}
 
+bool GL::Shader::compileStatus() const
+{
+	GL::Int status = GL::FALSE;
+	GL::getShaderiv(m_Handle, GL::COMPILE_STATUS, &status);
+	return status != GL::FALSE;
+}
+
+void GL::Shader::reportCompileLog()
+{
 	GL::Int logLength = 0;
 	GL::getShaderiv(m_Handle, GL::INFO_LOG_LENGTH, &logLength);
 	if (logLength > 0)
@@ -79,6 +80,18 @@ void GL::Shader::initFromSource(const std::vector<const char *> & data)
 	}
 }
 
+void GL::Shader::compile()
+{
+	GL::compileShader(m_Handle);
+
+	// Querying shader state forces the driver to finish compilation. In batch mode this is postponed
+	// until all shaders and programs are submitted, so drivers could compile them in parallel.
+	if (manager() && manager()->isBatching())
+		manager()->m_PendingShaders.push_back(std::static_pointer_cast<Shader>(shared_from_this()));
+	else
+		reportCompileLog();
+}
+
 void GL::Shader::destroy()
 {
 	if (m_Handle != 0)
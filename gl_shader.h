@@ -69,6 +69,23 @@ namespace GL
 		 */
 		inline void initFromSource(const std::string & data) { initFromSource(data.c_str()); }
 
+		/**
+		 * Checks whether the last compile operation was successful.
+		 * This is equivalent to querying GL::COMPILE_STATUS with GL::getShaderiv.
+		 * @note This call blocks until the driver finishes compilation of the shader.
+		 * @return *true* if shader has been successfully compiled, *false* otherwise.
+		 */
+		bool compileStatus() const;
+
+		/**
+		 * Reports compilation warnings and errors to *std::clog*.
+		 * This method is called automatically by initFromSource() unless the resource manager is in the
+		 * batch mode (see GL::ResourceManager::beginBatch), in which case it is called by
+		 * GL::ResourceManager::endBatch.
+		 * @note This call blocks until the driver finishes compilation of the shader.
+		 */
+		void reportCompileLog();
+
 	protected:
 		/**
 		 * Constructor.
@@ -99,6 +116,8 @@ namespace GL
 		UInt m_Handle;
 		Enum m_Type;
 
+		void compile();
+
 		Shader(const Shader &) = delete;
 		Shader & operator=(const Shader &) = delete;
 
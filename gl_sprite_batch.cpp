@@ -0,0 +1,244 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "gl_sprite_batch.h"
+#include "gl_resource_manager.h"
+#include "gl_buffer_binder.h"
+#include "gl_state_cache.h"
+#include <algorithm>
+#include <functional>
+#include <cstring>
+#include <cstddef>
+#include <cmath>
+
+const size_t GL::SpriteBatch::MaxSprites;
+const uint32_t GL::SpriteBatch::White;
+
+// Number of batches that fit into the vertex buffer before it is orphaned.
+static const size_t g_BatchesPerBuffer = 4;
+
+GL::SpriteBatch::SpriteBatch(ResourceManager * resMgr, size_t maxSprites)
+	: m_MaxSprites(std::max(size_t(1), std::min(maxSprites, MaxSprites))),
+	  m_DrawCalls(0),
+	  m_Flushes(0),
+	  m_PositionAttrib(-1),
+	  m_TexCoordAttrib(-1),
+	  m_ColorAttrib(-1),
+	  m_TextureUnit(0),
+	  m_SortByTexture(false)
+{
+	m_VertexBuffer = resMgr->createStreamBuffer(GL::ARRAY_BUFFER,
+		m_MaxSprites * 4 * sizeof(Vertex) * g_BatchesPerBuffer);
+
+	std::vector<UShort> indices(m_MaxSprites * 6);
+	for (size_t i = 0; i < m_MaxSprites; i++)
+	{
+		UShort base = UShort(i * 4);
+		UShort * p = &indices[i * 6];
+		p[0] = base;
+		p[1] = UShort(base + 1);
+		p[2] = UShort(base + 2);
+		p[3] = UShort(base + 2);
+		p[4] = UShort(base + 1);
+		p[5] = UShort(base + 3);
+	}
+
+	// Index buffer is bound when the batch is flushed, so it should not wait for a deferred upload
+	m_IndexBuffer = resMgr->createBuffer();
+	m_IndexBuffer->setDataImmediately(GL::ELEMENT_ARRAY_BUFFER, indices.data(), indices.size() * sizeof(UShort),
+		GL::STATIC_DRAW);
+
+	m_Vertices.reserve(m_MaxSprites * 4);
+	m_Textures.reserve(m_MaxSprites);
+}
+
+GL::SpriteBatch::~SpriteBatch()
+{
+}
+
+void GL::SpriteBatch::setAttribs(int aPos, int aTexCoord, int aColor)
+{
+	m_PositionAttrib = aPos;
+	m_TexCoordAttrib = aTexCoord;
+	m_ColorAttrib = aColor;
+}
+
+void GL::SpriteBatch::setSortByTexture(bool flag)
+{
+	if (flag != m_SortByTexture)
+	{
+		flush();
+		m_SortByTexture = flag;
+	}
+}
+
+void GL::SpriteBatch::setProgram(const ProgramPtr & program)
+{
+	if (program != m_Program)
+	{
+		flush();
+		m_Program = program;
+	}
+}
+
+void GL::SpriteBatch::draw(const TexturePtr & texture, float x, float y, float w, float h, float s1, float t1,
+	float s2, float t2, uint32_t color, float rotation)
+{
+	if (!m_Textures.empty() && !m_SortByTexture && m_Textures.back() != texture.get())
+		flush();
+	if (m_Textures.size() >= m_MaxSprites)
+		flush();
+
+	// Textures are referenced once per run of sprites, which keeps them alive until the batch is flushed
+	if (m_Textures.empty() || m_Textures.back() != texture.get())
+		m_TextureRefs.push_back(texture);
+	m_Textures.push_back(texture.get());
+
+	size_t first = m_Vertices.size();
+	m_Vertices.resize(first + 4);
+	Vertex * v = &m_Vertices[first];
+
+	// Vertices are in the same order as in GL::ResourceManager::createVertexBufferForTexturedQuad.
+	float px[4], py[4];
+	if (rotation == 0.0f)
+	{
+		px[0] = x; px[1] = x + w; px[2] = x; px[3] = x + w;
+		py[0] = y; py[1] = y; py[2] = y + h; py[3] = y + h;
+	}
+	else
+	{
+		float c = std::cos(rotation), s = std::sin(rotation);
+		float hw = w * 0.5f, hh = h * 0.5f;
+		float cx = x + hw, cy = y + hh;
+		float wc = hw * c, ws = hw * s, hc = hh * c, hs = hh * s;
+		px[0] = cx - wc + hs; px[1] = cx + wc + hs; px[2] = cx - wc - hs; px[3] = cx + wc - hs;
+		py[0] = cy - ws - hc; py[1] = cy + ws - hc; py[2] = cy - ws + hc; py[3] = cy + ws + hc;
+	}
+
+	const float ts[4] = { s1, s2, s1, s2 };
+	const float tt[4] = { t1, t1, t2, t2 };
+	const UByte rgba[4] = { UByte(color >> 24), UByte(color >> 16), UByte(color >> 8), UByte(color) };
+
+	for (int i = 0; i < 4; i++)
+	{
+		v[i].position[0] = px[i];
+		v[i].position[1] = py[i];
+		v[i].texCoord[0] = ts[i];
+		v[i].texCoord[1] = tt[i];
+		memcpy(v[i].color, rgba, sizeof(rgba));
+	}
+}
+
+void GL::SpriteBatch::flush()
+{
+	size_t count = m_Textures.size();
+	if (count == 0)
+		return;
+
+	++m_Flushes;
+
+	// Copy vertices into the stream buffer (in order of textures if sorting is enabled)
+
+	size_t offset = 0;
+	Vertex * dst = reinterpret_cast<Vertex *>(m_VertexBuffer->map(count * 4 * sizeof(Vertex), &offset));
+	if (!m_SortByTexture)
+		memcpy(dst, m_Vertices.data(), count * 4 * sizeof(Vertex));
+	else
+	{
+		m_Order.resize(count);
+		for (size_t i = 0; i < count; i++)
+			m_Order[i] = uint32_t(i);
+
+		const std::vector<Texture *> & textures = m_Textures;
+		std::stable_sort(m_Order.begin(), m_Order.end(), [&textures](uint32_t a, uint32_t b) {
+			return std::less<Texture *>()(textures[a], textures[b]);
+		});
+
+		m_SortedTextures.resize(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			memcpy(dst + i * 4, &m_Vertices[m_Order[i] * 4], 4 * sizeof(Vertex));
+			m_SortedTextures[i] = m_Textures[m_Order[i]];
+		}
+		m_Textures.swap(m_SortedTextures);
+	}
+	m_VertexBuffer->unmap();
+
+	// Draw runs of sprites with the same texture
+
+	StateCache & stateCache = StateCache::current();
+	if (m_Program)
+		m_Program->use();
+
+	{
+		GL::BufferBinder binder(m_VertexBuffer, GL::ARRAY_BUFFER);
+		Sizei stride = Sizei(sizeof(Vertex));
+
+		#define OFF(X) ((void *)(offset + offsetof(Vertex, X)))
+		if (m_PositionAttrib >= 0)
+		{
+			stateCache.enableVertexAttribArray(UInt(m_PositionAttrib));
+			GL::vertexAttribPointer(UInt(m_PositionAttrib), 2, GL::FLOAT, GL::FALSE, stride, OFF(position));
+		}
+		if (m_TexCoordAttrib >= 0)
+		{
+			stateCache.enableVertexAttribArray(UInt(m_TexCoordAttrib));
+			GL::vertexAttribPointer(UInt(m_TexCoordAttrib), 2, GL::FLOAT, GL::FALSE, stride, OFF(texCoord));
+		}
+		if (m_ColorAttrib >= 0)
+		{
+			stateCache.enableVertexAttribArray(UInt(m_ColorAttrib));
+			GL::vertexAttribPointer(UInt(m_ColorAttrib), 4, GL::UNSIGNED_BYTE, GL::TRUE, stride, OFF(color));
+		}
+		#undef OFF
+	}
+
+	GL::BufferBinder indexBinder(m_IndexBuffer, GL::ELEMENT_ARRAY_BUFFER);
+	for (size_t first = 0; first < count; )
+	{
+		Texture * texture = m_Textures[first];
+		size_t end = first + 1;
+		while (end < count && m_Textures[end] == texture)
+			++end;
+
+		if (texture)
+		{
+			stateCache.activeTexture(GL::Enum(GL::TEXTURE0 + m_TextureUnit));
+			texture->bind();
+		}
+
+		GL::drawElements(GL::TRIANGLES, Sizei((end - first) * 6), GL::UNSIGNED_SHORT,
+			(void *)(first * 6 * sizeof(UShort)));
+		++m_DrawCalls;
+
+		first = end;
+	}
+
+	clear();
+}
+
+void GL::SpriteBatch::clear()
+{
+	m_Vertices.clear();
+	m_Textures.clear();
+	m_TextureRefs.clear();
+}
@@ -0,0 +1,211 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __1862527bad5d66319e825e255f1a6884__
+#define __1862527bad5d66319e825e255f1a6884__
+
+#include "gl_texture.h"
+#include "gl_program.h"
+#include "gl_buffer.h"
+#include "gl_stream_buffer.h"
+#include "gl_attrib.h"
+#include <yip-imports/gl.h>
+#include <vector>
+#include <cstdint>
+
+namespace GL
+{
+	class ResourceManager;
+
+	/**
+	 * Renderer of textured 2D sprites.
+	 *
+	 * Sprites are accumulated into a single dynamic vertex buffer (see GL::StreamBuffer) and drawn with a shared
+	 * static index buffer, so consecutive sprites with the same texture are drawn with a single draw call.
+	 * Pending sprites are flushed when texture or program changes, when the batch is full and when flush() is
+	 * called. If sorting by texture is enabled, texture changes do not cause a flush; instead sprites are
+	 * stably sorted by texture when the batch is flushed. This reduces number of draw calls but changes order
+	 * of overlapping sprites with different textures, so it should only be used when sprites do not overlap or
+	 * depth testing is used.
+	 *
+	 * Each vertex consists of two `GL::FLOAT`s for position, two `GL::FLOAT`s for texture coordinate and four
+	 * normalized `GL::UNSIGNED_BYTE`s for color (see GL::SpriteBatch::Vertex).
+	 */
+	class SpriteBatch
+	{
+	public:
+		/** Vertex of the sprite. */
+		struct Vertex
+		{
+			Float position[2];					/**< Position. */
+			Float texCoord[2];					/**< Texture coordinates. */
+			UByte color[4];						/**< Color (red, green, blue and alpha). */
+		};
+
+		/** Maximum number of sprites in a batch (limited by 16-bit indices). */
+		static const size_t MaxSprites = 16384;
+
+		/** Color that does not modify the texture (opaque white). */
+		static const uint32_t White = 0xFFFFFFFFu;
+
+		/**
+		 * Constructor.
+		 * @param resMgr Pointer to the resource manager.
+		 * @param maxSprites Number of sprites after which the batch is flushed automatically (at most
+		 * GL::SpriteBatch::MaxSprites).
+		 */
+		explicit SpriteBatch(ResourceManager * resMgr, size_t maxSprites = 4096);
+
+		/** Destructor. */
+		~SpriteBatch();
+
+		/**
+		 * Sets attribute locations.
+		 * @param aPos Location of the position attribute.
+		 * @param aTexCoord Location of the texture coordinate attribute (or -1 to disable).
+		 * @param aColor Location of the color attribute (or -1 to disable).
+		 */
+		void setAttribs(int aPos, int aTexCoord = -1, int aColor = -1);
+
+		/**
+		 * Sets attributes.
+		 * @param aPos Position attribute.
+		 * @param aTexCoord Texture coordinate attribute.
+		 * @param aColor Color attribute.
+		 */
+		inline void setAttribs(const GL::Attrib & aPos, const GL::Attrib & aTexCoord, const GL::Attrib & aColor)
+			{ setAttribs(aPos.location(), aTexCoord.location(), aColor.location()); }
+
+		/**
+		 * Sets texture unit for textures of sprites.
+		 * @param unit Texture unit (default is 0).
+		 */
+		inline void setTextureUnit(int unit) noexcept { m_TextureUnit = unit; }
+
+		/**
+		 * Enables or disables sorting of sprites by texture.
+		 * Disabled by default.
+		 * @param flag *true* to enable sorting, *false* to disable sorting.
+		 */
+		void setSortByTexture(bool flag);
+
+		/**
+		 * Checks whether sprites are sorted by texture.
+		 * @return *true* if sorting is enabled, *false* otherwise.
+		 */
+		inline bool sortByTexture() const noexcept { return m_SortByTexture; }
+
+		/**
+		 * Sets program used to draw sprites.
+		 * Pending sprites are flushed if program changes. Program is made current before drawing.
+		 * @param program Program (or *nullptr* to draw with the current program).
+		 */
+		void setProgram(const ProgramPtr & program);
+
+		/**
+		 * Returns program used to draw sprites.
+		 * @return Program.
+		 */
+		inline const ProgramPtr & program() const noexcept { return m_Program; }
+
+		/**
+		 * Adds sprite to the batch.
+		 * Batch keeps reference to the texture until it is flushed.
+		 * @param texture Texture of the sprite (could be *nullptr*).
+		 * @param x X coordinate of the top left corner.
+		 * @param y Y coordinate of the top left corner.
+		 * @param w Width of the sprite.
+		 * @param h Height of the sprite.
+		 * @param color Color of the sprite in the `0xRRGGBBAA` format.
+		 */
+		inline void draw(const TexturePtr & texture, float x, float y, float w, float h, uint32_t color = White)
+			{ draw(texture, x, y, w, h, 0.0f, 0.0f, 1.0f, 1.0f, color, 0.0f); }
+
+		/**
+		 * Adds sprite to the batch.
+		 * Batch keeps reference to the texture until it is flushed.
+		 * @param texture Texture of the sprite (could be *nullptr*).
+		 * @param x X coordinate of the top left corner.
+		 * @param y Y coordinate of the top left corner.
+		 * @param w Width of the sprite.
+		 * @param h Height of the sprite.
+		 * @param s1 S texture coordinate of the top left corner.
+		 * @param t1 T texture coordinate of the top left corner.
+		 * @param s2 S texture coordinate of the bottom right corner.
+		 * @param t2 T texture coordinate of the bottom right corner.
+		 * @param color Color of the sprite in the `0xRRGGBBAA` format.
+		 * @param rotation Angle of rotation around the center of the sprite, in radians.
+		 */
+		void draw(const TexturePtr & texture, float x, float y, float w, float h, float s1, float t1, float s2,
+			float t2, uint32_t color = White, float rotation = 0.0f);
+
+		/** Draws all pending sprites. */
+		void flush();
+
+		/** Removes all pending sprites without drawing them. */
+		void clear();
+
+		/**
+		 * Returns number of pending sprites.
+		 * @return Number of sprites that will be drawn by the next flush.
+		 */
+		inline size_t numSprites() const noexcept { return m_Textures.size(); }
+
+		/**
+		 * Returns number of draw calls issued since the last call to resetStatistics().
+		 * @return Number of draw calls.
+		 */
+		inline size_t drawCalls() const noexcept { return m_DrawCalls; }
+
+		/**
+		 * Returns number of flushes since the last call to resetStatistics().
+		 * @return Number of flushes.
+		 */
+		inline size_t flushes() const noexcept { return m_Flushes; }
+
+		/** Resets number of draw calls and flushes. */
+		inline void resetStatistics() noexcept { m_DrawCalls = 0; m_Flushes = 0; }
+
+	private:
+		StreamBufferPtr m_VertexBuffer;
+		BufferPtr m_IndexBuffer;
+		ProgramPtr m_Program;
+		std::vector<Vertex> m_Vertices;
+		std::vector<Texture *> m_Textures;
+		std::vector<TexturePtr> m_TextureRefs;
+		std::vector<Texture *> m_SortedTextures;
+		std::vector<uint32_t> m_Order;
+		size_t m_MaxSprites;
+		size_t m_DrawCalls;
+		size_t m_Flushes;
+		int m_PositionAttrib;
+		int m_TexCoordAttrib;
+		int m_ColorAttrib;
+		int m_TextureUnit;
+		bool m_SortByTexture;
+
+		SpriteBatch(const SpriteBatch &) = delete;
+		SpriteBatch & operator=(const SpriteBatch &) = delete;
+	};
+}
+
+#endif
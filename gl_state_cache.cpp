@@ -0,0 +1,176 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "gl_state_cache.h"
+#include <iostream>
+
+GL::StateCache GL::StateCache::m_Default;
+GL::StateCache * GL::StateCache::m_Current = &GL::StateCache::m_Default;
+
+GL::StateCache::StateCache()
+	: m_IssuedCalls(0),
+	  m_SkippedCalls(0),
+	  m_Enabled(false),
+	  m_LazyUnbind(false)
+{
+	invalidate();
+}
+
+GL::StateCache::~StateCache()
+{
+	if (m_Current == this)
+		m_Current = &m_Default;
+}
+
+void GL::StateCache::setEnabled(bool flag)
+{
+	if (flag && !m_Enabled)
+		invalidate();
+	m_Enabled = flag;
+}
+
+void GL::StateCache::invalidate()
+{
+	m_ArrayBuffer = Unknown;
+	m_ElementArrayBuffer = Unknown;
+	m_ActiveTexture = Unknown;
+	m_Program = Unknown;
+	m_Framebuffer = Unknown;
+	m_ViewportKnown = false;
+
+	for (size_t i = 0; i < MaxTextureUnits; i++)
+	{
+		m_Textures2D[i] = Unknown;
+		m_TexturesCube[i] = Unknown;
+	}
+
+	for (size_t i = 0; i < MaxVertexAttribs; i++)
+		m_VertexAttribs[i] = AttribUnknown;
+}
+
+GL::UInt GL::StateCache::framebufferBinding()
+{
+	if (m_Enabled && m_Framebuffer != Unknown)
+		return m_Framebuffer;
+
+	GL::Int binding = 0;
+	GL::getIntegerv(GL::FRAMEBUFFER_BINDING, &binding);
+	m_Framebuffer = static_cast<UInt>(binding);
+
+	return m_Framebuffer;
+}
+
+void GL::StateCache::viewport(Int x, Int y, Sizei width, Sizei height)
+{
+	if (m_Enabled && m_ViewportKnown && m_Viewport[0] == x && m_Viewport[1] == y &&
+			m_Viewport[2] == width && m_Viewport[3] == height)
+	{
+		++m_SkippedCalls;
+		return;
+	}
+
+	GL::viewport(x, y, width, height);
+	++m_IssuedCalls;
+
+	m_Viewport[0] = x;
+	m_Viewport[1] = y;
+	m_Viewport[2] = width;
+	m_Viewport[3] = height;
+	m_ViewportKnown = true;
+}
+
+void GL::StateCache::getViewport(Int viewport[4])
+{
+	if (!m_Enabled || !m_ViewportKnown)
+	{
+		GL::getIntegerv(GL::VIEWPORT, m_Viewport);
+		m_ViewportKnown = true;
+	}
+
+	for (int i = 0; i < 4; i++)
+		viewport[i] = m_Viewport[i];
+}
+
+void GL::StateCache::pushRenderTarget(UInt framebuffer, Int x, Int y, Sizei width, Sizei height)
+{
+	RenderTarget previous;
+	previous.framebuffer = framebufferBinding();
+	getViewport(previous.viewport);
+	m_RenderTargets.push_back(previous);
+
+	bindFramebuffer(GL::FRAMEBUFFER, framebuffer);
+	viewport(x, y, width, height);
+}
+
+void GL::StateCache::popRenderTarget()
+{
+	if (UNLIKELY(m_RenderTargets.empty()))
+	{
+		std::clog << "GL::StateCache::popRenderTarget() called without matching pushRenderTarget()." << std::endl;
+		return;
+	}
+
+	RenderTarget previous = m_RenderTargets.back();
+	m_RenderTargets.pop_back();
+
+	bindFramebuffer(GL::FRAMEBUFFER, previous.framebuffer);
+	viewport(previous.viewport[0], previous.viewport[1], previous.viewport[2], previous.viewport[3]);
+}
+
+void GL::StateCache::forgetBuffer(UInt handle)
+{
+	if (m_ArrayBuffer == handle)
+		m_ArrayBuffer = 0;
+	if (m_ElementArrayBuffer == handle)
+		m_ElementArrayBuffer = 0;
+}
+
+void GL::StateCache::forgetTexture(UInt handle)
+{
+	for (size_t i = 0; i < MaxTextureUnits; i++)
+	{
+		if (m_Textures2D[i] == handle)
+			m_Textures2D[i] = 0;
+		if (m_TexturesCube[i] == handle)
+			m_TexturesCube[i] = 0;
+	}
+}
+
+void GL::StateCache::forgetFramebuffer(UInt handle)
+{
+	if (m_Framebuffer == handle)
+		m_Framebuffer = 0;
+}
+
+void GL::StateCache::forgetProgram(UInt handle)
+{
+	// Deleting the current program is deferred by OpenGL until it is no longer in use, and the handle may be
+	// reused by a new program in the meantime. Mark binding as unknown so next useProgram() is not skipped.
+	if (m_Program == handle)
+		m_Program = Unknown;
+}
+
+void GL::StateCache::resetStatistics()
+{
+	m_IssuedCalls = 0;
+	m_SkippedCalls = 0;
+}
@@ -0,0 +1,423 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __b9fe9c66aadee35a86e0cd3f44c37c01__
+#define __b9fe9c66aadee35a86e0cd3f44c37c01__
+
+#include <yip-imports/gl.h>
+#include <yip-imports/cxx-util/macros.h>
+#include <cstddef>
+#include <vector>
+
+namespace GL
+{
+	/**
+	 * Shadow copy of the OpenGL binding state.
+	 *
+	 * This class tracks buffers bound to the GL::ARRAY_BUFFER and GL::ELEMENT_ARRAY_BUFFER targets, active
+	 * texture unit, textures bound to each texture unit, current program, enabled vertex attribute arrays,
+	 * current framebuffer and viewport. Calls that would not change the state are skipped.
+	 *
+	 * Binder classes (GL::BufferBinder, GL::TextureBinder, GL::ProgramBinder, GL::EnableVertexAttrib and
+	 * GL::VertexAttribPointer) and the GL::Texture::bind, GL::Buffer::bind and GL::Program::use methods
+	 * go through the current state cache (see current()). Each GL::ResourceManager owns a state cache
+	 * and makes it current when constructed.
+	 *
+	 * The cache is disabled by default. When it is enabled, application should not change the tracked
+	 * state by calling OpenGL directly, or it should call invalidate() after doing so.
+	 */
+	class StateCache
+	{
+	public:
+		/** Maximum number of tracked texture units. */
+		static const size_t MaxTextureUnits = 32;
+		/** Maximum number of tracked vertex attributes. */
+		static const size_t MaxVertexAttribs = 32;
+
+		/** Constructor. */
+		StateCache();
+
+		/** Destructor. */
+		~StateCache();
+
+		/**
+		 * Returns the current state cache.
+		 * If no state cache has been made current, returns a disabled state cache that
+		 * passes all calls through to OpenGL.
+		 * @return Reference to the current state cache.
+		 */
+		static inline StateCache & current() { return *m_Current; }
+
+		/**
+		 * Makes this state cache current.
+		 * This should be called when application switches between multiple OpenGL contexts.
+		 */
+		inline void makeCurrent() { m_Current = this; }
+
+		/**
+		 * Enables or disables the state cache.
+		 * Tracked state is invalidated when cache gets enabled.
+		 * @param flag *true* to enable skipping of redundant calls, *false* to pass all calls through.
+		 */
+		void setEnabled(bool flag);
+
+		/**
+		 * Checks whether state cache is enabled.
+		 * @return *true* if state cache is enabled, *false* otherwise.
+		 */
+		inline bool isEnabled() const { return m_Enabled; }
+
+		/**
+		 * Enables or disables lazy unbinding.
+		 * When lazy unbinding is enabled (and the cache is enabled), binder classes do not restore bindings
+		 * to zero in their destructors. Objects stay bound until something else is bound in their place,
+		 * so consecutive uses of the same object issue no calls at all.
+		 * @note With lazy unbinding a buffer may stay bound to GL::ARRAY_BUFFER or GL::ELEMENT_ARRAY_BUFFER
+		 * after the binder goes out of scope. Code using client-side vertex arrays should bind zero explicitly.
+		 * @param flag *true* to enable lazy unbinding, *false* to disable it.
+		 */
+		inline void setLazyUnbind(bool flag) { m_LazyUnbind = flag; }
+
+		/**
+		 * Checks whether lazy unbinding is enabled.
+		 * @return *true* if lazy unbinding is enabled, *false* otherwise.
+		 */
+		inline bool lazyUnbind() const { return m_LazyUnbind && m_Enabled; }
+
+		/**
+		 * Marks all tracked state as unknown.
+		 * This should be called after application changes the tracked state by calling OpenGL directly.
+		 */
+		void invalidate();
+
+		/**
+		 * Binds buffer to the specified target.
+		 * This is equivalent to GL::bindBuffer.
+		 * @param target Buffer binding target.
+		 * @param handle Handle of the buffer.
+		 */
+		inline void bindBuffer(Enum target, UInt handle)
+		{
+			UInt * slot = bufferSlot(target);
+			if (m_Enabled && slot && *slot == handle)
+			{
+				++m_SkippedCalls;
+				return;
+			}
+			GL::bindBuffer(target, handle);
+			++m_IssuedCalls;
+			if (slot)
+				*slot = handle;
+		}
+
+		/**
+		 * Unbinds buffer from the specified target.
+		 * This call does nothing if lazy unbinding is enabled.
+		 * @param target Buffer binding target.
+		 */
+		inline void unbindBuffer(Enum target)
+		{
+			if (!lazyUnbind())
+				bindBuffer(target, 0);
+		}
+
+		/**
+		 * Selects active texture unit.
+		 * This is equivalent to GL::activeTexture.
+		 * @param unit Texture unit (GL::TEXTURE0, GL::TEXTURE1, etc).
+		 */
+		inline void activeTexture(Enum unit)
+		{
+			if (m_Enabled && m_ActiveTexture == unit)
+			{
+				++m_SkippedCalls;
+				return;
+			}
+			GL::activeTexture(unit);
+			++m_IssuedCalls;
+			m_ActiveTexture = unit;
+		}
+
+		/**
+		 * Binds texture to the active texture unit.
+		 * This is equivalent to GL::bindTexture.
+		 * @param target Texture binding target.
+		 * @param handle Handle of the texture.
+		 */
+		inline void bindTexture(Enum target, UInt handle)
+		{
+			UInt * slot = textureSlot(m_ActiveTexture, target);
+			if (m_Enabled && slot && *slot == handle)
+			{
+				++m_SkippedCalls;
+				return;
+			}
+			GL::bindTexture(target, handle);
+			++m_IssuedCalls;
+			if (slot)
+				*slot = handle;
+		}
+
+		/**
+		 * Unbinds texture from the specified texture unit.
+		 * This call does nothing if lazy unbinding is enabled.
+		 * @param unit Texture unit.
+		 * @param target Texture binding target.
+		 */
+		inline void unbindTexture(Enum unit, Enum target)
+		{
+			if (!lazyUnbind())
+			{
+				activeTexture(unit);
+				bindTexture(target, 0);
+			}
+		}
+
+		/**
+		 * Sets current program.
+		 * This is equivalent to GL::useProgram.
+		 * @param handle Handle of the program.
+		 */
+		inline void useProgram(UInt handle)
+		{
+			if (m_Enabled && m_Program == handle)
+			{
+				++m_SkippedCalls;
+				return;
+			}
+			GL::useProgram(handle);
+			++m_IssuedCalls;
+			m_Program = handle;
+		}
+
+		/**
+		 * Resets current program to zero.
+		 * This call does nothing if lazy unbinding is enabled.
+		 */
+		inline void unuseProgram()
+		{
+			if (!lazyUnbind())
+				useProgram(0);
+		}
+
+		/**
+		 * Enables vertex attribute array.
+		 * This is equivalent to GL::enableVertexAttribArray.
+		 * @param index Index of the generic vertex attribute.
+		 */
+		inline void enableVertexAttribArray(UInt index)
+		{
+			if (m_Enabled && index < MaxVertexAttribs && m_VertexAttribs[index] == AttribEnabled)
+			{
+				++m_SkippedCalls;
+				return;
+			}
+			GL::enableVertexAttribArray(index);
+			++m_IssuedCalls;
+			if (index < MaxVertexAttribs)
+				m_VertexAttribs[index] = AttribEnabled;
+		}
+
+		/**
+		 * Disables vertex attribute array.
+		 * This is equivalent to GL::disableVertexAttribArray.
+		 * @param index Index of the generic vertex attribute.
+		 */
+		inline void disableVertexAttribArray(UInt index)
+		{
+			if (m_Enabled && index < MaxVertexAttribs && m_VertexAttribs[index] == AttribDisabled)
+			{
+				++m_SkippedCalls;
+				return;
+			}
+			GL::disableVertexAttribArray(index);
+			++m_IssuedCalls;
+			if (index < MaxVertexAttribs)
+				m_VertexAttribs[index] = AttribDisabled;
+		}
+
+		/**
+		 * Binds framebuffer.
+		 * This is equivalent to GL::bindFramebuffer.
+		 * @param target Framebuffer binding target.
+		 * @param handle Handle of the framebuffer.
+		 */
+		inline void bindFramebuffer(Enum target, UInt handle)
+		{
+			bool tracked = (target == GL::FRAMEBUFFER);
+			if (m_Enabled && tracked && m_Framebuffer == handle)
+			{
+				++m_SkippedCalls;
+				return;
+			}
+			GL::bindFramebuffer(target, handle);
+			++m_IssuedCalls;
+			if (tracked)
+				m_Framebuffer = handle;
+		}
+
+		/**
+		 * Returns handle of the currently bound framebuffer.
+		 * If cache is enabled, OpenGL is queried only once after invalidation. Otherwise this is equivalent
+		 * to querying GL::FRAMEBUFFER_BINDING with GL::getIntegerv.
+		 * @return Handle of the currently bound framebuffer.
+		 */
+		UInt framebufferBinding();
+
+		/**
+		 * Sets the viewport.
+		 * This is equivalent to GL::viewport.
+		 * @param x X coordinate of the lower left corner of the viewport.
+		 * @param y Y coordinate of the lower left corner of the viewport.
+		 * @param width Width of the viewport.
+		 * @param height Height of the viewport.
+		 */
+		void viewport(Int x, Int y, Sizei width, Sizei height);
+
+		/**
+		 * Retrieves current viewport.
+		 * If cache is enabled, OpenGL is queried only once after invalidation. Otherwise this is equivalent
+		 * to querying GL::VIEWPORT with GL::getIntegerv.
+		 * @param viewport Output: X, Y, width and height of the viewport.
+		 */
+		void getViewport(Int viewport[4]);
+
+		/**
+		 * Binds framebuffer and sets the viewport, saving the previous framebuffer and viewport on the stack.
+		 * Render targets could be nested, e.g. for offscreen passes that render into another offscreen pass.
+		 * @param framebuffer Handle of the framebuffer.
+		 * @param x X coordinate of the lower left corner of the viewport.
+		 * @param y Y coordinate of the lower left corner of the viewport.
+		 * @param width Width of the viewport.
+		 * @param height Height of the viewport.
+		 * @see popRenderTarget().
+		 */
+		void pushRenderTarget(UInt framebuffer, Int x, Int y, Sizei width, Sizei height);
+
+		/**
+		 * Restores framebuffer and viewport saved by the matching call to pushRenderTarget().
+		 */
+		void popRenderTarget();
+
+		/**
+		 * Returns depth of the render target stack.
+		 * @return Number of render targets pushed with pushRenderTarget() and not yet popped.
+		 */
+		inline size_t renderTargetDepth() const { return m_RenderTargets.size(); }
+
+		/**
+		 * Notifies the cache that buffer has been deleted.
+		 * OpenGL implicitly unbinds deleted objects, this method updates the tracked state accordingly.
+		 * @param handle Handle of the deleted buffer.
+		 */
+		void forgetBuffer(UInt handle);
+
+		/**
+		 * Notifies the cache that texture has been deleted.
+		 * @param handle Handle of the deleted texture.
+		 */
+		void forgetTexture(UInt handle);
+
+		/**
+		 * Notifies the cache that framebuffer has been deleted.
+		 * @param handle Handle of the deleted framebuffer.
+		 */
+		void forgetFramebuffer(UInt handle);
+
+		/**
+		 * Notifies the cache that program has been deleted.
+		 * @param handle Handle of the deleted program.
+		 */
+		void forgetProgram(UInt handle);
+
+		/**
+		 * Returns number of calls that have been passed to OpenGL.
+		 * @return Number of issued calls.
+		 */
+		inline size_t issuedCalls() const { return m_IssuedCalls; }
+
+		/**
+		 * Returns number of calls that have been skipped as redundant.
+		 * @return Number of skipped calls.
+		 */
+		inline size_t skippedCalls() const { return m_SkippedCalls; }
+
+		/** Resets issued and skipped call counters to zero. */
+		void resetStatistics();
+
+	private:
+		enum AttribState : unsigned char { AttribUnknown = 0, AttribEnabled, AttribDisabled };
+
+		struct RenderTarget
+		{
+			UInt framebuffer;
+			Int viewport[4];
+		};
+
+		static const UInt Unknown = 0xFFFFFFFFu;
+
+		static StateCache * m_Current;
+		static StateCache m_Default;
+
+		UInt m_ArrayBuffer;
+		UInt m_ElementArrayBuffer;
+		Enum m_ActiveTexture;
+		UInt m_Textures2D[MaxTextureUnits];
+		UInt m_TexturesCube[MaxTextureUnits];
+		UInt m_Program;
+		AttribState m_VertexAttribs[MaxVertexAttribs];
+		UInt m_Framebuffer;
+		Int m_Viewport[4];
+		bool m_ViewportKnown;
+		std::vector<RenderTarget> m_RenderTargets;
+		size_t m_IssuedCalls;
+		size_t m_SkippedCalls;
+		bool m_Enabled;
+		bool m_LazyUnbind;
+
+		inline UInt * bufferSlot(Enum target)
+		{
+			if (target == GL::ARRAY_BUFFER)
+				return &m_ArrayBuffer;
+			if (target == GL::ELEMENT_ARRAY_BUFFER)
+				return &m_ElementArrayBuffer;
+			return nullptr;
+		}
+
+		inline UInt * textureSlot(Enum unit, Enum target)
+		{
+			size_t index = static_cast<size_t>(unit - GL::TEXTURE0);
+			if (UNLIKELY(unit == Unknown || index >= MaxTextureUnits))
+				return nullptr;
+			if (target == GL::TEXTURE_2D)
+				return &m_Textures2D[index];
+			if (target == GL::TEXTURE_CUBE_MAP)
+				return &m_TexturesCube[index];
+			return nullptr;
+		}
+
+		StateCache(const StateCache &) = delete;
+		StateCache & operator=(const StateCache &) = delete;
+	};
+}
+
+#endif
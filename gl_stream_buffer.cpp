@@ -0,0 +1,230 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "gl_stream_buffer.h"
+#include "gl_extensions.h"
+#include <yip-imports/cxx-util/macros.h>
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cassert>
+
+namespace
+{
+	const int UnknownMethod = -1;
+}
+
+GL::StreamBuffer::StreamBuffer(ResourceManager * resMgr, Enum target, size_t capacity,
+		const std::string & resName)
+	: Buffer(resMgr, resName),
+	  m_Target(target),
+	  m_Capacity(std::max(capacity, size_t(16))),
+	  m_Position(0),
+	  m_OrphanCount(0),
+	  m_MappedOffset(0),
+	  m_MappedSize(0),
+	  m_MapState(NotMapped),
+	  m_Method(UnknownMethod)
+{
+	setDataImmediately(m_Target, nullptr, m_Capacity, GL::STREAM_DRAW);
+}
+
+GL::StreamBuffer::~StreamBuffer()
+{
+	destroy();
+}
+
+GL::StreamBuffer::Method GL::StreamBuffer::method() const
+{
+	if (m_Method == UnknownMethod)
+	{
+		m_Method = SubDataMethod;
+	  #ifdef GL_OES_mapbuffer
+		if (Extensions::isSupported("GL_OES_mapbuffer"))
+		{
+			m_Method = MapBufferMethod;
+		  #ifdef GL_EXT_map_buffer_range
+			if (Extensions::isSupported("GL_EXT_map_buffer_range"))
+				m_Method = MapBufferRangeMethod;
+		  #endif
+		}
+	  #endif
+	}
+	return Method(m_Method);
+}
+
+size_t GL::StreamBuffer::write(const void * data, size_t size, size_t alignment)
+{
+	assert(m_MapState == NotMapped);
+
+	size_t offset = allocate(size, alignment);
+	if (size > 0 && handle() != 0)
+	{
+		bind(m_Target);
+		GL::bufferSubData(m_Target, GL::Intptr(offset), GL::Sizeiptr(size), data);
+		StateCache::current().unbindBuffer(m_Target);
+	}
+
+	return offset;
+}
+
+size_t GL::StreamBuffer::writeQuad(float x1, float y1, float x2, float y2)
+{
+	const GL::Float vertices[] = { x1, y1, x2, y1, x1, y2, x2, y2 };
+	return write(vertices, sizeof(vertices));
+}
+
+size_t GL::StreamBuffer::writeTexturedQuad(float x1, float y1, float x2, float y2,
+	float s1, float t1, float s2, float t2)
+{
+	const GL::Float vertices[] = { x1, y1, s1, t1, x2, y1, s2, t1, x1, y2, s1, t2, x2, y2, s2, t2 };
+	return write(vertices, sizeof(vertices));
+}
+
+void * GL::StreamBuffer::map(size_t size, size_t * offset, size_t alignment)
+{
+	assert(m_MapState == NotMapped);
+
+	m_MappedOffset = allocate(size, alignment);
+	m_MappedSize = size;
+	if (offset)
+		*offset = m_MappedOffset;
+
+	if (size > 0 && handle() != 0)
+	{
+		void * ptr = nullptr;
+		switch (method())
+		{
+		case SubDataMethod:
+			break;
+
+		case MapBufferMethod:
+			// The whole store is mapped and waits for pending draw calls, unless it has just been orphaned.
+		  #ifdef GL_OES_mapbuffer
+			if (m_MappedOffset == 0)
+			{
+				bind(m_Target);
+				ptr = GL::mapBufferOES(m_Target, GL::WRITE_ONLY_OES);
+				if (!ptr)
+					StateCache::current().unbindBuffer(m_Target);
+			}
+		  #endif
+			break;
+
+		case MapBufferRangeMethod:
+			// Allocated ranges are never reused before orphaning, so synchronization is not needed.
+		  #ifdef GL_EXT_map_buffer_range
+			bind(m_Target);
+			ptr = GL::mapBufferRangeEXT(m_Target, GL::Intptr(m_MappedOffset), GL::Sizeiptr(size),
+				GL::MAP_WRITE_BIT_EXT | GL::MAP_INVALIDATE_RANGE_BIT_EXT | GL::MAP_UNSYNCHRONIZED_BIT_EXT);
+			if (!ptr)
+				StateCache::current().unbindBuffer(m_Target);
+		  #endif
+			break;
+		}
+
+		if (ptr)
+		{
+			m_MapState = MappedBuffer;
+			return ptr;
+		}
+	}
+
+	if (m_Staging.size() < size)
+		m_Staging.resize(size);
+
+	m_MapState = MappedStaging;
+	return m_Staging.data();
+}
+
+void GL::StreamBuffer::unmap()
+{
+	assert(m_MapState != NotMapped);
+
+	MapState state = m_MapState;
+	m_MapState = NotMapped;
+
+	switch (state)
+	{
+	case NotMapped:
+		return;
+
+	case MappedStaging:
+		if (m_MappedSize > 0 && handle() != 0)
+		{
+			bind(m_Target);
+			GL::bufferSubData(m_Target, GL::Intptr(m_MappedOffset), GL::Sizeiptr(m_MappedSize), m_Staging.data());
+			StateCache::current().unbindBuffer(m_Target);
+		}
+		return;
+
+	case MappedBuffer:
+	  #ifdef GL_OES_mapbuffer
+		bind(m_Target);
+		if (UNLIKELY(!GL::unmapBufferOES(m_Target)))
+		{
+			std::clog << "Contents of stream buffer \"" << name() << "\" have been corrupted." << std::endl;
+			StateCache::current().unbindBuffer(m_Target);
+			orphan();
+			return;
+		}
+		StateCache::current().unbindBuffer(m_Target);
+	  #endif
+		return;
+	}
+}
+
+void GL::StreamBuffer::orphan()
+{
+	assert(m_MapState == NotMapped);
+
+	setDataImmediately(m_Target, nullptr, m_Capacity, GL::STREAM_DRAW);
+	m_Position = 0;
+	++m_OrphanCount;
+}
+
+void GL::StreamBuffer::destroy()
+{
+	m_Staging.clear();
+	m_Staging.shrink_to_fit();
+	m_MapState = NotMapped;
+	m_Position = 0;
+	Buffer::destroy();
+}
+
+size_t GL::StreamBuffer::allocate(size_t size, size_t alignment)
+{
+	if (alignment == 0)
+		alignment = 1;
+
+	size_t offset = (m_Position + alignment - 1) / alignment * alignment;
+	if (offset + size > m_Capacity)
+	{
+		if (UNLIKELY(size > m_Capacity))
+			m_Capacity = std::max(size, m_Capacity * 2);
+		orphan();
+		offset = 0;
+	}
+
+	m_Position = offset + size;
+	return offset;
+}
@@ -0,0 +1,204 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __954bc2b63e8f32e05b81f53dc271778f__
+#define __954bc2b63e8f32e05b81f53dc271778f__
+
+#include <yip-imports/gl.h>
+#include "gl_buffer.h"
+#include <vector>
+#include <memory>
+
+namespace GL
+{
+	class ResourceManager;
+
+	/**
+	 * Vertex or index buffer for data that is regenerated every frame.
+	 *
+	 * Stream buffer allocates one large data store and hands out consecutive sub-ranges of it as a ring. When
+	 * the store is full, it is orphaned (GL::bufferData is called with a null pointer), so the driver could
+	 * allocate a fresh store instead of waiting for draw calls that still read from the old one, and allocation
+	 * starts again from the beginning. Offsets returned by write() and map() could be passed directly to
+	 * GL::Attrib::useBuffer or to GL::drawElements.
+	 *
+	 * Data is written with GL::bufferSubData. map() additionally uses *GL_EXT_map_buffer_range* (unsynchronized
+	 * mapping of the range) or *GL_OES_mapbuffer* (mapping of the freshly orphaned store) when available.
+	 * Stream buffers ignore deferred uploads (see GL::ResourceManager::setDeferredUploads).
+	 */
+	class StreamBuffer : public Buffer
+	{
+	public:
+		/** Method used by map(). */
+		enum Method
+		{
+			SubDataMethod = 0,					/**< Data is staged and written with GL::bufferSubData. */
+			MapBufferMethod,					/**< GL::mapBufferOES is used for the first range of the store. */
+			MapBufferRangeMethod,				/**< GL::mapBufferRangeEXT is used for all ranges. */
+		};
+
+		/**
+		 * Returns target the buffer is bound to.
+		 * @return Target of the buffer (GL::ARRAY_BUFFER or GL::ELEMENT_ARRAY_BUFFER).
+		 */
+		inline Enum target() const { return m_Target; }
+
+		/**
+		 * Returns size of the data store.
+		 * @return Capacity of the buffer in bytes.
+		 */
+		inline size_t capacity() const { return m_Capacity; }
+
+		/**
+		 * Returns offset of the first free byte in the data store.
+		 * @return Current position in the ring.
+		 */
+		inline size_t position() const { return m_Position; }
+
+		/**
+		 * Returns number of times the data store has been orphaned.
+		 * @return Number of orphanings.
+		 */
+		inline size_t orphanCount() const { return m_OrphanCount; }
+
+		/**
+		 * Returns method used by map().
+		 * Method is selected on first use according to the available extensions.
+		 * @return Method.
+		 */
+		Method method() const;
+
+		/**
+		 * Writes data into the next free range of the buffer.
+		 * @note This method binds buffer to its target and then unbinds it.
+		 * @param data Pointer to the data.
+		 * @param size Size of the data in bytes.
+		 * @param alignment Alignment of the range in bytes.
+		 * @return Offset of the data in the buffer, in bytes.
+		 */
+		size_t write(const void * data, size_t size, size_t alignment = 4);
+
+		/**
+		 * Writes vertices of a 2D quad into the buffer.
+		 * Written vertices have the same layout as vertices of the buffer created by
+		 * GL::ResourceManager::createVertexBufferForQuad.
+		 * @param x1 X coordinate of the top left corner.
+		 * @param y1 Y coordinate of the top left corner.
+		 * @param x2 X coordinate of the bottom right corner.
+		 * @param y2 Y coordinate of the bottom right corner.
+		 * @return Offset of the vertices in the buffer, in bytes.
+		 */
+		size_t writeQuad(float x1, float y1, float x2, float y2);
+
+		/**
+		 * Writes vertices of a 2D quad with texture coordinates into the buffer.
+		 * Written vertices have the same layout as vertices of the buffer created by
+		 * GL::ResourceManager::createVertexBufferForTexturedQuad.
+		 * @param x1 X coordinate of the top left corner.
+		 * @param y1 Y coordinate of the top left corner.
+		 * @param x2 X coordinate of the bottom right corner.
+		 * @param y2 Y coordinate of the bottom right corner.
+		 * @param s1 S texture coordinate of the top left corner (optional).
+		 * @param t1 T texture coordinate of the top left corner (optional).
+		 * @param s2 S texture coordinate of the bottom right corner (optional).
+		 * @param t2 T texture coordinate of the bottom right corner (optional).
+		 * @return Offset of the vertices in the buffer, in bytes.
+		 */
+		size_t writeTexturedQuad(float x1, float y1, float x2, float y2,
+			float s1 = 0.0f, float t1 = 0.0f, float s2 = 1.0f, float t2 = 1.0f);
+
+		/**
+		 * Reserves the next free range of the buffer and returns pointer for writing into it.
+		 * Data should be written into the returned pointer and then unmap() should be called before the buffer
+		 * is used for drawing. Contents of the memory pointed to by the returned pointer are undefined and it
+		 * should not be read from.
+		 * @param size Size of the range in bytes.
+		 * @param offset Output for offset of the range in the buffer, in bytes.
+		 * @param alignment Alignment of the range in bytes.
+		 * @return Pointer to the memory for writing.
+		 */
+		void * map(size_t size, size_t * offset, size_t alignment = 4);
+
+		/**
+		 * Finishes writing into the range reserved by map().
+		 * @note This method binds buffer to its target and then unbinds it.
+		 */
+		void unmap();
+
+		/**
+		 * Orphans the data store and starts allocation from the beginning of the buffer.
+		 * Ranges returned earlier could still be used by draw calls that have already been issued.
+		 */
+		void orphan();
+
+	protected:
+		/**
+		 * Constructor.
+		 * @param resMgr Pointer to the resource manager.
+		 * @param target Target of the buffer (GL::ARRAY_BUFFER or GL::ELEMENT_ARRAY_BUFFER).
+		 * @param capacity Size of the data store in bytes.
+		 * @param resName Name of the buffer resource.
+		 */
+		StreamBuffer(ResourceManager * resMgr, Enum target, size_t capacity, const std::string & resName);
+
+		/** Destructor. */
+		~StreamBuffer();
+
+		/**
+		 * Releases the associated OpenGL buffer.
+		 * This is equivalent to GL::deleteBuffers.
+		 */
+		void destroy() override;
+
+	private:
+		enum MapState
+		{
+			NotMapped = 0,
+			MappedStaging,
+			MappedBuffer,
+		};
+
+		Enum m_Target;
+		size_t m_Capacity;
+		size_t m_Position;
+		size_t m_OrphanCount;
+		size_t m_MappedOffset;
+		size_t m_MappedSize;
+		std::vector<UByte> m_Staging;
+		MapState m_MapState;
+		mutable int m_Method;
+
+		size_t allocate(size_t size, size_t alignment);
+
+		StreamBuffer(const StreamBuffer &) = delete;
+		StreamBuffer & operator=(const StreamBuffer &) = delete;
+
+		friend class ResourceManager;
+	};
+
+	/** Strong pointer to the stream buffer. */
+	typedef std::shared_ptr<StreamBuffer> StreamBufferPtr;
+	/** Weak pointer to the stream buffer. */
+	typedef std::weak_ptr<StreamBuffer> StreamBufferWeakPtr;
+}
+
+#endif
@@ -23,8 +23,12 @@
 #include "gl_texture.h"
 #include "gl_resource_manager.h"
 #include "gl_texture_binder.h"
+#include "gl_extensions.h"
 #include <sstream>
+#include <algorithm>
 #include <stdexcept>
+#include <vector>
+#include <memory>
 
 GL::Texture::Texture(GL::ResourceManager * mgr, const std::string & resName, GL::Enum target)
 	: Resource(mgr, resName),
@@ -41,17 +45,7 @@ GL::Texture::~Texture()
 	destroy();
 }
 
-void GL::Texture::initFromStream(std::istream & stream, Stb::Image::Format fmt)
-{
-	Stb::ImagePtr image = Stb::Image::loadFromStream(stream, fmt);
-	uploadImage(*image, 0, GL::TEXTURE_2D);
-	GL::texParameterf(GL::TEXTURE_2D, GL::TEXTURE_WRAP_S, GL::CLAMP_TO_EDGE);
-	GL::texParameterf(GL::TEXTURE_2D, GL::TEXTURE_WRAP_T, GL::CLAMP_TO_EDGE);
-	GL::texParameterf(GL::TEXTURE_2D, GL::TEXTURE_MIN_FILTER, GL::LINEAR);
-	GL::texParameterf(GL::TEXTURE_2D, GL::TEXTURE_MAG_FILTER, GL::LINEAR);
-}
-
-void GL::Texture::uploadImage(const Stb::Image & image, int level, GL::Enum target)
+static GL::Enum glFormatForImage(const Stb::Image & image)
 {
 	GL::Enum fmt = GL::NONE;
 
@@ -67,12 +61,475 @@ void GL::Texture::uploadImage(const Stb::Image & image, int level, GL::Enum targ
 	if (fmt == GL::NONE)
 		std::clog << "Unable to upload image to OpenGL: " << "image has invalid pixel format." << std::endl;
 
+	return fmt;
+}
+
+static size_t bytesPerPixel(GL::Enum fmt)
+{
+	switch (fmt)
+	{
+	case GL::ALPHA: return 1;
+	case GL::LUMINANCE_ALPHA: return 2;
+	case GL::RGB: return 3;
+	case GL::RGBA: return 4;
+	default: return 0;
+	}
+}
+
+void GL::Texture::initFromStream(std::istream & stream, Stb::Image::Format fmt)
+{
+	std::string contents;
+	CompressedImagePtr compressed = CompressedImage::loadFromStreamIfCompressed(stream, contents);
+	if (compressed)
+		initFromCompressedImage(compressed);
+	else if (!contents.empty())
+	{
+		std::istrstream buffered(contents.data(), static_cast<std::streamsize>(contents.size()));
+		initFromImage(Stb::Image::loadFromStream(buffered, fmt));
+	}
+	else
+		initFromImage(Stb::Image::loadFromStream(stream, fmt));
+}
+
+void GL::Texture::initFromCompressedImage(const CompressedImagePtr & image)
+{
+	GL::Enum fmt = image->internalFormat();
+	bool compressed = isCompressedFormatSupported(fmt);
+	if (!compressed && !image->canDecode())
+		throw std::runtime_error("compressed texture format is not supported.");
+
+	setSize(image->width(), image->height());
+
+	GL::Enum decodedFmt = (image->hasAlpha() ? GL::RGBA : GL::RGB);
+	for (int level = 0; level < image->numLevels(); level++)
+	{
+		int w = image->levelWidth(level);
+		int h = image->levelHeight(level);
+		size_t bytes = (compressed ? image->levelSize(level) : size_t(w) * size_t(h) * bytesPerPixel(decodedFmt));
+
+		auto upload = [this, image, level, compressed]() {
+			uploadCompressedLevel(*image, level, level, compressed);
+		};
+
+		if (!deferUpload(bytes, upload))
+			upload();
+	}
+
+	bool hasMipmaps = (image->numLevels() == MipBuilder::numLevels(image->width(), image->height()));
+	if (!deferUpload(0, [this, hasMipmaps]() { bind(); setDefaultParameters(hasMipmaps); }))
+		setDefaultParameters(hasMipmaps);
+}
+
+void GL::Texture::uploadMipChain(const Stb::ImagePtr & image, const MipLevelsPtr & mipmaps, int first)
+{
+	GL::Enum fmt = glFormatForImage(*image);
+	if (fmt == GL::NONE)
+		return;
+
+	int numLevels = 1 + (mipmaps ? int(mipmaps->size()) : 0);
+	first = std::min(std::max(first, 0), numLevels - 1);
+
+	size_t bytes = 0;
+	for (int level = first; level < numLevels; level++)
+	{
+		if (level == 0)
+			bytes += size_t(image->width()) * size_t(image->height()) * bytesPerPixel(fmt);
+		else
+			bytes += (*mipmaps)[size_t(level - 1)].pixels.size();
+	}
+
+	if (first == 0)
+		setSize(image->width(), image->height());
+	else
+		setSize((*mipmaps)[size_t(first - 1)].width, (*mipmaps)[size_t(first - 1)].height);
+
+	auto upload = [this, image, mipmaps, fmt, first, numLevels]() {
+		bool isNew = m_Levels.empty();
+		for (int level = first; level < numLevels; level++)
+		{
+			if (level == 0)
+				uploadPixels(GL::TEXTURE_2D, 0, fmt, image->width(), image->height(), image->data());
+			else
+			{
+				const MipBuilder::Level & src = (*mipmaps)[size_t(level - 1)];
+				uploadPixels(GL::TEXTURE_2D, level - first, fmt, src.width, src.height, src.pixels.data());
+			}
+		}
+		releaseLevels(numLevels - first);
+		if (isNew)
+		{
+			// Mipmapped filtering on an incomplete chain would make the texture incomplete
+			int w = (first == 0 ? image->width() : (*mipmaps)[size_t(first - 1)].width);
+			int h = (first == 0 ? image->height() : (*mipmaps)[size_t(first - 1)].height);
+			setDefaultParameters(numLevels - first == MipBuilder::numLevels(w, h));
+		}
+	};
+
+	if (!deferUpload(bytes, upload))
+		upload();
+}
+
+void GL::Texture::uploadMipChain(const CompressedImagePtr & image, int first)
+{
+	GL::Enum fmt = image->internalFormat();
+	bool compressed = isCompressedFormatSupported(fmt);
+	if (!compressed && !image->canDecode())
+		throw std::runtime_error("compressed texture format is not supported.");
+
+	int numLevels = image->numLevels();
+	first = std::min(std::max(first, 0), numLevels - 1);
+	setSize(image->levelWidth(first), image->levelHeight(first));
+
+	size_t bytes = 0;
+	for (int level = first; level < numLevels; level++)
+		bytes += image->levelSize(level);
+
+	auto upload = [this, image, first, numLevels, compressed]() {
+		bool isNew = m_Levels.empty();
+		for (int level = first; level < numLevels; level++)
+			uploadCompressedLevel(*image, level, level - first, compressed);
+		releaseLevels(numLevels - first);
+		if (isNew)
+		{
+			int w = image->levelWidth(first), h = image->levelHeight(first);
+			setDefaultParameters(numLevels - first == MipBuilder::numLevels(w, h));
+		}
+	};
+
+	if (!deferUpload(bytes, upload))
+		upload();
+}
+
+bool GL::Texture::isCompressedFormatSupported(GL::Enum fmt)
+{
+	switch (fmt)
+	{
+	case CompressedImage::ETC1Format:
+		return Extensions::isSupported("GL_OES_compressed_ETC1_RGB8_texture");
+
+	case CompressedImage::DXT1Format:
+	case CompressedImage::DXT1AlphaFormat:
+		if (Extensions::isSupported("GL_EXT_texture_compression_dxt1"))
+			return true;
+		return Extensions::isSupported("GL_EXT_texture_compression_s3tc");
+
+	case CompressedImage::DXT3Format:
+	case CompressedImage::DXT5Format:
+		return Extensions::isSupported("GL_EXT_texture_compression_s3tc");
+	}
+
+	// Other formats could be found in KTX files only; check the list reported by the implementation
+	GL::Int numFormats = 0;
+	GL::getIntegerv(GL::NUM_COMPRESSED_TEXTURE_FORMATS, &numFormats);
+	if (numFormats <= 0)
+		return false;
+
+	std::vector<GL::Int> formats(size_t(numFormats), 0);
+	GL::getIntegerv(GL::COMPRESSED_TEXTURE_FORMATS, formats.data());
+	return std::find(formats.begin(), formats.end(), GL::Int(fmt)) != formats.end();
+}
+
+void GL::Texture::initFromImage(const Stb::Image & image)
+{
+	uploadImage(image, 0, GL::TEXTURE_2D);
+	if (!deferUpload(0, [this]() { bind(); setDefaultParameters(); }))
+		setDefaultParameters();
+}
+
+void GL::Texture::initFromImage(const Stb::ImagePtr & image)
+{
+	uploadImage(image, 0, GL::TEXTURE_2D);
+	if (!deferUpload(0, [this]() { bind(); setDefaultParameters(); }))
+		setDefaultParameters();
+}
+
+void GL::Texture::initFromImage(const Stb::ImagePtr & image, const MipBuilder & builder)
+{
+	std::shared_ptr<std::vector<MipBuilder::Level>> mipmaps = std::make_shared<std::vector<MipBuilder::Level>>();
+	builder.build(*image, *mipmaps);
+	initFromImage(image, mipmaps);
+}
+
+void GL::Texture::initFromImage(const Stb::ImagePtr & image, const MipLevelsPtr & mipmaps)
+{
+	uploadImage(image, 0, GL::TEXTURE_2D);
+	uploadMipmaps(mipmaps, glFormatForImage(*image), GL::TEXTURE_2D);
+
+	bool hasMipmaps = (mipmaps && !mipmaps->empty()) || (image->width() == 1 && image->height() == 1);
+	if (!deferUpload(0, [this, hasMipmaps]() { bind(); setDefaultParameters(hasMipmaps); }))
+		setDefaultParameters(hasMipmaps);
+}
+
+void GL::Texture::initWithPlaceholder()
+{
+	static const GL::UByte white[4] = { 0xFF, 0xFF, 0xFF, 0xFF };
+
+	uploadPixels(GL::TEXTURE_2D, 0, GL::RGBA, 1, 1, white);
+	GL::texParameterf(GL::TEXTURE_2D, GL::TEXTURE_WRAP_S, GL::CLAMP_TO_EDGE);
+	GL::texParameterf(GL::TEXTURE_2D, GL::TEXTURE_WRAP_T, GL::CLAMP_TO_EDGE);
+	GL::texParameterf(GL::TEXTURE_2D, GL::TEXTURE_MIN_FILTER, GL::NEAREST);
+	GL::texParameterf(GL::TEXTURE_2D, GL::TEXTURE_MAG_FILTER, GL::NEAREST);
+	setSize(1, 1);
+}
+
+void GL::Texture::initEmpty(int w, int h, GL::Enum fmt)
+{
+	setSize(w, h);
+	if (!deferUpload(size_t(w) * size_t(h) * bytesPerPixel(fmt), [this, w, h, fmt]() {
+			uploadPixels(GL::TEXTURE_2D, 0, fmt, w, h, nullptr);
+			setDefaultParameters();
+		}))
+	{
+		uploadPixels(GL::TEXTURE_2D, 0, fmt, w, h, nullptr);
+		setDefaultParameters();
+	}
+}
+
+void GL::Texture::uploadImage(const Stb::Image & image, int level, GL::Enum target)
+{
+	GL::Enum fmt = glFormatForImage(image);
+	int w = image.width();
+	int h = image.height();
+
 	if (level == 0 || m_Width == 0 || m_Height == 0)
-		setSize(image.width(), image.height());
+		setSize(w, h);
+
+	size_t bytes = size_t(w) * size_t(h) * bytesPerPixel(fmt);
+	if (manager() && manager()->deferredUploads())
+	{
+		const GL::UByte * p = reinterpret_cast<const GL::UByte *>(image.data());
+		std::shared_ptr<std::vector<GL::UByte>> data = std::make_shared<std::vector<GL::UByte>>(p, p + bytes);
+		if (deferUpload(bytes, [this, target, level, fmt, w, h, data]() {
+				uploadPixels(target, level, fmt, w, h, data->data());
+			}))
+			return;
+	}
+
+	uploadPixels(target, level, fmt, w, h, image.data());
+}
+
+void GL::Texture::uploadImage(const Stb::ImagePtr & image, int level, GL::Enum target)
+{
+	GL::Enum fmt = glFormatForImage(*image);
+	int w = image->width();
+	int h = image->height();
+
+	if (level == 0 || m_Width == 0 || m_Height == 0)
+		setSize(w, h);
+
+	size_t bytes = size_t(w) * size_t(h) * bytesPerPixel(fmt);
+	if (deferUpload(bytes, [this, target, level, fmt, w, h, image]() {
+			uploadPixels(target, level, fmt, w, h, image->data());
+		}))
+		return;
+
+	uploadPixels(target, level, fmt, w, h, image->data());
+}
+
+void GL::Texture::uploadMipmaps(const MipLevelsPtr & mipmaps, GL::Enum fmt, GL::Enum target)
+{
+	if (!mipmaps || mipmaps->empty() || fmt == GL::NONE)
+		return;
+
+	size_t bytes = 0;
+	for (const MipBuilder::Level & level : *mipmaps)
+		bytes += level.pixels.size();
+
+	auto upload = [this, mipmaps, fmt, target]() {
+		int index = 1;
+		for (const MipBuilder::Level & level : *mipmaps)
+			uploadPixels(target, index++, fmt, level.width, level.height, level.pixels.data());
+	};
+
+	if (!deferUpload(bytes, upload))
+		upload();
+}
+
+void GL::Texture::uploadPixels(GL::Enum target, int level, GL::Enum fmt, int w, int h, const void * pixels)
+{
+	if (m_Handle == 0)
+		return;
+
+	bind();
+
+	if (m_PixelPacker.format() != PixelPacker::UnpackedFormat && (fmt == GL::RGB || fmt == GL::RGBA))
+	{
+		std::vector<GL::UShort> packed;
+		if (pixels)
+			m_PixelPacker.pack(pixels, w, h, int(bytesPerPixel(fmt)), packed);
+
+		GL::Enum packedFmt = m_PixelPacker.glFormat();
+		GL::pixelStorei(GL::UNPACK_ALIGNMENT, 2);
+		GL::texImage2D(target, level, packedFmt, w, h, 0, packedFmt, m_PixelPacker.glType(),
+			(pixels ? packed.data() : nullptr));
+
+		setLevelInfo(target, level, w, h, size_t(w) * size_t(h) * sizeof(GL::UShort));
+		return;
+	}
+
+	GL::pixelStorei(GL::UNPACK_ALIGNMENT, 1);
+	GL::texImage2D(target, level, fmt, w, h, 0, fmt, GL::UNSIGNED_BYTE, pixels);
+
+	setLevelInfo(target, level, w, h, size_t(w) * size_t(h) * bytesPerPixel(fmt));
+}
+
+void GL::Texture::uploadCompressedPixels(GL::Enum target, int level, GL::Enum fmt, int w, int h, const void * data,
+	size_t size)
+{
+	if (m_Handle == 0)
+		return;
+
+	bind();
+	GL::compressedTexImage2D(target, level, fmt, w, h, 0, GL::Sizei(size), data);
+
+	setLevelInfo(target, level, w, h, size);
+}
+
+void GL::Texture::uploadCompressedLevel(const CompressedImage & image, int level, int targetLevel, bool compressed)
+{
+	int w = image.levelWidth(level);
+	int h = image.levelHeight(level);
+
+	if (compressed)
+	{
+		uploadCompressedPixels(GL::TEXTURE_2D, targetLevel, image.internalFormat(), w, h, image.levelData(level),
+			image.levelSize(level));
+	}
+	else
+	{
+		std::vector<GL::UByte> pixels;
+		image.decode(level, pixels);
+		uploadPixels(GL::TEXTURE_2D, targetLevel, (image.hasAlpha() ? GL::RGBA : GL::RGB), w, h, pixels.data());
+	}
+}
+
+void GL::Texture::releaseLevels(int first)
+{
+	if (m_Handle == 0)
+		return;
+
+	for (auto it = m_Levels.begin(); it != m_Levels.end(); )
+	{
+		if (it->target != GL::TEXTURE_2D || it->level < first)
+			++it;
+		else
+		{
+			// Zero-sized image releases memory of the level
+			bind();
+			GL::texImage2D(GL::TEXTURE_2D, it->level, GL::RGBA, 0, 0, 0, GL::RGBA, GL::UNSIGNED_BYTE, nullptr);
+			it = m_Levels.erase(it);
+		}
+	}
+}
+
+void GL::Texture::uploadSubImage(int x, int y, int w, int h, GL::Enum fmt, const void * pixels, int level,
+	GL::Enum target)
+{
+	size_t bytes = size_t(w) * size_t(h) * bytesPerPixel(fmt);
+	if (manager() && manager()->deferredUploads())
+	{
+		const GL::UByte * p = reinterpret_cast<const GL::UByte *>(pixels);
+		std::shared_ptr<std::vector<GL::UByte>> data = std::make_shared<std::vector<GL::UByte>>(p, p + bytes);
+		if (deferUpload(bytes, [this, target, level, x, y, w, h, fmt, data]() {
+				uploadSubPixels(target, level, x, y, w, h, fmt, data->data());
+			}))
+			return;
+	}
+
+	uploadSubPixels(target, level, x, y, w, h, fmt, pixels);
+}
+
+void GL::Texture::uploadSubImage(const Stb::Image & image, int x, int y, int level, GL::Enum target)
+{
+	GL::Enum fmt = glFormatForImage(image);
+	if (fmt != GL::NONE)
+		uploadSubImage(x, y, image.width(), image.height(), fmt, image.data(), level, target);
+}
+
+void GL::Texture::uploadSubPixels(GL::Enum target, int level, int x, int y, int w, int h, GL::Enum fmt,
+	const void * pixels)
+{
+	if (m_Handle == 0)
+		return;
 
 	bind();
+
+	if (m_PixelPacker.format() != PixelPacker::UnpackedFormat && (fmt == GL::RGB || fmt == GL::RGBA))
+	{
+		std::vector<GL::UShort> packed;
+		m_PixelPacker.pack(pixels, w, h, int(bytesPerPixel(fmt)), packed, x, y);
+
+		GL::pixelStorei(GL::UNPACK_ALIGNMENT, 2);
+		GL::texSubImage2D(target, level, x, y, w, h, m_PixelPacker.glFormat(), m_PixelPacker.glType(),
+			packed.data());
+		return;
+	}
+
 	GL::pixelStorei(GL::UNPACK_ALIGNMENT, 1);
-	GL::texImage2D(target, level, fmt, image.width(), image.height(), 0, fmt, GL::UNSIGNED_BYTE, image.data());
+	GL::texSubImage2D(target, level, x, y, w, h, fmt, GL::UNSIGNED_BYTE, pixels);
+}
+
+void GL::Texture::setLevelInfo(GL::Enum target, int level, int w, int h, size_t bytes)
+{
+	for (LevelInfo & info : m_Levels)
+	{
+		if (info.target == target && info.level == level)
+		{
+			info.width = w;
+			info.height = h;
+			info.bytes = bytes;
+			return;
+		}
+	}
+
+	LevelInfo info;
+	info.target = target;
+	info.level = level;
+	info.width = w;
+	info.height = h;
+	info.bytes = bytes;
+	m_Levels.push_back(info);
+}
+
+void GL::Texture::generateMipmap()
+{
+	bind();
+	GL::generateMipmap(m_Target);
+
+	std::vector<LevelInfo> baseLevels;
+	for (const LevelInfo & info : m_Levels)
+	{
+		if (info.level == 0 && info.width > 0 && info.height > 0)
+			baseLevels.push_back(info);
+	}
+
+	for (const LevelInfo & base : baseLevels)
+	{
+		size_t bpp = base.bytes / (size_t(base.width) * size_t(base.height));
+		int w = base.width, h = base.height;
+		for (int level = 1; w > 1 || h > 1; level++)
+		{
+			w = (w > 1 ? w / 2 : 1);
+			h = (h > 1 ? h / 2 : 1);
+			setLevelInfo(base.target, level, w, h, size_t(w) * size_t(h) * bpp);
+		}
+	}
+}
+
+void GL::Texture::setDefaultParameters(bool mipmaps)
+{
+	GL::texParameterf(GL::TEXTURE_2D, GL::TEXTURE_WRAP_S, GL::CLAMP_TO_EDGE);
+	GL::texParameterf(GL::TEXTURE_2D, GL::TEXTURE_WRAP_T, GL::CLAMP_TO_EDGE);
+	GL::texParameterf(GL::TEXTURE_2D, GL::TEXTURE_MIN_FILTER, (mipmaps ? GL::LINEAR_MIPMAP_LINEAR : GL::LINEAR));
+	GL::texParameterf(GL::TEXTURE_2D, GL::TEXTURE_MAG_FILTER, GL::LINEAR);
+}
+
+size_t GL::Texture::memoryUsage() const
+{
+	size_t bytes = 0;
+	for (const LevelInfo & info : m_Levels)
+		bytes += info.bytes;
+	return bytes;
 }
 
 void GL::Texture::destroy()
@@ -80,8 +537,10 @@ void GL::Texture::destroy()
 	if (m_Handle != 0)
 	{
 		GL::deleteTextures(1, &m_Handle);
+		StateCache::current().forgetTexture(m_Handle);
 		m_Handle = 0;
 	}
 	m_Width = 0;
 	m_Height = 0;
+	m_Levels.clear();
 }
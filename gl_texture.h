@@ -26,6 +26,11 @@
 #include <yip-imports/gl.h>
 #include <yip-imports/stb_image.hpp>
 #include "gl_resource.h"
+#include "gl_state_cache.h"
+#include "gl_mip_builder.h"
+#include "gl_compressed_image.h"
+#include "gl_pixel_packer.h"
+#include <vector>
 
 #ifdef __ANDROID__
 #include <backward/strstream>
@@ -54,19 +59,98 @@ namespace GL
 		/**
 		 * Binds texture into the OpenGL context.
 		 * This is equivalent to GL::bindTexture.
+		 * The call is skipped if texture is already bound to the active texture unit (see GL::StateCache).
 		 */
-		inline void bind() { GL::bindTexture(m_Target, m_Handle); }
+		inline void bind() { StateCache::current().bindTexture(m_Target, m_Handle); }
 
 		/**
 		 * Initializes texture from the specified stream.
+		 * KTX, PKM and DDS files are detected and loaded with initFromCompressedImage(); other files are decoded
+		 * with stb_image.
 		 * @note This method binds the texture into the OpenGL context.
 		 * @note This method changes GL::UNPACK_ALIGNMENT.
 		 * @param stream Stream to initialize from.
 		 * @param fmt Desired pixel format of the texture (image will be converted into the specified format).
-		 * Use Stb::Image::UNKNOWN to use format of the image.
+		 * Use Stb::Image::UNKNOWN to use format of the image. Ignored for compressed images.
 		 */
 		void initFromStream(std::istream & stream, Stb::Image::Format fmt = Stb::Image::UNKNOWN);
 
+		/**
+		 * Initializes texture from the already decoded image.
+		 * @note This method binds the texture into the OpenGL context.
+		 * @note This method changes GL::UNPACK_ALIGNMENT.
+		 * @param image Image.
+		 */
+		void initFromImage(const Stb::Image & image);
+
+		/**
+		 * Initializes texture from the already decoded image.
+		 * Unlike the version accepting a reference, this method does not copy image data when
+		 * uploads are deferred.
+		 * @note This method binds the texture into the OpenGL context.
+		 * @note This method changes GL::UNPACK_ALIGNMENT.
+		 * @param image Pointer to the image.
+		 */
+		void initFromImage(const Stb::ImagePtr & image);
+
+		/**
+		 * Initializes texture from the already decoded image and builds mipmaps for it on the CPU.
+		 * All mipmap levels are uploaded and trilinear filtering (GL::LINEAR_MIPMAP_LINEAR) is enabled.
+		 * @note This method binds the texture into the OpenGL context.
+		 * @note This method changes GL::UNPACK_ALIGNMENT.
+		 * @param image Pointer to the image.
+		 * @param builder Mipmap builder.
+		 * @see GL::MipBuilder.
+		 */
+		void initFromImage(const Stb::ImagePtr & image, const MipBuilder & builder);
+
+		/**
+		 * Initializes texture from the already decoded image and mipmap levels built for it.
+		 * All mipmap levels are uploaded and trilinear filtering (GL::LINEAR_MIPMAP_LINEAR) is enabled.
+		 * @note This method binds the texture into the OpenGL context.
+		 * @note This method changes GL::UNPACK_ALIGNMENT.
+		 * @param image Pointer to the image.
+		 * @param mipmaps Mipmap levels starting with level 1 (see GL::MipBuilder::build).
+		 */
+		void initFromImage(const Stb::ImagePtr & image, const MipLevelsPtr & mipmaps);
+
+		/**
+		 * Initializes texture from the compressed image.
+		 * All mipmap levels are uploaded with GL::compressedTexImage2D. If format of the image is not supported
+		 * by the OpenGL implementation, mipmap levels are decoded in software and uploaded uncompressed.
+		 * Trilinear filtering is enabled if the image contains a complete mipmap chain.
+		 * @note This method binds the texture into the OpenGL context.
+		 * @note This method changes GL::UNPACK_ALIGNMENT.
+		 * @param image Pointer to the compressed image.
+		 * @throws std::runtime_error if format is not supported and could not be decoded in software.
+		 */
+		void initFromCompressedImage(const CompressedImagePtr & image);
+
+		/**
+		 * Checks whether the specified compressed format is supported by the current OpenGL context.
+		 * @param format Compressed internal format (e.g. GL::CompressedImage::ETC1Format).
+		 * @return *true* if format is supported, *false* otherwise.
+		 */
+		static bool isCompressedFormatSupported(Enum format);
+
+		/**
+		 * Initializes texture with a 1x1 white placeholder image.
+		 * This is used for textures that are being loaded asynchronously.
+		 * @note This method binds the texture into the OpenGL context.
+		 * @note This method changes GL::UNPACK_ALIGNMENT.
+		 */
+		void initWithPlaceholder();
+
+		/**
+		 * Allocates storage for the texture without initializing its contents.
+		 * Contents could be uploaded later with uploadSubImage().
+		 * @note This method binds the texture into the OpenGL context.
+		 * @param width Width of the texture in pixels.
+		 * @param height Height of the texture in pixels.
+		 * @param format Pixel format (GL::ALPHA, GL::LUMINANCE_ALPHA, GL::RGB or GL::RGBA).
+		 */
+		void initEmpty(int width, int height, Enum format = GL::RGBA);
+
 		/**
 		 * Initializes texture from binary data.
 		 * @note This method binds the texture into the OpenGL context.
@@ -106,6 +190,86 @@ namespace GL
 		 */
 		void uploadImage(const Stb::Image & image, int level = 0, Enum target = GL::TEXTURE_2D);
 
+		/**
+		 * Uploads the specified image into the specified mipmap level of the texture.
+		 * Unlike the version accepting a reference, this method does not copy image data when
+		 * uploads are deferred.
+		 * @note This method binds the texture into the OpenGL context.
+		 * @note This method changes GL::UNPACK_ALIGNMENT.
+		 * @param image Pointer to the image.
+		 * @param level Mipmap level to upload image into
+		 * @param target Binding target for the texture.
+		 */
+		void uploadImage(const Stb::ImagePtr & image, int level = 0, Enum target = GL::TEXTURE_2D);
+
+		/**
+		 * Uploads mipmap levels built by GL::MipBuilder into the texture.
+		 * Levels are not copied when uploads are deferred.
+		 * @note This method binds the texture into the OpenGL context.
+		 * @note This method changes GL::UNPACK_ALIGNMENT.
+		 * @param mipmaps Mipmap levels starting with level 1.
+		 * @param format Pixel format of the levels (should match format of the level 0).
+		 * @param target Binding target for the texture.
+		 */
+		void uploadMipmaps(const MipLevelsPtr & mipmaps, Enum format, Enum target = GL::TEXTURE_2D);
+
+		/**
+		 * Re-specifies the texture from the part of the mipmap chain.
+		 * Source level *first* becomes the level 0 of the texture, so the texture has lower resolution when
+		 * *first* is greater than zero; all smaller levels are uploaded after it. Levels of the previous
+		 * specification that are no longer used are redefined as empty to release their memory. Trilinear
+		 * filtering is enabled when the texture is specified for the first time.
+		 * This is used by GL::TextureStreamer.
+		 * @note This method binds the texture into the OpenGL context.
+		 * @note This method changes GL::UNPACK_ALIGNMENT.
+		 * @param image Pointer to the image (source level 0).
+		 * @param mipmaps Source levels starting with level 1 (see GL::MipBuilder::build).
+		 * @param first Index of the first source level to upload.
+		 */
+		void uploadMipChain(const Stb::ImagePtr & image, const MipLevelsPtr & mipmaps, int first);
+
+		/**
+		 * Re-specifies the texture from the part of the mipmap chain of the compressed image.
+		 * @note This method binds the texture into the OpenGL context.
+		 * @note This method changes GL::UNPACK_ALIGNMENT.
+		 * @param image Pointer to the compressed image.
+		 * @param first Index of the first source level to upload.
+		 * @throws std::runtime_error if format is not supported and could not be decoded in software.
+		 * @see uploadMipChain(const Stb::ImagePtr &, const MipLevelsPtr &, int).
+		 */
+		void uploadMipChain(const CompressedImagePtr & image, int first);
+
+		/**
+		 * Uploads pixels into the rectangular region of the specified mipmap level of the texture.
+		 * This is equivalent to GL::texSubImage2D. If resource manager is configured for deferred uploads,
+		 * pixels are copied and upload is performed later by GL::ResourceManager::pumpUploads.
+		 * @note This method binds the texture into the OpenGL context.
+		 * @note This method changes GL::UNPACK_ALIGNMENT.
+		 * @param x X coordinate of the region.
+		 * @param y Y coordinate of the region.
+		 * @param width Width of the region.
+		 * @param height Height of the region.
+		 * @param format Pixel format of the data (should match format of the texture).
+		 * @param pixels Pointer to the pixels (rows are tightly packed).
+		 * @param level Mipmap level.
+		 * @param target Binding target for the texture.
+		 */
+		void uploadSubImage(int x, int y, int width, int height, Enum format, const void * pixels, int level = 0,
+			Enum target = GL::TEXTURE_2D);
+
+		/**
+		 * Uploads the specified image into the rectangular region of the specified mipmap level of the texture.
+		 * Format of the image should match format of the texture.
+		 * @note This method binds the texture into the OpenGL context.
+		 * @note This method changes GL::UNPACK_ALIGNMENT.
+		 * @param image Image.
+		 * @param x X coordinate of the region.
+		 * @param y Y coordinate of the region.
+		 * @param level Mipmap level.
+		 * @param target Binding target for the texture.
+		 */
+		void uploadSubImage(const Stb::Image & image, int x, int y, int level = 0, Enum target = GL::TEXTURE_2D);
+
 		/**
 		 * Returns width of the texture in pixels.
 		 * @return Width of the texture in pixels.
@@ -137,6 +301,37 @@ namespace GL
 		 */
 		inline void setHeight(int h) { m_Height = h; }
 
+		/**
+		 * Sets 16-bit packed format for subsequent uploads of RGB and RGBA pixels.
+		 * When set, all uploads into the texture (including uploadSubImage() and mipmap levels) are converted
+		 * with GL::PixelPacker, so it should be set before the texture is initialized. Alpha and luminance
+		 * images are not converted. GL::PixelPacker::RGB565Format discards alpha channel.
+		 * @param format Packed pixel format (GL::PixelPacker::UnpackedFormat disables conversion).
+		 * @param dither Set to *true* to apply ordered dithering.
+		 */
+		inline void setPackedFormat(PixelPacker::Format format, bool dither = true)
+			{ m_PixelPacker = PixelPacker(format, dither); }
+
+		/**
+		 * Returns converter used for uploads of RGB and RGBA pixels.
+		 * @return Pixel packer.
+		 */
+		inline const PixelPacker & pixelPacker() const { return m_PixelPacker; }
+
+		/**
+		 * Generates mipmaps for the texture.
+		 * This is equivalent to GL::generateMipmap but also updates memory usage statistics.
+		 * @note This method binds the texture into the OpenGL context.
+		 */
+		void generateMipmap();
+
+		/**
+		 * Returns estimated amount of video memory used by the texture.
+		 * The estimate includes all uploaded mipmap levels and all faces of the cube map.
+		 * @return Estimated memory usage in bytes.
+		 */
+		size_t memoryUsage() const override;
+
 	protected:
 		/**
 		 * Constructor.
@@ -160,6 +355,28 @@ namespace GL
 		UInt m_Handle;
 		int m_Width;
 		int m_Height;
+		PixelPacker m_PixelPacker;
+
+		struct LevelInfo
+		{
+			Enum target;
+			int level;
+			int width;
+			int height;
+			size_t bytes;
+		};
+
+		std::vector<LevelInfo> m_Levels;
+
+		void setLevelInfo(Enum target, int level, int width, int height, size_t bytes);
+		void uploadPixels(Enum target, int level, Enum format, int width, int height, const void * pixels);
+		void uploadCompressedPixels(Enum target, int level, Enum format, int width, int height, const void * data,
+			size_t size);
+		void uploadCompressedLevel(const CompressedImage & image, int level, int targetLevel, bool compressed);
+		void releaseLevels(int first);
+		void uploadSubPixels(Enum target, int level, int x, int y, int width, int height, Enum format,
+			const void * pixels);
+		void setDefaultParameters(bool mipmaps = false);
 
 		Texture(const Texture &) = delete;
 		Texture & operator=(const Texture &) = delete;
@@ -0,0 +1,280 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "gl_texture_atlas.h"
+#include "gl_resource_manager.h"
+#include <yip-imports/cxx-util/macros.h>
+#include <stdexcept>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+GL::TextureAtlas::TextureAtlas(ResourceManager * resMgr, int pageWidth, int pageHeight, int padding)
+	: m_ResourceManager(resMgr),
+	  m_UsedPixels(0),
+	  m_PageWidth(pageWidth),
+	  m_PageHeight(pageHeight),
+	  m_Padding(std::max(padding, 0))
+{
+}
+
+GL::TextureAtlas::~TextureAtlas()
+{
+}
+
+const GL::TextureAtlas::SubTexture & GL::TextureAtlas::addImage(const std::string & name, const Stb::Image & image)
+{
+	auto it = m_Images.find(name);
+	if (it != m_Images.end())
+		return it->second;
+
+	int w = image.width(), h = image.height();
+	size_t numPixels = size_t(w) * size_t(h);
+	const UByte * src = reinterpret_cast<const UByte *>(image.data());
+
+	if (image.format() == Stb::Image::RGBA)
+		return addImage(name, w, h, src);
+
+	std::vector<UByte> rgba(numPixels * 4);
+	UByte * dst = rgba.data();
+	switch (image.format())
+	{
+	case Stb::Image::ALPHA:
+		for (size_t i = 0; i < numPixels; i++, src += 1, dst += 4)
+		{
+			dst[0] = dst[1] = dst[2] = 0xFF;
+			dst[3] = src[0];
+		}
+		break;
+
+	case Stb::Image::LUMINANCE_ALPHA:
+		for (size_t i = 0; i < numPixels; i++, src += 2, dst += 4)
+		{
+			dst[0] = dst[1] = dst[2] = src[0];
+			dst[3] = src[1];
+		}
+		break;
+
+	case Stb::Image::RGB:
+		for (size_t i = 0; i < numPixels; i++, src += 3, dst += 4)
+		{
+			memcpy(dst, src, 3);
+			dst[3] = 0xFF;
+		}
+		break;
+
+	case Stb::Image::RGBA:
+	case Stb::Image::UNKNOWN:
+		throw std::runtime_error("image has invalid pixel format.");
+	}
+
+	return addImage(name, w, h, rgba.data());
+}
+
+const GL::TextureAtlas::SubTexture & GL::TextureAtlas::addImage(const std::string & name, int w, int h,
+	const void * pixels)
+{
+	auto it = m_Images.find(name);
+	if (it != m_Images.end())
+		return it->second;
+
+	int paddedWidth = w + 2 * m_Padding;
+	int paddedHeight = h + 2 * m_Padding;
+	if (UNLIKELY(w <= 0 || h <= 0 || paddedWidth > m_PageWidth || paddedHeight > m_PageHeight))
+		throw std::runtime_error("image \"" + name + "\" does not fit into the texture atlas page.");
+
+	// Find the page (try existing pages first)
+
+	int x = 0, y = 0;
+	size_t node = 0, pageIndex = 0;
+	for (; pageIndex < m_Pages.size(); pageIndex++)
+	{
+		if (findPosition(m_Pages[pageIndex], paddedWidth, paddedHeight, &x, &y, &node))
+			break;
+	}
+
+	if (pageIndex == m_Pages.size())
+	{
+		createPage();
+		findPosition(m_Pages[pageIndex], paddedWidth, paddedHeight, &x, &y, &node);
+	}
+
+	Page & page = m_Pages[pageIndex];
+	insertNode(page, node, x, y, paddedWidth, paddedHeight);
+
+	// Replicate edge pixels of the image into the padding
+
+	const UByte * src = reinterpret_cast<const UByte *>(pixels);
+	m_Pixels.resize(size_t(paddedWidth) * size_t(paddedHeight) * 4);
+	for (int py = 0; py < paddedHeight; py++)
+	{
+		int sy = std::min(std::max(py - m_Padding, 0), h - 1);
+		const UByte * srcRow = src + size_t(sy) * size_t(w) * 4;
+		UByte * dstRow = &m_Pixels[size_t(py) * size_t(paddedWidth) * 4];
+
+		for (int px = 0; px < m_Padding; px++)
+			memcpy(dstRow + px * 4, srcRow, 4);
+		memcpy(dstRow + m_Padding * 4, srcRow, size_t(w) * 4);
+		for (int px = m_Padding + w; px < paddedWidth; px++)
+			memcpy(dstRow + px * 4, srcRow + (w - 1) * 4, 4);
+	}
+
+	page.texture->uploadSubImage(x, y, paddedWidth, paddedHeight, GL::RGBA, m_Pixels.data());
+
+	SubTexture & sub = m_Images[name];
+	sub.texture = page.texture;
+	sub.x = x + m_Padding;
+	sub.y = y + m_Padding;
+	sub.width = w;
+	sub.height = h;
+	sub.page = int(pageIndex);
+	sub.s1 = float(sub.x) / float(m_PageWidth);
+	sub.t1 = float(sub.y) / float(m_PageHeight);
+	sub.s2 = float(sub.x + w) / float(m_PageWidth);
+	sub.t2 = float(sub.y + h) / float(m_PageHeight);
+
+	m_UsedPixels += size_t(w) * size_t(h);
+
+	return sub;
+}
+
+const GL::TextureAtlas::SubTexture & GL::TextureAtlas::addFile(const std::string & name)
+{
+	auto it = m_Images.find(name);
+	if (it != m_Images.end())
+		return it->second;
+
+	Stb::ImagePtr image = Stb::Image::loadFromStream(*m_ResourceManager->resourceLoader().openResource(name),
+		Stb::Image::RGBA);
+	return addImage(name, *image);
+}
+
+const GL::TextureAtlas::SubTexture & GL::TextureAtlas::find(const std::string & name) const
+{
+	static const SubTexture invalid;
+	auto it = m_Images.find(name);
+	return (it != m_Images.end() ? it->second : invalid);
+}
+
+float GL::TextureAtlas::efficiency() const
+{
+	size_t total = totalPixels();
+	return (total > 0 ? float(double(m_UsedPixels) / double(total)) : 1.0f);
+}
+
+void GL::TextureAtlas::clear()
+{
+	m_Pages.clear();
+	m_Images.clear();
+	m_Pixels.clear();
+	m_UsedPixels = 0;
+}
+
+bool GL::TextureAtlas::findPosition(const Page & page, int w, int h, int * outX, int * outY,
+	size_t * outIndex) const
+{
+	// Skyline bottom-left: choose position with the lowest top edge, then the narrowest segment.
+	int bestBottom = INT_MAX, bestWidth = INT_MAX;
+	bool found = false;
+
+	for (size_t i = 0; i < page.skyline.size(); i++)
+	{
+		int x = page.skyline[i].x;
+		if (x + w > m_PageWidth)
+			break;
+
+		int y = 0, remaining = w;
+		for (size_t j = i; remaining > 0 && j < page.skyline.size(); j++)
+		{
+			y = std::max(y, page.skyline[j].y);
+			remaining -= page.skyline[j].width;
+		}
+		if (y + h > m_PageHeight)
+			continue;
+
+		if (y + h < bestBottom || (y + h == bestBottom && page.skyline[i].width < bestWidth))
+		{
+			bestBottom = y + h;
+			bestWidth = page.skyline[i].width;
+			*outX = x;
+			*outY = y;
+			*outIndex = i;
+			found = true;
+		}
+	}
+
+	return found;
+}
+
+void GL::TextureAtlas::insertNode(Page & page, size_t index, int x, int y, int w, int h)
+{
+	SkylineNode node;
+	node.x = x;
+	node.y = y + h;
+	node.width = w;
+	page.skyline.insert(page.skyline.begin() + ptrdiff_t(index), node);
+
+	// Shrink or remove nodes covered by the new one
+	for (size_t i = index + 1; i < page.skyline.size(); )
+	{
+		const SkylineNode & prev = page.skyline[i - 1];
+		SkylineNode & cur = page.skyline[i];
+
+		int overlap = prev.x + prev.width - cur.x;
+		if (overlap <= 0)
+			break;
+
+		cur.x += overlap;
+		cur.width -= overlap;
+		if (cur.width > 0)
+			break;
+
+		page.skyline.erase(page.skyline.begin() + ptrdiff_t(i));
+	}
+
+	// Merge neighbouring nodes at the same height
+	for (size_t i = 0; i + 1 < page.skyline.size(); )
+	{
+		if (page.skyline[i].y == page.skyline[i + 1].y)
+		{
+			page.skyline[i].width += page.skyline[i + 1].width;
+			page.skyline.erase(page.skyline.begin() + ptrdiff_t(i + 1));
+		}
+		else
+			++i;
+	}
+}
+
+void GL::TextureAtlas::createPage()
+{
+	Page page;
+	page.texture = m_ResourceManager->createTexture(GL::TEXTURE_2D);
+	page.texture->initEmpty(m_PageWidth, m_PageHeight, GL::RGBA);
+
+	SkylineNode node;
+	node.x = 0;
+	node.y = 0;
+	node.width = m_PageWidth;
+	page.skyline.push_back(node);
+
+	m_Pages.push_back(page);
+}
@@ -0,0 +1,214 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __11d538035d85510fcccfa4548c43cbe1__
+#define __11d538035d85510fcccfa4548c43cbe1__
+
+#include "gl_texture.h"
+#include <yip-imports/stb_image.hpp>
+#include <yip-imports/gl.h>
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <memory>
+
+namespace GL
+{
+	class ResourceManager;
+
+	/**
+	 * Runtime texture atlas.
+	 *
+	 * Packs many small images into a few large RGBA textures (pages), so they could be drawn without changing
+	 * bound texture (see GL::SpriteBatch). Images are placed with the skyline bottom-left algorithm and uploaded
+	 * into the page with GL::Texture::uploadSubImage as soon as they are added, so images could be added at any
+	 * time. A new page is created when an image does not fit into existing pages.
+	 *
+	 * Each image is surrounded by a border of *padding* pixels filled with copies of its edge pixels, so linear
+	 * filtering does not bleed neighbouring images into each other.
+	 */
+	class TextureAtlas
+	{
+	public:
+		/** Image in the atlas. */
+		struct SubTexture
+		{
+			TexturePtr texture;					/**< Page texture containing the image. */
+			float s1;							/**< S texture coordinate of the top left corner. */
+			float t1;							/**< T texture coordinate of the top left corner. */
+			float s2;							/**< S texture coordinate of the bottom right corner. */
+			float t2;							/**< T texture coordinate of the bottom right corner. */
+			int x;								/**< X coordinate of the image in the page, in pixels. */
+			int y;								/**< Y coordinate of the image in the page, in pixels. */
+			int width;							/**< Width of the image in pixels. */
+			int height;							/**< Height of the image in pixels. */
+			int page;							/**< Index of the page. */
+
+			/** Constructor. Creates an invalid sub-texture. */
+			inline SubTexture() : s1(0.0f), t1(0.0f), s2(0.0f), t2(0.0f), x(0), y(0), width(0), height(0),
+				page(-1) {}
+
+			/**
+			 * Checks whether this sub-texture refers to an image in the atlas.
+			 * @return *true* if sub-texture is valid, *false* otherwise.
+			 */
+			inline bool isValid() const noexcept { return page >= 0; }
+		};
+
+		/**
+		 * Constructor.
+		 * @param resMgr Pointer to the resource manager.
+		 * @param pageWidth Width of pages in pixels.
+		 * @param pageHeight Height of pages in pixels.
+		 * @param padding Width of the border around each image in pixels.
+		 */
+		TextureAtlas(ResourceManager * resMgr, int pageWidth = 1024, int pageHeight = 1024, int padding = 1);
+
+		/** Destructor. */
+		~TextureAtlas();
+
+		/**
+		 * Returns width of pages.
+		 * @return Width of pages in pixels.
+		 */
+		inline int pageWidth() const noexcept { return m_PageWidth; }
+
+		/**
+		 * Returns height of pages.
+		 * @return Height of pages in pixels.
+		 */
+		inline int pageHeight() const noexcept { return m_PageHeight; }
+
+		/**
+		 * Returns number of pages.
+		 * @return Number of pages.
+		 */
+		inline size_t numPages() const noexcept { return m_Pages.size(); }
+
+		/**
+		 * Returns texture of the specified page.
+		 * @param index Index of the page.
+		 * @return Texture.
+		 */
+		inline const TexturePtr & page(size_t index) const { return m_Pages[index].texture; }
+
+		/**
+		 * Adds image to the atlas.
+		 * If image with the specified name already exists in the atlas, it is returned and the new image is
+		 * ignored.
+		 * @param name Name of the image.
+		 * @param image Image.
+		 * @return Sub-texture for the image.
+		 * @throws std::runtime_error if image is larger than the page.
+		 */
+		const SubTexture & addImage(const std::string & name, const Stb::Image & image);
+
+		/**
+		 * Adds image to the atlas.
+		 * If image with the specified name already exists in the atlas, it is returned and the new image is
+		 * ignored.
+		 * @param name Name of the image.
+		 * @param width Width of the image in pixels.
+		 * @param height Height of the image in pixels.
+		 * @param pixels Pointer to the RGBA pixels (rows are tightly packed).
+		 * @return Sub-texture for the image.
+		 * @throws std::runtime_error if image is larger than the page.
+		 */
+		const SubTexture & addImage(const std::string & name, int width, int height, const void * pixels);
+
+		/**
+		 * Loads image with the resource loader of the resource manager and adds it to the atlas.
+		 * If image with the specified name already exists in the atlas, it is returned without loading.
+		 * @param name Name of the image file.
+		 * @return Sub-texture for the image.
+		 * @throws std::runtime_error if image could not be loaded or is larger than the page.
+		 */
+		const SubTexture & addFile(const std::string & name);
+
+		/**
+		 * Returns sub-texture for the image with the specified name.
+		 * @param name Name of the image.
+		 * @return Sub-texture. If image is not in the atlas, returned sub-texture is invalid.
+		 */
+		const SubTexture & find(const std::string & name) const;
+
+		/**
+		 * Returns number of images in the atlas.
+		 * @return Number of images.
+		 */
+		inline size_t numImages() const noexcept { return m_Images.size(); }
+
+		/**
+		 * Returns number of pixels occupied by images (not including padding).
+		 * @return Number of pixels.
+		 */
+		inline size_t usedPixels() const noexcept { return m_UsedPixels; }
+
+		/**
+		 * Returns number of pixels in all pages.
+		 * @return Number of pixels.
+		 */
+		inline size_t totalPixels() const noexcept
+			{ return m_Pages.size() * size_t(m_PageWidth) * size_t(m_PageHeight); }
+
+		/**
+		 * Returns packing efficiency of the atlas.
+		 * @return Ratio of usedPixels() to totalPixels() (1 for an empty atlas).
+		 */
+		float efficiency() const;
+
+		/** Removes all images and destroys all pages. */
+		void clear();
+
+	private:
+		struct SkylineNode
+		{
+			int x;
+			int y;
+			int width;
+		};
+
+		struct Page
+		{
+			TexturePtr texture;
+			std::vector<SkylineNode> skyline;
+		};
+
+		ResourceManager * m_ResourceManager;
+		std::vector<Page> m_Pages;
+		std::unordered_map<std::string, SubTexture> m_Images;
+		std::vector<UByte> m_Pixels;
+		size_t m_UsedPixels;
+		int m_PageWidth;
+		int m_PageHeight;
+		int m_Padding;
+
+		bool findPosition(const Page & page, int width, int height, int * x, int * y, size_t * index) const;
+		void insertNode(Page & page, size_t index, int x, int y, int width, int height);
+		void createPage();
+
+		TextureAtlas(const TextureAtlas &) = delete;
+		TextureAtlas & operator=(const TextureAtlas &) = delete;
+	};
+}
+
+#endif
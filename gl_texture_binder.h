@@ -24,6 +24,7 @@
 #define __695009233d48e4afc60dfabb116ee572__
 
 #include "gl_texture.h"
+#include "gl_state_cache.h"
 #include <yip-imports/gl.h>
 
 namespace GL
@@ -47,6 +48,7 @@ namespace GL
 		/**
 		 * Constructor.
 		 * Calls GL::activeTexture and GL::bindTexture with the specified texture.
+		 * Calls that do not change the state are skipped (see GL::StateCache).
 		 * @param texture Texture to use.
 		 * @param unit Texture unit to use (default is GL::TEXTURE0).
 		 * @see GL::bindTexture, GL::activeTexture.
@@ -55,15 +57,17 @@ namespace GL
 			: m_Unit(unit),
 			  m_Target(texture->target())
 		{
-			GL::activeTexture(unit);
+			StateCache::current().activeTexture(unit);
 			texture->bind();
 		}
 
-		/** Destructor. Calls GL::bindTexture with texture handle set to zero. */
+		/**
+		 * Destructor. Calls GL::bindTexture with texture handle set to zero.
+		 * The call is skipped if lazy unbinding is enabled in the current GL::StateCache.
+		 */
 		inline ~TextureBinder()
 		{
-			GL::activeTexture(m_Unit);
-			GL::bindTexture(m_Target, 0);
+			StateCache::current().unbindTexture(m_Unit, m_Target);
 		}
 
 	private:
@@ -0,0 +1,306 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "gl_texture_streamer.h"
+#include "gl_resource_manager.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+// Returns number of bytes per pixel of uncompressed level as uploaded into the texture.
+static size_t uploadedBytesPerPixel(const GL::Texture & texture, int channels)
+{
+	if (channels >= 3 && texture.pixelPacker().format() != GL::PixelPacker::UnpackedFormat)
+		return 2;
+	return size_t(channels);
+}
+
+GL::TextureStreamer::TextureStreamer(ResourceManager * resMgr, size_t budget, int tailSize)
+	: m_ResourceManager(resMgr),
+	  m_Budget(budget),
+	  m_ResidentBytes(0),
+	  m_UploadedBytes(0),
+	  m_Evictions(0),
+	  m_Frame(0),
+	  m_RetainFrames(30),
+	  m_TailSize(std::max(tailSize, 1))
+{
+}
+
+GL::TextureStreamer::~TextureStreamer()
+{
+}
+
+GL::TexturePtr GL::TextureStreamer::load(const std::string & name)
+{
+	TexturePtr texture = m_ResourceManager->createTexture(GL::TEXTURE_2D, name);
+	const PixelPacker & packer = m_ResourceManager->texturePixelPacker();
+	texture->setPackedFormat(packer.format(), packer.dither());
+
+	::Resource::StreamPtr stream = m_ResourceManager->resourceLoader().openResource(name);
+	Internal::DecodedImage decoded = ResourceManager::decodeImage(*stream, &m_ResourceManager->mipBuilder());
+	if (decoded.compressed)
+		add(texture, decoded.compressed);
+	else
+		add(texture, decoded.image, decoded.mipmaps);
+
+	return texture;
+}
+
+void GL::TextureStreamer::add(const TexturePtr & texture, const Stb::ImagePtr & image,
+	const MipLevelsPtr & mipmaps)
+{
+	int channels = 0;
+	switch (image->format())
+	{
+	case Stb::Image::UNKNOWN: break;
+	case Stb::Image::ALPHA: channels = 1; break;
+	case Stb::Image::LUMINANCE_ALPHA: channels = 2; break;
+	case Stb::Image::RGB: channels = 3; break;
+	case Stb::Image::RGBA: channels = 4; break;
+	}
+
+	Entry entry;
+	entry.image = image;
+	entry.mipmaps = mipmaps;
+
+	int numLevels = 1 + (mipmaps ? int(mipmaps->size()) : 0);
+	size_t bpp = uploadedBytesPerPixel(*texture, channels);
+	entry.chainBytes.resize(size_t(numLevels) + 1, 0);
+	entry.tailLevel = numLevels - 1;
+	for (int level = numLevels - 1; level >= 0; level--)
+	{
+		int w = (level == 0 ? image->width() : (*mipmaps)[size_t(level - 1)].width);
+		int h = (level == 0 ? image->height() : (*mipmaps)[size_t(level - 1)].height);
+		entry.chainBytes[size_t(level)] = entry.chainBytes[size_t(level) + 1] + size_t(w) * size_t(h) * bpp;
+		if (w <= m_TailSize && h <= m_TailSize)
+			entry.tailLevel = level;
+	}
+
+	addEntry(texture, entry);
+}
+
+void GL::TextureStreamer::add(const TexturePtr & texture, const CompressedImagePtr & image)
+{
+	Entry entry;
+	entry.compressed = image;
+
+	bool supported = Texture::isCompressedFormatSupported(image->internalFormat());
+	size_t bpp = uploadedBytesPerPixel(*texture, (image->hasAlpha() ? 4 : 3));
+
+	int numLevels = image->numLevels();
+	entry.chainBytes.resize(size_t(numLevels) + 1, 0);
+	entry.tailLevel = numLevels - 1;
+	for (int level = numLevels - 1; level >= 0; level--)
+	{
+		int w = image->levelWidth(level), h = image->levelHeight(level);
+		size_t bytes = (supported ? image->levelSize(level) : size_t(w) * size_t(h) * bpp);
+		entry.chainBytes[size_t(level)] = entry.chainBytes[size_t(level) + 1] + bytes;
+		if (w <= m_TailSize && h <= m_TailSize)
+			entry.tailLevel = level;
+	}
+
+	addEntry(texture, entry);
+}
+
+void GL::TextureStreamer::remove(const TexturePtr & texture)
+{
+	auto it = m_Entries.find(texture.get());
+	if (it != m_Entries.end())
+	{
+		m_ResidentBytes -= it->second.chainBytes[size_t(it->second.residentLevel)];
+		m_Entries.erase(it);
+	}
+}
+
+void GL::TextureStreamer::request(const TexturePtr & texture, int level)
+{
+	auto it = m_Entries.find(texture.get());
+	if (it != m_Entries.end())
+		it->second.requestedLevel = std::min(it->second.requestedLevel, std::max(level, 0));
+}
+
+void GL::TextureStreamer::update(size_t maxUploadBytes)
+{
+	++m_Frame;
+
+	// Update wanted levels from requests of the frame
+
+	m_Candidates.clear();
+	for (auto it = m_Entries.begin(); it != m_Entries.end(); )
+	{
+		Entry & entry = it->second;
+		if (entry.texture.expired())
+		{
+			m_ResidentBytes -= entry.chainBytes[size_t(entry.residentLevel)];
+			it = m_Entries.erase(it);
+			continue;
+		}
+
+		if (entry.requestedLevel != INT_MAX)
+		{
+			entry.wantedLevel = std::min(entry.requestedLevel, entry.tailLevel);
+			entry.lastRequestFrame = m_Frame;
+			entry.requestedLevel = INT_MAX;
+		}
+		else if (m_Frame - entry.lastRequestFrame > m_RetainFrames)
+			entry.wantedLevel = entry.tailLevel;
+
+		if (entry.wantedLevel < entry.residentLevel)
+			m_Candidates.push_back(&entry);
+
+		++it;
+	}
+
+	// Enforce the budget (it could have been changed)
+
+	if (m_ResidentBytes > m_Budget)
+		evictFor(m_ResidentBytes - m_Budget, nullptr);
+
+	// Upload more detailed levels, most recently requested textures first
+
+	std::sort(m_Candidates.begin(), m_Candidates.end(), [](const Entry * a, const Entry * b) {
+		if (a->lastRequestFrame != b->lastRequestFrame)
+			return a->lastRequestFrame > b->lastRequestFrame;
+		return a->residentLevel - a->wantedLevel > b->residentLevel - b->wantedLevel;
+	});
+
+	size_t uploaded = 0;
+	for (Entry * entry : m_Candidates)
+	{
+		// Find the most detailed level that fits into both the upload limit and the budget
+		int level = entry->wantedLevel;
+		for (; level < entry->residentLevel; level++)
+		{
+			size_t cost = entry->chainBytes[size_t(level)];
+			if (uploaded > 0 && cost > maxUploadBytes - std::min(uploaded, maxUploadBytes))
+				continue;
+
+			size_t extra = cost - entry->chainBytes[size_t(entry->residentLevel)];
+			if (m_ResidentBytes + extra <= m_Budget || evictFor(m_ResidentBytes + extra - m_Budget, entry))
+				break;
+		}
+
+		if (level < entry->residentLevel)
+		{
+			uploaded += entry->chainBytes[size_t(level)];
+			setResidentLevel(*entry, level);
+		}
+	}
+}
+
+int GL::TextureStreamer::residentLevel(const TexturePtr & texture) const
+{
+	auto it = m_Entries.find(texture.get());
+	return (it != m_Entries.end() ? it->second.residentLevel : -1);
+}
+
+int GL::TextureStreamer::levelForScreenSize(int textureWidth, int textureHeight, float screenWidth,
+	float screenHeight)
+{
+	float ratio = std::max(float(textureWidth) / std::max(screenWidth, 1.0f),
+		float(textureHeight) / std::max(screenHeight, 1.0f));
+	return (ratio <= 1.0f ? 0 : int(std::floor(std::log2(ratio))));
+}
+
+void GL::TextureStreamer::addEntry(const TexturePtr & texture, Entry & entry)
+{
+	remove(texture);
+
+	entry.texture = texture;
+	entry.residentLevel = int(entry.chainBytes.size()) - 1;
+	entry.requestedLevel = INT_MAX;
+	entry.wantedLevel = entry.tailLevel;
+	entry.lastRequestFrame = 0;
+
+	Entry & added = m_Entries[texture.get()];
+	added = std::move(entry);
+	setResidentLevel(added, added.tailLevel);
+}
+
+void GL::TextureStreamer::setResidentLevel(Entry & entry, int level)
+{
+	TexturePtr texture = entry.texture.lock();
+	if (!texture)
+		return;
+
+	if (entry.compressed)
+		texture->uploadMipChain(entry.compressed, level);
+	else
+		texture->uploadMipChain(entry.image, entry.mipmaps, level);
+
+	m_ResidentBytes -= entry.chainBytes[size_t(entry.residentLevel)];
+	m_ResidentBytes += entry.chainBytes[size_t(level)];
+	m_UploadedBytes += entry.chainBytes[size_t(level)];
+	entry.residentLevel = level;
+}
+
+bool GL::TextureStreamer::evictFor(size_t bytes, const Entry * requester)
+{
+	// Victims are textures that hold more detailed levels than they need, least recently requested first.
+	// When the budget itself is exceeded (no requester), levels of textures that are still needed are evicted
+	// too, down to their mip tails.
+
+	std::vector<std::pair<Entry *, int>> victims;
+	size_t available = 0;
+	for (auto & it : m_Entries)
+	{
+		Entry & entry = it.second;
+		if (&entry == requester || (requester && entry.lastRequestFrame >= requester->lastRequestFrame))
+			continue;
+
+		int target = (requester ? entry.wantedLevel : entry.tailLevel);
+		if (target <= entry.residentLevel)
+			continue;
+
+		victims.push_back(std::make_pair(&entry, target));
+		available += entry.chainBytes[size_t(entry.residentLevel)] - entry.chainBytes[size_t(target)];
+	}
+
+	if (available < bytes && requester)
+		return false;
+
+	typedef std::pair<Entry *, int> Victim;
+	std::sort(victims.begin(), victims.end(), [](const Victim & a, const Victim & b) {
+		return a.first->lastRequestFrame < b.first->lastRequestFrame;
+	});
+
+	size_t freed = 0;
+	for (const auto & victim : victims)
+	{
+		if (freed >= bytes)
+			break;
+
+		// Evict only as many levels as needed
+		Entry & entry = *victim.first;
+		int level = entry.residentLevel;
+		size_t resident = entry.chainBytes[size_t(level)];
+		while (level < victim.second && freed + resident - entry.chainBytes[size_t(level)] < bytes)
+			++level;
+
+		freed += resident - entry.chainBytes[size_t(level)];
+		setResidentLevel(entry, level);
+		++m_Evictions;
+	}
+
+	return freed >= bytes;
+}
@@ -0,0 +1,210 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __32097cc0dabe5c78938cd83119b15553__
+#define __32097cc0dabe5c78938cd83119b15553__
+
+#include "gl_texture.h"
+#include "gl_mip_builder.h"
+#include "gl_compressed_image.h"
+#include <yip-imports/stb_image.hpp>
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+
+namespace GL
+{
+	class ResourceManager;
+
+	/**
+	 * Streaming of mipmap levels of textures within a video memory budget.
+	 *
+	 * Each registered texture keeps its complete mipmap chain in system memory, but only a low-resolution mip
+	 * tail is uploaded initially. Renderer calls request() with the most detailed mipmap level it needs for
+	 * each texture drawn in the frame (see levelForScreenSize()), and update() uploads more detailed levels
+	 * for requested textures. When the budget is exceeded, the most detailed levels of textures that have not
+	 * been requested recently are evicted.
+	 *
+	 * OpenGL ES 2.0 does not support GL::TEXTURE_BASE_LEVEL, so changing the most detailed level re-specifies
+	 * the texture with GL::Texture::uploadMipChain: the new top level becomes level 0 and all smaller levels
+	 * are uploaded after it. Texture coordinates are normalized, so this is invisible to shaders.
+	 */
+	class TextureStreamer
+	{
+	public:
+		/**
+		 * Constructor.
+		 * @param resMgr Pointer to the resource manager.
+		 * @param budget Video memory budget for streamed textures in bytes.
+		 * @param tailSize Maximum width and height of the mip tail uploaded initially.
+		 */
+		TextureStreamer(ResourceManager * resMgr, size_t budget, int tailSize = 64);
+
+		/** Destructor. */
+		~TextureStreamer();
+
+		/**
+		 * Sets video memory budget.
+		 * Textures are evicted to fit into the new budget on the next call to update().
+		 * @param bytes Budget in bytes.
+		 */
+		inline void setBudget(size_t bytes) { m_Budget = bytes; }
+
+		/**
+		 * Returns video memory budget.
+		 * @return Budget in bytes.
+		 */
+		inline size_t budget() const { return m_Budget; }
+
+		/**
+		 * Sets number of frames after the last request during which mipmap levels of the texture are protected
+		 * from eviction.
+		 * @param frames Number of frames (default is 30).
+		 */
+		inline void setRetainFrames(unsigned frames) { m_RetainFrames = frames; }
+
+		/**
+		 * Loads texture with the specified name and registers it for streaming.
+		 * KTX, PKM and DDS files use mipmap levels they contain. For other images mipmap levels are built with
+		 * the mipmap builder of the resource manager (see GL::ResourceManager::mipBuilder). Packed format of the
+		 * resource manager is applied to the texture.
+		 * @param name Name of the texture file.
+		 * @return Pointer to the texture.
+		 * @throws std::runtime_error if texture could not be loaded.
+		 */
+		TexturePtr load(const std::string & name);
+
+		/**
+		 * Registers texture for streaming and uploads its mip tail.
+		 * @param texture Texture.
+		 * @param image Source image (level 0).
+		 * @param mipmaps Source levels starting with level 1 (see GL::MipBuilder::build).
+		 */
+		void add(const TexturePtr & texture, const Stb::ImagePtr & image, const MipLevelsPtr & mipmaps);
+
+		/**
+		 * Registers texture for streaming and uploads its mip tail.
+		 * @param texture Texture.
+		 * @param image Compressed source image.
+		 */
+		void add(const TexturePtr & texture, const CompressedImagePtr & image);
+
+		/**
+		 * Unregisters texture. Uploaded levels are kept in the texture.
+		 * @param texture Texture.
+		 */
+		void remove(const TexturePtr & texture);
+
+		/**
+		 * Requests the specified mipmap level of the texture for the current frame.
+		 * If texture is requested several times within the frame, the most detailed level is used.
+		 * @param texture Texture.
+		 * @param level Index of the most detailed mipmap level needed (0 is the full resolution).
+		 */
+		void request(const TexturePtr & texture, int level);
+
+		/**
+		 * Uploads requested mipmap levels and evicts levels that do not fit into the budget.
+		 * This method should be called once per frame on the thread owning the OpenGL context.
+		 * @param maxUploadBytes Maximum number of bytes to upload. At least one texture is always processed.
+		 */
+		void update(size_t maxUploadBytes = SIZE_MAX);
+
+		/**
+		 * Returns index of the most detailed source level currently uploaded into the texture.
+		 * @param texture Texture.
+		 * @return Index of the level or -1 if texture is not registered.
+		 */
+		int residentLevel(const TexturePtr & texture) const;
+
+		/**
+		 * Returns number of registered textures.
+		 * @return Number of textures.
+		 */
+		inline size_t numTextures() const { return m_Entries.size(); }
+
+		/**
+		 * Returns estimated amount of video memory used by streamed textures.
+		 * @return Memory usage in bytes.
+		 */
+		inline size_t residentBytes() const { return m_ResidentBytes; }
+
+		/**
+		 * Returns total number of bytes uploaded into streamed textures.
+		 * @return Number of bytes.
+		 */
+		inline size_t uploadedBytes() const { return m_UploadedBytes; }
+
+		/**
+		 * Returns total number of evictions.
+		 * @return Number of evictions.
+		 */
+		inline size_t evictions() const { return m_Evictions; }
+
+		/**
+		 * Calculates mipmap level needed to draw the texture with the specified size on screen.
+		 * @param textureWidth Width of the texture (level 0) in pixels.
+		 * @param textureHeight Height of the texture (level 0) in pixels.
+		 * @param screenWidth Width of the textured area on screen in pixels.
+		 * @param screenHeight Height of the textured area on screen in pixels.
+		 * @return Index of the mipmap level.
+		 */
+		static int levelForScreenSize(int textureWidth, int textureHeight, float screenWidth, float screenHeight);
+
+	private:
+		struct Entry
+		{
+			TextureWeakPtr texture;
+			Stb::ImagePtr image;
+			MipLevelsPtr mipmaps;
+			CompressedImagePtr compressed;
+			std::vector<size_t> chainBytes;
+			int tailLevel;
+			int residentLevel;
+			int requestedLevel;
+			int wantedLevel;
+			uint64_t lastRequestFrame;
+		};
+
+		ResourceManager * m_ResourceManager;
+		std::unordered_map<Texture *, Entry> m_Entries;
+		std::vector<Entry *> m_Candidates;
+		size_t m_Budget;
+		size_t m_ResidentBytes;
+		size_t m_UploadedBytes;
+		size_t m_Evictions;
+		uint64_t m_Frame;
+		unsigned m_RetainFrames;
+		int m_TailSize;
+
+		void addEntry(const TexturePtr & texture, Entry & entry);
+		void setResidentLevel(Entry & entry, int level);
+		bool evictFor(size_t bytes, const Entry * requester);
+
+		TextureStreamer(const TextureStreamer &) = delete;
+		TextureStreamer & operator=(const TextureStreamer &) = delete;
+	};
+}
+
+#endif
@@ -0,0 +1,87 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "gl_thread_pool.h"
+#include <iostream>
+#include <exception>
+
+GL::ThreadPool::ThreadPool(size_t numThreads)
+	: m_Shutdown(false)
+{
+	if (numThreads == 0)
+	{
+		unsigned cores = std::thread::hardware_concurrency();
+		numThreads = (cores > 1 ? cores - 1 : 1);
+	}
+
+	m_Threads.reserve(numThreads);
+	for (size_t i = 0; i < numThreads; i++)
+		m_Threads.push_back(std::thread(&ThreadPool::run, this));
+}
+
+GL::ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Shutdown = true;
+		m_Tasks.clear();
+	}
+
+	m_Condition.notify_all();
+
+	for (std::thread & thread : m_Threads)
+		thread.join();
+}
+
+void GL::ThreadPool::enqueue(Task task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Tasks.push_back(std::move(task));
+	}
+	m_Condition.notify_one();
+}
+
+void GL::ThreadPool::run()
+{
+	for (;;)
+	{
+		Task task;
+
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Condition.wait(lock, [this]() { return m_Shutdown || !m_Tasks.empty(); });
+			if (m_Shutdown)
+				return;
+			task = std::move(m_Tasks.front());
+			m_Tasks.pop_front();
+		}
+
+		try {
+			task();
+		} catch (const std::exception & e) {
+			std::clog << "Unhandled exception in the worker thread: " << e.what() << std::endl;
+		} catch (...) {
+			std::clog << "Unhandled exception in the worker thread." << std::endl;
+		}
+	}
+}
@@ -0,0 +1,85 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __95e633510b06063429b36536647c4f4d__
+#define __95e633510b06063429b36536647c4f4d__
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+namespace GL
+{
+	/**
+	 * Simple pool of worker threads.
+	 * This class is used by GL::ResourceManager to perform file I/O and image decoding in background.
+	 * Tasks executed by the pool must not call any OpenGL functions.
+	 */
+	class ThreadPool
+	{
+	public:
+		/** Task to be executed by the pool. */
+		typedef std::function<void()> Task;
+
+		/**
+		 * Constructor.
+		 * @param numThreads Number of worker threads. Pass zero to select number of threads based
+		 * on the number of available CPU cores.
+		 */
+		explicit ThreadPool(size_t numThreads = 0);
+
+		/**
+		 * Destructor.
+		 * Waits for tasks that are currently running. Tasks that have not been started yet are discarded.
+		 */
+		~ThreadPool();
+
+		/**
+		 * Returns number of worker threads in the pool.
+		 * @return Number of worker threads.
+		 */
+		inline size_t numThreads() const { return m_Threads.size(); }
+
+		/**
+		 * Schedules the specified task for execution on one of the worker threads.
+		 * @param task Task to execute.
+		 */
+		void enqueue(Task task);
+
+	private:
+		std::vector<std::thread> m_Threads;
+		std::deque<Task> m_Tasks;
+		std::mutex m_Mutex;
+		std::condition_variable m_Condition;
+		bool m_Shutdown;
+
+		void run();
+
+		ThreadPool(const ThreadPool &) = delete;
+		ThreadPool & operator=(const ThreadPool &) = delete;
+	};
+}
+
+#endif
@@ -38,6 +38,9 @@ namespace GL
 	/**
 	 * Convenient C++ wrapper for uniform shader variables.
 	 * This class caches location of the uniform.
+	 *
+	 * If uniform value shadowing is enabled for the program (see GL::Program::setUniformShadowEnabled),
+	 * setters skip OpenGL calls when value of the uniform has not changed.
 	 */
 	class Uniform
 	{
@@ -57,7 +60,26 @@ namespace GL
 			: m_Program(program),
 			  m_Name(name)
 		{
-			m_Location = program->getUniformLocation(name);
+			m_Location = program->uniformLocation(name);
+		}
+
+		/**
+		 * Constructor.
+		 * Location of the uniform is taken from the reflection table of the program without calling OpenGL.
+		 * @param program Pointer to the program.
+		 * @param hash Hash of the name of the uniform.
+		 * @see GL::Program::findUniform.
+		 */
+		inline Uniform(const GL::ProgramPtr & program, GL::NameHash hash)
+			: m_Program(program),
+			  m_Location(-1)
+		{
+			const Program::Variable * variable = program->findUniform(hash);
+			if (LIKELY(variable))
+			{
+				m_Name = variable->name;
+				m_Location = variable->location;
+			}
 		}
 
 		/** Destructor. */
@@ -96,7 +118,7 @@ namespace GL
 		 */
 		inline void set1f(Float value)
 		{
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&value, sizeof(value)))
 				GL::uniform1f(m_Location, value);
 		}
 
@@ -107,7 +129,7 @@ namespace GL
 		 */
 		inline void set1fv(const Float * values, Sizei length)
 		{
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(values, length * sizeof(Float)))
 				GL::uniform1fv(m_Location, length, values);
 		}
 
@@ -117,7 +139,7 @@ namespace GL
 		 */
 		inline void set1fv(const std::vector<Float> & values)
 		{
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(values.data(), values.size() * sizeof(Float)))
 				GL::uniform1fv(m_Location, Sizei(values.size()), values.data());
 		}
 
@@ -127,7 +149,7 @@ namespace GL
 		 */
 		inline void set1i(Int value)
 		{
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&value, sizeof(value)))
 				GL::uniform1i(m_Location, value);
 		}
 
@@ -138,7 +160,7 @@ namespace GL
 		 */
 		inline void set1iv(const Int * values, Sizei length)
 		{
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(values, length * sizeof(Int)))
 				GL::uniform1iv(m_Location, length, values);
 		}
 
@@ -148,7 +170,7 @@ namespace GL
 		 */
 		inline void set1iv(const std::vector<Int> & values)
 		{
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(values.data(), values.size() * sizeof(Int)))
 				GL::uniform1iv(m_Location, Sizei(values.size()), values.data());
 		}
 
@@ -159,7 +181,8 @@ namespace GL
 		 */
 		inline void set2f(Float x, Float y)
 		{
-			if (LIKELY(m_Location >= 0))
+			const Float values[] = { x, y };
+			if (LIKELY(m_Location >= 0) && valueChanged(values, sizeof(values)))
 				GL::uniform2f(m_Location, x, y);
 		}
 
@@ -171,7 +194,7 @@ namespace GL
 		inline void set2f(const glm::vec2 & value)
 		{
 			STATIC_ASSERT(sizeof(value.x) == sizeof(Float));
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&value[0], 2 * sizeof(Float)))
 				GL::uniform2fv(m_Location, 1, &value[0]);
 		}
 	  #endif
@@ -183,7 +206,7 @@ namespace GL
 		 */
 		inline void set2fv(const Float * values, Sizei length)
 		{
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(values, length * 2 * sizeof(Float)))
 				GL::uniform2fv(m_Location, length, values);
 		}
 
@@ -196,7 +219,7 @@ namespace GL
 		inline void set2fv(const glm::vec2 * values, Sizei length)
 		{
 			STATIC_ASSERT(sizeof(values[0].x) == sizeof(Float));
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&values[0][0], length * 2 * sizeof(Float)))
 				GL::uniform2fv(m_Location, length, &values[0][0]);
 		}
 	  #endif
@@ -207,7 +230,7 @@ namespace GL
 		 */
 		inline void set2fv(const std::vector<Float> & values)
 		{
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(values.data(), (values.size() / 2) * 2 * sizeof(Float)))
 				GL::uniform2fv(m_Location, Sizei(values.size() / 2), values.data());
 		}
 
@@ -219,7 +242,7 @@ namespace GL
 		inline void set2fv(const std::vector<glm::vec2> & values)
 		{
 			STATIC_ASSERT(sizeof(values[0].x) == sizeof(Float));
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&values[0][0], values.size() * 2 * sizeof(Float)))
 				GL::uniform2fv(m_Location, Sizei(values.size()), &values[0][0]);
 		}
 	  #endif
@@ -231,7 +254,8 @@ namespace GL
 		 */
 		inline void set2i(Int x, Int y)
 		{
-			if (LIKELY(m_Location >= 0))
+			const Int values[] = { x, y };
+			if (LIKELY(m_Location >= 0) && valueChanged(values, sizeof(values)))
 				GL::uniform2i(m_Location, x, y);
 		}
 
@@ -243,7 +267,7 @@ namespace GL
 		inline void set2i(const glm::ivec2 & value)
 		{
 			STATIC_ASSERT(sizeof(value.x) == sizeof(Int));
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&value[0], 2 * sizeof(Int)))
 				GL::uniform2iv(m_Location, 1, &value[0]);
 		}
 	  #endif
@@ -255,7 +279,7 @@ namespace GL
 		 */
 		inline void set2iv(const Int * values, Sizei length)
 		{
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(values, length * 2 * sizeof(Int)))
 				GL::uniform2iv(m_Location, length, values);
 		}
 
@@ -268,7 +292,7 @@ namespace GL
 		inline void set2iv(const glm::ivec2 * values, Sizei length)
 		{
 			STATIC_ASSERT(sizeof(values[0].x) == sizeof(Int));
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&values[0][0], length * 2 * sizeof(Int)))
 				GL::uniform2iv(m_Location, length, &values[0][0]);
 		}
 	  #endif
@@ -279,7 +303,7 @@ namespace GL
 		 */
 		inline void set2iv(const std::vector<Int> & values)
 		{
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(values.data(), (values.size() / 2) * 2 * sizeof(Int)))
 				GL::uniform2iv(m_Location, Sizei(values.size() / 2), values.data());
 		}
 
@@ -291,7 +315,7 @@ namespace GL
 		inline void set2iv(const std::vector<glm::ivec2> & values)
 		{
 			STATIC_ASSERT(sizeof(values[0].x) == sizeof(Int));
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&values[0][0], values.size() * 2 * sizeof(Int)))
 				GL::uniform2iv(m_Location, Sizei(values.size()), &values[0][0]);
 		}
 	  #endif
@@ -304,7 +328,8 @@ namespace GL
 		 */
 		inline void set3f(Float x, Float y, Float z)
 		{
-			if (LIKELY(m_Location >= 0))
+			const Float values[] = { x, y, z };
+			if (LIKELY(m_Location >= 0) && valueChanged(values, sizeof(values)))
 				GL::uniform3f(m_Location, x, y, z);
 		}
 
@@ -316,7 +341,7 @@ namespace GL
 		inline void set3f(const glm::vec3 & value)
 		{
 			STATIC_ASSERT(sizeof(value.x) == sizeof(Float));
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&value[0], 3 * sizeof(Float)))
 				GL::uniform3fv(m_Location, 1, &value[0]);
 		}
 	  #endif
@@ -328,7 +353,7 @@ namespace GL
 		 */
 		inline void set3fv(const Float * values, Sizei length)
 		{
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(values, length * 3 * sizeof(Float)))
 				GL::uniform3fv(m_Location, length, values);
 		}
 
@@ -341,7 +366,7 @@ namespace GL
 		inline void set3fv(const glm::vec3 * values, Sizei length)
 		{
 			STATIC_ASSERT(sizeof(values[0].x) == sizeof(Float));
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&values[0][0], length * 3 * sizeof(Float)))
 				GL::uniform3fv(m_Location, length, &values[0][0]);
 		}
 	  #endif
@@ -352,7 +377,7 @@ namespace GL
 		 */
 		inline void set3fv(const std::vector<Float> & values)
 		{
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(values.data(), (values.size() / 3) * 3 * sizeof(Float)))
 				GL::uniform3fv(m_Location, Sizei(values.size() / 3), values.data());
 		}
 
@@ -364,7 +389,7 @@ namespace GL
 		inline void set3fv(const std::vector<glm::vec3> & values)
 		{
 			STATIC_ASSERT(sizeof(values[0].x) == sizeof(Float));
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&values[0][0], values.size() * 3 * sizeof(Float)))
 				GL::uniform3fv(m_Location, Sizei(values.size()), &values[0][0]);
 		}
 	  #endif
@@ -377,7 +402,8 @@ namespace GL
 		 */
 		inline void set3i(Int x, Int y, Int z)
 		{
-			if (LIKELY(m_Location >= 0))
+			const Int values[] = { x, y, z };
+			if (LIKELY(m_Location >= 0) && valueChanged(values, sizeof(values)))
 				GL::uniform3i(m_Location, x, y, z);
 		}
 
@@ -389,7 +415,7 @@ namespace GL
 		inline void set3i(const glm::ivec3 & value)
 		{
 			STATIC_ASSERT(sizeof(value.x) == sizeof(Int));
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&value[0], 3 * sizeof(Int)))
 				GL::uniform3iv(m_Location, 1, &value[0]);
 		}
 	  #endif
@@ -401,7 +427,7 @@ namespace GL
 		 */
 		inline void set3iv(const Int * values, Sizei length)
 		{
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(values, length * 3 * sizeof(Int)))
 				GL::uniform3iv(m_Location, length, values);
 		}
 
@@ -414,7 +440,7 @@ namespace GL
 		inline void set3iv(const glm::ivec3 * values, Sizei length)
 		{
 			STATIC_ASSERT(sizeof(values[0].x) == sizeof(Int));
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&values[0][0], length * 3 * sizeof(Int)))
 				GL::uniform3iv(m_Location, length, &values[0][0]);
 		}
 	  #endif
@@ -425,7 +451,7 @@ namespace GL
 		 */
 		inline void set3iv(const std::vector<Int> & values)
 		{
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(values.data(), (values.size() / 3) * 3 * sizeof(Int)))
 				GL::uniform3iv(m_Location, Sizei(values.size() / 3), values.data());
 		}
 
@@ -437,7 +463,7 @@ namespace GL
 		inline void set3iv(const std::vector<glm::ivec3> & values)
 		{
 			STATIC_ASSERT(sizeof(values[0].x) == sizeof(Int));
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&values[0][0], values.size() * 3 * sizeof(Int)))
 				GL::uniform3iv(m_Location, Sizei(values.size()), &values[0][0]);
 		}
 	  #endif
@@ -451,7 +477,8 @@ namespace GL
 		 */
 		inline void set4f(Float x, Float y, Float z, Float w)
 		{
-			if (LIKELY(m_Location >= 0))
+			const Float values[] = { x, y, z, w };
+			if (LIKELY(m_Location >= 0) && valueChanged(values, sizeof(values)))
 				GL::uniform4f(m_Location, x, y, z, w);
 		}
 
@@ -463,7 +490,7 @@ namespace GL
 		inline void set4f(const glm::vec4 & value)
 		{
 			STATIC_ASSERT(sizeof(value.x) == sizeof(Float));
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&value[0], 4 * sizeof(Float)))
 				GL::uniform4fv(m_Location, 1, &value[0]);
 		}
 
@@ -474,7 +501,7 @@ namespace GL
 		inline void set4f(const glm::quat & value)
 		{
 			STATIC_ASSERT(sizeof(value.x) == sizeof(Float));
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&value[0], 4 * sizeof(Float)))
 				GL::uniform4fv(m_Location, 1, &value[0]);
 		}
 	  #endif
@@ -486,7 +513,7 @@ namespace GL
 		 */
 		inline void set4fv(const Float * values, Sizei length)
 		{
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(values, length * 4 * sizeof(Float)))
 				GL::uniform4fv(m_Location, length, values);
 		}
 
@@ -499,7 +526,7 @@ namespace GL
 		inline void set4fv(const glm::vec4 * values, Sizei length)
 		{
 			STATIC_ASSERT(sizeof(values[0].x) == sizeof(Float));
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&values[0][0], length * 4 * sizeof(Float)))
 				GL::uniform4fv(m_Location, length, &values[0][0]);
 		}
 
@@ -511,7 +538,7 @@ namespace GL
 		inline void set4fv(const glm::quat * values, Sizei length)
 		{
 			STATIC_ASSERT(sizeof(values[0].x) == sizeof(Float));
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&values[0][0], length * 4 * sizeof(Float)))
 				GL::uniform4fv(m_Location, length, &values[0][0]);
 		}
 	  #endif
@@ -522,7 +549,7 @@ namespace GL
 		 */
 		inline void set4fv(const std::vector<Float> & values)
 		{
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(values.data(), (values.size() / 4) * 4 * sizeof(Float)))
 				GL::uniform4fv(m_Location, Sizei(values.size() / 4), values.data());
 		}
 
@@ -534,7 +561,7 @@ namespace GL
 		inline void set4fv(const std::vector<glm::vec4> & values)
 		{
 			STATIC_ASSERT(sizeof(values[0].x) == sizeof(Float));
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&values[0][0], values.size() * 4 * sizeof(Float)))
 				GL::uniform4fv(m_Location, Sizei(values.size()), &values[0][0]);
 		}
 
@@ -545,7 +572,7 @@ namespace GL
 		inline void set4fv(const std::vector<glm::quat> & values)
 		{
 			STATIC_ASSERT(sizeof(values[0].x) == sizeof(Float));
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&values[0][0], values.size() * 4 * sizeof(Float)))
 				GL::uniform4fv(m_Location, Sizei(values.size()), &values[0][0]);
 		}
 	  #endif
@@ -559,7 +586,8 @@ namespace GL
 		 */
 		inline void set4i(Int x, Int y, Int z, Int w)
 		{
-			if (LIKELY(m_Location >= 0))
+			const Int values[] = { x, y, z, w };
+			if (LIKELY(m_Location >= 0) && valueChanged(values, sizeof(values)))
 				GL::uniform4i(m_Location, x, y, z, w);
 		}
 
@@ -571,7 +599,7 @@ namespace GL
 		inline void set4i(const glm::ivec4 & value)
 		{
 			STATIC_ASSERT(sizeof(value.x) == sizeof(Int));
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&value[0], 4 * sizeof(Int)))
 				GL::uniform4iv(m_Location, 1, &value[0]);
 		}
 	  #endif
@@ -583,7 +611,7 @@ namespace GL
 		 */
 		inline void set4iv(const Int * values, Sizei length)
 		{
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(values, length * 4 * sizeof(Int)))
 				GL::uniform4iv(m_Location, length, values);
 		}
 
@@ -596,7 +624,7 @@ namespace GL
 		inline void set4iv(const glm::ivec4 * values, Sizei length)
 		{
 			STATIC_ASSERT(sizeof(values[0].x) == sizeof(Int));
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&values[0][0], length * 4 * sizeof(Int)))
 				GL::uniform4iv(m_Location, length, &values[0][0]);
 		}
 	  #endif
@@ -607,7 +635,7 @@ namespace GL
 		 */
 		inline void set4iv(const std::vector<Int> & values)
 		{
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(values.data(), (values.size() / 4) * 4 * sizeof(Int)))
 				GL::uniform4iv(m_Location, Sizei(values.size() / 4), values.data());
 		}
 
@@ -619,7 +647,7 @@ namespace GL
 		inline void set4iv(const std::vector<glm::ivec4> & values)
 		{
 			STATIC_ASSERT(sizeof(values[0].x) == sizeof(Int));
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&values[0][0], values.size() * 4 * sizeof(Int)))
 				GL::uniform4iv(m_Location, Sizei(values.size()), &values[0][0]);
 		}
 	  #endif
@@ -631,7 +659,7 @@ namespace GL
 		 */
 		inline void setMatrix2fv(const Float * values, Sizei count = 1)
 		{
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(values, count * 4 * sizeof(Float)))
 				GL::uniformMatrix2fv(m_Location, count, GL::FALSE, values);
 		}
 
@@ -643,7 +671,7 @@ namespace GL
 		 */
 		inline void setTransposedMatrix2fv(const Float * values, Sizei count = 1)
 		{
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(values, count * 4 * sizeof(Float), true))
 				GL::uniformMatrix2fv(m_Location, count, GL::TRUE, values);
 		}
 
@@ -655,7 +683,7 @@ namespace GL
 		inline void setMatrix2fv(const glm::mat2 & value)
 		{
 			STATIC_ASSERT(sizeof(value[0][0]) == sizeof(Float));
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&value[0][0], 4 * sizeof(Float)))
 				GL::uniformMatrix2fv(m_Location, 1, GL::FALSE, &value[0][0]);
 		}
 
@@ -667,7 +695,7 @@ namespace GL
 		inline void setMatrix2fv(const glm::mat2 * values, Sizei count = 1)
 		{
 			STATIC_ASSERT(sizeof(values[0][0][0]) == sizeof(Float));
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&values[0][0][0], count * 4 * sizeof(Float)))
 				GL::uniformMatrix2fv(m_Location, count, GL::FALSE, &values[0][0][0]);
 		}
 
@@ -678,7 +706,7 @@ namespace GL
 		inline void setMatrix2fv(const std::vector<glm::mat2> & values)
 		{
 			STATIC_ASSERT(sizeof(values[0][0][0]) == sizeof(Float));
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&values[0][0][0], values.size() * 4 * sizeof(Float)))
 				GL::uniformMatrix2fv(m_Location, Sizei(values.size()), GL::FALSE, &values[0][0][0]);
 		}
 	  #endif
@@ -690,7 +718,7 @@ namespace GL
 		 */
 		inline void setMatrix3fv(const Float * values, Sizei count = 1)
 		{
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(values, count * 9 * sizeof(Float)))
 				GL::uniformMatrix3fv(m_Location, count, GL::FALSE, values);
 		}
 
@@ -702,7 +730,7 @@ namespace GL
 		 */
 		inline void setTransposedMatrix3fv(const Float * values, Sizei count = 1)
 		{
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(values, count * 9 * sizeof(Float), true))
 				GL::uniformMatrix3fv(m_Location, count, GL::TRUE, values);
 		}
 
@@ -714,7 +742,7 @@ namespace GL
 		inline void setMatrix3fv(const glm::mat3 & value)
 		{
 			STATIC_ASSERT(sizeof(value[0][0]) == sizeof(Float));
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&value[0][0], 9 * sizeof(Float)))
 				GL::uniformMatrix3fv(m_Location, 1, GL::FALSE, &value[0][0]);
 		}
 
@@ -726,7 +754,7 @@ namespace GL
 		inline void setMatrix3fv(const glm::mat3 * values, Sizei count = 1)
 		{
 			STATIC_ASSERT(sizeof(values[0][0][0]) == sizeof(Float));
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&values[0][0][0], count * 9 * sizeof(Float)))
 				GL::uniformMatrix3fv(m_Location, count, GL::FALSE, &values[0][0][0]);
 		}
 
@@ -737,7 +765,7 @@ namespace GL
 		inline void setMatrix3fv(const std::vector<glm::mat3> & values)
 		{
 			STATIC_ASSERT(sizeof(values[0][0][0]) == sizeof(Float));
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&values[0][0][0], values.size() * 9 * sizeof(Float)))
 				GL::uniformMatrix3fv(m_Location, Sizei(values.size()), GL::FALSE, &values[0][0][0]);
 		}
 	  #endif
@@ -749,7 +777,7 @@ namespace GL
 		 */
 		inline void setMatrix4fv(const Float * values, Sizei count = 1)
 		{
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(values, count * 16 * sizeof(Float)))
 				GL::uniformMatrix4fv(m_Location, count, GL::FALSE, values);
 		}
 
@@ -761,7 +789,7 @@ namespace GL
 		 */
 		inline void setTransposedMatrix4fv(const Float * values, Sizei count = 1)
 		{
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(values, count * 16 * sizeof(Float), true))
 				GL::uniformMatrix4fv(m_Location, count, GL::TRUE, values);
 		}
 
@@ -773,7 +801,7 @@ namespace GL
 		inline void setMatrix4fv(const glm::mat4 & value)
 		{
 			STATIC_ASSERT(sizeof(value[0][0]) == sizeof(Float));
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&value[0][0], 16 * sizeof(Float)))
 				GL::uniformMatrix4fv(m_Location, 1, GL::FALSE, &value[0][0]);
 		}
 
@@ -785,7 +813,7 @@ namespace GL
 		inline void setMatrix4fv(const glm::mat4 * values, Sizei count = 1)
 		{
 			STATIC_ASSERT(sizeof(values[0][0][0]) == sizeof(Float));
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&values[0][0][0], count * 16 * sizeof(Float)))
 				GL::uniformMatrix4fv(m_Location, count, GL::FALSE, &values[0][0][0]);
 		}
 
@@ -796,7 +824,7 @@ namespace GL
 		inline void setMatrix4fv(const std::vector<glm::mat4> & values)
 		{
 			STATIC_ASSERT(sizeof(values[0][0][0]) == sizeof(Float));
-			if (LIKELY(m_Location >= 0))
+			if (LIKELY(m_Location >= 0) && valueChanged(&values[0][0][0], values.size() * 16 * sizeof(Float)))
 				GL::uniformMatrix4fv(m_Location, Sizei(values.size()), GL::FALSE, &values[0][0][0]);
 		}
 	  #endif
@@ -805,6 +833,11 @@ namespace GL
 		GL::ProgramPtr m_Program;
 		std::string m_Name;
 		int m_Location;
+
+		inline bool valueChanged(const void * data, size_t size, bool transposed = false) const
+		{
+			return m_Program->uniformValueChanged(m_Location, data, size, transposed);
+		}
 	};
 }
 
@@ -0,0 +1,91 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "gl_upload_scheduler.h"
+
+GL::UploadScheduler::UploadScheduler()
+	: m_PendingBytes(0),
+	  m_UploadedBytes(0)
+{
+}
+
+GL::UploadScheduler::~UploadScheduler()
+{
+}
+
+void GL::UploadScheduler::enqueue(size_t bytes, Task task)
+{
+	Entry entry;
+	entry.bytes = bytes;
+	entry.task = std::move(task);
+	m_Queue.push_back(std::move(entry));
+	m_PendingBytes += bytes;
+}
+
+size_t GL::UploadScheduler::pump(std::chrono::microseconds timeBudget, size_t byteBudget)
+{
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point deadline = Clock::now() + timeBudget;
+	size_t numUploads = 0;
+	size_t numBytes = 0;
+
+	while (!m_Queue.empty())
+	{
+		if (numUploads > 0)
+		{
+			if (byteBudget > 0 && numBytes + m_Queue.front().bytes > byteBudget)
+				break;
+			if (Clock::now() >= deadline)
+				break;
+		}
+
+		numBytes += m_Queue.front().bytes;
+		runFront();
+		++numUploads;
+	}
+
+	return numUploads;
+}
+
+size_t GL::UploadScheduler::flush()
+{
+	size_t numUploads = 0;
+	for (; !m_Queue.empty(); ++numUploads)
+		runFront();
+	return numUploads;
+}
+
+void GL::UploadScheduler::clear()
+{
+	m_Queue.clear();
+	m_PendingBytes = 0;
+}
+
+void GL::UploadScheduler::runFront()
+{
+	// Task is removed from the queue before execution so that it could safely enqueue more uploads
+	Entry entry = std::move(m_Queue.front());
+	m_Queue.pop_front();
+	m_PendingBytes -= entry.bytes;
+	m_UploadedBytes += entry.bytes;
+	entry.task();
+}
@@ -0,0 +1,115 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __b36223a238f7d680e68f35d5f6bf1936__
+#define __b36223a238f7d680e68f35d5f6bf1936__
+
+#include <functional>
+#include <chrono>
+#include <deque>
+
+namespace GL
+{
+	/**
+	 * Queue of deferred uploads of data into OpenGL.
+	 *
+	 * Uploads are executed in the order they were queued by the pump() method, which limits amount of work
+	 * done per call by the time and byte budgets. This allows to spread uploads of large amounts of data
+	 * over several frames.
+	 *
+	 * Instance of this class is owned by the GL::ResourceManager.
+	 * @see GL::ResourceManager::pumpUploads.
+	 */
+	class UploadScheduler
+	{
+	public:
+		/** Upload task. */
+		typedef std::function<void()> Task;
+
+		/** Constructor. */
+		UploadScheduler();
+
+		/** Destructor. Discards all pending uploads. */
+		~UploadScheduler();
+
+		/**
+		 * Adds upload into the queue.
+		 * @param bytes Number of bytes uploaded by the task (used for budgeting and progress reporting).
+		 * @param task Task that performs the upload.
+		 */
+		void enqueue(size_t bytes, Task task);
+
+		/**
+		 * Executes pending uploads until either time or byte budget is exhausted.
+		 * At least one upload is always executed (if queue is not empty) to guarantee progress.
+		 * @param timeBudget Maximum time to spend.
+		 * @param byteBudget Maximum number of bytes to upload (zero means no limit).
+		 * @return Number of executed uploads.
+		 */
+		size_t pump(std::chrono::microseconds timeBudget, size_t byteBudget = 0);
+
+		/**
+		 * Executes all pending uploads.
+		 * @return Number of executed uploads.
+		 */
+		size_t flush();
+
+		/** Discards all pending uploads. */
+		void clear();
+
+		/**
+		 * Returns number of pending uploads.
+		 * @return Number of pending uploads.
+		 */
+		inline size_t pendingUploads() const { return m_Queue.size(); }
+
+		/**
+		 * Returns number of bytes in pending uploads.
+		 * @return Number of bytes still queued for upload.
+		 */
+		inline size_t pendingBytes() const { return m_PendingBytes; }
+
+		/**
+		 * Returns total number of bytes uploaded by this scheduler.
+		 * @return Number of uploaded bytes.
+		 */
+		inline size_t uploadedBytes() const { return m_UploadedBytes; }
+
+	private:
+		struct Entry
+		{
+			size_t bytes;
+			Task task;
+		};
+
+		std::deque<Entry> m_Queue;
+		size_t m_PendingBytes;
+		size_t m_UploadedBytes;
+
+		void runFront();
+
+		UploadScheduler(const UploadScheduler &) = delete;
+		UploadScheduler & operator=(const UploadScheduler &) = delete;
+	};
+}
+
+#endif
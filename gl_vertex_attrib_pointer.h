@@ -25,6 +25,7 @@
 
 #include <yip-imports/gl.h>
 #include "gl_attrib.h"
+#include "gl_state_cache.h"
 
 namespace GL
 {
@@ -66,7 +67,7 @@ namespace GL
 			if (LIKELY(m_Index >= 0))
 			{
 				vertexAttribPointer(m_Index, size, type, normalized, stride, pointer);
-				enableVertexAttribArray(m_Index);
+				StateCache::current().enableVertexAttribArray(m_Index);
 			}
 		}
 
@@ -93,7 +94,7 @@ namespace GL
 			if (LIKELY(m_Index >= 0))
 			{
 				vertexAttribPointer(m_Index, size, type, normalized, stride, pointer);
-				enableVertexAttribArray(m_Index);
+				StateCache::current().enableVertexAttribArray(m_Index);
 			}
 		}
 
@@ -101,7 +102,7 @@ namespace GL
 		inline ~VertexAttribPointer()
 		{
 			if (LIKELY(m_Index >= 0))
-				disableVertexAttribArray(m_Index);
+				StateCache::current().disableVertexAttribArray(m_Index);
 		}
 
 	private:
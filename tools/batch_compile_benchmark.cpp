@@ -0,0 +1,105 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Compares sequential and batched compilation of programs against the mock OpenGL implementation, which
+// simulates a driver compiling shaders on background threads.
+//
+// Usage: batch_compile_benchmark [programs] [compile-us] [link-us] [driver-threads]
+//
+#include "mock_gl.h"
+#include "../gl_resource_manager.h"
+#include "../gl_program.h"
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+static const char g_ProgramSource[] =
+	"%vertex\n"
+	"attribute vec4 a_position;\n"
+	"void main() { gl_Position = a_position; }\n"
+	"%fragment\n"
+	"void main() { gl_FragColor = vec4(1.0); }\n";
+
+static double loadPrograms(size_t numPrograms, bool batch)
+{
+	GL::ResourceManager manager;
+	std::vector<GL::ProgramPtr> programs;
+	MockGL::resetCounters();
+
+	auto start = std::chrono::steady_clock::now();
+
+	if (batch)
+		manager.beginBatch();
+
+	for (size_t i = 0; i < numPrograms; i++)
+	{
+		GL::ProgramPtr program = manager.createProgram();
+		program->initFromSource(g_ProgramSource);
+		programs.push_back(program);
+	}
+
+	if (batch)
+		manager.endBatch();
+
+	// Using a program waits for the link anyway, so include this into the measurement
+	for (const GL::ProgramPtr & program : programs)
+	{
+		if (!program->linkStatus())
+			std::cerr << "program \"" << program->name() << "\" is not linked." << std::endl;
+	}
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+int main(int argc, char ** argv)
+{
+	size_t numPrograms = (argc > 1 ? size_t(atoi(argv[1])) : 50);
+	int compileLatency = (argc > 2 ? atoi(argv[2]) : 2000);
+	int linkLatency = (argc > 3 ? atoi(argv[3]) : 1000);
+	int numThreads = (argc > 4 ? atoi(argv[4]) : 4);
+
+	if (argc > 5 || numPrograms == 0 || compileLatency < 0 || linkLatency < 0 || numThreads <= 0)
+	{
+		std::cerr << "usage: " << argv[0] << " [programs] [compile-us] [link-us] [driver-threads]" << std::endl;
+		return 1;
+	}
+
+	MockGL::setCompileLatency(std::chrono::microseconds(compileLatency), std::chrono::microseconds(linkLatency));
+	std::cout << numPrograms << " programs, " << compileLatency << " us per shader, " << linkLatency
+		<< " us per program, " << numThreads << " driver threads." << std::endl;
+
+	MockGL::setCompilerThreads(size_t(numThreads));
+	double sequential = loadPrograms(numPrograms, false);
+	size_t sequentialStalls = MockGL::numStalls();
+
+	MockGL::setCompilerThreads(size_t(numThreads));
+	double batched = loadPrograms(numPrograms, true);
+	size_t batchedStalls = MockGL::numStalls();
+
+	std::cout << "Sequential: " << sequential << " ms, " << sequentialStalls << " stalls." << std::endl;
+	std::cout << "Batched:    " << batched << " ms, " << batchedStalls << " stalls." << std::endl;
+	std::cout << "Speedup:    " << sequential / batched << 'x' << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,59 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __995723129ebe42aa8b6700cc35d6f71f__
+#define __995723129ebe42aa8b6700cc35d6f71f__
+
+#include <iostream>
+
+/**
+ * Checks the condition and reports the failed check with its location without aborting the test.
+ * @param condition Condition to check.
+ */
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::cerr << __FILE__ << ':' << __LINE__ << ": check failed: " << #condition << std::endl; \
+			++g_Failures; \
+		} \
+	} while (0)
+
+/** Number of failed checks. */
+static int g_Failures;
+
+/**
+ * Prints the summary of checks.
+ * @return Exit code of the test (zero if all checks passed).
+ */
+static int reportChecks()
+{
+	if (g_Failures > 0)
+	{
+		std::cerr << g_Failures << " checks failed." << std::endl;
+		return 1;
+	}
+
+	std::cout << "All checks passed." << std::endl;
+	return 0;
+}
+
+#endif
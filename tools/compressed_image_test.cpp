@@ -0,0 +1,336 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Tests GL::CompressedImage on KTX, PKM and DDS files built in memory: detection of the containers, sizes and
+// offsets of mipmap levels, rejection of malformed files and software decoding of ETC1, DXT1 and DXT5 blocks.
+// No OpenGL context is needed.
+//
+// Usage: compressed_image_test
+//
+#include "check.h"
+#include "../gl_compressed_image.h"
+#include <iostream>
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstddef>
+
+// ETC1 block in the individual mode: base color (255, 0, 0), table 0, all pixels use modifier +2
+static const unsigned char g_ETC1RedBlock[8] = { 0xF0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+
+// ETC1 block in the differential mode: base color (132, 0, 0) for the left half
+static const unsigned char g_ETC1DarkRedBlock[8] = { 0x87, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00 };
+
+// DXT color block: color 0 is red, color 1 is blue; pixels 0, 1 and 2 use indices 0, 1 and 2
+static const unsigned char g_DXTColorBlock[8] = { 0x00, 0xF8, 0x1F, 0x00, 0x24, 0x00, 0x00, 0x00 };
+
+static void writeLE32(std::string & data, size_t offset, uint32_t value)
+{
+	for (int i = 0; i < 4; i++)
+		data[offset + size_t(i)] = char((value >> (8 * i)) & 0xFF);
+}
+
+static void writeBE32(std::string & data, size_t offset, uint32_t value)
+{
+	for (int i = 0; i < 4; i++)
+		data[offset + size_t(i)] = char((value >> (24 - 8 * i)) & 0xFF);
+}
+
+static void writeBE16(std::string & data, size_t offset, unsigned value)
+{
+	data[offset] = char((value >> 8) & 0xFF);
+	data[offset + 1] = char(value & 0xFF);
+}
+
+static void appendBlocks(std::string & data, const unsigned char * block, size_t blockSize, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		data.append(reinterpret_cast<const char *>(block), blockSize);
+}
+
+static bool throws(const std::string & data)
+{
+	try
+	{
+		GL::CompressedImage::loadFromData(data.data(), data.size());
+		return false;
+	}
+	catch (const std::runtime_error &)
+	{
+		return true;
+	}
+}
+
+// Builds DXT5 (or DXT1) file with the complete mipmap chain for the specified size
+static std::string makeDDS(int width, int height, int numLevels, bool dxt5)
+{
+	std::string data(128, '\0');
+	memcpy(&data[0], "DDS ", 4);
+	writeLE32(data, 4, 124);
+	writeLE32(data, 8, 0x1007 | 0x20000);
+	writeLE32(data, 12, uint32_t(height));
+	writeLE32(data, 16, uint32_t(width));
+	writeLE32(data, 28, uint32_t(numLevels));
+	writeLE32(data, 76, 32);
+	writeLE32(data, 80, 0x4);
+	memcpy(&data[84], (dxt5 ? "DXT5" : "DXT1"), 4);
+
+	// DXT5 alpha block: alpha 0 is 255, alpha 1 is 0, all pixels use index 0
+	const unsigned char alphaBlock[8] = { 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+	for (int level = 0; level < numLevels; level++)
+	{
+		int w = std::max(width >> level, 1), h = std::max(height >> level, 1);
+		for (int i = 0; i < ((w + 3) / 4) * ((h + 3) / 4); i++)
+		{
+			if (dxt5)
+				appendBlocks(data, alphaBlock, 8, 1);
+			appendBlocks(data, g_DXTColorBlock, 8, 1);
+		}
+	}
+
+	return data;
+}
+
+// Builds KTX file with ETC1 data and the specified number of mipmap levels of a 8x4 image
+static std::string makeKTX(int numLevels, bool bigEndian)
+{
+	const unsigned char signature[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+	auto write32 = (bigEndian ? writeBE32 : writeLE32);
+
+	std::string data(64, '\0');
+	memcpy(&data[0], signature, 12);
+	write32(data, 12, 0x04030201);
+	write32(data, 28, GL::CompressedImage::ETC1Format);
+	write32(data, 36, 8);
+	write32(data, 40, 4);
+	write32(data, 52, 1);
+	write32(data, 56, uint32_t(numLevels));
+	write32(data, 60, 8);
+	data.append(8, 'k');
+
+	for (int level = 0; level < numLevels; level++)
+	{
+		size_t numBlocks = (level == 0 ? 2 : 1);
+		size_t offset = data.size();
+		data.append(4, '\0');
+		write32(data, offset, uint32_t(numBlocks * 8));
+		appendBlocks(data, g_ETC1RedBlock, 8, numBlocks);
+	}
+
+	return data;
+}
+
+static void testDetection()
+{
+	std::string ktx = makeKTX(1, false), dds = makeDDS(4, 4, 1, true);
+	CHECK(GL::CompressedImage::isCompressedImage(ktx.data(), ktx.size()));
+	CHECK(GL::CompressedImage::isCompressedImage(dds.data(), dds.size()));
+	CHECK(GL::CompressedImage::isCompressedImage("PKM 10", 6));
+	CHECK(!GL::CompressedImage::isCompressedImage("\x89PNG\r\n\x1A\n", 8));
+	CHECK(!GL::CompressedImage::isCompressedImage("DD", 2));
+	CHECK(throws("BM not a compressed image"));
+
+	// Streams that could not contain a compressed image are left untouched
+	std::string contents;
+	std::istringstream png("\x89PNG");
+	CHECK(!GL::CompressedImage::loadFromStreamIfCompressed(png, contents));
+	CHECK(contents.empty() && png.tellg() == 0);
+
+	std::istringstream text("DDT file");
+	CHECK(!GL::CompressedImage::loadFromStreamIfCompressed(text, contents));
+	CHECK(contents == "DDT file");
+
+	std::istringstream stream(ktx);
+	CHECK(GL::CompressedImage::loadFromStreamIfCompressed(stream, contents) != nullptr);
+}
+
+static void testKTX()
+{
+	for (int bigEndian = 0; bigEndian < 2; bigEndian++)
+	{
+		std::string data = makeKTX(4, bigEndian != 0);
+		GL::CompressedImagePtr image = GL::CompressedImage::loadFromData(data.data(), data.size());
+		CHECK(image->internalFormat() == GL::CompressedImage::ETC1Format);
+		CHECK(!image->hasAlpha());
+		CHECK(image->numLevels() == 4);
+
+		// Key/value data is skipped, each level is preceded by its size
+		const int expected[][2] = { { 8, 4 }, { 4, 2 }, { 2, 1 }, { 1, 1 } };
+		const char * base = static_cast<const char *>(image->levelData(0));
+		size_t offset = 0;
+		for (int level = 0; level < std::min(image->numLevels(), 4); level++)
+		{
+			size_t size = (level == 0 ? 16 : 8);
+			CHECK(image->levelWidth(level) == expected[level][0]);
+			CHECK(image->levelHeight(level) == expected[level][1]);
+			CHECK(image->levelSize(level) == size);
+			CHECK(static_cast<const char *>(image->levelData(level)) - base == ptrdiff_t(offset));
+			CHECK(memcmp(image->levelData(level), g_ETC1RedBlock, 8) == 0);
+			offset += 4 + size;
+		}
+	}
+
+	std::string data = makeKTX(2, false);
+	CHECK(throws(data.substr(0, data.size() - 1)));
+	CHECK(throws(data.substr(0, 60)));
+
+	std::string badEndianness = data;
+	writeLE32(badEndianness, 12, 0x12345678);
+	CHECK(throws(badEndianness));
+
+	std::string uncompressed = data;
+	writeLE32(uncompressed, 16, 0x1401);
+	CHECK(throws(uncompressed));
+
+	std::string cubeMap = data;
+	writeLE32(cubeMap, 52, 6);
+	CHECK(throws(cubeMap));
+
+	std::string shortLevel = data;
+	writeLE32(shortLevel, 72, 8);
+	CHECK(throws(shortLevel));
+}
+
+static void testPKM()
+{
+	// 6x6 image is padded to 8x8 (2x2 blocks)
+	std::string data = "PKM 10";
+	data.append(10, '\0');
+	writeBE16(data, 8, 8);
+	writeBE16(data, 10, 8);
+	writeBE16(data, 12, 6);
+	writeBE16(data, 14, 6);
+	appendBlocks(data, g_ETC1RedBlock, 8, 1);
+	appendBlocks(data, g_ETC1DarkRedBlock, 8, 1);
+	appendBlocks(data, g_ETC1RedBlock, 8, 2);
+
+	GL::CompressedImagePtr image = GL::CompressedImage::loadFromData(data.data(), data.size());
+	CHECK(image->internalFormat() == GL::CompressedImage::ETC1Format);
+	CHECK(image->width() == 6 && image->height() == 6);
+	CHECK(image->numLevels() == 1);
+	CHECK(image->levelSize(0) == 32);
+	CHECK(memcmp(image->levelData(0), g_ETC1RedBlock, 8) == 0);
+
+	std::vector<GL::UByte> pixels;
+	CHECK(image->canDecode());
+	CHECK(image->decode(0, pixels));
+	CHECK(pixels.size() == 6 * 6 * 3);
+	if (pixels.size() == 6 * 6 * 3)
+	{
+		CHECK(pixels[0] == 255 && pixels[1] == 2 && pixels[2] == 2);
+		CHECK(pixels[4 * 3] == 134 && pixels[4 * 3 + 1] == 2 && pixels[4 * 3 + 2] == 2);
+		CHECK(pixels[(4 * 6) * 3] == 255);
+	}
+
+	CHECK(throws(data.substr(0, data.size() - 1)));
+
+	std::string mipmapped = data;
+	writeBE16(mipmapped, 6, 1);
+	CHECK(throws(mipmapped));
+
+	std::string tooLarge = data;
+	writeBE16(tooLarge, 12, 9);
+	CHECK(throws(tooLarge));
+}
+
+static void testDDS()
+{
+	// 8x8 image with 4 levels uses 4 + 1 + 1 + 1 blocks of 16 bytes each
+	std::string data = makeDDS(8, 8, 4, true);
+	GL::CompressedImagePtr image = GL::CompressedImage::loadFromData(data.data(), data.size());
+	CHECK(image->internalFormat() == GL::CompressedImage::DXT5Format);
+	CHECK(image->hasAlpha());
+	CHECK(image->numLevels() == 4);
+
+	const char * base = static_cast<const char *>(image->levelData(0));
+	const size_t sizes[] = { 64, 16, 16, 16 };
+	size_t offset = 0;
+	for (int level = 0; level < std::min(image->numLevels(), 4); level++)
+	{
+		CHECK(image->levelWidth(level) == std::max(8 >> level, 1));
+		CHECK(image->levelHeight(level) == std::max(8 >> level, 1));
+		CHECK(image->levelSize(level) == sizes[level]);
+		CHECK(static_cast<const char *>(image->levelData(level)) - base == ptrdiff_t(offset));
+		offset += sizes[level];
+	}
+
+	std::vector<GL::UByte> pixels;
+	CHECK(image->decode(0, pixels));
+	CHECK(pixels.size() == 8 * 8 * 4);
+	if (pixels.size() == 8 * 8 * 4)
+		CHECK(pixels[0] == 255 && pixels[1] == 0 && pixels[2] == 0 && pixels[3] == 255);
+
+	// DXT1 without alpha: the third color is interpolated between the first two
+	std::string dxt1 = makeDDS(4, 4, 1, false);
+	image = GL::CompressedImage::loadFromData(dxt1.data(), dxt1.size());
+	CHECK(image->internalFormat() == GL::CompressedImage::DXT1Format);
+	CHECK(!image->hasAlpha());
+	CHECK(image->decode(0, pixels));
+	CHECK(pixels.size() == 4 * 4 * 3);
+	if (pixels.size() == 4 * 4 * 3)
+	{
+		CHECK(pixels[0] == 255 && pixels[1] == 0 && pixels[2] == 0);
+		CHECK(pixels[3] == 0 && pixels[4] == 0 && pixels[5] == 255);
+		CHECK(pixels[6] == 170 && pixels[7] == 0 && pixels[8] == 85);
+	}
+
+	CHECK(throws(data.substr(0, data.size() - 1)));
+
+	std::string badHeader = data;
+	writeLE32(badHeader, 4, 100);
+	CHECK(throws(badHeader));
+
+	std::string unknownFormat = data;
+	memcpy(&unknownFormat[84], "ATI2", 4);
+	CHECK(throws(unknownFormat));
+
+	std::string cubeMap = data;
+	writeLE32(cubeMap, 112, 0x200);
+	CHECK(throws(cubeMap));
+}
+
+int main(int argc, char ** argv)
+{
+	if (argc > 1)
+	{
+		std::cerr << "usage: " << argv[0] << std::endl;
+		return 1;
+	}
+
+	try
+	{
+		testDetection();
+		testKTX();
+		testPKM();
+		testDDS();
+	}
+	catch (const std::exception & e)
+	{
+		std::cerr << "unexpected exception: " << e.what() << std::endl;
+		++g_Failures;
+	}
+
+	return reportChecks();
+}
@@ -0,0 +1,194 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Tests GL::Frustum and bounds of meshes computed by GL::ModelData. Batched culling (which uses SSE or NEON
+// when available) is compared with tests of individual volumes on random data, and both are timed.
+//
+// Usage: frustum_culling_test [volumes]
+//
+#include "check.h"
+#include "../gl_frustum.h"
+#include "../gl_model_data.h"
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+// Builds perspective projection looking down the negative Z axis (same as gluPerspective)
+static void perspective(float fovY, float aspect, float zNear, float zFar, float * m)
+{
+	float f = 1.0f / std::tan(fovY * 0.5f);
+	for (int i = 0; i < 16; i++)
+		m[i] = 0.0f;
+	m[0] = f / aspect;
+	m[5] = f;
+	m[10] = (zFar + zNear) / (zNear - zFar);
+	m[11] = -1.0f;
+	m[14] = 2.0f * zFar * zNear / (zNear - zFar);
+}
+
+static void testKnownVolumes()
+{
+	float matrix[16];
+	perspective(1.0f, 1.0f, 1.0f, 100.0f, matrix);
+	GL::Frustum frustum(matrix);
+
+	const float inFront[3] = { 0.0f, 0.0f, -10.0f }, behind[3] = { 0.0f, 0.0f, 10.0f };
+	const float tooFar[3] = { 0.0f, 0.0f, -200.0f }, aside[3] = { 50.0f, 0.0f, -10.0f };
+	CHECK(frustum.isSphereVisible(inFront, 1.0f));
+	CHECK(!frustum.isSphereVisible(behind, 1.0f));
+	CHECK(!frustum.isSphereVisible(tooFar, 1.0f));
+	CHECK(!frustum.isSphereVisible(aside, 1.0f));
+	CHECK(frustum.isSphereVisible(aside, 50.0f));
+
+	const float boxMin[3] = { -1.0f, -1.0f, -11.0f }, boxMax[3] = { 1.0f, 1.0f, -9.0f };
+	const float crossingMin[3] = { -1.0f, -1.0f, -5.0f }, crossingMax[3] = { 1.0f, 1.0f, 5.0f };
+	const float behindMin[3] = { -1.0f, -1.0f, 5.0f }, behindMax[3] = { 1.0f, 1.0f, 6.0f };
+	CHECK(frustum.isBoxVisible(boxMin, boxMax));
+	CHECK(frustum.isBoxVisible(crossingMin, crossingMax));
+	CHECK(!frustum.isBoxVisible(behindMin, behindMax));
+
+	// Default frustum contains everything
+	GL::Frustum everything;
+	CHECK(everything.isSphereVisible(behind, 1.0f));
+	CHECK(everything.isBoxVisible(behindMin, behindMax));
+}
+
+static void testMeshBounds()
+{
+	GL::ModelData data;
+	const float positions[4][3] = { { 0, 0, 0 }, { 2, 0, 0 }, { 0, 4, 0 }, { 10, 10, 10 } };
+	data.vertices.resize(4);
+	for (size_t i = 0; i < 4; i++)
+	{
+		for (int j = 0; j < 3; j++)
+			data.vertices[i].position[j] = positions[i][j];
+	}
+
+	data.indices = { 0, 1, 2, 3, 3, 3 };
+	data.meshes.resize(2);
+	data.meshes[0].firstIndex = 0;
+	data.meshes[0].numIndices = 3;
+	data.meshes[1].firstIndex = 3;
+	data.meshes[1].numIndices = 3;
+	data.computeMeshBounds();
+
+	const GL::ModelData::Mesh & mesh = data.meshes[0];
+	CHECK(mesh.boundsMin[0] == 0.0f && mesh.boundsMin[1] == 0.0f && mesh.boundsMin[2] == 0.0f);
+	CHECK(mesh.boundsMax[0] == 2.0f && mesh.boundsMax[1] == 4.0f && mesh.boundsMax[2] == 0.0f);
+	CHECK(mesh.center[0] == 1.0f && mesh.center[1] == 2.0f && mesh.center[2] == 0.0f);
+	CHECK(std::fabs(mesh.radius - std::sqrt(5.0f)) < 1e-6f);
+
+	// Mesh that consists of a single point has zero radius
+	CHECK(data.meshes[1].center[0] == 10.0f && data.meshes[1].radius == 0.0f);
+}
+
+static void testRandomVolumes(size_t count)
+{
+	std::mt19937 random(12345);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> extent(0.0f, 10.0f);
+
+	float projection[16], view[16], matrix[16];
+	perspective(1.0f, 1.5f, 0.5f, 80.0f, projection);
+
+	// Camera is rotated around Y axis by 0.3 radians and moved to (5, 0, 20)
+	float c = std::cos(0.3f), s = std::sin(0.3f);
+	const float rotation[16] = { c, 0, -s, 0,  0, 1, 0, 0,  s, 0, c, 0,  0, 0, 0, 1 };
+	for (int i = 0; i < 16; i++)
+		view[i] = rotation[i];
+	view[12] = -(c * 5.0f + s * 20.0f);
+	view[13] = 0.0f;
+	view[14] = -(-s * 5.0f + c * 20.0f);
+
+	for (int col = 0; col < 4; col++)
+	{
+		for (int row = 0; row < 4; row++)
+		{
+			float sum = 0.0f;
+			for (int k = 0; k < 4; k++)
+				sum += projection[k * 4 + row] * view[col * 4 + k];
+			matrix[col * 4 + row] = sum;
+		}
+	}
+
+	GL::Frustum frustum(matrix);
+	GL::Frustum::BoundsList list;
+	std::vector<float> boxes(count * 6), spheres(count * 4);
+	for (size_t i = 0; i < count; i++)
+	{
+		float * box = &boxes[i * 6];
+		float * sphere = &spheres[i * 4];
+		float radiusSquared = 0.0f;
+		for (int j = 0; j < 3; j++)
+		{
+			float center = position(random), halfSize = extent(random);
+			box[j] = center - halfSize;
+			box[j + 3] = center + halfSize;
+			sphere[j] = center;
+			radiusSquared += halfSize * halfSize;
+		}
+		sphere[3] = std::sqrt(radiusSquared);
+		list.add(box, box + 3, sphere, sphere[3]);
+	}
+
+	std::vector<int> visible, expected;
+	visible.reserve(count);
+	expected.reserve(count);
+
+	auto start = std::chrono::steady_clock::now();
+	frustum.cull(list, visible);
+	std::chrono::duration<double, std::micro> batched = std::chrono::steady_clock::now() - start;
+
+	start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < count; i++)
+	{
+		if (frustum.isBoxVisible(&boxes[i * 6], &boxes[i * 6 + 3]) &&
+			frustum.isSphereVisible(&spheres[i * 4], spheres[i * 4 + 3]))
+			expected.push_back(int(i));
+	}
+	std::chrono::duration<double, std::micro> individual = std::chrono::steady_clock::now() - start;
+
+	CHECK(visible == expected);
+
+	std::cout << count << " volumes, " << visible.size() << " visible." << std::endl;
+	std::cout << "Batched cull:      " << batched.count() << " us." << std::endl;
+	std::cout << "Individual tests:  " << individual.count() << " us." << std::endl;
+}
+
+int main(int argc, char ** argv)
+{
+	int count = (argc > 1 ? atoi(argv[1]) : 100000);
+	if (argc > 2 || count <= 0)
+	{
+		std::cerr << "usage: " << argv[0] << " [volumes]" << std::endl;
+		return 1;
+	}
+
+	testKnownVolumes();
+	testMeshBounds();
+	testRandomVolumes(size_t(count));
+
+	return reportChecks();
+}
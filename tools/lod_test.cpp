@@ -0,0 +1,215 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Tests generation and selection of levels of detail on a tessellated unit sphere. For each level, number of
+// triangles, geometric error estimated by GL::MeshSimplifier and measured deviation from the sphere are
+// reported.
+//
+// Usage: lod_test [subdivisions] [levels]
+//
+#include "check.h"
+#include "mock_gl.h"
+#include "../gl_mesh_simplifier.h"
+#include "../gl_model_data.h"
+#include "../gl_model.h"
+#include "../gl_resource_manager.h"
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <map>
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+	// Gives access to the protected initialization of the model
+	class TestModel : public GL::Model
+	{
+	public:
+		TestModel(GL::ResourceManager * resMgr, const GL::ModelData & data)
+			: Model(resMgr, "<lod_test>")
+		{
+			initFromData(data);
+		}
+	};
+}
+
+static GL::UInt addVertex(GL::ModelData & data, float x, float y, float z)
+{
+	float length = std::sqrt(x * x + y * y + z * z);
+	GL::Model::Vertex vertex = GL::Model::Vertex();
+	vertex.position[0] = vertex.normal[0] = x / length;
+	vertex.position[1] = vertex.normal[1] = y / length;
+	vertex.position[2] = vertex.normal[2] = z / length;
+	data.vertices.push_back(vertex);
+	return GL::UInt(data.vertices.size() - 1);
+}
+
+// Builds unit sphere by subdividing the icosahedron; the sphere has no borders and no attribute seams
+static void buildSphere(int subdivisions, GL::ModelData & data)
+{
+	const float t = (1.0f + std::sqrt(5.0f)) * 0.5f;
+	const float positions[12][3] = {
+		{ -1, t, 0 }, { 1, t, 0 }, { -1, -t, 0 }, { 1, -t, 0 },
+		{ 0, -1, t }, { 0, 1, t }, { 0, -1, -t }, { 0, 1, -t },
+		{ t, 0, -1 }, { t, 0, 1 }, { -t, 0, -1 }, { -t, 0, 1 },
+	};
+	const GL::UInt faces[] = {
+		0, 11, 5,  0, 5, 1,  0, 1, 7,  0, 7, 10,  0, 10, 11,
+		1, 5, 9,  5, 11, 4,  11, 10, 2,  10, 7, 6,  7, 1, 8,
+		3, 9, 4,  3, 4, 2,  3, 2, 6,  3, 6, 8,  3, 8, 9,
+		4, 9, 5,  2, 4, 11,  6, 2, 10,  8, 6, 7,  9, 8, 1,
+	};
+
+	data.clear();
+	for (const float * p : positions)
+		addVertex(data, p[0], p[1], p[2]);
+	data.indices.assign(faces, faces + sizeof(faces) / sizeof(faces[0]));
+
+	for (int i = 0; i < subdivisions; i++)
+	{
+		std::map<std::pair<GL::UInt, GL::UInt>, GL::UInt> midpoints;
+		auto midpoint = [&data, &midpoints](GL::UInt a, GL::UInt b) -> GL::UInt {
+			auto key = std::make_pair(std::min(a, b), std::max(a, b));
+			auto it = midpoints.find(key);
+			if (it != midpoints.end())
+				return it->second;
+			const GL::Model::Vertex & va = data.vertices[a], & vb = data.vertices[b];
+			GL::UInt index = addVertex(data, va.position[0] + vb.position[0], va.position[1] + vb.position[1],
+				va.position[2] + vb.position[2]);
+			midpoints[key] = index;
+			return index;
+		};
+
+		std::vector<GL::UInt> indices;
+		for (size_t j = 0; j < data.indices.size(); j += 3)
+		{
+			GL::UInt a = data.indices[j], b = data.indices[j + 1], c = data.indices[j + 2];
+			GL::UInt ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+			const GL::UInt triangles[] = { a, ab, ca,  b, bc, ab,  c, ca, bc,  ab, bc, ca };
+			indices.insert(indices.end(), triangles, triangles + 12);
+		}
+		data.indices.swap(indices);
+	}
+
+	data.materials.resize(1);
+	data.materials[0].initWithDefaults();
+	data.meshes.resize(1);
+	data.meshes[0].materialIndex = 0;
+	data.meshes[0].firstIndex = 0;
+	data.meshes[0].numIndices = GL::UInt(data.indices.size());
+	for (int i = 0; i < 3; i++)
+	{
+		data.center[i] = 0.0f;
+		data.size[i] = 2.0f;
+	}
+	data.radius = 1.0f;
+	data.hasPositions = true;
+	data.hasNormals = true;
+	data.computeMeshBounds();
+}
+
+// Returns maximum distance between the unit sphere and the centroids of the triangles
+static float measureDeviation(const GL::ModelData & data, const GL::ModelData::Mesh & mesh)
+{
+	float deviation = 0.0f;
+	for (size_t i = mesh.firstIndex; i < size_t(mesh.firstIndex + mesh.numIndices); i += 3)
+	{
+		float centroid[3] = { 0.0f, 0.0f, 0.0f };
+		for (size_t j = 0; j < 3; j++)
+		{
+			for (int k = 0; k < 3; k++)
+				centroid[k] += data.vertices[data.indices[i + j]].position[k] / 3.0f;
+		}
+		float lengthSquared = centroid[0] * centroid[0] + centroid[1] * centroid[1] + centroid[2] * centroid[2];
+		deviation = std::max(deviation, 1.0f - std::sqrt(lengthSquared));
+	}
+	return deviation;
+}
+
+int main(int argc, char ** argv)
+{
+	int subdivisions = (argc > 1 ? atoi(argv[1]) : 4);
+	int numLevels = (argc > 2 ? atoi(argv[2]) : 5);
+	if (argc > 3 || subdivisions < 0 || subdivisions > 7 || numLevels < 1)
+	{
+		std::cerr << "usage: " << argv[0] << " [subdivisions] [levels]" << std::endl;
+		return 1;
+	}
+
+	GL::ModelData data;
+	buildSphere(subdivisions, data);
+	size_t numVertices = data.vertices.size();
+	size_t numTriangles = data.indices.size() / 3;
+
+	GL::MeshSimplifier::generateLods(data, size_t(numLevels));
+	CHECK(!data.lods.empty());
+	CHECK(data.vertices.size() == numVertices);
+
+	std::cout << "Level 0: " << numTriangles << " triangles, error 0, measured deviation "
+		<< measureDeviation(data, data.meshes[0]) << '.' << std::endl;
+
+	size_t previousTriangles = numTriangles;
+	float previousError = 0.0f;
+	for (size_t level = 0; level < data.lods.size(); level++)
+	{
+		const GL::ModelData::Lod & lod = data.lods[level];
+		CHECK(lod.meshes.size() == 1);
+		const GL::ModelData::Mesh & mesh = lod.meshes[0];
+
+		size_t triangles = mesh.numIndices / 3;
+		float deviation = measureDeviation(data, mesh);
+		std::cout << "Level " << level + 1 << ": " << triangles << " triangles, error " << lod.error
+			<< ", measured deviation " << deviation << '.' << std::endl;
+
+		// Levels share vertices of the full-detail model, and each level removes at least a quarter of triangles
+		CHECK(mesh.numIndices % 3 == 0);
+		CHECK(size_t(mesh.firstIndex) + mesh.numIndices <= data.indices.size());
+		for (size_t i = mesh.firstIndex; i < size_t(mesh.firstIndex + mesh.numIndices); i++)
+			CHECK(data.indices[i] < numVertices);
+		CHECK(triangles * 4 <= previousTriangles * 3);
+		CHECK(lod.error >= previousError);
+		CHECK(deviation < 0.5f);
+
+		previousTriangles = triangles;
+		previousError = lod.error;
+	}
+
+	// Selection of the level by projected size
+	GL::ResourceManager manager;
+	std::shared_ptr<TestModel> model = std::make_shared<TestModel>(&manager, data);
+	CHECK(model->numLods() == data.lods.size() + 1);
+	CHECK(model->selectLod(model->projectedRadius(0.5f, 1000.0f)) == 0);
+	CHECK(model->selectLod(1e6f) == 0);
+	CHECK(model->selectLod(1e-3f) == model->numLods() - 1);
+
+	size_t previousLevel = 0;
+	for (float distance = 2.0f; distance < 1e5f; distance *= 2.0f)
+	{
+		size_t level = model->selectLod(model->projectedRadius(distance, 1000.0f));
+		CHECK(level >= previousLevel);
+		previousLevel = level;
+	}
+	CHECK(previousLevel == model->numLods() - 1);
+
+	return reportChecks();
+}
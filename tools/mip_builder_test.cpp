@@ -0,0 +1,207 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Tests GL::MipBuilder: sizes of levels, box filter (which uses SSE2 or NEON for RGBA images) against a scalar
+// reference, preservation of flat colors by all filters and gamma-correct averaging. Also measures speed of
+// building mipmap chains.
+//
+// Usage: mip_builder_test [size]
+//
+#include "check.h"
+#include "../gl_mip_builder.h"
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdlib>
+
+static std::vector<GL::UByte> randomPixels(int width, int height, int channels, unsigned seed)
+{
+	std::mt19937 random(seed);
+	std::vector<GL::UByte> pixels(size_t(width) * size_t(height) * size_t(channels));
+	for (GL::UByte & pixel : pixels)
+		pixel = GL::UByte(random() & 0xFF);
+	return pixels;
+}
+
+// Straightforward 2x2 box filter with rounding; edge pixels are repeated for odd sizes
+static std::vector<GL::UByte> referenceBox(const std::vector<GL::UByte> & src, int sw, int sh, int channels)
+{
+	int dw = std::max(sw / 2, 1), dh = std::max(sh / 2, 1);
+	std::vector<GL::UByte> dst(size_t(dw) * size_t(dh) * size_t(channels));
+	for (int y = 0; y < dh; y++)
+	{
+		int y0 = std::min(y * 2, sh - 1), y1 = std::min(y * 2 + 1, sh - 1);
+		for (int x = 0; x < dw; x++)
+		{
+			int x0 = std::min(x * 2, sw - 1), x1 = std::min(x * 2 + 1, sw - 1);
+			for (int c = 0; c < channels; c++)
+			{
+				unsigned sum = unsigned(src[size_t((y0 * sw + x0) * channels + c)])
+					+ src[size_t((y0 * sw + x1) * channels + c)]
+					+ src[size_t((y1 * sw + x0) * channels + c)]
+					+ src[size_t((y1 * sw + x1) * channels + c)];
+				dst[size_t((y * dw + x) * channels + c)] = GL::UByte((sum + 2) >> 2);
+			}
+		}
+	}
+	return dst;
+}
+
+static void testLevelSizes()
+{
+	CHECK(GL::MipBuilder::numLevels(1, 1) == 1);
+	CHECK(GL::MipBuilder::numLevels(256, 256) == 9);
+	CHECK(GL::MipBuilder::numLevels(37, 5) == 6);
+
+	std::vector<GL::UByte> pixels = randomPixels(37, 5, 4, 1);
+	std::vector<GL::MipBuilder::Level> levels;
+	GL::MipBuilder().build(pixels.data(), 37, 5, 4, levels);
+
+	const int expected[][2] = { { 18, 2 }, { 9, 1 }, { 4, 1 }, { 2, 1 }, { 1, 1 } };
+	CHECK(levels.size() == 5);
+	for (size_t i = 0; i < std::min(levels.size(), size_t(5)); i++)
+	{
+		CHECK(levels[i].width == expected[i][0] && levels[i].height == expected[i][1]);
+		CHECK(levels[i].pixels.size() == size_t(expected[i][0] * expected[i][1] * 4));
+	}
+
+	GL::MipBuilder().build(pixels.data(), 1, 1, 4, levels);
+	CHECK(levels.empty());
+}
+
+static void testBoxFilter()
+{
+	const int sizes[][2] = { { 64, 64 }, { 37, 5 }, { 7, 9 }, { 2, 1 }, { 1, 16 } };
+	for (const int * size : sizes)
+	{
+		for (int channels = 1; channels <= 4; channels++)
+		{
+			std::vector<GL::UByte> pixels = randomPixels(size[0], size[1], channels, unsigned(channels));
+			std::vector<GL::MipBuilder::Level> levels;
+			GL::MipBuilder().build(pixels.data(), size[0], size[1], channels, levels);
+
+			int width = size[0], height = size[1];
+			std::vector<GL::UByte> expected = pixels;
+			for (const GL::MipBuilder::Level & level : levels)
+			{
+				expected = referenceBox(expected, width, height, channels);
+				width = std::max(width / 2, 1);
+				height = std::max(height / 2, 1);
+				CHECK(level.pixels == expected);
+			}
+		}
+	}
+}
+
+static void testFlatColor()
+{
+	const GL::UByte color[4] = { 200, 100, 30, 160 };
+	std::vector<GL::UByte> pixels(33 * 17 * 4);
+	for (size_t i = 0; i < pixels.size(); i++)
+		pixels[i] = color[i % 4];
+
+	const GL::MipBuilder builders[] = {
+		GL::MipBuilder(GL::MipBuilder::BoxFilter, false),
+		GL::MipBuilder(GL::MipBuilder::BoxFilter, true),
+		GL::MipBuilder(GL::MipBuilder::KaiserFilter, false),
+		GL::MipBuilder(GL::MipBuilder::KaiserFilter, true),
+	};
+
+	for (const GL::MipBuilder & builder : builders)
+	{
+		std::vector<GL::MipBuilder::Level> levels;
+		builder.build(pixels.data(), 33, 17, 4, levels);
+		int maxError = 0;
+		for (const GL::MipBuilder::Level & level : levels)
+		{
+			for (size_t i = 0; i < level.pixels.size(); i++)
+				maxError = std::max(maxError, std::abs(int(level.pixels[i]) - int(color[i % 4])));
+		}
+		CHECK(maxError <= 1);
+	}
+}
+
+static void testGammaCorrection()
+{
+	// Checkerboard of black and white pixels with alternating alpha
+	std::vector<GL::UByte> pixels(4 * 4 * 4);
+	for (int y = 0; y < 4; y++)
+	{
+		for (int x = 0; x < 4; x++)
+		{
+			GL::UByte value = GL::UByte((x + y) % 2 ? 255 : 0);
+			GL::UByte * p = &pixels[size_t((y * 4 + x) * 4)];
+			p[0] = p[1] = p[2] = p[3] = value;
+		}
+	}
+
+	std::vector<GL::MipBuilder::Level> plain, gamma;
+	GL::MipBuilder(GL::MipBuilder::BoxFilter, false).build(pixels.data(), 4, 4, 4, plain);
+	GL::MipBuilder(GL::MipBuilder::BoxFilter, true).build(pixels.data(), 4, 4, 4, gamma);
+
+	// Linear average of 0 and 1 is 0.5, which is 188 in sRGB; alpha is never converted
+	CHECK(plain[0].pixels[0] == 128 && plain[0].pixels[3] == 128);
+	CHECK(std::abs(int(gamma[0].pixels[0]) - 188) <= 1);
+	CHECK(gamma[0].pixels[3] == 128);
+}
+
+static void measure(const char * name, const GL::MipBuilder & builder, const std::vector<GL::UByte> & pixels,
+	int size)
+{
+	std::vector<GL::MipBuilder::Level> levels;
+	double best = 0.0;
+	for (int i = 0; i < 3; i++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		builder.build(pixels.data(), size, size, 4, levels);
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		if (i == 0 || elapsed.count() < best)
+			best = elapsed.count();
+	}
+	std::cout << name << best << " ms, " << double(size) * double(size) / (best * 1000.0)
+		<< " Mpixels/s." << std::endl;
+}
+
+int main(int argc, char ** argv)
+{
+	int size = (argc > 1 ? atoi(argv[1]) : 1024);
+	if (argc > 2 || size <= 0)
+	{
+		std::cerr << "usage: " << argv[0] << " [size]" << std::endl;
+		return 1;
+	}
+
+	testLevelSizes();
+	testBoxFilter();
+	testFlatColor();
+	testGammaCorrection();
+
+	std::vector<GL::UByte> pixels = randomPixels(size, size, 4, 0);
+	std::cout << size << 'x' << size << " RGBA image." << std::endl;
+	measure("Box:                ", GL::MipBuilder(GL::MipBuilder::BoxFilter, false), pixels, size);
+	measure("Box, gamma-correct: ", GL::MipBuilder(GL::MipBuilder::BoxFilter, true), pixels, size);
+	measure("Kaiser:             ", GL::MipBuilder(GL::MipBuilder::KaiserFilter, false), pixels, size);
+
+	return reportChecks();
+}
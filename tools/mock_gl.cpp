@@ -0,0 +1,387 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "mock_gl.h"
+#include <unordered_map>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	struct Object
+	{
+		Clock::time_point ready;
+		std::vector<GL::UInt> shaders;
+		std::vector<char> data;
+		bool linked = true;
+	};
+
+	const char g_BinaryMagic[] = "MOCKGLBIN";
+
+	std::string g_Extensions = "GL_OES_get_program_binary GL_OES_mapbuffer GL_EXT_map_buffer_range";
+	std::chrono::microseconds g_CompileLatency(0);
+	std::chrono::microseconds g_LinkLatency(0);
+	std::vector<Clock::time_point> g_CompilerThreads(1);
+	bool g_AcceptProgramBinaries = true;
+
+	std::unordered_map<GL::UInt, Object> g_Objects;
+	GL::UInt g_NextHandle = 1;
+	GL::UInt g_ArrayBuffer;
+	GL::UInt g_ElementArrayBuffer;
+	GL::UInt g_Framebuffer;
+
+	size_t g_Stalls;
+	size_t g_Compiles;
+	size_t g_Links;
+	size_t g_ProgramBinaries;
+	size_t g_DrawCalls;
+}
+
+static GL::UInt newObject()
+{
+	GL::UInt handle = g_NextHandle++;
+	g_Objects[handle].ready = Clock::now();
+	return handle;
+}
+
+static void genObjects(GL::Sizei n, GL::UInt * handles)
+{
+	for (GL::Sizei i = 0; i < n; i++)
+		handles[i] = newObject();
+}
+
+static void deleteObjects(GL::Sizei n, const GL::UInt * handles)
+{
+	for (GL::Sizei i = 0; i < n; i++)
+		g_Objects.erase(handles[i]);
+}
+
+// Schedules work on the least loaded compiler thread and returns time when the work will be finished
+static Clock::time_point schedule(std::chrono::microseconds latency, Clock::time_point notBefore)
+{
+	auto thread = std::min_element(g_CompilerThreads.begin(), g_CompilerThreads.end());
+	Clock::time_point start = std::max(std::max(*thread, notBefore), Clock::now());
+	*thread = start + latency;
+	return *thread;
+}
+
+// Waits until the driver finishes compilation or linking of the object
+static Object & waitFor(GL::UInt handle)
+{
+	Object & object = g_Objects[handle];
+	if (object.ready > Clock::now())
+	{
+		++g_Stalls;
+		std::this_thread::sleep_until(object.ready);
+	}
+	return object;
+}
+
+static std::vector<char> & boundBufferData(GL::Enum target)
+{
+	return g_Objects[target == GL::ELEMENT_ARRAY_BUFFER ? g_ElementArrayBuffer : g_ArrayBuffer].data;
+}
+
+void MockGL::setExtensions(const std::string & extensions)
+{
+	g_Extensions = extensions;
+}
+
+void MockGL::setCompileLatency(std::chrono::microseconds compile, std::chrono::microseconds link)
+{
+	g_CompileLatency = compile;
+	g_LinkLatency = link;
+}
+
+void MockGL::setCompilerThreads(size_t threads)
+{
+	g_CompilerThreads.assign(std::max(threads, size_t(1)), Clock::now());
+}
+
+void MockGL::setAcceptProgramBinaries(bool flag)
+{
+	g_AcceptProgramBinaries = flag;
+}
+
+void MockGL::resetCounters()
+{
+	g_Stalls = 0;
+	g_Compiles = 0;
+	g_Links = 0;
+	g_ProgramBinaries = 0;
+	g_DrawCalls = 0;
+}
+
+size_t MockGL::numStalls() { return g_Stalls; }
+size_t MockGL::numCompiles() { return g_Compiles; }
+size_t MockGL::numLinks() { return g_Links; }
+size_t MockGL::numProgramBinaries() { return g_ProgramBinaries; }
+size_t MockGL::numDrawCalls() { return g_DrawCalls; }
+
+namespace GL
+{
+	void init() {}
+	void flush() {}
+	void finish() {}
+	Enum getError() { return GL::NO_ERROR; }
+
+	const UByte * getString(Enum name)
+	{
+		switch (name)
+		{
+		case GL::VENDOR: return reinterpret_cast<const UByte *>("MockGL");
+		case GL::RENDERER: return reinterpret_cast<const UByte *>("MockGL");
+		case GL::VERSION: return reinterpret_cast<const UByte *>("OpenGL ES 2.0 MockGL");
+		case GL::EXTENSIONS: return reinterpret_cast<const UByte *>(g_Extensions.c_str());
+		}
+		return nullptr;
+	}
+
+	void getIntegerv(Enum name, Int * value)
+	{
+		switch (name)
+		{
+		case GL::NUM_PROGRAM_BINARY_FORMATS_OES: *value = 1; return;
+		case GL::MAX_VERTEX_UNIFORM_VECTORS: *value = 256; return;
+		case GL::MAX_VERTEX_ATTRIBS: *value = 16; return;
+		case GL::FRAMEBUFFER_BINDING: *value = Int(g_Framebuffer); return;
+		case GL::VIEWPORT: value[0] = value[1] = value[2] = value[3] = 0; return;
+		}
+		*value = 0;
+	}
+
+	void viewport(Int, Int, Sizei, Sizei) {}
+
+	// Textures
+
+	void genTextures(Sizei n, UInt * handles) { genObjects(n, handles); }
+	void deleteTextures(Sizei n, const UInt * handles) { deleteObjects(n, handles); }
+	void bindTexture(Enum, UInt) {}
+	void activeTexture(Enum) {}
+	void texImage2D(Enum, Int, Int, Sizei, Sizei, Int, Enum, Enum, const void *) {}
+	void texSubImage2D(Enum, Int, Int, Int, Sizei, Sizei, Enum, Enum, const void *) {}
+	void compressedTexImage2D(Enum, Int, Enum, Sizei, Sizei, Int, Sizei, const void *) {}
+	void texParameterf(Enum, Enum, Float) {}
+	void texParameteri(Enum, Enum, Int) {}
+	void pixelStorei(Enum, Int) {}
+	void generateMipmap(Enum) {}
+
+	// Buffers
+
+	void genBuffers(Sizei n, UInt * handles) { genObjects(n, handles); }
+	void deleteBuffers(Sizei n, const UInt * handles) { deleteObjects(n, handles); }
+
+	void bindBuffer(Enum target, UInt handle)
+	{
+		(target == GL::ELEMENT_ARRAY_BUFFER ? g_ElementArrayBuffer : g_ArrayBuffer) = handle;
+	}
+
+	void bufferData(Enum target, Sizeiptr size, const void * data, Enum)
+	{
+		std::vector<char> & buffer = boundBufferData(target);
+		buffer.resize(size_t(size));
+		if (data && size > 0)
+			memcpy(buffer.data(), data, size_t(size));
+	}
+
+	void bufferSubData(Enum target, Intptr offset, Sizeiptr size, const void * data)
+	{
+		std::vector<char> & buffer = boundBufferData(target);
+		if (size_t(offset + size) <= buffer.size() && size > 0)
+			memcpy(buffer.data() + offset, data, size_t(size));
+	}
+
+	void * mapBufferOES(Enum target, Enum)
+	{
+		return boundBufferData(target).data();
+	}
+
+	void * mapBufferRangeEXT(Enum target, Intptr offset, Sizeiptr, Bitfield)
+	{
+		return boundBufferData(target).data() + offset;
+	}
+
+	Boolean unmapBufferOES(Enum)
+	{
+		return GL::TRUE;
+	}
+
+	// Framebuffers and renderbuffers
+
+	void genFramebuffers(Sizei n, UInt * handles) { genObjects(n, handles); }
+	void deleteFramebuffers(Sizei n, const UInt * handles) { deleteObjects(n, handles); }
+	void bindFramebuffer(Enum, UInt handle) { g_Framebuffer = handle; }
+	void genRenderbuffers(Sizei n, UInt * handles) { genObjects(n, handles); }
+	void deleteRenderbuffers(Sizei n, const UInt * handles) { deleteObjects(n, handles); }
+	void bindRenderbuffer(Enum, UInt) {}
+	void renderbufferStorage(Enum, Enum, Sizei, Sizei) {}
+
+	// Shaders
+
+	UInt createShader(Enum) { return newObject(); }
+	void deleteShader(UInt handle) { g_Objects.erase(handle); }
+	void shaderSource(UInt, Sizei, const Char * const *, const Int *) {}
+
+	void compileShader(UInt handle)
+	{
+		++g_Compiles;
+		g_Objects[handle].ready = schedule(g_CompileLatency, Clock::now());
+	}
+
+	void getShaderiv(UInt handle, Enum name, Int * value)
+	{
+		waitFor(handle);
+		*value = (name == GL::COMPILE_STATUS ? GL::TRUE : 0);
+	}
+
+	void getShaderInfoLog(UInt, Sizei size, Sizei * length, Char * log)
+	{
+		if (size > 0)
+			log[0] = 0;
+		if (length)
+			*length = 0;
+	}
+
+	// Programs
+
+	UInt createProgram() { return newObject(); }
+	void deleteProgram(UInt handle) { g_Objects.erase(handle); }
+	void attachShader(UInt program, UInt shader) { g_Objects[program].shaders.push_back(shader); }
+
+	void detachShader(UInt program, UInt shader)
+	{
+		std::vector<UInt> & shaders = g_Objects[program].shaders;
+		shaders.erase(std::remove(shaders.begin(), shaders.end(), shader), shaders.end());
+	}
+
+	void linkProgram(UInt handle)
+	{
+		++g_Links;
+
+		// Linking starts when all attached shaders are compiled
+		Object & program = g_Objects[handle];
+		Clock::time_point start = Clock::now();
+		for (UInt shader : program.shaders)
+			start = std::max(start, g_Objects[shader].ready);
+
+		program.ready = schedule(g_LinkLatency, start);
+		program.linked = true;
+	}
+
+	void getProgramiv(UInt handle, Enum name, Int * value)
+	{
+		Object & program = waitFor(handle);
+		switch (name)
+		{
+		case GL::LINK_STATUS: *value = (program.linked ? GL::TRUE : GL::FALSE); return;
+		case GL::PROGRAM_BINARY_LENGTH_OES: *value = Int(sizeof(g_BinaryMagic) + sizeof(UInt)); return;
+		}
+		*value = 0;
+	}
+
+	void getProgramInfoLog(UInt, Sizei size, Sizei * length, Char * log)
+	{
+		getShaderInfoLog(0, size, length, log);
+	}
+
+	void getProgramBinaryOES(UInt handle, Sizei size, Sizei * length, Enum * format, void * binary)
+	{
+		waitFor(handle);
+
+		Sizei binarySize = Sizei(sizeof(g_BinaryMagic) + sizeof(UInt));
+		if (size < binarySize)
+		{
+			*length = 0;
+			return;
+		}
+
+		memcpy(binary, g_BinaryMagic, sizeof(g_BinaryMagic));
+		memcpy(static_cast<char *>(binary) + sizeof(g_BinaryMagic), &handle, sizeof(handle));
+		*length = binarySize;
+		*format = 0x4D4F;
+	}
+
+	void programBinaryOES(UInt handle, Enum format, const void * binary, Int length)
+	{
+		++g_ProgramBinaries;
+
+		Object & program = g_Objects[handle];
+		program.ready = Clock::now();
+		program.linked = (g_AcceptProgramBinaries && format == 0x4D4F &&
+			size_t(length) == sizeof(g_BinaryMagic) + sizeof(UInt) &&
+			!memcmp(binary, g_BinaryMagic, sizeof(g_BinaryMagic)));
+	}
+
+	void validateProgram(UInt) {}
+	void useProgram(UInt) {}
+
+	void getActiveUniform(UInt, UInt, Sizei, Sizei *, Int *, Enum *, Char *) {}
+	void getActiveAttrib(UInt, UInt, Sizei, Sizei *, Int *, Enum *, Char *) {}
+	Int getAttribLocation(UInt, const Char *) { return -1; }
+	Int getUniformLocation(UInt, const Char *) { return -1; }
+
+	// Uniforms
+
+	void uniform1f(Int, Float) {}
+	void uniform2f(Int, Float, Float) {}
+	void uniform3f(Int, Float, Float, Float) {}
+	void uniform4f(Int, Float, Float, Float, Float) {}
+	void uniform1i(Int, Int) {}
+	void uniform2i(Int, Int, Int) {}
+	void uniform3i(Int, Int, Int, Int) {}
+	void uniform4i(Int, Int, Int, Int, Int) {}
+	void uniform1fv(Int, Sizei, const Float *) {}
+	void uniform2fv(Int, Sizei, const Float *) {}
+	void uniform3fv(Int, Sizei, const Float *) {}
+	void uniform4fv(Int, Sizei, const Float *) {}
+	void uniform1iv(Int, Sizei, const Int *) {}
+	void uniform2iv(Int, Sizei, const Int *) {}
+	void uniform3iv(Int, Sizei, const Int *) {}
+	void uniform4iv(Int, Sizei, const Int *) {}
+	void uniformMatrix2fv(Int, Sizei, Boolean, const Float *) {}
+	void uniformMatrix3fv(Int, Sizei, Boolean, const Float *) {}
+	void uniformMatrix4fv(Int, Sizei, Boolean, const Float *) {}
+
+	// Vertex attributes and drawing
+
+	void vertexAttrib1f(UInt, Float) {}
+	void vertexAttrib2f(UInt, Float, Float) {}
+	void vertexAttrib3f(UInt, Float, Float, Float) {}
+	void vertexAttrib4f(UInt, Float, Float, Float, Float) {}
+	void vertexAttrib2fv(UInt, const Float *) {}
+	void vertexAttrib3fv(UInt, const Float *) {}
+	void vertexAttrib4fv(UInt, const Float *) {}
+	void vertexAttribPointer(UInt, Int, Enum, Boolean, Sizei, const void *) {}
+	void enableVertexAttribArray(UInt) {}
+	void disableVertexAttribArray(UInt) {}
+	void vertexAttribDivisorEXT(UInt, UInt) {}
+	void vertexAttribDivisorANGLE(UInt, UInt) {}
+
+	void drawArrays(Enum, Int, Sizei) { ++g_DrawCalls; }
+	void drawElements(Enum, Sizei, Enum, const void *) { ++g_DrawCalls; }
+	void drawElementsInstancedEXT(Enum, Sizei, Enum, const void *, Sizei) { ++g_DrawCalls; }
+	void drawElementsInstancedANGLE(Enum, Sizei, Enum, const void *, Sizei) { ++g_DrawCalls; }
+}
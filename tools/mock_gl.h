@@ -0,0 +1,103 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef __158342bd0936ebdb447eea12a49e5df4__
+#define __158342bd0936ebdb447eea12a49e5df4__
+
+#include <yip-imports/gl.h>
+#include <chrono>
+#include <string>
+
+/**
+ * Mock implementation of the OpenGL ES 2.0 entry points used by the library.
+ *
+ * Tools are linked with mock_gl.cpp instead of the gles2 package, so they build and run without an OpenGL
+ * context. Objects get unique handles, buffers keep their contents in system memory and all queries return
+ * successful results.
+ *
+ * The mock also simulates a driver that compiles shaders and links programs on a number of background
+ * threads: compileShader() and linkProgram() only schedule the work, while any query of the shader or
+ * program state waits until the work is finished (see setCompileLatency()).
+ */
+namespace MockGL
+{
+	/**
+	 * Sets string returned by GL::getString(GL::EXTENSIONS).
+	 * @param extensions Space-separated list of extensions.
+	 */
+	void setExtensions(const std::string & extensions);
+
+	/**
+	 * Sets time needed to compile a shader and to link a program.
+	 * @param compile Compilation time of a single shader.
+	 * @param link Link time of a single program.
+	 */
+	void setCompileLatency(std::chrono::microseconds compile, std::chrono::microseconds link);
+
+	/**
+	 * Sets number of threads used by the simulated driver to compile shaders and link programs.
+	 * @param threads Number of threads (default is 1).
+	 */
+	void setCompilerThreads(size_t threads);
+
+	/**
+	 * Sets whether GL::programBinaryOES accepts binaries returned by GL::getProgramBinaryOES.
+	 * Binaries that were not produced by the mock are always rejected.
+	 * @param flag *true* to accept binaries (default), *false* to reject them.
+	 */
+	void setAcceptProgramBinaries(bool flag);
+
+	/** Resets all counters. */
+	void resetCounters();
+
+	/**
+	 * Returns number of queries that had to wait for compilation or linking to finish.
+	 * @return Number of stalls.
+	 */
+	size_t numStalls();
+
+	/**
+	 * Returns number of GL::compileShader calls.
+	 * @return Number of calls.
+	 */
+	size_t numCompiles();
+
+	/**
+	 * Returns number of GL::linkProgram calls.
+	 * @return Number of calls.
+	 */
+	size_t numLinks();
+
+	/**
+	 * Returns number of GL::programBinaryOES calls.
+	 * @return Number of calls.
+	 */
+	size_t numProgramBinaries();
+
+	/**
+	 * Returns number of draw calls.
+	 * @return Number of calls.
+	 */
+	size_t numDrawCalls();
+}
+
+#endif
@@ -0,0 +1,164 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Converts Alias|Wavefront OBJ models into the precompiled binary format loaded by GL::BinaryModel.
+//
+// Usage: obj2glbm [-packed] [-optimize] [-lod levels] [-stats] input.obj [output.glbm]
+//
+// With -stats, sizes of vertex data in float and packed formats are printed. Output file could be omitted in
+// this case.
+//
+#include "../gl_obj_model.h"
+#include "../gl_binary_model.h"
+#include "../gl_mesh_optimizer.h"
+#include "../gl_mesh_simplifier.h"
+#include <yip-imports/resource_loader.h>
+#include <iostream>
+#include <fstream>
+#include <exception>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+
+static void printVertexStats(const GL::ModelData & data)
+{
+	size_t numIndices = 0;
+	for (const GL::ModelData::Mesh & mesh : data.meshes)
+		numIndices += mesh.numIndices;
+
+	size_t floatSize = data.vertices.size() * sizeof(GL::Model::Vertex);
+	size_t packedSize = data.vertices.size() * sizeof(GL::Model::PackedVertex);
+
+	// Upper bound of bytes fetched per draw, assuming that vertex cache does not hit
+	size_t floatFetched = numIndices * sizeof(GL::Model::Vertex);
+	size_t packedFetched = numIndices * sizeof(GL::Model::PackedVertex);
+
+	std::cout << "Float vertices:  " << sizeof(GL::Model::Vertex) << " bytes per vertex, " << floatSize
+		<< " bytes total, up to " << floatFetched << " bytes fetched per draw." << std::endl;
+	std::cout << "Packed vertices: " << sizeof(GL::Model::PackedVertex) << " bytes per vertex, " << packedSize
+		<< " bytes total, up to " << packedFetched << " bytes fetched per draw." << std::endl;
+	if (floatSize > 0)
+	{
+		std::cout << "Packing saves " << floatSize - packedSize << " bytes ("
+			<< 100.0 * double(floatSize - packedSize) / double(floatSize) << "%)." << std::endl;
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	GL::Model::VertexFormat format = GL::Model::FloatVertexFormat;
+	bool optimize = false;
+	bool stats = false;
+	int numLods = 0;
+	const char * input = nullptr;
+	const char * output = nullptr;
+	bool validArgs = true;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-packed"))
+			format = GL::Model::PackedVertexFormat;
+		else if (!strcmp(argv[i], "-optimize"))
+			optimize = true;
+		else if (!strcmp(argv[i], "-stats"))
+			stats = true;
+		else if (!strcmp(argv[i], "-lod") && i + 1 < argc)
+			numLods = atoi(argv[++i]);
+		else if (!input)
+			input = argv[i];
+		else if (!output)
+			output = argv[i];
+		else
+			validArgs = false;
+	}
+
+	if (!validArgs || !input || (!output && !stats) || numLods < 0)
+	{
+		std::cerr << "usage: " << argv[0] << " [-packed] [-optimize] [-lod levels] [-stats] input.obj "
+			"[output.glbm]" << std::endl;
+		return 1;
+	}
+
+	try
+	{
+		GL::ModelData data;
+		GL::ObjModel::loadData(::Resource::Loader::standard(), input, data);
+
+		if (numLods > 0)
+		{
+			GL::MeshSimplifier::generateLods(data, size_t(numLods));
+			for (const GL::ModelData::Lod & lod : data.lods)
+			{
+				size_t numIndices = 0;
+				for (const GL::ModelData::Mesh & mesh : lod.meshes)
+					numIndices += mesh.numIndices;
+				std::cout << "LOD " << (&lod - data.lods.data() + 1) << ": " << numIndices / 3
+					<< " triangles, error " << lod.error << "." << std::endl;
+			}
+		}
+
+		if (optimize)
+		{
+			GL::MeshOptimizer::Report report = GL::MeshOptimizer::optimize(data);
+			std::cout << "ACMR: " << report.before.acmr << " -> " << report.after.acmr << std::endl;
+			std::cout << "ATVR: " << report.before.atvr << " -> " << report.after.atvr << std::endl;
+		}
+
+		if (output)
+		{
+			std::string tempOutput = std::string(output) + ".tmp";
+			{
+				std::ofstream file(tempOutput, std::ios::out | std::ios::binary | std::ios::trunc);
+				if (!file.is_open())
+				{
+					std::cerr << "unable to create file \"" << tempOutput << "\"." << std::endl;
+					return 1;
+				}
+				GL::BinaryModel::write(file, data, format);
+			}
+
+			remove(output);
+			if (rename(tempOutput.c_str(), output) != 0)
+			{
+				std::cerr << "unable to rename \"" << tempOutput << "\" to \"" << output << "\"." << std::endl;
+				remove(tempOutput.c_str());
+				return 1;
+			}
+		}
+
+		size_t numIndices = 0;
+		for (const GL::ModelData::Mesh & mesh : data.meshes)
+			numIndices += mesh.numIndices;
+		std::cout << data.vertices.size() << " vertices, " << numIndices / 3 << " triangles, "
+			<< data.meshes.size() << " meshes." << std::endl;
+
+		if (stats)
+			printVertexStats(data);
+	}
+	catch (const std::exception & e)
+	{
+		std::cerr << input << ": " << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,190 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Compares GL::ObjParser with ModelOBJ::import from the dhpoware-modelobj package, which is used by
+// GL::ObjModel by default. Both loaders are timed on the same file and the resulting GL::ModelData structures
+// are compared field by field.
+//
+// Usage: obj_parser_benchmark [-iterations n] [-threads n] model.obj
+//
+#include "../gl_obj_parser.h"
+#include "../gl_obj_model.h"
+#include "../gl_model_data.h"
+#include <yip-imports/resource_loader.h>
+#include <algorithm>
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+
+static size_t g_Mismatches;
+static const char * g_Comparison;
+
+static void mismatch(const std::string & what)
+{
+	if (g_Mismatches++ < 20)
+		std::cout << "Mismatch (" << g_Comparison << "): " << what << '.' << std::endl;
+}
+
+template <class TYPE> static void compare(const std::string & what, const TYPE & legacy, const TYPE & parsed)
+{
+	if (!(legacy == parsed))
+		mismatch(what);
+}
+
+static void compare(const std::string & what, const float * legacy, const float * parsed, size_t count)
+{
+	if (memcmp(legacy, parsed, count * sizeof(float)) != 0)
+		mismatch(what);
+}
+
+static void compareData(const GL::ModelData & legacy, const GL::ModelData & parsed)
+{
+	compare("center", legacy.center, parsed.center, 3);
+	compare("size", legacy.size, parsed.size, 3);
+	compare("radius", legacy.radius, parsed.radius);
+	compare("hasPositions", legacy.hasPositions, parsed.hasPositions);
+	compare("hasTexCoords", legacy.hasTexCoords, parsed.hasTexCoords);
+	compare("hasNormals", legacy.hasNormals, parsed.hasNormals);
+	compare("hasTangents", legacy.hasTangents, parsed.hasTangents);
+
+	compare("number of vertices", legacy.vertices.size(), parsed.vertices.size());
+	for (size_t i = 0; i < std::min(legacy.vertices.size(), parsed.vertices.size()); i++)
+	{
+		if (memcmp(&legacy.vertices[i], &parsed.vertices[i], sizeof(GL::Model::Vertex)) != 0)
+			mismatch("vertex " + std::to_string(i));
+	}
+
+	compare("number of indices", legacy.indices.size(), parsed.indices.size());
+	for (size_t i = 0; i < std::min(legacy.indices.size(), parsed.indices.size()); i++)
+		compare("index " + std::to_string(i), legacy.indices[i], parsed.indices[i]);
+
+	compare("number of materials", legacy.materials.size(), parsed.materials.size());
+	for (size_t i = 0; i < std::min(legacy.materials.size(), parsed.materials.size()); i++)
+	{
+		const GL::ModelData::Material & a = legacy.materials[i];
+		const GL::ModelData::Material & b = parsed.materials[i];
+		std::string prefix = "material " + std::to_string(i) + ' ';
+		compare(prefix + "ambient", a.ambient, b.ambient, 4);
+		compare(prefix + "diffuse", a.diffuse, b.diffuse, 4);
+		compare(prefix + "specular", a.specular, b.specular, 4);
+		compare(prefix + "shininess", a.shininess, b.shininess);
+		compare(prefix + "opacity", a.opacity, b.opacity);
+		compare(prefix + "texture", a.texture, b.texture);
+		compare(prefix + "normal map", a.normalMap, b.normalMap);
+	}
+
+	compare("number of meshes", legacy.meshes.size(), parsed.meshes.size());
+	for (size_t i = 0; i < std::min(legacy.meshes.size(), parsed.meshes.size()); i++)
+	{
+		const GL::ModelData::Mesh & a = legacy.meshes[i];
+		const GL::ModelData::Mesh & b = parsed.meshes[i];
+		std::string prefix = "mesh " + std::to_string(i) + ' ';
+		compare(prefix + "material", a.materialIndex, b.materialIndex);
+		compare(prefix + "first index", a.firstIndex, b.firstIndex);
+		compare(prefix + "number of indices", a.numIndices, b.numIndices);
+	}
+}
+
+// Returns the best time of several runs in milliseconds
+template <class FUNC> static double measure(int iterations, FUNC func)
+{
+	double best = 0.0;
+	for (int i = 0; i < iterations; i++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		func();
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		if (i == 0 || elapsed.count() < best)
+			best = elapsed.count();
+	}
+	return best;
+}
+
+int main(int argc, char ** argv)
+{
+	int iterations = 5;
+	size_t numThreads = 0;
+	const char * input = nullptr;
+	bool validArgs = true;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-iterations") && i + 1 < argc)
+			iterations = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-threads") && i + 1 < argc)
+			numThreads = size_t(atoi(argv[++i]));
+		else if (!input)
+			input = argv[i];
+		else
+			validArgs = false;
+	}
+
+	if (!validArgs || !input || iterations <= 0)
+	{
+		std::cerr << "usage: " << argv[0] << " [-iterations n] [-threads n] model.obj" << std::endl;
+		return 1;
+	}
+
+	try
+	{
+		::Resource::Loader & loader = ::Resource::Loader::standard();
+		GL::ModelData legacy, parsed, singleThreaded;
+
+		double legacyTime = measure(iterations, [&]() { GL::ObjModel::loadData(loader, input, legacy); });
+
+		GL::ObjParser serialParser(1);
+		double serialTime = measure(iterations, [&]() { serialParser.parse(loader, input, singleThreaded); });
+
+		GL::ObjParser parser(numThreads);
+		double parallelTime = measure(iterations, [&]() { parser.parse(loader, input, parsed); });
+
+		size_t numIndices = parsed.indices.size();
+		std::cout << parsed.vertices.size() << " vertices, " << numIndices / 3 << " triangles, "
+			<< parsed.meshes.size() << " meshes." << std::endl;
+		std::cout << "ModelOBJ::import:      " << legacyTime << " ms." << std::endl;
+		std::cout << "ObjParser (1 thread):  " << serialTime << " ms, " << legacyTime / serialTime << "x."
+			<< std::endl;
+		std::cout << "ObjParser (" << parser.numThreads() << " threads): " << parallelTime << " ms, "
+			<< legacyTime / parallelTime << "x." << std::endl;
+
+		g_Comparison = "1 thread";
+		compareData(legacy, singleThreaded);
+		g_Comparison = "multiple threads";
+		compareData(legacy, parsed);
+	}
+	catch (const std::exception & e)
+	{
+		std::cerr << input << ": " << e.what() << std::endl;
+		return 1;
+	}
+
+	if (g_Mismatches > 0)
+	{
+		std::cout << g_Mismatches << " mismatches." << std::endl;
+		return 1;
+	}
+
+	std::cout << "Results are identical." << std::endl;
+	return 0;
+}
@@ -0,0 +1,260 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Tests GL::PixelPacker: packed pixels (produced with SSE2 or NEON when available) are compared with a scalar
+// reference for all formats, with and without dithering. Also checks that dithering preserves average color
+// of flat areas, reports PSNR of each format on a smooth gradient and on noise and measures speed of packing.
+//
+// Usage: pixel_packer_test [size]
+//
+#include "check.h"
+#include "../gl_pixel_packer.h"
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+static const char * const g_FormatNames[] = { "Unpacked", "RGB565  ", "RGBA4444", "RGBA5551" };
+
+// Number of bits of R, G, B and A channels in the packed formats (from the highest bits to the lowest)
+static const int g_FormatBits[][4] = { { 8, 8, 8, 8 }, { 5, 6, 5, 0 }, { 4, 4, 4, 4 }, { 5, 5, 5, 1 } };
+
+static const int g_BayerMatrix[4][4] = {
+	{ 0, 8, 2, 10 },
+	{ 12, 4, 14, 6 },
+	{ 3, 11, 1, 9 },
+	{ 15, 7, 13, 5 },
+};
+
+// Straightforward per-pixel conversion with rounding or ordered dithering; 1-bit channels are truncated
+static GL::UShort referencePixel(GL::PixelPacker::Format format, bool dither, const GL::UByte * pixel,
+	int channels, int x, int y)
+{
+	unsigned result = 0;
+	int position = 16;
+	for (int c = 0; c < 4; c++)
+	{
+		int bits = g_FormatBits[format][c];
+		if (bits == 0)
+			continue;
+
+		int shift = 8 - bits;
+		int bias = 0;
+		if (bits > 1)
+			bias = (dither ? ((2 * g_BayerMatrix[y & 3][x & 3] + 1) << shift) >> 5 : (1 << shift) >> 1);
+
+		int value = std::min((c < channels ? int(pixel[c]) : 255) + bias, 255);
+		position -= bits;
+		result |= unsigned(value >> shift) << position;
+	}
+	return GL::UShort(result);
+}
+
+static std::vector<GL::UByte> randomPixels(int width, int height, int channels, unsigned seed)
+{
+	std::mt19937 random(seed);
+	std::vector<GL::UByte> pixels(size_t(width) * size_t(height) * size_t(channels));
+	for (GL::UByte & pixel : pixels)
+		pixel = GL::UByte(random() & 0xFF);
+	return pixels;
+}
+
+// Horizontal gradient in all channels
+static std::vector<GL::UByte> gradientPixels(int width, int height, int channels)
+{
+	std::vector<GL::UByte> pixels(size_t(width) * size_t(height) * size_t(channels));
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			for (int c = 0; c < channels; c++)
+				pixels[size_t((y * width + x) * channels + c)] = GL::UByte(x * 256 / width);
+		}
+	}
+	return pixels;
+}
+
+static void testAgainstReference()
+{
+	// Odd widths exercise the scalar tail after the vectorized part of each row
+	const int sizes[][2] = { { 64, 8 }, { 37, 5 }, { 7, 3 }, { 1, 1 } };
+	for (int format = GL::PixelPacker::RGB565Format; format <= GL::PixelPacker::RGBA5551Format; format++)
+	{
+		for (int dither = 0; dither < 2; dither++)
+		{
+			GL::PixelPacker packer(GL::PixelPacker::Format(format), dither != 0);
+			for (const int * size : sizes)
+			{
+				for (int channels = 3; channels <= 4; channels++)
+				{
+					int width = size[0], height = size[1], originX = 3, originY = 1;
+					std::vector<GL::UByte> pixels = randomPixels(width, height, channels, unsigned(format * 4));
+					std::vector<GL::UShort> packed;
+					packer.pack(pixels.data(), width, height, channels, packed, originX, originY);
+					CHECK(packed.size() == size_t(width) * size_t(height));
+
+					size_t mismatches = 0;
+					for (int y = 0; y < height && packed.size() == size_t(width * height); y++)
+					{
+						for (int x = 0; x < width; x++)
+						{
+							const GL::UByte * pixel = &pixels[size_t((y * width + x) * channels)];
+							GL::UShort expected = referencePixel(GL::PixelPacker::Format(format), dither != 0,
+								pixel, channels, originX + x, originY + y);
+							if (packed[size_t(y * width + x)] != expected)
+								++mismatches;
+						}
+					}
+					CHECK(mismatches == 0);
+				}
+			}
+		}
+	}
+}
+
+static void testUnpack()
+{
+	// Minimum and maximum values of each channel are restored exactly
+	for (int format = GL::PixelPacker::RGB565Format; format <= GL::PixelPacker::RGBA5551Format; format++)
+	{
+		GL::PixelPacker packer(GL::PixelPacker::Format(format), false);
+		const GL::UShort packed[] = { 0x0000, 0xFFFF };
+		std::vector<GL::UByte> unpacked;
+		packer.unpack(packed, 2, unpacked);
+		CHECK(unpacked.size() == 8);
+		if (unpacked.size() != 8)
+			continue;
+
+		bool hasAlpha = (g_FormatBits[format][3] > 0);
+		CHECK(unpacked[0] == 0 && unpacked[1] == 0 && unpacked[2] == 0 && unpacked[3] == (hasAlpha ? 0 : 255));
+		CHECK(unpacked[4] == 255 && unpacked[5] == 255 && unpacked[6] == 255 && unpacked[7] == 255);
+	}
+
+	// RGB565 with pure red, green and blue
+	GL::PixelPacker packer(GL::PixelPacker::RGB565Format, false);
+	const GL::UShort packed[] = { 0xF800, 0x07E0, 0x001F };
+	std::vector<GL::UByte> unpacked;
+	packer.unpack(packed, 3, unpacked);
+	const GL::UByte expected[] = { 255, 0, 0, 255,  0, 255, 0, 255,  0, 0, 255, 255 };
+	CHECK(unpacked == std::vector<GL::UByte>(expected, expected + 12));
+
+	// Lossless conversion has infinite PSNR
+	const GL::UByte white[] = { 255, 255, 255, 255,  0, 0, 0, 0 };
+	CHECK(std::isinf(GL::PixelPacker(GL::PixelPacker::RGBA4444Format).psnr(white, 2, 1, 4)));
+	CHECK(std::isinf(GL::PixelPacker().psnr(white, 2, 1, 4)));
+}
+
+static void testDithering()
+{
+	// 100 lies between the 5-bit levels 99 and 107: rounding always picks 107, dithering mixes both levels and
+	// brings average color of the area closer to the original
+	std::vector<GL::UByte> pixels(16 * 16 * 3, 100);
+	double error[2];
+	for (int dither = 0; dither < 2; dither++)
+	{
+		GL::PixelPacker packer(GL::PixelPacker::RGB565Format, dither != 0);
+		std::vector<GL::UShort> packed;
+		std::vector<GL::UByte> unpacked;
+		packer.pack(pixels.data(), 16, 16, 3, packed);
+		packer.unpack(packed.data(), packed.size(), unpacked);
+
+		size_t numLow = 0, numHigh = 0;
+		double sum = 0.0;
+		for (size_t i = 0; i < unpacked.size(); i += 4)
+		{
+			numLow += (unpacked[i] == 99);
+			numHigh += (unpacked[i] == 107);
+			sum += unpacked[i];
+		}
+		error[dither] = std::fabs(sum / double(packed.size()) - 100.0);
+		CHECK(numLow + numHigh == packed.size());
+		CHECK(dither ? numLow > 0 && numHigh > 0 : numHigh == packed.size());
+	}
+	CHECK(error[1] < error[0]);
+}
+
+static void reportPSNR()
+{
+	// Images are opaque, so that 1-bit alpha of RGBA5551Format does not dominate the error
+	std::vector<GL::UByte> gradient = gradientPixels(256, 64, 3);
+	std::vector<GL::UByte> noise = randomPixels(256, 64, 3, 0);
+
+	std::cout << "PSNR (dB)            gradient   gradient, dithered   noise" << std::endl;
+	for (int format = GL::PixelPacker::RGB565Format; format <= GL::PixelPacker::RGBA5551Format; format++)
+	{
+		GL::PixelPacker rounded(GL::PixelPacker::Format(format), false);
+		GL::PixelPacker dithered(GL::PixelPacker::Format(format), true);
+		double plainGradient = rounded.psnr(gradient.data(), 256, 64, 3);
+		double ditheredGradient = dithered.psnr(gradient.data(), 256, 64, 3);
+		double ditheredNoise = dithered.psnr(noise.data(), 256, 64, 3);
+		std::cout << g_FormatNames[format] << "             " << plainGradient << "    " << ditheredGradient
+			<< "              " << ditheredNoise << std::endl;
+
+		// Dithering trades some PSNR for the absence of banding, but the loss is bounded
+		CHECK(plainGradient > 20.0 && ditheredGradient > 20.0 && ditheredNoise > 20.0);
+		CHECK(ditheredGradient > plainGradient - 6.0);
+	}
+}
+
+static void measure(int size)
+{
+	std::vector<GL::UByte> pixels = randomPixels(size, size, 4, 1);
+	std::vector<GL::UShort> packed;
+	for (int format = GL::PixelPacker::RGB565Format; format <= GL::PixelPacker::RGBA5551Format; format++)
+	{
+		GL::PixelPacker packer(GL::PixelPacker::Format(format), true);
+		double best = 0.0;
+		for (int i = 0; i < 3; i++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			packer.pack(pixels.data(), size, size, 4, packed);
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+			if (i == 0 || elapsed.count() < best)
+				best = elapsed.count();
+		}
+		std::cout << g_FormatNames[format] << ": " << best << " ms, "
+			<< double(size) * double(size) / (best * 1000.0) << " Mpixels/s." << std::endl;
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	int size = (argc > 1 ? atoi(argv[1]) : 1024);
+	if (argc > 2 || size <= 0)
+	{
+		std::cerr << "usage: " << argv[0] << " [size]" << std::endl;
+		return 1;
+	}
+
+	testAgainstReference();
+	testUnpack();
+	testDithering();
+	reportPSNR();
+
+	std::cout << size << 'x' << size << " RGBA image." << std::endl;
+	measure(size);
+
+	return reportChecks();
+}
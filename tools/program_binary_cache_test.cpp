@@ -0,0 +1,233 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Tests GL::ProgramBinaryCache against simulated drivers that accept and reject program binaries.
+//
+// Usage: program_binary_cache_test
+//
+#include "check.h"
+#include "mock_gl.h"
+#include "../gl_program_binary_cache.h"
+#include "../gl_resource_manager.h"
+#include "../gl_program.h"
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <map>
+
+static const char g_ProgramSource[] =
+	"%vertex\n"
+	"attribute vec4 a_position;\n"
+	"void main() { gl_Position = a_position; }\n"
+	"%fragment\n"
+	"void main() { gl_FragColor = vec4(1.0); }\n";
+
+static const char g_IncludingProgramSource[] =
+	"%vertex shader.vert\n"
+	"%fragment shader.frag\n";
+
+namespace
+{
+	// Keeps binaries in memory instead of files
+	class MemoryCache : public GL::ProgramBinaryCache
+	{
+	public:
+		size_t writes = 0;
+
+	protected:
+		bool readBinary(const std::string & key, GL::Enum * format, std::vector<char> & data) override
+		{
+			auto it = m_Binaries.find(key);
+			if (it == m_Binaries.end())
+				return false;
+			*format = it->second.first;
+			data = it->second.second;
+			return true;
+		}
+
+		void writeBinary(const std::string & key, GL::Enum format, const std::vector<char> & data) override
+		{
+			m_Binaries[key] = std::make_pair(format, data);
+			++writes;
+		}
+
+	private:
+		std::map<std::string, std::pair<GL::Enum, std::vector<char>>> m_Binaries;
+	};
+
+	// Serves shader files from memory and counts how many times each of them is opened
+	class CountingLoader : public ::Resource::Loader
+	{
+	public:
+		std::map<std::string, size_t> opens;
+
+		::Resource::StreamPtr openResource(const std::string & name) override
+		{
+			++opens[name];
+			if (name == "shader.vert")
+				return std::make_shared<std::istringstream>("void main() { gl_Position = vec4(0.0); }\n");
+			if (name == "shader.frag")
+				return std::make_shared<std::istringstream>("void main() { gl_FragColor = vec4(1.0); }\n");
+			throw std::runtime_error("unable to open \"" + name + "\".");
+		}
+	};
+
+	// Simulates the extension without calling OpenGL
+	class SimulatedDriverCache : public MemoryCache
+	{
+	public:
+		bool accept = true;
+
+		bool isSupported() const override { return true; }
+
+	protected:
+		bool programBinary(GL::Program &, GL::Enum format, const std::vector<char> & data) override
+		{
+			return accept && format == 1 && data == binary();
+		}
+
+		bool getProgramBinary(const GL::Program &, GL::Enum * format, std::vector<char> & data) override
+		{
+			*format = 1;
+			data = binary();
+			return true;
+		}
+
+	private:
+		static std::vector<char> binary() { return std::vector<char>(16, 'b'); }
+	};
+}
+
+// Tests bookkeeping of the cache using the overridable hooks
+static void testHooks()
+{
+	GL::ResourceManager manager;
+	GL::ProgramPtr program = manager.createProgram();
+	SimulatedDriverCache cache;
+
+	CHECK(!cache.load("key", *program));
+	CHECK(cache.misses() == 1);
+
+	cache.store("key", *program);
+	CHECK(cache.writes == 1);
+
+	CHECK(cache.load("key", *program));
+	CHECK(cache.hits() == 1);
+
+	cache.accept = false;
+	CHECK(!cache.load("key", *program));
+	CHECK(cache.rejections() == 1);
+	CHECK(cache.hits() == 1);
+	CHECK(cache.misses() == 1);
+}
+
+// Simulates application launch: loads the program through the resource manager and checks its link status
+static bool launch(const std::shared_ptr<MemoryCache> & cache, bool batch)
+{
+	GL::ResourceManager manager;
+	manager.setProgramBinaryCache(cache);
+	MockGL::resetCounters();
+
+	GL::ProgramPtr program = manager.createProgram();
+	if (!batch)
+		program->initFromSource(g_ProgramSource);
+	else
+	{
+		manager.beginBatch();
+		size_t writes = cache->writes;
+		program->initFromSource(g_ProgramSource);
+		CHECK(cache->writes == writes);
+		manager.endBatch();
+	}
+
+	return program->linkStatus();
+}
+
+// Tests fallback to compilation when the mock driver rejects binaries
+static void testResourceManager(bool batch)
+{
+	std::shared_ptr<MemoryCache> cache = std::make_shared<MemoryCache>();
+	MockGL::setAcceptProgramBinaries(true);
+
+	// First launch: cache is empty, program is compiled and stored
+	CHECK(launch(cache, batch));
+	CHECK(cache->misses() == 1);
+	CHECK(cache->writes == 1);
+	CHECK(MockGL::numCompiles() == 2);
+	CHECK(MockGL::numLinks() == 1);
+
+	// Second launch: program is loaded from the binary
+	CHECK(launch(cache, batch));
+	CHECK(cache->hits() == 1);
+	CHECK(cache->writes == 1);
+	CHECK(MockGL::numProgramBinaries() == 1);
+	CHECK(MockGL::numCompiles() == 0);
+	CHECK(MockGL::numLinks() == 0);
+
+	// Third launch: driver has been updated and rejects the binary, program is compiled and stored again
+	MockGL::setAcceptProgramBinaries(false);
+	CHECK(launch(cache, batch));
+	CHECK(cache->rejections() == 1);
+	CHECK(cache->writes == 2);
+	CHECK(MockGL::numProgramBinaries() == 1);
+	CHECK(MockGL::numCompiles() == 2);
+	CHECK(MockGL::numLinks() == 1);
+}
+
+// Checks that shader files included by the program are loaded only once when the cache misses
+static void testIncludedFiles()
+{
+	CountingLoader loader;
+	std::shared_ptr<MemoryCache> cache = std::make_shared<MemoryCache>();
+	MockGL::setAcceptProgramBinaries(true);
+
+	GL::ResourceManager manager(loader);
+	manager.setProgramBinaryCache(cache);
+	MockGL::resetCounters();
+
+	GL::ProgramPtr program = manager.createProgram();
+	program->initFromSource(g_IncludingProgramSource);
+	CHECK(program->linkStatus());
+	CHECK(cache->misses() == 1);
+	CHECK(cache->writes == 1);
+	CHECK(MockGL::numCompiles() == 2);
+	CHECK(loader.opens["shader.vert"] == 1);
+	CHECK(loader.opens["shader.frag"] == 1);
+
+	// Shaders are now cached by the resource manager, only sources for the cache key are loaded
+	program = manager.createProgram();
+	program->initFromSource(g_IncludingProgramSource);
+	CHECK(program->linkStatus());
+	CHECK(cache->hits() == 1);
+	CHECK(loader.opens["shader.vert"] == 2);
+	CHECK(loader.opens["shader.frag"] == 2);
+}
+
+int main()
+{
+	testHooks();
+	testResourceManager(false);
+	testResourceManager(true);
+	testIncludedFiles();
+
+	return reportChecks();
+}
@@ -0,0 +1,92 @@
+/* vim: set ai noet ts=4 sw=4 tw=115: */
+//
+// Copyright (c) 2014 Nikolay Zapolnov (zapolnov@gmail.com).
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Measures how many sprites per second GL::SpriteBatch accepts on the CPU side, against the mock OpenGL
+// implementation. Each frame draws the specified number of sprites that cycle through the specified number
+// of textures, with and without sorting by texture.
+//
+// Usage: sprite_batch_benchmark [sprites-per-frame] [textures] [frames]
+//
+#include "mock_gl.h"
+#include "../gl_resource_manager.h"
+#include "../gl_sprite_batch.h"
+#include "../gl_texture.h"
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+static void run(size_t numSprites, size_t numTextures, size_t numFrames, bool sortByTexture)
+{
+	GL::ResourceManager manager;
+	GL::SpriteBatch batch(&manager);
+	batch.setAttribs(0, 1, 2);
+	batch.setSortByTexture(sortByTexture);
+
+	std::vector<GL::TexturePtr> textures;
+	for (size_t i = 0; i < numTextures; i++)
+		textures.push_back(manager.createTexture());
+
+	// Consecutive sprites use the same texture in runs of four
+	MockGL::resetCounters();
+	auto start = std::chrono::steady_clock::now();
+
+	for (size_t frame = 0; frame < numFrames; frame++)
+	{
+		for (size_t i = 0; i < numSprites; i++)
+		{
+			float x = float(i % 64) * 16.0f, y = float(i / 64) * 16.0f;
+			const GL::TexturePtr & texture = textures[(i / 4) % numTextures];
+			batch.draw(texture, x, y, 16.0f, 16.0f, 0.0f, 0.0f, 1.0f, 1.0f, GL::SpriteBatch::White,
+				float(frame) * 0.01f);
+		}
+		batch.flush();
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	double spritesPerSecond = double(numSprites * numFrames) / elapsed.count();
+
+	std::cout << (sortByTexture ? "Sorted:   " : "Unsorted: ") << spritesPerSecond / 1e6 << " million sprites/s, "
+		<< elapsed.count() * 1000.0 / double(numFrames) << " ms per frame, "
+		<< double(MockGL::numDrawCalls()) / double(numFrames) << " draw calls per frame." << std::endl;
+}
+
+int main(int argc, char ** argv)
+{
+	int numSprites = (argc > 1 ? atoi(argv[1]) : 10000);
+	int numTextures = (argc > 2 ? atoi(argv[2]) : 4);
+	int numFrames = (argc > 3 ? atoi(argv[3]) : 100);
+
+	if (argc > 4 || numSprites <= 0 || numTextures <= 0 || numFrames <= 0)
+	{
+		std::cerr << "usage: " << argv[0] << " [sprites-per-frame] [textures] [frames]" << std::endl;
+		return 1;
+	}
+
+	std::cout << numSprites << " sprites per frame, " << numTextures << " textures, " << numFrames << " frames."
+		<< std::endl;
+
+	run(size_t(numSprites), size_t(numTextures), size_t(numFrames), false);
+	run(size_t(numSprites), size_t(numTextures), size_t(numFrames), true);
+
+	return 0;
+}